@@ -10,8 +10,35 @@
 #include <getopt.h>   
 #include <time.h>     
 #include <sys/select.h>    
+#include <poll.h>
+#include <stdint.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+#endif
 #include "com_uart_port.h"
 
+#if defined(__linux__) && defined(TCGETS2) && \
+    (defined(__x86_64__) || defined(__i386__) || defined(__arm__) || defined(__aarch64__) || defined(__riscv))
+/* <asm/termbits.h> clashes with <termios.h>, the generic kernel layout of termios2 */
+struct termios2 {
+	tcflag_t c_iflag;
+	tcflag_t c_oflag;
+	tcflag_t c_cflag;
+	tcflag_t c_lflag;
+	cc_t c_line;
+	cc_t c_cc[19];
+	speed_t c_ispeed;
+	speed_t c_ospeed;
+};
+#ifndef BOTHER
+#define BOTHER 0010000
+#endif
+#define COM_HAVE_TERMIOS2 1
+#else
+#define COM_HAVE_TERMIOS2 0
+#endif
+
 int setOpt(int fd, int nSpeed, int nBits, int nParity, int nStop)
 {
     struct termios newtio, oldtio;
@@ -111,14 +138,14 @@ int setOpt(int fd, int nSpeed, int nBits, int nParity, int nStop)
             cfsetospeed(&newtio, B230400);
             break;
         default:
-            printf("\tSorry, Unsupported baud rate, set default 9600!\n\n");
+            // 非标准波特率在tcsetattr之后用termios2设置
             cfsetispeed(&newtio, B9600);
             cfsetospeed(&newtio, B9600);
             break;
     }
-    // 设置read读取最小字节数和超时时间
-    newtio.c_cc[VTIME] = 1; // 读取一个字符等待1*(1/10)s
-    newtio.c_cc[VMIN] = 1;  // 读取字符的最少个数为1
+    // read不等待: 超时由poll控制, read取走驱动里已有的全部字节
+    newtio.c_cc[VTIME] = 0;
+    newtio.c_cc[VMIN] = 0;
 
       tcflush(fd,TCIFLUSH); //清空缓冲区
       if (tcsetattr(fd, TCSANOW, &newtio) != 0)    //激活新设置
@@ -126,73 +153,269 @@ int setOpt(int fd, int nSpeed, int nBits, int nParity, int nStop)
         perror("SetupSerial 3");
           return -1;
      }
+
+    if (cfgetospeed(&newtio) == B9600 && nSpeed != 9600)
+    {
+        if (com_set_custom_baud(fd, nSpeed) != 0)
+        {
+            perror("SetupSerial custom baud rate");
+            return -1;
+        }
+    }
       printf("Serial set done!\n");
     return 0;
 }
 
-int com_recv(int fd, char *rcv_buf, int data_len, int timeout)
+
+/* Any baud rate the UART can divide down to, through termios2 (BOTHER) */
+int com_set_custom_baud(int fd, uint32_t baudrate)
 {
-    int len, fs_sel;
-    fd_set fs_read;
-    struct timeval time;
+#if COM_HAVE_TERMIOS2
+	struct termios2 tio2;
 
-    if(timeout >=0)
-    {
-	    time.tv_sec = timeout / 1000;              //set the rcv wait time
-	    time.tv_usec = timeout % 1000 * 1000;    //100000us = 0.1s
-    }
+	if (ioctl(fd, TCGETS2, &tio2) != 0)
+		return -1;
+
+	tio2.c_cflag &= ~CBAUD;
+	tio2.c_cflag |= BOTHER;
+	tio2.c_ispeed = baudrate;
+	tio2.c_ospeed = baudrate;
 
+	return ioctl(fd, TCSETS2, &tio2);
+#else
+	errno = ENOTSUP;
+	return -1;
+#endif
+}
 
-    FD_ZERO(&fs_read);        //每次循环都要清空集合，否则不能检测描述符变化
-    FD_SET(fd, &fs_read);    //添加描述符
 
-    // 超时等待读变化，>0：就绪描述字的正数目， -1：出错， 0 ：超时
-    if(timeout >=0)
-    {
-	    fs_sel = select(fd + 1, &fs_read, NULL, NULL, &time);
-    }
-    else
-    {
+/* The driver passes received bytes up without its FIFO/latency timer delay (8250, ftdi_sio) */
+int com_set_low_latency(int fd, int on)
+{
+#if defined(__linux__) && defined(TIOCGSERIAL)
+	struct serial_struct serial;
+
+	if (ioctl(fd, TIOCGSERIAL, &serial) != 0)
+		return -1;
 
-	    fs_sel = select(fd + 1, &fs_read, NULL, NULL, NULL);
+	if (on)
+		serial.flags |= ASYNC_LOW_LATENCY;
+	else
+		serial.flags &= ~ASYNC_LOW_LATENCY;
 
-    }
-    //    printf("fs_sel = %d\n", fs_sel);
-    if(fs_sel)
-    {
-	    len = read(fd, rcv_buf, data_len);
-	    return len;
-    }
-    else
-    {
-	    printf("Sorry,I am wrong!");
-	    return -1;
-    }
+	return ioctl(fd, TIOCSSERIAL, &serial);
+#else
+	errno = ENOTSUP;
+	return -1;
+#endif
 }
 
-int com_send(int fd, char *send_buf, int data_len)
+static int64_t com_now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+
+/* Milliseconds left until deadline for poll(), -1 waits forever */
+static int com_remaining(int64_t deadline)
 {
-	ssize_t ret = 0;
+	int64_t left;
 
-	ret = write(fd, send_buf, data_len);
-	if (ret == data_len)
+	if (deadline < 0)
+		return -1;
+
+	left = deadline - com_now_ms();
+	return left > 0 ? (int)left : 0;
+}
+
+
+/* Waits at most timeout ms (-1 forever) for data, returns what the driver has, up to data_len.
+   0 on timeout, -1 on error. */
+int com_recv(int fd, char *rcv_buf, int data_len, int timeout)
+{
+	struct pollfd pfd;
+	int rc;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+
+	// 超时等待读变化，>0：就绪， -1：出错， 0 ：超时
+	while ((rc = poll(&pfd, 1, timeout)) == -1 && errno == EINTR)
 	{
-		//printf("send data is %s\n", send_buf);
-		return ret;
 	}
-	else
+	if (rc <= 0)
+		return rc;
+
+	while ((rc = read(fd, rcv_buf, data_len)) == -1 && errno == EINTR)
+	{
+	}
+	if (rc == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		return 0;
+	if (rc == 0 && (pfd.revents & POLLHUP))
+	{
+		errno = EIO;
+		return -1;
+	}
+
+	return rc;
+}
+
+
+/* Writes all of send_buf, a short write is continued once the driver has room again */
+int com_send(int fd, char *send_buf, int data_len)
+{
+	int sent = 0;
+
+	while (sent < data_len)
 	{
+		ssize_t ret = write(fd, send_buf + sent, data_len - sent);
+
+		if (ret > 0)
+		{
+			sent += ret;
+			continue;
+		}
+		if (ret == -1 && errno == EINTR)
+			continue;
+		if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			struct pollfd pfd;
+			int rc;
+
+			// 发送缓冲满，等待可写
+			pfd.fd = fd;
+			pfd.events = POLLOUT;
+			while ((rc = poll(&pfd, 1, COM_SEND_TIMEOUT)) == -1 && errno == EINTR)
+			{
+			}
+			if (rc > 0)
+				continue;
+			if (rc == 0)
+				errno = ETIMEDOUT;
+		}
+
 		printf("write device error\n");
 		tcflush(fd,TCOFLUSH);
 		return -1;
 	}
+
+	return sent;
+}
+
+
+void com_reader_init(com_reader_t *reader, int fd)
+{
+	reader->fd = fd;
+	reader->head = 0;
+	reader->tail = 0;
+}
+
+
+/* Reads what the driver has into the free end of the buffer. Returns the number of
+   bytes, 0 at the deadline, -1 on errors. */
+static int com_reader_fill(com_reader_t *reader, int64_t deadline)
+{
+	int rc;
+
+	if (reader->head == reader->tail)
+	{
+		reader->head = 0;
+		reader->tail = 0;
+	}
+	else if (reader->tail == COM_READER_SIZE)
+	{
+		memmove(reader->buf, reader->buf + reader->head, reader->tail - reader->head);
+		reader->tail -= reader->head;
+		reader->head = 0;
+	}
+
+	for (;;)
+	{
+		rc = com_recv(reader->fd, (char *)reader->buf + reader->tail,
+			      COM_READER_SIZE - reader->tail, com_remaining(deadline));
+		if (rc != 0 || com_remaining(deadline) == 0)
+			break;
+	}
+	if (rc > 0)
+		reader->tail += rc;
+
+	return rc;
+}
+
+
+/* Reads exactly len bytes, returns len or fewer when the timeout (ms, -1 forever)
+   expired first, -1 on errors */
+int com_read_exactly(com_reader_t *reader, uint8_t *dest, int len, int timeout)
+{
+	int64_t deadline = timeout < 0 ? -1 : com_now_ms() + timeout;
+	int copied = 0;
+
+	for (;;)
+	{
+		int n = reader->tail - reader->head;
+
+		if (n > len - copied)
+			n = len - copied;
+		memcpy(dest + copied, reader->buf + reader->head, n);
+		reader->head += n;
+		copied += n;
+		if (copied == len)
+			return copied;
+
+		n = com_reader_fill(reader, deadline);
+		if (n == -1)
+			return -1;
+		if (n == 0)
+			return copied;
+	}
+}
+
+
+/* Reads up to and including delimiter into dest. Returns the length, 0 when the timeout
+   (ms, -1 forever) expired first, the bytes stay buffered then. -1 with errno EMSGSIZE
+   if size bytes came without delimiter, or on errors. */
+int com_read_until(com_reader_t *reader, uint8_t *dest, int size, uint8_t delimiter, int timeout)
+{
+	int64_t deadline = timeout < 0 ? -1 : com_now_ms() + timeout;
+	int searched = 0;
+
+	for (;;)
+	{
+		int n = reader->tail - reader->head;
+		uint8_t *end;
+
+		if (n > size)
+			n = size;
+		end = memchr(reader->buf + reader->head + searched, delimiter, n - searched);
+		if (end != NULL)
+		{
+			n = end - (reader->buf + reader->head) + 1;
+			memcpy(dest, reader->buf + reader->head, n);
+			reader->head += n;
+			return n;
+		}
+		searched = n;
+		if (n == size || n == COM_READER_SIZE)
+		{
+			errno = EMSGSIZE;
+			return -1;
+		}
+
+		n = com_reader_fill(reader, deadline);
+		if (n <= 0)
+			return n;
+	}
 }
 
 int32_t init_com_port(enum COM_PORT port,uint32_t baudrate)
 {
 	int fdSerial;
 
-	// 打开串口设备
+	// 打开串口设备, 非阻塞: 读写的等待由poll完成
 	fdSerial = open(DEV_NAME, O_RDWR | O_NOCTTY | O_NDELAY);
 	if(fdSerial < 0)
 	{
@@ -200,16 +423,6 @@ int32_t init_com_port(enum COM_PORT port,uint32_t baudrate)
 		return -1;
 	}
 
-	// 设置串口阻塞， 0：阻塞， FNDELAY：非阻塞
-	if (fcntl(fdSerial, F_SETFL, 0) < 0)    //阻塞，即使前面在open串口设备时设置的是非阻塞的
-	{
-		printf("fcntl failed!\n");
-	}
-	else
-	{
-		printf("fcntl=%d\n", fcntl(fdSerial, F_SETFL, 0));
-	}
-
 	if (isatty(fdSerial) == 0)
 	{
 		printf("standard input is not a terminal device\n");
@@ -231,8 +444,10 @@ int32_t init_com_port(enum COM_PORT port,uint32_t baudrate)
 		exit(1);
 	}
 
+	// USB串口等驱动不支持时忽略
+	com_set_low_latency(fdSerial, 1);
+
 	tcflush(fdSerial, TCIOFLUSH);    //清掉串口缓存
-	fcntl(fdSerial, F_SETFL, 0);    //串口阻塞
 
 
 	return fdSerial;
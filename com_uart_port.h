@@ -38,6 +38,25 @@ enum COM_PORT {
 //#define DEV_NAME    "/dev/ttyS26"    ///< 串口设备
 #define DEV_NAME    "/dev/ttyS9"    ///< 串口设备
 
+/* Longest wait of com_send() for room in the driver, ms */
+#define COM_SEND_TIMEOUT    1000
+/* Receive buffer of com_read_exactly()/com_read_until() */
+#define COM_READER_SIZE     4096
+
+/* Buffered reads of a port, bytes after the requested ones stay for the next call */
+typedef struct com_reader {
+	int fd;
+	int head;
+	int tail;
+	uint8_t buf[COM_READER_SIZE];
+} com_reader_t;
+
 extern int32_t init_com_port(enum COM_PORT port,uint32_t baudrate);
 extern int com_recv(int fd, char *rcv_buf, int data_len, int timeout);
 extern int com_send(int fd, char *send_buf, int data_len);
+extern int com_set_custom_baud(int fd, uint32_t baudrate);
+extern int com_set_low_latency(int fd, int on);
+
+extern void com_reader_init(com_reader_t *reader, int fd);
+extern int com_read_exactly(com_reader_t *reader, uint8_t *dest, int len, int timeout);
+extern int com_read_until(com_reader_t *reader, uint8_t *dest, int size, uint8_t delimiter, int timeout);
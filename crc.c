@@ -0,0 +1,263 @@
+#include "crc.h"
+
+#if CRC_CFG_SLICE_BY8
+#define CRC_TABLE_SLICES 8
+#else
+#define CRC_TABLE_SLICES 1
+#endif
+
+#include "crc_tables.h"
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32_ARM_ACLE 1
+#elif CRC_CFG_PCLMUL && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CRC32_PCLMUL 1
+#endif
+
+
+static inline uint32_t load_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+uint16_t crc16_modbus_update(uint16_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+#if CRC_CFG_SLICE_BY8
+    while (len >= 8) {
+        const uint16_t first = crc ^ (uint16_t)(p[0] | (p[1] << 8));
+        crc = crc16_modbus_table[7][first & 0xFF] ^ crc16_modbus_table[6][first >> 8]
+            ^ crc16_modbus_table[5][p[2]] ^ crc16_modbus_table[4][p[3]]
+            ^ crc16_modbus_table[3][p[4]] ^ crc16_modbus_table[2][p[5]]
+            ^ crc16_modbus_table[1][p[6]] ^ crc16_modbus_table[0][p[7]];
+        p += 8;
+        len -= 8;
+    }
+#endif
+    while (len--) {
+        crc = (crc >> 8) ^ crc16_modbus_table[0][(crc ^ *p++) & 0xFF];
+    }
+    return crc;
+}
+
+
+uint16_t crc16_ccitt_update(uint16_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+#if CRC_CFG_SLICE_BY8
+    while (len >= 8) {
+        crc = crc16_ccitt_table[7][p[0] ^ (crc >> 8)] ^ crc16_ccitt_table[6][p[1] ^ (crc & 0xFF)]
+            ^ crc16_ccitt_table[5][p[2]] ^ crc16_ccitt_table[4][p[3]]
+            ^ crc16_ccitt_table[3][p[4]] ^ crc16_ccitt_table[2][p[5]]
+            ^ crc16_ccitt_table[1][p[6]] ^ crc16_ccitt_table[0][p[7]];
+        p += 8;
+        len -= 8;
+    }
+#endif
+    while (len--) {
+        crc = (uint16_t)(crc << 8) ^ crc16_ccitt_table[0][((crc >> 8) ^ *p++) & 0xFF];
+    }
+    return crc;
+}
+
+
+uint8_t crc8_mstp_update(uint8_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    /* Frame headers are 7 bytes, a single table is as fast as it gets. */
+    while (len--) {
+        crc = crc8_mstp_table[crc ^ *p++];
+    }
+    return crc;
+}
+
+
+#if !CRC32_ARM_ACLE
+
+static uint32_t crc32_ieee_update_table(uint32_t crc, const uint8_t *p, size_t len)
+{
+#if CRC_CFG_SLICE_BY8
+    while (len >= 8) {
+        const uint32_t one = load_le32(p) ^ crc;
+        const uint32_t two = load_le32(p + 4);
+        crc = crc32_ieee_table[7][one & 0xFF] ^ crc32_ieee_table[6][(one >> 8) & 0xFF]
+            ^ crc32_ieee_table[5][(one >> 16) & 0xFF] ^ crc32_ieee_table[4][one >> 24]
+            ^ crc32_ieee_table[3][two & 0xFF] ^ crc32_ieee_table[2][(two >> 8) & 0xFF]
+            ^ crc32_ieee_table[1][(two >> 16) & 0xFF] ^ crc32_ieee_table[0][two >> 24];
+        p += 8;
+        len -= 8;
+    }
+#endif
+    while (len--) {
+        crc = (crc >> 8) ^ crc32_ieee_table[0][(crc ^ *p++) & 0xFF];
+    }
+    return crc;
+}
+
+#endif
+
+
+#if CRC32_PCLMUL
+
+/* Folding with carry-less multiplication, refer to Intel's "Fast CRC Computation for
+ * Generic Polynomials Using PCLMULQDQ Instruction". The constants are the bit reflected
+ * x^n mod P(x) values for the folding distances, and the Barrett reduction constants.
+ * len must be at least 64 and a multiple of 16. */
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32_ieee_update_pclmul(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    static const uint64_t k1k2[2] __attribute__((aligned(16))) = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+    static const uint64_t k3k4[2] __attribute__((aligned(16))) = { 0x01751997d0ULL, 0x00ccaa009eULL };
+    static const uint64_t k5k0[2] __attribute__((aligned(16))) = { 0x0163cd6124ULL, 0x0000000000ULL };
+    static const uint64_t poly[2] __attribute__((aligned(16))) = { 0x01db710641ULL, 0x01f7011641ULL };
+
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+    x1 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    x0 = _mm_load_si128((const __m128i *)k1k2);
+    buf += 64;
+    len -= 64;
+
+    /* Fold 4 x 128 bits in parallel. */
+    while (len >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+        y5 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+        y6 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+        y7 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+        y8 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+        buf += 64;
+        len -= 64;
+    }
+
+    /* Fold into 128 bits. */
+    x0 = _mm_load_si128((const __m128i *)k3k4);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    while (len >= 16) {
+        x2 = _mm_loadu_si128((const __m128i *)buf);
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        buf += 16;
+        len -= 16;
+    }
+
+    /* Fold 128 bits to 64 bits. */
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+    x0 = _mm_loadl_epi64((const __m128i *)k5k0);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    /* Barrett reduction to 32 bits. */
+    x0 = _mm_load_si128((const __m128i *)poly);
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+static bool crc32_portable;
+
+static bool crc32_pclmul_supported(void)
+{
+    static int supported = -1;
+    if (supported < 0) {
+        __builtin_cpu_init();
+        supported = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+    }
+    return !crc32_portable && supported > 0;
+}
+
+#endif /* CRC32_PCLMUL */
+
+
+uint32_t crc32_ieee_update(uint32_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+#if CRC32_ARM_ACLE
+    while (len >= 8) {
+        uint64_t v;
+        __builtin_memcpy(&v, p, sizeof(v));
+        crc = __crc32d(crc, v);
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = __crc32b(crc, *p++);
+    }
+    return crc;
+#else
+#if CRC32_PCLMUL
+    if (len >= 64 && crc32_pclmul_supported()) {
+        const size_t bulk = len & ~(size_t)15;
+        crc = crc32_ieee_update_pclmul(crc, p, bulk);
+        p += bulk;
+        len -= bulk;
+    }
+#endif
+    return crc32_ieee_update_table(crc, p, len);
+#endif
+}
+
+
+void crc32_ieee_set_portable(bool portable)
+{
+#if CRC32_PCLMUL
+    crc32_portable = portable;
+#else
+    (void)portable;
+#endif
+}
+
+
+const char *crc32_ieee_engine(void)
+{
+#if CRC32_ARM_ACLE
+    return "armv8-crc";
+#else
+#if CRC32_PCLMUL
+    if (crc32_pclmul_supported()) {
+        return "pclmul";
+    }
+#endif
+    return CRC_CFG_SLICE_BY8 ? "slice-by-8" : "table";
+#endif
+}
@@ -0,0 +1,105 @@
+#ifndef __CRC_H__
+#define __CRC_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Table driven CRC calculation shared by the Modbus RTU framing, the SLIP service
+ * frames, the BACnet MS/TP header and the firmware image checks.
+ *
+ * Every CRC has an incremental interface:
+ *
+ *   uint32_t crc = CRC32_IEEE_INIT;
+ *   crc = crc32_ieee_update(crc, part1, len1);
+ *   crc = crc32_ieee_update(crc, part2, len2);
+ *   value = crc32_ieee_final(crc);
+ *
+ * and a one shot function that does all three steps, e.g. crc32_ieee().
+ *
+ * The tables (crc_tables.h) process 8 bytes per step (slicing-by-8). Targets that
+ * can't spend the flash for that (12 KB) define CRC_CFG_SLICE_BY8 to 0, which keeps
+ * one table per CRC (2.5 KB) and processes one byte per step.
+ *
+ * CRC-32 uses the ARMv8 CRC32 instructions, if the compiler targets them, and the
+ * PCLMULQDQ instruction on x86 hosts that support it (CRC_CFG_PCLMUL).
+ */
+
+#ifndef CRC_CFG_SLICE_BY8
+#define CRC_CFG_SLICE_BY8 1
+#endif
+
+#ifndef CRC_CFG_PCLMUL
+#define CRC_CFG_PCLMUL 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* CRC-16/MODBUS: polynomial 0x8005 reflected, init 0xFFFF. The value is transmitted low byte first. */
+#define CRC16_MODBUS_INIT 0xFFFFU
+
+uint16_t crc16_modbus_update(uint16_t crc, const void *data, size_t len);
+
+static inline uint16_t crc16_modbus(const void *data, size_t len)
+{
+    return crc16_modbus_update(CRC16_MODBUS_INIT, data, len);
+}
+
+/* CRC-16/CCITT (CCITT-FALSE): polynomial 0x1021, init 0xFFFF. The value is transmitted high byte first. */
+#define CRC16_CCITT_INIT 0xFFFFU
+
+uint16_t crc16_ccitt_update(uint16_t crc, const void *data, size_t len);
+
+static inline uint16_t crc16_ccitt(const void *data, size_t len)
+{
+    return crc16_ccitt_update(CRC16_CCITT_INIT, data, len);
+}
+
+/* CRC-8 of the BACnet MS/TP frame header: polynomial x^8 + x^7 + 1, init 0xFF,
+ * the ones complement is transmitted. A header including its CRC octet has the
+ * remainder CRC8_MSTP_GOOD. */
+#define CRC8_MSTP_INIT 0xFFU
+#define CRC8_MSTP_GOOD 0x55U
+
+uint8_t crc8_mstp_update(uint8_t crc, const void *data, size_t len);
+
+static inline uint8_t crc8_mstp_final(uint8_t crc)
+{
+    return (uint8_t)~crc;
+}
+
+static inline uint8_t crc8_mstp(const void *data, size_t len)
+{
+    return crc8_mstp_final(crc8_mstp_update(CRC8_MSTP_INIT, data, len));
+}
+
+/* CRC-32 (IEEE 802.3, zlib): polynomial 0x04C11DB7 reflected, init and final xor 0xFFFFFFFF. */
+#define CRC32_IEEE_INIT 0xFFFFFFFFU
+
+uint32_t crc32_ieee_update(uint32_t crc, const void *data, size_t len);
+
+static inline uint32_t crc32_ieee_final(uint32_t crc)
+{
+    return ~crc;
+}
+
+static inline uint32_t crc32_ieee(const void *data, size_t len)
+{
+    return crc32_ieee_final(crc32_ieee_update(CRC32_IEEE_INIT, data, len));
+}
+
+/* Implementation crc32_ieee_update() uses for long buffers: "armv8-crc", "pclmul", "slice-by-8" or "table" */
+const char *crc32_ieee_engine(void);
+
+/* Don't use PCLMULQDQ even if the CPU has it, for benchmarks and tests of the table code.
+ * The ARMv8 CRC32 instructions are chosen at compile time and stay in use. */
+void crc32_ieee_set_portable(bool portable);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
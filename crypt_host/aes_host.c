@@ -887,6 +887,292 @@ void BEE_config(uint32_t start, uint32_t end, uint32_t* counter)
 }
 #endif
 
+// Streaming AES CTR 128 + SHA256 using OTP key.
+// The plaintext is processed RT_STREAM_SIZE bytes at a time: it is hashed and encrypted
+// (or decrypted and hashed) while in the cache, and the keystream of the chunk comes
+// from a single DCP ECB call.
+
+static status_t rt_stream_lock_init(void)
+{
+    status_t ret_val = kStatus_Success;
+
+#ifdef FREERTOS
+    //init dcp_lock if don't init.
+    if((NULL == &dcp_lock) || (NULL == (&dcp_lock)->lock_mtx))
+    {
+        ret_val = rt_init_mutex(&dcp_lock);
+    }
+#endif
+
+    return ret_val;
+}
+
+// XOR the next length bytes of the CTR keystream, p_in and p_out may be the same buffer
+static status_t rt_stream_ctr(rt_enc_hash_context_t *p_ctx, const uint8_t *p_in, uint8_t *p_out, uint32_t length)
+{
+    status_t ret_val;
+    dcp_handle_t m_handle;
+    uint32_t i, n;
+    int j;
+
+    while(length > 0)
+    {
+        if(p_ctx->stream_offset == RT_STREAM_SIZE)
+        {
+            //counter blocks of the whole stream buffer, encrypted in one go
+            for(i = 0; i < RT_STREAM_SIZE; i += RT_AES_BLOCK_SIZE)
+            {
+                memcpy(&p_ctx->stream[i], p_ctx->nonce_counter, RT_AES_BLOCK_SIZE);
+
+                for( j = 16; j > 0; j-- )
+                    if( ++p_ctx->nonce_counter[j - 1] != 0 )
+                        break;
+            }
+
+            m_handle.channel    = kDCP_Channel3;
+            m_handle.keySlot    = kDCP_OtpKey;
+            m_handle.swapConfig = kDCP_KeyByteSwap | kDCP_KeyWordSwap;
+
+            #ifdef FREERTOS
+            ret_val = rt_lock_mutex(&dcp_lock);
+            if(kStatus_Success != ret_val) return ret_val;
+            #endif
+
+            ret_val = DCP_AES_SetKey(DCP, &m_handle, NULL, 16);
+            if(kStatus_Success == ret_val)
+            {
+                DCACHE_CleanByRange((uint32_t)p_ctx->stream, RT_STREAM_SIZE);
+                ret_val = DCP_AES_EncryptEcb(DCP, &m_handle, p_ctx->stream, p_ctx->stream, RT_STREAM_SIZE);
+                DCACHE_InvalidateByRange((uint32_t)p_ctx->stream, RT_STREAM_SIZE);
+            }
+
+            #ifdef FREERTOS
+            rt_unlock_mutex(&dcp_lock);
+            #endif
+            if(kStatus_Success != ret_val) return ret_val;
+
+            p_ctx->stream_offset = 0;
+        }
+
+        n = RT_STREAM_SIZE - p_ctx->stream_offset;
+        if(n > length)
+        {
+            n = length;
+        }
+
+        for(i = 0; i < n; i++)
+        {
+            p_out[i] = p_in[i] ^ p_ctx->stream[p_ctx->stream_offset + i];
+        }
+
+        p_ctx->stream_offset += n;
+        p_in   += n;
+        p_out  += n;
+        length -= n;
+    }
+
+    return kStatus_Success;
+}
+
+static status_t rt_stream_init(rt_enc_hash_context_t *p_ctx, rt_operation_t operation, bool en_integrity)
+{
+    status_t ret_val;
+
+    ret_val = rt_stream_lock_init();
+    if(kStatus_Success != ret_val) return ret_val;
+
+    if(DCP_KEY == kDCP_None)   //use OTP key
+        return kStatus_InvalidArgument;
+
+    memset(p_ctx, 0, sizeof(rt_enc_hash_context_t));
+    p_ctx->operation = operation;
+    p_ctx->en_integrity = en_integrity;
+    p_ctx->stream_offset = RT_STREAM_SIZE;
+
+    if(true == en_integrity)
+    {
+        ret_val = rt_hash256_init(&p_ctx->hash);
+        if(kStatus_Success != ret_val) return ret_val;
+    }
+
+    return kStatus_Success;
+}
+
+status_t RT_Enc_Hash_Init(rt_enc_hash_context_t *p_ctx, bool en_integrity)
+{
+    status_t ret_val;
+
+    if(p_ctx == NULL)
+    {
+        return kStatus_InvalidArgument;
+    }
+
+    ret_val = rt_stream_init(p_ctx, RT_ENCRYPT, en_integrity);
+    if(kStatus_Success != ret_val) return ret_val;
+
+    //generate iv
+    ret_val = rt_rng_vector_generate(p_ctx->iv, sizeof(p_ctx->iv));
+    if(kStatus_Success != ret_val) return ret_val;
+
+    memcpy(p_ctx->nonce_counter, p_ctx->iv, RT_AES_IV_SIZE);
+
+    return kStatus_Success;
+}
+
+status_t RT_Enc_Hash_Update(rt_enc_hash_context_t *p_ctx, const uint8_t *in_plaintext, uint32_t in_length, uint8_t *out_cipher)
+{
+    status_t ret_val;
+    uint32_t n;
+
+    if((p_ctx == NULL) || (p_ctx->operation != RT_ENCRYPT) ||
+       ((in_length > 0) && ((in_plaintext == NULL) || (out_cipher == NULL))))
+    {
+        return kStatus_InvalidArgument;
+    }
+
+    while(in_length > 0)
+    {
+        n = (in_length < RT_STREAM_SIZE) ? in_length : RT_STREAM_SIZE;
+
+        //hash first, the ciphertext may overwrite the plaintext
+        if(true == p_ctx->en_integrity)
+        {
+            ret_val = rt_hash256_update(&p_ctx->hash, in_plaintext, n);
+            if(kStatus_Success != ret_val) return ret_val;
+        }
+
+        ret_val = rt_stream_ctr(p_ctx, in_plaintext, out_cipher, n);
+        if(kStatus_Success != ret_val) return ret_val;
+
+        in_plaintext += n;
+        out_cipher   += n;
+        in_length    -= n;
+    }
+
+    return kStatus_Success;
+}
+
+// out_trailer : hash value(if en_integrity == true) + iv
+// *out_length : size of out_trailer, need >= 48 when en_integrity = true, >= 16 else;
+//               set to the length of the trailer
+status_t RT_Enc_Hash_Final(rt_enc_hash_context_t *p_ctx, uint8_t *out_trailer, uint32_t *out_length)
+{
+    status_t ret_val = kStatus_Success;
+    uint32_t length = 0;
+
+    if((p_ctx == NULL) || (p_ctx->operation != RT_ENCRYPT) || (out_trailer == NULL) || (out_length == NULL) ||
+       (*out_length < ((true == p_ctx->en_integrity) ? RT_HASH_SIZE : 0) + RT_AES_IV_SIZE))
+    {
+        return kStatus_InvalidArgument;
+    }
+
+    //add hash: sha256
+    if(true == p_ctx->en_integrity)
+    {
+        size_t digest_len = RT_HASH_SIZE;
+        ret_val = rt_hash256_finalize(&p_ctx->hash, out_trailer, &digest_len);
+        if(kStatus_Success != ret_val) return ret_val;
+
+        length += digest_len;
+    }
+
+    //copy nonce
+    memcpy(&out_trailer[length], p_ctx->iv, RT_AES_IV_SIZE);
+    length += RT_AES_IV_SIZE;
+
+    *out_length = length;
+    memset(p_ctx, 0, sizeof(rt_enc_hash_context_t));
+
+    return ret_val;
+}
+
+// in_trailer : hash value(if en_integrity == true) + iv, the end of the data made by RT_Enc_Hash_*
+// in_length  : need == 48 when en_integrity = true, == 16 when en_integrity = false
+status_t RT_Dec_Verify_Init(rt_enc_hash_context_t *p_ctx, const uint8_t *in_trailer, uint32_t in_length, bool en_integrity)
+{
+    status_t ret_val;
+
+    if((p_ctx == NULL) || (in_trailer == NULL) ||
+       (in_length != ((true == en_integrity) ? RT_HASH_SIZE : 0) + RT_AES_IV_SIZE))
+    {
+        return kStatus_InvalidArgument;
+    }
+
+    ret_val = rt_stream_init(p_ctx, RT_DECRYPT, en_integrity);
+    if(kStatus_Success != ret_val) return ret_val;
+
+    //get hash and iv
+    if(true == en_integrity)
+    {
+        memcpy(p_ctx->digest, in_trailer, RT_HASH_SIZE);
+    }
+    memcpy(p_ctx->iv, &in_trailer[in_length - RT_AES_IV_SIZE], RT_AES_IV_SIZE);
+    memcpy(p_ctx->nonce_counter, p_ctx->iv, RT_AES_IV_SIZE);
+
+    return kStatus_Success;
+}
+
+status_t RT_Dec_Verify_Update(rt_enc_hash_context_t *p_ctx, const uint8_t *in_cipher, uint32_t in_length, uint8_t *out_plaintext)
+{
+    status_t ret_val;
+    uint32_t n;
+
+    if((p_ctx == NULL) || (p_ctx->operation != RT_DECRYPT) ||
+       ((in_length > 0) && ((in_cipher == NULL) || (out_plaintext == NULL))))
+    {
+        return kStatus_InvalidArgument;
+    }
+
+    while(in_length > 0)
+    {
+        n = (in_length < RT_STREAM_SIZE) ? in_length : RT_STREAM_SIZE;
+
+        ret_val = rt_stream_ctr(p_ctx, in_cipher, out_plaintext, n);
+        if(kStatus_Success != ret_val) return ret_val;
+
+        if(true == p_ctx->en_integrity)
+        {
+            ret_val = rt_hash256_update(&p_ctx->hash, out_plaintext, n);
+            if(kStatus_Success != ret_val) return ret_val;
+        }
+
+        in_cipher     += n;
+        out_plaintext += n;
+        in_length     -= n;
+    }
+
+    return kStatus_Success;
+}
+
+// return kStatus_Success when hash is ok (or en_integrity == false), kStatus_Fail when hash is error.
+status_t RT_Dec_Verify_Final(rt_enc_hash_context_t *p_ctx)
+{
+    status_t ret_val = kStatus_Success;
+
+    if((p_ctx == NULL) || (p_ctx->operation != RT_DECRYPT))
+    {
+        return kStatus_InvalidArgument;
+    }
+
+    //calculate and verify hash
+    if(true == p_ctx->en_integrity)
+    {
+        uint8_t digest[RT_HASH_SIZE];
+        size_t digest_len = RT_HASH_SIZE;
+
+        ret_val = rt_hash256_finalize(&p_ctx->hash, digest, &digest_len);
+        if((kStatus_Success == ret_val) && (memcmp(digest, p_ctx->digest, RT_HASH_SIZE) != 0))
+        {
+            PRINTF("Verify Hash fail!\r\n");
+            ret_val = kStatus_Fail;
+        }
+    }
+
+    memset(p_ctx, 0, sizeof(rt_enc_hash_context_t));
+
+    return ret_val;
+}
+
 //need define dcp_lock (like this : rt_lock_t dcp_lock;) before use RT_Enc_Hash_Data or RT_Dec_Verify_Data  if #define FREERTOS
 // AES CRT 128   using OTP key.
 // in_plaintext : input data pointer need to encryption
@@ -901,7 +1187,8 @@ void BEE_config(uint32_t start, uint32_t end, uint32_t* counter)
 status_t RT_Enc_Hash_Data(const uint8_t *in_plaintext, uint32_t in_length, uint8_t *out_cipher, uint32_t *out_length, bool en_integrity)
 {
     status_t ret_val  = kStatus_Success;
-    uint8_t iv[RT_AES_IV_SIZE];
+    rt_enc_hash_context_t ctx;
+    uint32_t trailer_length;
 
     //check input parameter
     if((in_plaintext == NULL) || (in_length == 0) || (in_length%16 != 0) || (out_length == NULL) || (out_cipher == NULL))
@@ -917,40 +1204,18 @@ status_t RT_Enc_Hash_Data(const uint8_t *in_plaintext, uint32_t in_length, uint8
         return kStatus_InvalidArgument;
     }
 
-#ifdef FREERTOS
-    //init dcp_lock if don't init.
-    if((NULL == &dcp_lock) || (NULL == (&dcp_lock)->lock_mtx))
-    {
-        ret_val = rt_init_mutex(&dcp_lock);
-        if(kStatus_Success != ret_val) return ret_val;
-    }
-#endif
-
-    //generate iv
-    ret_val = rt_rng_vector_generate(iv, sizeof(iv));
+    //one pass: hash and encrypt each chunk of the plaintext
+    ret_val = RT_Enc_Hash_Init(&ctx, en_integrity);
     if(kStatus_Success != ret_val) return ret_val;
 
-    //AES128 CRT encryption,
-    if(DCP_KEY == kDCP_None)   //use OTP key
-        return kStatus_InvalidArgument;
-    ret_val = rt_aes_ctr(DCP_KEY, NULL, iv, (uint8_t *)in_plaintext, in_length, out_cipher);
+    ret_val = RT_Enc_Hash_Update(&ctx, in_plaintext, in_length, out_cipher);
     if(kStatus_Success != ret_val) return ret_val;
 
-    *out_length = in_length;
-
-    //add hash: sha256
-    if(true == en_integrity)
-    {
-        size_t digest_len = 32;
-        ret_val = rt_hash256_calculate(in_plaintext, in_length, &out_cipher[*out_length], &digest_len);
-        if(kStatus_Success != ret_val) return ret_val;
-
-        *out_length += digest_len;
-    }
+    trailer_length = *out_length - in_length;
+    ret_val = RT_Enc_Hash_Final(&ctx, &out_cipher[in_length], &trailer_length);
+    if(kStatus_Success != ret_val) return ret_val;
 
-    //copy nonce
-    memcpy(&out_cipher[*out_length], iv, RT_AES_IV_SIZE);
-    *out_length += RT_AES_IV_SIZE;
+    *out_length = in_length + trailer_length;
 
     return ret_val;
 }
@@ -970,7 +1235,7 @@ status_t RT_Enc_Hash_Data(const uint8_t *in_plaintext, uint32_t in_length, uint8
 status_t RT_Dec_Verify_Data(const uint8_t *in_cipher, uint32_t in_length, uint8_t  *out_plaintext, uint32_t *out_length, bool en_integrity)
 {
     status_t ret_val  = kStatus_Success;
-    uint8_t iv[RT_AES_IV_SIZE];
+    rt_enc_hash_context_t ctx;
 
     //check input parameter
     if((in_cipher == NULL) || (in_length == 0) || (in_length%16 != 0) || (out_length == NULL) || (out_plaintext == NULL))
@@ -991,17 +1256,6 @@ status_t RT_Dec_Verify_Data(const uint8_t *in_cipher, uint32_t in_length, uint8_
         return kStatus_InvalidArgument;
     }
 
-#ifdef FREERTOS
-    //init dcp_lock.
-    if((NULL == &dcp_lock) || (NULL == (&dcp_lock)->lock_mtx))
-    {
-        ret_val = rt_init_mutex(&dcp_lock);
-        if(kStatus_Success != ret_val) return ret_val;
-    }
-#endif
-
-    //get iv
-    memcpy(iv, &in_cipher[in_length - RT_AES_IV_SIZE], RT_AES_IV_SIZE);
     *out_length = in_length - RT_AES_IV_SIZE;
 
     if(true == en_integrity)
@@ -1010,30 +1264,14 @@ status_t RT_Dec_Verify_Data(const uint8_t *in_cipher, uint32_t in_length, uint8_
         *out_length -= 32;
     }
 
-    //AES128 CRT decode
-    if(DCP_KEY == kDCP_None)  //use OTP key
-        return kStatus_InvalidArgument;
-    ret_val = rt_aes_ctr(DCP_KEY, NULL, iv, (uint8_t *)in_cipher, *out_length, out_plaintext);
+    //one pass: decrypt and hash each chunk of the ciphertext
+    ret_val = RT_Dec_Verify_Init(&ctx, &in_cipher[*out_length], in_length - *out_length, en_integrity);
     if(kStatus_Success != ret_val) return ret_val;
 
-    //calculate and verify hash
-    if(true == en_integrity)
-    {
-        //32 = the length of hash
-        uint8_t digest[32];
-        size_t digest_len = 32;
-
-        ret_val = rt_hash256_calculate(out_plaintext, in_length - RT_AES_IV_SIZE - 32, digest, &digest_len);
-        if(kStatus_Success != ret_val) return ret_val;
-
-        if(memcmp(digest, &in_cipher[in_length - RT_AES_IV_SIZE - 32], 32) != 0)
-        {
-            PRINTF("Verify Hash fail!\r\n");
-            return kStatus_Fail;
-        }
-    }
+    ret_val = RT_Dec_Verify_Update(&ctx, in_cipher, *out_length, out_plaintext);
+    if(kStatus_Success != ret_val) return ret_val;
 
-    return ret_val;
+    return RT_Dec_Verify_Final(&ctx);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -26,6 +26,8 @@
 #include "mbedtls/aes.h"
 #include "mbedtls/cipher.h"
 
+#include "sha256_host.h"
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -85,6 +87,24 @@ typedef struct
 } rt_aes_context_t;
 
 
+#define RT_HASH_SIZE         32
+// Keystream generated per DCP call by the streaming encrypt / decrypt, a multiple of the cache line
+#define RT_STREAM_SIZE       (16 * RT_AES_BLOCK_SIZE)
+
+// Context of the streaming RT_Enc_Hash_* / RT_Dec_Verify_* functions
+typedef struct
+{
+    rt_operation_t operation;
+    bool en_integrity;
+    uint8_t iv[RT_AES_IV_SIZE];
+    uint8_t nonce_counter[RT_AES_IV_SIZE];
+    uint8_t digest[RT_HASH_SIZE];
+    // bytes of stream already used, RT_STREAM_SIZE when it needs a refill
+    uint32_t stream_offset;
+    SDK_ALIGN(uint8_t stream[RT_STREAM_SIZE], 32);
+    rt_sha256_context_t hash;
+} rt_enc_hash_context_t;
+
 typedef enum _dcp_otp_key_select
 {
     kDCP_None,
@@ -146,6 +166,25 @@ status_t RT_Dec_Verify_Data(const uint8_t *in_cipher, uint32_t in_length, uint8_
 
 status_t RT_Enc_Hash_Data(const uint8_t *in_plaintext, uint32_t in_length, uint8_t *out_cipher, uint32_t *out_length, bool en_integrity);
 
+// Streaming form of RT_Enc_Hash_Data, the same output in one pass over the plaintext:
+// Init, Update for each part of the plaintext (any sizes), Final for the trailer
+// (hash if en_integrity + iv) which goes after the ciphertext.
+status_t RT_Enc_Hash_Init(rt_enc_hash_context_t *p_ctx, bool en_integrity);
+
+status_t RT_Enc_Hash_Update(rt_enc_hash_context_t *p_ctx, const uint8_t *in_plaintext, uint32_t in_length, uint8_t *out_cipher);
+
+status_t RT_Enc_Hash_Final(rt_enc_hash_context_t *p_ctx, uint8_t *out_trailer, uint32_t *out_length);
+
+// Streaming form of RT_Dec_Verify_Data. The trailer (the last 48 bytes if en_integrity,
+// else 16) is needed first, it holds the iv: read it from the end of the image, or
+// send it ahead of the ciphertext. Final returns kStatus_Fail if the hash is wrong,
+// the plaintext already output must then be discarded.
+status_t RT_Dec_Verify_Init(rt_enc_hash_context_t *p_ctx, const uint8_t *in_trailer, uint32_t in_length, bool en_integrity);
+
+status_t RT_Dec_Verify_Update(rt_enc_hash_context_t *p_ctx, const uint8_t *in_cipher, uint32_t in_length, uint8_t *out_plaintext);
+
+status_t RT_Dec_Verify_Final(rt_enc_hash_context_t *p_ctx);
+
 status_t RT_Enc_Dec_Verify_Data_Test(void);
 
 #ifdef __cplusplus
@@ -0,0 +1,542 @@
+/** \file
+ *  \brief  Crypto throughput benchmark for VSOM Platform
+ *
+ *  \date   October 2026
+ *
+ *  \copyright Honeywell
+ *  ALL RIGHTS RESERVED, Honeywell Confidential and Proprietary.
+ */
+
+#include "bench_host.h"
+
+#include <string.h>
+
+#include "fsl_dcp.h"
+#include "fsl_cache.h"
+#include "fsl_debug_console.h"
+
+#ifdef FREERTOS
+#include "rt_mutex_hal.h"
+
+extern rt_lock_t dcp_lock;
+#endif
+
+#include "mbedtls/aes.h"
+#include "aes_host.h"
+#include "sha256_host.h"
+#include "ecc_host.h"
+#include "ecdsa_host.h"
+#include "crc.h"
+
+#if RT_BENCH_MCRYPTO
+#include "hal_aes.h"
+#include "aes-xts.h"
+#include "cmac1.h"
+#endif
+
+// Backends:
+//   dcp        fsl_dcp driver calls, with the cache maintenance the DCP needs
+//   dcp-stream RT_Enc_Hash_Update keystream (OTP key), without the hash
+//   mbedtls    mbedTLS API, DCP accelerated or software depending on the mbedTLS config
+//   mcrypto    MCRYPTO library on the DCP
+//   crc.c      shared CRC library, the name of its implementation is printed
+// ECDSA is measured per signature: the size is the one of the hash.
+
+#define RT_BENCH_MIN_SIZE       16u
+#define RT_BENCH_MAX_SIZE       (1024u * 1024u)
+#define RT_BENCH_REPEATS        3
+
+typedef status_t (*rt_bench_fn_t)(uint32_t size);
+
+typedef struct
+{
+    const char *algo;
+    const char *backend;
+    rt_bench_fn_t run;
+    // fixed size (ECDSA), 0 for the message sizes
+    uint32_t size;
+} rt_bench_t;
+
+static const uint8_t s_bench_key[RT_AES_BLOCK_SIZE] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+static uint8_t *s_bench_in;
+static uint8_t *s_bench_out;
+static uint8_t s_bench_iv[RT_AES_IV_SIZE];
+
+static dcp_handle_t s_bench_dcp;
+static mbedtls_aes_context s_bench_mbedtls_enc;
+static mbedtls_aes_context s_bench_mbedtls_dec;
+static rt_enc_hash_context_t s_bench_stream;
+static rt_ecc_private_key_t s_bench_priv_key;
+static rt_ecc_public_key_t s_bench_pub_key;
+static rt_secp256r1_signature_t s_bench_signature;
+static uint8_t s_bench_hash[RT_HASH_SIZE];
+#if RT_BENCH_MCRYPTO
+static mcrypto_aes_ctx_t s_bench_mcrypto;
+static mcrypto_aes_xts_ctx_t s_bench_mcrypto_xts;
+#endif
+
+// keeps the compiler from dropping the results of the CRC runs
+static volatile uint32_t s_bench_sink;
+
+
+//////////////////////////////DCP///////////////////////////////////////////////
+
+static status_t bench_dcp_lock(uint32_t size)
+{
+    DCACHE_CleanByRange((uint32_t)s_bench_in, size);
+    #ifdef FREERTOS
+    return rt_lock_mutex(&dcp_lock);
+    #else
+    return kStatus_Success;
+    #endif
+}
+
+static status_t bench_dcp_unlock(uint32_t size, status_t ret_val)
+{
+    #ifdef FREERTOS
+    rt_unlock_mutex(&dcp_lock);
+    #endif
+    DCACHE_InvalidateByRange((uint32_t)s_bench_out, size);
+    return ret_val;
+}
+
+static status_t bench_dcp_ecb_enc(uint32_t size)
+{
+    status_t ret_val = bench_dcp_lock(size);
+    if(kStatus_Success != ret_val) return ret_val;
+
+    ret_val = DCP_AES_EncryptEcb(DCP, &s_bench_dcp, s_bench_in, s_bench_out, size);
+    return bench_dcp_unlock(size, ret_val);
+}
+
+static status_t bench_dcp_ecb_dec(uint32_t size)
+{
+    status_t ret_val = bench_dcp_lock(size);
+    if(kStatus_Success != ret_val) return ret_val;
+
+    ret_val = DCP_AES_DecryptEcb(DCP, &s_bench_dcp, s_bench_in, s_bench_out, size);
+    return bench_dcp_unlock(size, ret_val);
+}
+
+static status_t bench_dcp_cbc_enc(uint32_t size)
+{
+    status_t ret_val = bench_dcp_lock(size);
+    if(kStatus_Success != ret_val) return ret_val;
+
+    ret_val = DCP_AES_EncryptCbc(DCP, &s_bench_dcp, s_bench_in, s_bench_out, size, s_bench_iv);
+    return bench_dcp_unlock(size, ret_val);
+}
+
+static status_t bench_dcp_cbc_dec(uint32_t size)
+{
+    status_t ret_val = bench_dcp_lock(size);
+    if(kStatus_Success != ret_val) return ret_val;
+
+    ret_val = DCP_AES_DecryptCbc(DCP, &s_bench_dcp, s_bench_in, s_bench_out, size, s_bench_iv);
+    return bench_dcp_unlock(size, ret_val);
+}
+
+// rt_aes_ctr: one DCP call per block
+static status_t bench_dcp_ctr(uint32_t size)
+{
+    return rt_aes_ctr(kDCP_None, (uint8_t *)s_bench_key, s_bench_iv, s_bench_in, size, s_bench_out);
+}
+
+// the stream is started once in bench_setup, only the keystream is timed
+static status_t bench_dcp_stream_ctr(uint32_t size)
+{
+    return RT_Enc_Hash_Update(&s_bench_stream, s_bench_in, size, s_bench_out);
+}
+
+static status_t bench_dcp_hash(dcp_hash_algo_t algo, uint32_t size, uint32_t out_size)
+{
+    size_t hash_size = out_size;
+    status_t ret_val = bench_dcp_lock(size);
+    if(kStatus_Success != ret_val) return ret_val;
+
+    ret_val = DCP_HASH(DCP, &s_bench_dcp, algo, s_bench_in, size, s_bench_out, &hash_size);
+    return bench_dcp_unlock(out_size, ret_val);
+}
+
+static status_t bench_dcp_sha256(uint32_t size)
+{
+    return bench_dcp_hash(kDCP_Sha256, size, RT_HASH_SIZE);
+}
+
+static status_t bench_dcp_crc32(uint32_t size)
+{
+    return bench_dcp_hash(kDCP_Crc32, size, 4);
+}
+
+
+//////////////////////////////mbedTLS///////////////////////////////////////////
+
+static status_t bench_mbedtls_ecb(mbedtls_aes_context *p_ctx, int mode, uint32_t size)
+{
+    uint32_t i;
+
+    for(i = 0; i < size; i += RT_AES_BLOCK_SIZE)
+    {
+        if(0 != mbedtls_aes_crypt_ecb(p_ctx, mode, &s_bench_in[i], &s_bench_out[i]))
+        {
+            return kStatus_Fail;
+        }
+    }
+    return kStatus_Success;
+}
+
+static status_t bench_mbedtls_ecb_enc(uint32_t size)
+{
+    return bench_mbedtls_ecb(&s_bench_mbedtls_enc, MBEDTLS_AES_ENCRYPT, size);
+}
+
+static status_t bench_mbedtls_ecb_dec(uint32_t size)
+{
+    return bench_mbedtls_ecb(&s_bench_mbedtls_dec, MBEDTLS_AES_DECRYPT, size);
+}
+
+static status_t bench_mbedtls_cbc_enc(uint32_t size)
+{
+    uint8_t iv[RT_AES_IV_SIZE];
+
+    memcpy(iv, s_bench_iv, sizeof(iv));
+    if(0 != mbedtls_aes_crypt_cbc(&s_bench_mbedtls_enc, MBEDTLS_AES_ENCRYPT, size, iv, s_bench_in, s_bench_out))
+    {
+        return kStatus_Fail;
+    }
+    return kStatus_Success;
+}
+
+static status_t bench_mbedtls_cbc_dec(uint32_t size)
+{
+    uint8_t iv[RT_AES_IV_SIZE];
+
+    memcpy(iv, s_bench_iv, sizeof(iv));
+    if(0 != mbedtls_aes_crypt_cbc(&s_bench_mbedtls_dec, MBEDTLS_AES_DECRYPT, size, iv, s_bench_in, s_bench_out))
+    {
+        return kStatus_Fail;
+    }
+    return kStatus_Success;
+}
+
+static status_t bench_mbedtls_ctr(uint32_t size)
+{
+    uint8_t nonce_counter[RT_AES_IV_SIZE];
+    uint8_t stream_block[RT_AES_BLOCK_SIZE];
+    size_t nc_off = 0;
+
+    memcpy(nonce_counter, s_bench_iv, sizeof(nonce_counter));
+    if(0 != mbedtls_aes_crypt_ctr(&s_bench_mbedtls_enc, size, &nc_off, nonce_counter, stream_block, s_bench_in, s_bench_out))
+    {
+        return kStatus_Fail;
+    }
+    return kStatus_Success;
+}
+
+static status_t bench_mbedtls_sha256(uint32_t size)
+{
+    size_t digest_size;
+
+    return rt_hash256_calculate(s_bench_in, size, s_bench_out, &digest_size);
+}
+
+static status_t bench_ecdsa_sign(uint32_t size)
+{
+    return rt_secp256r1_ecdsa_sign(&s_bench_priv_key, s_bench_hash, size,
+                                   s_bench_signature, sizeof(s_bench_signature));
+}
+
+static status_t bench_ecdsa_verify(uint32_t size)
+{
+    return rt_secp256r1_ecdsa_verify(&s_bench_pub_key, s_bench_hash, size,
+                                     s_bench_signature, sizeof(s_bench_signature));
+}
+
+
+//////////////////////////////MCRYPTO and CRC///////////////////////////////////
+
+#if RT_BENCH_MCRYPTO
+static status_t bench_mcrypto_result(mcrypto_status_t status)
+{
+    return (MCRYPTO_OK == status) ? kStatus_Success : kStatus_Fail;
+}
+
+static status_t bench_mcrypto_ecb_enc(uint32_t size)
+{
+    return bench_mcrypto_result(mcrypto_aes_ecb_encrypt(&s_bench_mcrypto, s_bench_in, s_bench_out, size));
+}
+
+static status_t bench_mcrypto_ecb_dec(uint32_t size)
+{
+    return bench_mcrypto_result(mcrypto_aes_ecb_decrypt(&s_bench_mcrypto, s_bench_in, s_bench_out, size));
+}
+
+static status_t bench_mcrypto_xts_enc(uint32_t size)
+{
+    return bench_mcrypto_result(mcrypto_aes_xts_encrypt(&s_bench_mcrypto_xts, 0x60000000u, s_bench_in, s_bench_out, size));
+}
+
+static status_t bench_mcrypto_xts_dec(uint32_t size)
+{
+    return bench_mcrypto_result(mcrypto_aes_xts_decrypt(&s_bench_mcrypto_xts, 0x60000000u, s_bench_in, s_bench_out, size));
+}
+
+static status_t bench_mcrypto_cmac(uint32_t size)
+{
+    mcrypto_auth_tag_t tag;
+
+    return bench_mcrypto_result(mcrypto_aes_cmac(&s_bench_mcrypto, s_bench_in, size, &tag));
+}
+#endif
+
+static status_t bench_crc32(uint32_t size)
+{
+    s_bench_sink = crc32_ieee(s_bench_in, size);
+    return kStatus_Success;
+}
+
+
+static const rt_bench_t s_benches[] = {
+    { "aes-ecb-enc",  "dcp",        bench_dcp_ecb_enc,      0 },
+    { "aes-ecb-enc",  "mbedtls",    bench_mbedtls_ecb_enc,  0 },
+    { "aes-ecb-dec",  "dcp",        bench_dcp_ecb_dec,      0 },
+    { "aes-ecb-dec",  "mbedtls",    bench_mbedtls_ecb_dec,  0 },
+    { "aes-cbc-enc",  "dcp",        bench_dcp_cbc_enc,      0 },
+    { "aes-cbc-enc",  "mbedtls",    bench_mbedtls_cbc_enc,  0 },
+    { "aes-cbc-dec",  "dcp",        bench_dcp_cbc_dec,      0 },
+    { "aes-cbc-dec",  "mbedtls",    bench_mbedtls_cbc_dec,  0 },
+    { "aes-ctr",      "dcp",        bench_dcp_ctr,          0 },
+    { "aes-ctr",      "dcp-stream", bench_dcp_stream_ctr,   0 },
+    { "aes-ctr",      "mbedtls",    bench_mbedtls_ctr,      0 },
+#if RT_BENCH_MCRYPTO
+    { "aes-ecb-enc",  "mcrypto",    bench_mcrypto_ecb_enc,  0 },
+    { "aes-ecb-dec",  "mcrypto",    bench_mcrypto_ecb_dec,  0 },
+    { "aes-xts-enc",  "mcrypto",    bench_mcrypto_xts_enc,  0 },
+    { "aes-xts-dec",  "mcrypto",    bench_mcrypto_xts_dec,  0 },
+    { "aes-cmac",     "mcrypto",    bench_mcrypto_cmac,     0 },
+#endif
+    { "sha256",       "dcp",        bench_dcp_sha256,       0 },
+    { "sha256",       "mbedtls",    bench_mbedtls_sha256,   0 },
+    { "crc32",        "dcp",        bench_dcp_crc32,        0 },
+    { "crc32",        NULL,         bench_crc32,            0 },
+    { "ecdsa-sign",   "mbedtls",    bench_ecdsa_sign,       RT_HASH_SIZE },
+    { "ecdsa-verify", "mbedtls",    bench_ecdsa_verify,     RT_HASH_SIZE },
+};
+
+
+//////////////////////////////Measurement///////////////////////////////////////
+
+static void bench_cycle_counter_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+// Cycles of iterations runs, the 32-bit counter limits a run to a few seconds
+static status_t bench_run(const rt_bench_t *p_bench, uint32_t size, uint32_t iterations, uint32_t *p_cycles)
+{
+    status_t ret_val;
+    uint32_t start = DWT->CYCCNT;
+    uint32_t i;
+
+    for(i = 0; i < iterations; i++)
+    {
+        ret_val = p_bench->run(size);
+        if(kStatus_Success != ret_val) return ret_val;
+    }
+
+    *p_cycles = DWT->CYCCNT - start;
+    return kStatus_Success;
+}
+
+static status_t bench_measure(const rt_bench_t *p_bench, uint32_t size)
+{
+    const uint32_t min_cycles = (SystemCoreClock / 1000u) * RT_BENCH_MIN_MS;
+    uint32_t iterations = 1;
+    uint32_t cycles;
+    uint32_t best;
+    uint64_t bytes;
+    status_t ret_val;
+    int repeat;
+
+    // calibrate, which also warms up the caches
+    for(;;)
+    {
+        ret_val = bench_run(p_bench, size, iterations, &cycles);
+        if(kStatus_Success != ret_val) return ret_val;
+
+        if(cycles >= min_cycles) break;
+
+        if(cycles < min_cycles / 8u)
+        {
+            iterations *= 8u;
+        }else{
+            iterations = (uint32_t)(((uint64_t)iterations * min_cycles * 5u) / ((uint64_t)cycles * 4u)) + 1u;
+        }
+    }
+
+    best = cycles;
+    for(repeat = 1; repeat < RT_BENCH_REPEATS; repeat++)
+    {
+        ret_val = bench_run(p_bench, size, iterations, &cycles);
+        if(kStatus_Success != ret_val) return ret_val;
+
+        if(cycles < best) best = cycles;
+    }
+
+    // fixed point: cycles per op x10, cycles per byte x1000, MB/s x100
+    bytes = (uint64_t)iterations * size;
+    uint32_t op_x10   = (uint32_t)(((uint64_t)best * 10u) / iterations);
+    uint32_t byte_x1k = (uint32_t)(((uint64_t)best * 1000u) / bytes);
+    uint32_t mbs_x100 = (uint32_t)((bytes * (SystemCoreClock / 10000u)) / best);
+
+    PRINTF("crypto,%s,%s,%u,%u,%u.%u,%u.%03u,%u.%02u\r\n",
+           p_bench->algo, (p_bench->backend != NULL) ? p_bench->backend : crc32_ieee_engine(),
+           size, iterations, op_x10 / 10u, op_x10 % 10u, byte_x1k / 1000u, byte_x1k % 1000u,
+           mbs_x100 / 100u, mbs_x100 % 100u);
+
+    return kStatus_Success;
+}
+
+static status_t bench_setup(void)
+{
+    status_t ret_val;
+    uint32_t i;
+#if RT_BENCH_MCRYPTO
+    mcrypto_secret_key_t key1;
+    mcrypto_secret_key_t key2;
+#endif
+
+    for(i = 0; i < sizeof(s_bench_iv); i++)
+    {
+        s_bench_iv[i] = (uint8_t)i;
+    }
+    for(i = 0; i < sizeof(s_bench_hash); i++)
+    {
+        s_bench_hash[i] = (uint8_t)(0xA5u ^ i);
+    }
+
+    // payload key on the channel of the streaming functions
+    s_bench_dcp.channel    = kDCP_Channel3;
+    s_bench_dcp.keySlot    = kDCP_KeySlot0;
+    s_bench_dcp.swapConfig = kDCP_NoSwap;
+    ret_val = DCP_AES_SetKey(DCP, &s_bench_dcp, s_bench_key, sizeof(s_bench_key));
+    if(kStatus_Success != ret_val) return ret_val;
+
+    // the dcp-stream runs continue one stream, its init (rng iv) is not measured
+    ret_val = RT_Enc_Hash_Init(&s_bench_stream, false);
+    if(kStatus_Success != ret_val) return ret_val;
+
+    mbedtls_aes_init(&s_bench_mbedtls_enc);
+    mbedtls_aes_init(&s_bench_mbedtls_dec);
+    if((0 != mbedtls_aes_setkey_enc(&s_bench_mbedtls_enc, s_bench_key, RT_BITS_128)) ||
+       (0 != mbedtls_aes_setkey_dec(&s_bench_mbedtls_dec, s_bench_key, RT_BITS_128)))
+    {
+        return kStatus_Fail;
+    }
+
+#if RT_BENCH_MCRYPTO
+    memcpy(key1.data, s_bench_key, sizeof(key1.data));
+    for(i = 0; i < sizeof(key2.data) / sizeof(key2.data[0]); i++)
+    {
+        key2.data[i] = ~key1.data[i];
+    }
+    if((MCRYPTO_OK != mcrypto_aes_ctx_init_with_key(&s_bench_mcrypto, &key1)) ||
+       (MCRYPTO_OK != mcrypto_aes_xts_ctx_init(&s_bench_mcrypto_xts, &key1, &key2)))
+    {
+        return kStatus_Fail;
+    }
+    memset(&key1, 0, sizeof(key1));
+    memset(&key2, 0, sizeof(key2));
+#endif
+
+    ret_val = rt_secp256r1_gen_keypair(&s_bench_priv_key, &s_bench_pub_key);
+    if(kStatus_Success != ret_val) return ret_val;
+
+    // a valid signature for the verify runs
+    return rt_secp256r1_ecdsa_sign(&s_bench_priv_key, s_bench_hash, sizeof(s_bench_hash),
+                                   s_bench_signature, sizeof(s_bench_signature));
+}
+
+static void bench_cleanup(void)
+{
+    mbedtls_aes_free(&s_bench_mbedtls_enc);
+    mbedtls_aes_free(&s_bench_mbedtls_dec);
+#if RT_BENCH_MCRYPTO
+    mcrypto_aes_ctx_cleanup(&s_bench_mcrypto);
+    mcrypto_aes_xts_ctx_cleanup(&s_bench_mcrypto_xts);
+#endif
+    rt_secp256r1_private_key_free(&s_bench_priv_key);
+    rt_secp256r1_public_key_free(&s_bench_pub_key);
+    memset(&s_bench_dcp, 0, sizeof(s_bench_dcp));
+    memset(&s_bench_stream, 0, sizeof(s_bench_stream));
+}
+
+
+status_t rt_crypto_bench(uint8_t * p_buf, uint32_t buf_size)
+{
+    status_t ret_val;
+    uint32_t pad;
+    uint32_t half;
+    uint32_t max_size;
+    uint32_t size;
+    uint32_t i;
+
+    if(p_buf == NULL)
+    {
+        return kStatus_InvalidArgument;
+    }
+
+    // input and output on cache lines of their own, for the DCP cache maintenance
+    pad = (32u - ((uint32_t)p_buf & 31u)) & 31u;
+    if(buf_size < pad + 64u)
+    {
+        return kStatus_InvalidArgument;
+    }
+    half = ((buf_size - pad) / 2u) & ~31u;
+    s_bench_in  = p_buf + pad;
+    s_bench_out = s_bench_in + half;
+
+    max_size = (half < RT_BENCH_MAX_SIZE) ? half : RT_BENCH_MAX_SIZE;
+    for(i = 0; i < max_size; i++)
+    {
+        s_bench_in[i] = (uint8_t)(i * 31u + 7u);
+    }
+
+    bench_cycle_counter_init();
+
+    ret_val = bench_setup();
+    if(kStatus_Success != ret_val)
+    {
+        PRINTF("Crypto bench setup fail!\r\n");
+        bench_cleanup();
+        return ret_val;
+    }
+
+    PRINTF("crypto,algo,backend,size,iterations,cycles_per_op,cycles_per_byte,mb_per_s\r\n");
+
+    for(i = 0; i < sizeof(s_benches) / sizeof(s_benches[0]); i++)
+    {
+        const rt_bench_t *p_bench = &s_benches[i];
+
+        for(size = (p_bench->size != 0) ? p_bench->size : RT_BENCH_MIN_SIZE; size <= max_size; size *= 4u)
+        {
+            ret_val = bench_measure(p_bench, size);
+            if(kStatus_Success != ret_val)
+            {
+                PRINTF("Crypto bench %s %s fail!\r\n", p_bench->algo, (p_bench->backend != NULL) ? p_bench->backend : "crc.c");
+                bench_cleanup();
+                return ret_val;
+            }
+
+            if(p_bench->size != 0) break;
+        }
+    }
+
+    bench_cleanup();
+    return kStatus_Success;
+}
@@ -0,0 +1,41 @@
+/** \file
+ *  \brief  Crypto throughput benchmark for VSOM Platform
+ *
+ *  \date   October 2026
+ *
+ *  \copyright Honeywell
+ *  ALL RIGHTS RESERVED, Honeywell Confidential and Proprietary.
+ */
+#ifndef __BENCH_HOST_H__
+#define __BENCH_HOST_H__
+
+#include "fsl_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Set to 0 if the MCRYPTO library isn't linked
+#ifndef RT_BENCH_MCRYPTO
+#define RT_BENCH_MCRYPTO 1
+#endif
+
+// Minimum duration of one measurement in milliseconds
+#ifndef RT_BENCH_MIN_MS
+#define RT_BENCH_MIN_MS  50
+#endif
+
+// Measures the crypto backends of the RT with the DWT cycle counter and prints
+// one CSV line per algorithm, backend and message size:
+//   crypto,<algo>,<backend>,<size>,<iterations>,<cycles_per_op>,<cycles_per_byte>,<mb_per_s>
+// the same format as the host benchmark (imgcrypt/cryptobench.c).
+// p_buf holds the input and output data, the message sizes go from 16 bytes up to
+// half of buf_size (1 MB at most) by factors of 4: give it a buffer in SDRAM
+// to measure the large sizes.
+status_t rt_crypto_bench(uint8_t * p_buf, uint32_t buf_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
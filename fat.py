@@ -8,6 +8,8 @@ import hashlib
 import base64
 import configparser
 import binascii
+import subprocess
+import tempfile
 
 # Import pynrfjprog API module and HEX parser module
 # from pynrfjprog import Hex,LowLevel
@@ -75,11 +77,43 @@ def ota_parse_version(in_ver):
     return list_to_int(ver_int)
 
 
+# Native multi-threaded AES-CTR / SHA-256 tool (imgcrypt/readme.txt), used when it is built
+IMGCRYPT_TOOL = os.path.join(os.path.dirname(os.path.abspath(__file__)), "imgcrypt",
+                             "imgcrypt.exe" if os.name == "nt" else "imgcrypt")
+
+
+def imgcrypt_ctr(file_name, en_key, nonce, init_val):
+    if not os.path.exists(IMGCRYPT_TOOL):
+        return None
+
+    fd, out_file = tempfile.mkstemp(suffix=".ctr")
+    os.close(fd)
+    try:
+        r_v = subprocess.call([IMGCRYPT_TOOL, "ctr", bytes(en_key).hex(), bytes(nonce).hex(),
+                               str(init_val), file_name, out_file])
+        if r_v:
+            print("imgcrypt error, falling back to Python!")
+            return None
+
+        return file_readf(out_file)
+    except OSError as e:
+        print("imgcrypt can't run, falling back to Python: " + str(e))
+        return None
+    finally:
+        os.remove(out_file)
+
+
 def ota_package_encrypt(file_name, en_key, nonce, init_val, do_en=1):
     if not os.path.exists(file_name):
         print(file_name)
         raise Exception("File not exists!")
 
+    if do_en and os.path.splitext(file_name)[1] in (".bin", ".imx"):
+        # same padding and counter blocks as below, segments encrypted on all cores
+        file_encrypt = imgcrypt_ctr(file_name, en_key, nonce, init_val)
+        if file_encrypt is not None:
+            return file_encrypt
+
     file_type, file_size, file_data, ret = read_file_data(file_name, align=16)
     if ret:
         print("read file error!")
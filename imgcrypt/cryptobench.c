@@ -0,0 +1,483 @@
+/**
+ * @file cryptobench.c
+ * @brief Throughput benchmark of the host crypto backends
+ * @date 2026-10-19
+ *
+ * Measures the MCRYPTO host AES backend (ECB, CBC, CTR, XTS, CMAC), img_sha256 and the
+ * CRC-32 of crc.c for message sizes from 16 bytes to 1 MB. Every algorithm runs with
+ * the hardware accelerated implementation (AES-NI, ARMv8 CE, SHA-NI, PCLMULQDQ) and
+ * again with the portable one, when the two differ.
+ *
+ * MCRYPTO has no CBC mode: CBC is built on ECB as an application would do it, encryption
+ * block by block (each block depends on the previous one), decryption in one ECB call
+ * followed by the XOR with the previous ciphertext blocks.
+ *
+ * Each measurement repeats the operation for at least the minimum time, the fastest
+ * of CRYPTOBENCH_REPEATS runs is printed as a CSV line:
+ *   crypto,<algo>,<backend>,<size>,<iterations>,<cycles_per_op>,<cycles_per_byte>,<mb_per_s>
+ * Cycles are TSC cycles on x86, they are left empty on other hosts. crypt_host/bench_host.c
+ * prints the same lines for the DCP, mbedTLS and MCRYPTO backends of the target, so both
+ * outputs can be compared with the same scripts.
+ *
+ * @copyright Copyright 2020 Honeywell International Inc. All rights reserved.
+ */
+/*
+ * THIS DOCUMENT CONTAINS PROPRIETARY INFORMATION OF HONEYWELL INTERNATIONAL INC.
+ * NEITHER THIS DOCUMENT NOR THE INFORMATION CONTAINED HEREIN MAY BE REPRODUCED, USED,
+ * DISTRIBUTED OR DISCLOSED TO OTHERS WITHOUT THE WRITTEN CONSENT OF HONEYWELL.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "hal_aes.h"
+#include "aes-xts.h"
+#include "cmac1.h"
+#include "img_sha256.h"
+#include "crc.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CRYPTOBENCH_TSC
+#endif
+
+#define CRYPTOBENCH_MIN_SIZE    16U
+#define CRYPTOBENCH_MAX_SIZE    (1024U * 1024U)
+
+/* Runs per measurement, the fastest one is reported */
+#define CRYPTOBENCH_REPEATS     3
+
+const char* cryptobench_help =
+    "Usage: cryptobench [-t MS] [-m MAX_SIZE] [ALGO...]\n"
+    "\n"
+    "  -t MS        Minimum time of a run in milliseconds (default 100)\n"
+    "  -m MAX_SIZE  Largest message size in bytes (default 1048576)\n"
+    "  ALGO         aes-ecb-enc aes-ecb-dec aes-cbc-enc aes-cbc-dec aes-ctr\n"
+    "               aes-xts-enc aes-xts-dec aes-cmac sha256 crc32 (default all)\n"
+    "\n"
+    "Sizes go from 16 bytes to MAX_SIZE by factors of 4. The output is CSV:\n"
+    "  crypto,ALGO,BACKEND,SIZE,ITERATIONS,CYCLES_PER_OP,CYCLES_PER_BYTE,MB_PER_S\n";
+
+typedef int (*cryptobench_fn_t)(size_t size);
+
+typedef struct tag_cryptobench_algo
+{
+    const char* name;
+
+    /* Name of the implementation currently used */
+    const char* (*engine)(void);
+
+    /* One operation on size bytes, returns 0 if it succeeds */
+    cryptobench_fn_t run;
+} cryptobench_algo_t;
+
+typedef struct tag_cryptobench_result
+{
+    uint64_t iterations;
+    uint64_t nsec;
+    uint64_t cycles;
+} cryptobench_result_t;
+
+static mcrypto_aes_ctx_t cryptobench_aes;
+static mcrypto_aes_xts_ctx_t cryptobench_xts;
+static uint8_t cryptobench_iv[MCRYPTO_AES_BLOCK_SIZE];
+static uint8_t* cryptobench_in;
+static uint8_t* cryptobench_out;
+
+/* Keeps the compiler from dropping the results of the CRC and digest runs */
+static volatile uint32_t cryptobench_sink;
+
+/* --------------- Operations --------------- */
+
+static int cryptobench_ecb_enc(size_t size)
+{
+    return (MCRYPTO_OK != mcrypto_aes_ecb_encrypt(&cryptobench_aes, cryptobench_in, cryptobench_out, size));
+}
+
+static int cryptobench_ecb_dec(size_t size)
+{
+    return (MCRYPTO_OK != mcrypto_aes_ecb_decrypt(&cryptobench_aes, cryptobench_in, cryptobench_out, size));
+}
+
+static int cryptobench_cbc_enc(size_t size)
+{
+    const uint8_t* chain = cryptobench_iv;
+    size_t offset;
+    size_t i;
+
+    for (offset = 0; offset < size; offset += MCRYPTO_AES_BLOCK_SIZE)
+    {
+        for (i = 0; i < MCRYPTO_AES_BLOCK_SIZE; ++i)
+        {
+            cryptobench_out[offset + i] = cryptobench_in[offset + i] ^ chain[i];
+        }
+
+        if (MCRYPTO_OK != mcrypto_aes_ecb_encrypt(&cryptobench_aes, &cryptobench_out[offset], &cryptobench_out[offset], MCRYPTO_AES_BLOCK_SIZE))
+        {
+            return 1;
+        }
+
+        chain = &cryptobench_out[offset];
+    }
+
+    return 0;
+}
+
+static int cryptobench_cbc_dec(size_t size)
+{
+    size_t i;
+
+    if (MCRYPTO_OK != mcrypto_aes_ecb_decrypt(&cryptobench_aes, cryptobench_in, cryptobench_out, size))
+    {
+        return 1;
+    }
+
+    for (i = 0; i < MCRYPTO_AES_BLOCK_SIZE; ++i)
+    {
+        cryptobench_out[i] ^= cryptobench_iv[i];
+    }
+
+    for (i = MCRYPTO_AES_BLOCK_SIZE; i < size; ++i)
+    {
+        cryptobench_out[i] ^= cryptobench_in[i - MCRYPTO_AES_BLOCK_SIZE];
+    }
+
+    return 0;
+}
+
+static int cryptobench_ctr(size_t size)
+{
+    uint8_t counter[MCRYPTO_AES_BLOCK_SIZE];
+
+    memcpy(counter, cryptobench_iv, sizeof(counter));
+
+    return (MCRYPTO_OK != mcrypto_aes_ctr_crypt(&cryptobench_aes, counter, cryptobench_in, cryptobench_out, size));
+}
+
+static int cryptobench_xts_enc(size_t size)
+{
+    return (MCRYPTO_OK != mcrypto_aes_xts_encrypt(&cryptobench_xts, 0x60000000U, cryptobench_in, cryptobench_out, size));
+}
+
+static int cryptobench_xts_dec(size_t size)
+{
+    return (MCRYPTO_OK != mcrypto_aes_xts_decrypt(&cryptobench_xts, 0x60000000U, cryptobench_in, cryptobench_out, size));
+}
+
+static int cryptobench_cmac(size_t size)
+{
+    mcrypto_auth_tag_t tag;
+
+    if (MCRYPTO_OK != mcrypto_aes_cmac(&cryptobench_aes, cryptobench_in, (uint32_t) size, &tag))
+    {
+        return 1;
+    }
+
+    cryptobench_sink = tag.data[0];
+
+    return 0;
+}
+
+static int cryptobench_sha256(size_t size)
+{
+    img_sha256_ctx_t ctx;
+    uint8_t digest[IMG_SHA256_SIZE];
+
+    img_sha256_init(&ctx);
+    img_sha256_update(&ctx, cryptobench_in, size);
+    img_sha256_final(&ctx, digest);
+
+    cryptobench_sink = digest[0];
+
+    return 0;
+}
+
+static int cryptobench_crc32(size_t size)
+{
+    cryptobench_sink = crc32_ieee(cryptobench_in, size);
+
+    return 0;
+}
+
+static const cryptobench_algo_t cryptobench_algos[] =
+{
+    { "aes-ecb-enc", mcrypto_get_host_aes_engine, cryptobench_ecb_enc },
+    { "aes-ecb-dec", mcrypto_get_host_aes_engine, cryptobench_ecb_dec },
+    { "aes-cbc-enc", mcrypto_get_host_aes_engine, cryptobench_cbc_enc },
+    { "aes-cbc-dec", mcrypto_get_host_aes_engine, cryptobench_cbc_dec },
+    { "aes-ctr",     mcrypto_get_host_aes_engine, cryptobench_ctr },
+    { "aes-xts-enc", mcrypto_get_host_aes_engine, cryptobench_xts_enc },
+    { "aes-xts-dec", mcrypto_get_host_aes_engine, cryptobench_xts_dec },
+    { "aes-cmac",    mcrypto_get_host_aes_engine, cryptobench_cmac },
+    { "sha256",      img_sha256_engine,           cryptobench_sha256 },
+    { "crc32",       crc32_ieee_engine,           cryptobench_crc32 },
+};
+
+#define CRYPTOBENCH_ALGOS (sizeof(cryptobench_algos) / sizeof(cryptobench_algos[0]))
+
+/* --------------- Measurement --------------- */
+
+static uint64_t cryptobench_nsec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000U + (uint64_t) ts.tv_nsec;
+}
+
+static uint64_t cryptobench_cycles(void)
+{
+#if defined(CRYPTOBENCH_TSC)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static int cryptobench_run(const cryptobench_algo_t* algo, size_t size, uint64_t iterations, cryptobench_result_t* result)
+{
+    uint64_t start_nsec = cryptobench_nsec();
+    uint64_t start_cycles = cryptobench_cycles();
+    uint64_t i;
+
+    for (i = 0; i < iterations; ++i)
+    {
+        if (0 != algo->run(size))
+        {
+            return 1;
+        }
+    }
+
+    result->cycles = cryptobench_cycles() - start_cycles;
+    result->nsec = cryptobench_nsec() - start_nsec;
+    result->iterations = iterations;
+
+    return 0;
+}
+
+static int cryptobench_measure(const cryptobench_algo_t* algo, const char* backend, size_t size, uint64_t min_nsec)
+{
+    cryptobench_result_t best;
+    cryptobench_result_t result;
+    uint64_t iterations = 1;
+    int repeat;
+
+    /* Calibrate, which also warms up the caches */
+    for (;;)
+    {
+        if (0 != cryptobench_run(algo, size, iterations, &result))
+        {
+            fprintf(stderr, "cryptobench: %s of %zu bytes failed\n", algo->name, size);
+            return 1;
+        }
+
+        if (result.nsec >= min_nsec)
+        {
+            break;
+        }
+
+        /* Aim a bit above the minimum, at most 8 times more iterations per step */
+        if (result.nsec * 8U < min_nsec)
+        {
+            iterations *= 8U;
+        }
+        else
+        {
+            iterations = iterations * min_nsec * 5U / (result.nsec * 4U) + 1U;
+        }
+    }
+
+    best = result;
+    for (repeat = 1; repeat < CRYPTOBENCH_REPEATS; ++repeat)
+    {
+        if (0 != cryptobench_run(algo, size, iterations, &result))
+        {
+            return 1;
+        }
+
+        if (result.nsec < best.nsec)
+        {
+            best = result;
+        }
+    }
+
+    printf("crypto,%s,%s,%zu,%llu,", algo->name, backend, size, (unsigned long long) best.iterations);
+
+#if defined(CRYPTOBENCH_TSC)
+    printf("%.1f,%.3f,", (double) best.cycles / (double) best.iterations,
+           (double) best.cycles / ((double) best.iterations * (double) size));
+#else
+    printf(",,");
+#endif
+
+    printf("%.2f\n", (double) best.iterations * (double) size * 1000.0 / (double) best.nsec);
+    fflush(stdout);
+
+    return 0;
+}
+
+static void cryptobench_portable(bool portable)
+{
+    mcrypto_set_host_aes_portable(portable);
+    img_sha256_set_portable(portable);
+    crc32_ieee_set_portable(portable);
+}
+
+static int cryptobench_selected(const char* name, int argc, char** argv, int arg)
+{
+    if (arg >= argc)
+    {
+        return 1;
+    }
+
+    for (; arg < argc; ++arg)
+    {
+        if (0 == strcmp(argv[arg], name))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int cryptobench_setup(void)
+{
+    mcrypto_secret_key_t key1 = { { 0x16157e2bU, 0xa6d2ae28U, 0x8815f7abU, 0x3c4fcf09U } };
+    mcrypto_secret_key_t key2 = { { 0x03be9176U, 0xa820505eU, 0x85616eacU, 0xdca0f929U } };
+    size_t i;
+
+    cryptobench_in = aligned_alloc(64, CRYPTOBENCH_MAX_SIZE);
+    cryptobench_out = aligned_alloc(64, CRYPTOBENCH_MAX_SIZE);
+    if ((NULL == cryptobench_in) || (NULL == cryptobench_out))
+    {
+        fprintf(stderr, "cryptobench: out of memory\n");
+        return 1;
+    }
+
+    for (i = 0; i < CRYPTOBENCH_MAX_SIZE; ++i)
+    {
+        cryptobench_in[i] = (uint8_t)(i * 31U + 7U);
+    }
+
+    for (i = 0; i < sizeof(cryptobench_iv); ++i)
+    {
+        cryptobench_iv[i] = (uint8_t) i;
+    }
+
+    if ((MCRYPTO_OK != mcrypto_aes_ctx_init_with_key(&cryptobench_aes, &key1)) ||
+        (MCRYPTO_OK != mcrypto_aes_xts_ctx_init(&cryptobench_xts, &key1, &key2)))
+    {
+        fprintf(stderr, "cryptobench: cannot initialize the AES contexts\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t min_nsec = 100U * 1000000U;
+    size_t max_size = CRYPTOBENCH_MAX_SIZE;
+    const char* accelerated[CRYPTOBENCH_ALGOS];
+    size_t a;
+    size_t size;
+    int portable;
+    int arg = 1;
+    int i;
+
+    while ((arg + 1 < argc) && ('-' == argv[arg][0]))
+    {
+        if (0 == strcmp(argv[arg], "-t"))
+        {
+            min_nsec = strtoull(argv[arg + 1], NULL, 0) * 1000000U;
+        }
+        else if (0 == strcmp(argv[arg], "-m"))
+        {
+            max_size = (size_t) strtoul(argv[arg + 1], NULL, 0);
+        }
+        else
+        {
+            break;
+        }
+        arg += 2;
+    }
+
+    if ((arg < argc) && ('-' == argv[arg][0]))
+    {
+        fputs(cryptobench_help, stderr);
+        return 2;
+    }
+
+    if ((0 == min_nsec) || (CRYPTOBENCH_MIN_SIZE > max_size) || (CRYPTOBENCH_MAX_SIZE < max_size))
+    {
+        fputs(cryptobench_help, stderr);
+        return 2;
+    }
+
+    for (i = arg; i < argc; ++i)
+    {
+        for (a = 0; (a < CRYPTOBENCH_ALGOS) && (0 != strcmp(argv[i], cryptobench_algos[a].name)); ++a)
+        {
+        }
+
+        if (CRYPTOBENCH_ALGOS == a)
+        {
+            fprintf(stderr, "cryptobench: unknown algorithm %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    if (0 != cryptobench_setup())
+    {
+        return 1;
+    }
+
+    printf("crypto,algo,backend,size,iterations,cycles_per_op,cycles_per_byte,mb_per_s\n");
+
+    /* The accelerated implementations first, then the portable ones where they differ */
+    for (portable = 0; portable <= 1; ++portable)
+    {
+        cryptobench_portable(0 != portable);
+
+        for (a = 0; a < CRYPTOBENCH_ALGOS; ++a)
+        {
+            const cryptobench_algo_t* algo = &cryptobench_algos[a];
+            const char* backend = algo->engine();
+
+            if (!cryptobench_selected(algo->name, argc, argv, arg))
+            {
+                continue;
+            }
+
+            if (0 == portable)
+            {
+                accelerated[a] = backend;
+            }
+            else if (0 == strcmp(accelerated[a], backend))
+            {
+                continue;
+            }
+
+            for (size = CRYPTOBENCH_MIN_SIZE; size <= max_size; size *= 4U)
+            {
+                if (0 != cryptobench_measure(algo, backend, size, min_nsec))
+                {
+                    return 1;
+                }
+            }
+        }
+    }
+
+    cryptobench_portable(false);
+    mcrypto_aes_ctx_cleanup(&cryptobench_aes);
+    mcrypto_aes_xts_ctx_cleanup(&cryptobench_xts);
+    free(cryptobench_in);
+    free(cryptobench_out);
+
+    return 0;
+}
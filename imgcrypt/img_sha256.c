@@ -0,0 +1,296 @@
+/**
+ * @file img_sha256.c
+ * @brief SHA-256 for the host image tools
+ * @date 2026-10-19
+ *
+ * This module implements SHA-256 as defined in FIPS 180-4. The compression function
+ * uses the SHA-NI instructions when the CPU reports them, detected at run time.
+ *
+ * @copyright Copyright 2020 Honeywell International Inc. All rights reserved.
+ */
+/*
+ * THIS DOCUMENT CONTAINS PROPRIETARY INFORMATION OF HONEYWELL INTERNATIONAL INC.
+ * NEITHER THIS DOCUMENT NOR THE INFORMATION CONTAINED HEREIN MAY BE REPRODUCED, USED,
+ * DISTRIBUTED OR DISCLOSED TO OTHERS WITHOUT THE WRITTEN CONSENT OF HONEYWELL.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include "img_sha256.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define IMG_SHA256_SHANI
+#endif
+
+/* Set by img_sha256_set_portable() */
+static bool img_sha256_portable = false;
+
+static const uint32_t img_sha256_k[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t img_sha256_h0[8] =
+{
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+#define ROTR(x, n)  (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void img_sha256_blocks_portable(uint32_t* state, const uint8_t* data, size_t blocks)
+{
+    uint32_t w[64];
+    uint32_t a, b, c, d, e, f, g, h;
+    uint32_t t1, t2;
+    uint32_t i;
+
+    while (blocks-- > 0)
+    {
+        for (i = 0; i < 16; ++i)
+        {
+            w[i] = ((uint32_t) data[4 * i] << 24) | ((uint32_t) data[4 * i + 1] << 16) |
+                   ((uint32_t) data[4 * i + 2] << 8) | (uint32_t) data[4 * i + 3];
+        }
+
+        for (i = 16; i < 64; ++i)
+        {
+            uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+        f = state[5];
+        g = state[6];
+        h = state[7];
+
+        for (i = 0; i < 64; ++i)
+        {
+            t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + img_sha256_k[i] + w[i];
+            t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+
+        data += 64;
+    }
+}
+
+#if defined(IMG_SHA256_SHANI)
+
+static bool img_sha256_shani_available(void)
+{
+    return (0 != __builtin_cpu_supports("sha")) && (0 != __builtin_cpu_supports("sse4.1"));
+}
+
+/*
+ * The SHA-NI state is split in ABEF and CDGH, SHA256RNDS2 does two rounds. Each group
+ * of four rounds also advances the message schedule: MSG1 on the previous message
+ * words, MSG2 on the next ones.
+ */
+__attribute__((target("sha,sse4.1")))
+static void img_sha256_blocks_shani(uint32_t* state, const uint8_t* data, size_t blocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i state0, state1, abef, cdgh;
+    __m128i msg[4];
+    __m128i rounds, tmp;
+    uint32_t group;
+
+    tmp = _mm_loadu_si128((const __m128i*) &state[0]);
+    state1 = _mm_loadu_si128((const __m128i*) &state[4]);
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);             /* CDAB */
+    state1 = _mm_shuffle_epi32(state1, 0x1B);       /* EFGH */
+    state0 = _mm_alignr_epi8(tmp, state1, 8);       /* ABEF */
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);    /* CDGH */
+
+    while (blocks-- > 0)
+    {
+        abef = state0;
+        cdgh = state1;
+
+        for (group = 0; group < 16; ++group)
+        {
+            __m128i* cur = &msg[group % 4];
+            __m128i* prev = &msg[(group + 3) % 4];
+            __m128i* next = &msg[(group + 1) % 4];
+
+            if (4 > group)
+            {
+                *cur = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (data + 16 * group)), mask);
+            }
+
+            rounds = _mm_add_epi32(*cur, _mm_loadu_si128((const __m128i*) &img_sha256_k[4 * group]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, rounds);
+
+            if ((3 <= group) && (14 >= group))
+            {
+                tmp = _mm_alignr_epi8(*cur, *prev, 4);
+                *next = _mm_sha256msg2_epu32(_mm_add_epi32(*next, tmp), *cur);
+            }
+
+            rounds = _mm_shuffle_epi32(rounds, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, rounds);
+
+            if ((1 <= group) && (12 >= group))
+            {
+                *prev = _mm_sha256msg1_epu32(*prev, *cur);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+
+        data += 64;
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);          /* FEBA */
+    state1 = _mm_shuffle_epi32(state1, 0xB1);       /* DCHG */
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);    /* DCBA */
+    state1 = _mm_alignr_epi8(state1, tmp, 8);       /* ABEF */
+
+    _mm_storeu_si128((__m128i*) &state[0], state0);
+    _mm_storeu_si128((__m128i*) &state[4], state1);
+}
+
+#endif /* IMG_SHA256_SHANI */
+
+static void img_sha256_blocks(uint32_t* state, const uint8_t* data, size_t blocks)
+{
+#if defined(IMG_SHA256_SHANI)
+    if (!img_sha256_portable && img_sha256_shani_available())
+    {
+        img_sha256_blocks_shani(state, data, blocks);
+        return;
+    }
+#endif
+
+    img_sha256_blocks_portable(state, data, blocks);
+}
+
+void img_sha256_init(img_sha256_ctx_t* ctx)
+{
+    memcpy((void*) ctx->state, (const void*) img_sha256_h0, sizeof(ctx->state));
+    ctx->length = 0;
+}
+
+void img_sha256_update(img_sha256_ctx_t* ctx, const uint8_t* data, size_t size)
+{
+    size_t used = (size_t)(ctx->length % sizeof(ctx->buffer));
+    size_t n;
+
+    ctx->length += size;
+
+    /* Complete the buffered block */
+    if (0 < used)
+    {
+        n = sizeof(ctx->buffer) - used;
+        if (n > size)
+        {
+            n = size;
+        }
+
+        memcpy((void*) &ctx->buffer[used], (const void*) data, n);
+        data += n;
+        size -= n;
+
+        if (sizeof(ctx->buffer) > used + n)
+        {
+            return;
+        }
+
+        img_sha256_blocks(ctx->state, ctx->buffer, 1);
+    }
+
+    /* Whole blocks straight from the input */
+    n = size / sizeof(ctx->buffer);
+    if (0 < n)
+    {
+        img_sha256_blocks(ctx->state, data, n);
+        data += n * sizeof(ctx->buffer);
+        size -= n * sizeof(ctx->buffer);
+    }
+
+    memcpy((void*) ctx->buffer, (const void*) data, size);
+}
+
+void img_sha256_final(img_sha256_ctx_t* ctx, uint8_t* digest)
+{
+    size_t used = (size_t)(ctx->length % sizeof(ctx->buffer));
+    uint64_t bits = ctx->length * 8;
+    uint32_t i;
+
+    /* Padding: 0x80, zeros, 64-bit big endian length in bits */
+    ctx->buffer[used++] = 0x80;
+
+    if (sizeof(ctx->buffer) - 8 < used)
+    {
+        memset((void*) &ctx->buffer[used], 0x00, sizeof(ctx->buffer) - used);
+        img_sha256_blocks(ctx->state, ctx->buffer, 1);
+        used = 0;
+    }
+
+    memset((void*) &ctx->buffer[used], 0x00, sizeof(ctx->buffer) - 8 - used);
+
+    for (i = 0; i < 8; ++i)
+    {
+        ctx->buffer[sizeof(ctx->buffer) - 1 - i] = (uint8_t)(bits >> (8 * i));
+    }
+
+    img_sha256_blocks(ctx->state, ctx->buffer, 1);
+
+    for (i = 0; i < 8; ++i)
+    {
+        digest[4 * i]     = (uint8_t)(ctx->state[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(ctx->state[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(ctx->state[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)(ctx->state[i]);
+    }
+
+    memset((void*) ctx, 0x00, sizeof(img_sha256_ctx_t));
+}
+
+void img_sha256_set_portable(bool portable)
+{
+    img_sha256_portable = portable;
+}
+
+const char* img_sha256_engine(void)
+{
+#if defined(IMG_SHA256_SHANI)
+    if (!img_sha256_portable && img_sha256_shani_available())
+    {
+        return "sha-ni";
+    }
+#endif
+
+    return "portable";
+}
@@ -0,0 +1,71 @@
+/**
+ * @file img_sha256.h
+ * @brief SHA-256 for the host image tools
+ * @date 2026-10-19
+ *
+ * Uses the x86 SHA extensions when the CPU has them, portable C otherwise.
+ *
+ * @copyright Copyright 2020 Honeywell International Inc. All rights reserved.
+ */
+/*
+ * THIS DOCUMENT CONTAINS PROPRIETARY INFORMATION OF HONEYWELL INTERNATIONAL INC.
+ * NEITHER THIS DOCUMENT NOR THE INFORMATION CONTAINED HEREIN MAY BE REPRODUCED, USED,
+ * DISTRIBUTED OR DISCLOSED TO OTHERS WITHOUT THE WRITTEN CONSENT OF HONEYWELL.
+ */
+
+#ifndef IMG_SHA256_H
+#define IMG_SHA256_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * @brief SHA-256 digest size in bytes
+ */
+#define IMG_SHA256_SIZE (32U)
+
+/**
+ * @brief SHA-256 context
+ */
+typedef struct tag_img_sha256_ctx
+{
+    /** @brief Intermediate hash value */
+    uint32_t state[8];
+
+    /** @brief Number of bytes hashed */
+    uint64_t length;
+
+    /** @brief Bytes of the incomplete block */
+    uint8_t buffer[64];
+} img_sha256_ctx_t;
+
+void img_sha256_init(img_sha256_ctx_t* ctx);
+
+void img_sha256_update(img_sha256_ctx_t* ctx, const uint8_t* data, size_t size);
+
+void img_sha256_final(img_sha256_ctx_t* ctx, uint8_t* digest);
+
+/**
+ * @brief Use the portable implementation even if the CPU has the SHA extensions.
+ *
+ * For benchmarks, not to be changed while digests are computed.
+ */
+void img_sha256_set_portable(bool portable);
+
+/**
+ * @brief Get the name of the SHA-256 implementation in use.
+ *
+ * @return "sha-ni" or "portable"
+ */
+const char* img_sha256_engine(void);
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus*/
+
+#endif /* IMG_SHA256_H */
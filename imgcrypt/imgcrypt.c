@@ -0,0 +1,532 @@
+/**
+ * @file imgcrypt.c
+ * @brief Multi-threaded AES-128-CTR and SHA-256 for firmware images
+ * @date 2026-10-19
+ *
+ * Host tool for the image generation in fat.py. An image is split into segments
+ * of IMGCRYPT_SEGMENT_SIZE bytes, CTR segments are independent (the counter of a
+ * segment is the initial counter plus its block offset) and run on all cores.
+ * A SHA-256 can't be split without changing the digest: each file is one task,
+ * running in parallel with the other files and with the CTR segments.
+ *
+ * The output is bit-identical to the Python pipeline (ota_package_encrypt) and
+ * to RT_Enc_Hash_Data for the same key and iv.
+ *
+ * @copyright Copyright 2020 Honeywell International Inc. All rights reserved.
+ */
+/*
+ * THIS DOCUMENT CONTAINS PROPRIETARY INFORMATION OF HONEYWELL INTERNATIONAL INC.
+ * NEITHER THIS DOCUMENT NOR THE INFORMATION CONTAINED HEREIN MAY BE REPRODUCED, USED,
+ * DISTRIBUTED OR DISCLOSED TO OTHERS WITHOUT THE WRITTEN CONSENT OF HONEYWELL.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "hal_aes.h"
+#include "img_sha256.h"
+
+/* Bytes of an image handled by one task */
+#define IMGCRYPT_SEGMENT_SIZE   (256U * 1024U)
+
+#define IMGCRYPT_MAX_THREADS    64
+
+/* CTR nonce bytes, the rest of the counter block is a 32-bit big endian counter */
+#define IMGCRYPT_NONCE_SIZE     12
+
+const char* imgcrypt_help =
+    "Usage: imgcrypt [-j THREADS] COMMAND ...\n"
+    "\n"
+    "  ctr KEY NONCE COUNTER INPUT OUTPUT\n"
+    "        AES-128-CTR of INPUT, padded with 0xff to 16 bytes. The counter block is\n"
+    "        the 12-byte NONCE followed by COUNTER as 32-bit big endian, the same as\n"
+    "        AES.new(key, AES.MODE_CTR, nonce=NONCE, initial_value=COUNTER).\n"
+    "  enchash KEY IV INPUT OUTPUT\n"
+    "        RT_Enc_Hash_Data layout: AES-128-CTR of INPUT (padded with 0xff to 16\n"
+    "        bytes) from the 16-byte counter block IV, SHA-256 of the padded INPUT, IV.\n"
+    "  sha256 FILE...\n"
+    "        SHA-256 of each FILE, in the format of sha256sum.\n"
+    "  engines\n"
+    "        Print the AES and SHA-256 implementations in use.\n"
+    "\n"
+    "KEY, NONCE and IV are hex strings, COUNTER is decimal or 0x hex.\n"
+    "THREADS defaults to the number of online CPUs.\n";
+
+/* --------------- Task pool --------------- */
+
+typedef struct tag_imgcrypt_task
+{
+    /* CTR segment if ctx is set, SHA-256 of the whole data otherwise */
+    mcrypto_aes_ctx_t* ctx;
+    uint8_t counter[MCRYPTO_AES_BLOCK_SIZE];
+    const uint8_t* input;
+    uint8_t* output;
+    size_t size;
+    mcrypto_status_t status;
+} imgcrypt_task_t;
+
+typedef struct tag_imgcrypt_pool
+{
+    pthread_mutex_t lock;
+    imgcrypt_task_t* tasks;
+    size_t count;
+    size_t next;
+} imgcrypt_pool_t;
+
+static void imgcrypt_run_task(imgcrypt_task_t* task)
+{
+    if (NULL != task->ctx)
+    {
+        task->status = mcrypto_aes_ctr_crypt(task->ctx, task->counter, task->input, task->output, task->size);
+    }
+    else
+    {
+        img_sha256_ctx_t sha;
+
+        img_sha256_init(&sha);
+        img_sha256_update(&sha, task->input, task->size);
+        img_sha256_final(&sha, task->output);
+        task->status = MCRYPTO_OK;
+    }
+}
+
+static void* imgcrypt_worker(void* arg)
+{
+    imgcrypt_pool_t* pool = (imgcrypt_pool_t*) arg;
+    imgcrypt_task_t* task;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        task = (pool->next < pool->count) ? &pool->tasks[pool->next++] : NULL;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (NULL == task)
+        {
+            return NULL;
+        }
+
+        imgcrypt_run_task(task);
+    }
+}
+
+/* Runs all tasks on up to threads threads, returns -1 if one of them failed */
+static int imgcrypt_run(imgcrypt_task_t* tasks, size_t count, int threads)
+{
+    pthread_t ids[IMGCRYPT_MAX_THREADS];
+    imgcrypt_pool_t pool;
+    int started = 0;
+    size_t i;
+
+    pthread_mutex_init(&pool.lock, NULL);
+    pool.tasks = tasks;
+    pool.count = count;
+    pool.next = 0;
+
+    if ((size_t) threads > count)
+    {
+        threads = (int) count;
+    }
+
+    /* The calling thread is one of the workers */
+    while (started < threads - 1)
+    {
+        if (0 != pthread_create(&ids[started], NULL, imgcrypt_worker, &pool))
+        {
+            break;
+        }
+        started++;
+    }
+
+    imgcrypt_worker(&pool);
+
+    while (started > 0)
+    {
+        pthread_join(ids[--started], NULL);
+    }
+
+    pthread_mutex_destroy(&pool.lock);
+
+    for (i = 0; i < count; ++i)
+    {
+        if (MCRYPTO_OK != tasks[i].status)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Adds blocks to a 128-bit big endian counter block */
+static void imgcrypt_counter_add(uint8_t* counter, uint64_t blocks)
+{
+    int i;
+
+    for (i = MCRYPTO_AES_BLOCK_SIZE - 1; (i >= 0) && (0 != blocks); --i)
+    {
+        blocks += counter[i];
+        counter[i] = (uint8_t) blocks;
+        blocks >>= 8;
+    }
+}
+
+/* Splits data into CTR tasks, returns the number of tasks written */
+static size_t imgcrypt_ctr_tasks(imgcrypt_task_t* tasks, mcrypto_aes_ctx_t* ctx, const uint8_t* counter,
+                                 const uint8_t* input, uint8_t* output, size_t size)
+{
+    size_t count = 0;
+    size_t offset;
+
+    for (offset = 0; offset < size; offset += IMGCRYPT_SEGMENT_SIZE)
+    {
+        imgcrypt_task_t* task = &tasks[count++];
+
+        memset((void*) task, 0x00, sizeof(imgcrypt_task_t));
+        task->ctx = ctx;
+        memcpy((void*) task->counter, (const void*) counter, MCRYPTO_AES_BLOCK_SIZE);
+        imgcrypt_counter_add(task->counter, offset / MCRYPTO_AES_BLOCK_SIZE);
+        task->input = input + offset;
+        task->output = output + offset;
+        task->size = (size - offset < IMGCRYPT_SEGMENT_SIZE) ? (size - offset) : IMGCRYPT_SEGMENT_SIZE;
+    }
+
+    return count;
+}
+
+/* --------------- Files and arguments --------------- */
+
+/* Reads a file, padded with 0xff to a multiple of align bytes, size set to the padded size */
+static uint8_t* imgcrypt_read_file(const char* name, size_t align, size_t* size)
+{
+    FILE* file = fopen(name, "rb");
+    uint8_t* data;
+    long length;
+    size_t padded;
+
+    if (NULL == file)
+    {
+        perror(name);
+        return NULL;
+    }
+
+    if ((0 != fseek(file, 0, SEEK_END)) || (0 > (length = ftell(file))) || (0 != fseek(file, 0, SEEK_SET)))
+    {
+        perror(name);
+        fclose(file);
+        return NULL;
+    }
+
+    padded = ((size_t) length + align - 1) / align * align;
+
+    /* One more byte so an empty file still gets a buffer */
+    data = (uint8_t*) malloc(padded + 1);
+    if (NULL == data)
+    {
+        fprintf(stderr, "%s: out of memory\n", name);
+        fclose(file);
+        return NULL;
+    }
+
+    if (fread(data, 1, (size_t) length, file) != (size_t) length)
+    {
+        perror(name);
+        free(data);
+        fclose(file);
+        return NULL;
+    }
+
+    fclose(file);
+    memset((void*) (data + length), 0xff, padded - (size_t) length);
+    *size = padded;
+
+    return data;
+}
+
+static int imgcrypt_write_file(const char* name, const uint8_t* data, size_t size)
+{
+    FILE* file = fopen(name, "wb");
+
+    if (NULL == file)
+    {
+        perror(name);
+        return -1;
+    }
+
+    if ((fwrite(data, 1, size, file) != size) || (0 != fclose(file)))
+    {
+        perror(name);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Parses exactly size bytes of hex */
+static int imgcrypt_parse_hex(const char* text, uint8_t* data, size_t size)
+{
+    size_t i;
+    unsigned int byte;
+
+    if (strlen(text) != 2 * size)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < size; ++i)
+    {
+        if (1 != sscanf(&text[2 * i], "%2x", &byte))
+        {
+            return -1;
+        }
+        data[i] = (uint8_t) byte;
+    }
+
+    return 0;
+}
+
+static int imgcrypt_key(const char* text, mcrypto_aes_ctx_t* ctx)
+{
+    mcrypto_secret_key_t key;
+    int ret = 0;
+
+    if (0 != imgcrypt_parse_hex(text, (uint8_t*) key.data, sizeof(key.data)))
+    {
+        fprintf(stderr, "imgcrypt: key must be 32 hex digits\n");
+        return -1;
+    }
+
+    if (MCRYPTO_OK != mcrypto_aes_ctx_init_with_key(ctx, &key))
+    {
+        ret = -1;
+    }
+
+    memset((void*) &key, 0x00, sizeof(key));
+    return ret;
+}
+
+/* --------------- Commands --------------- */
+
+static int imgcrypt_cmd_ctr(int argc, char** argv, int threads)
+{
+    mcrypto_aes_ctx_t ctx;
+    uint8_t counter[MCRYPTO_AES_BLOCK_SIZE];
+    unsigned long initial;
+    imgcrypt_task_t* tasks;
+    uint8_t* data;
+    size_t size;
+    char* end;
+    int ret = -1;
+
+    if (5 != argc)
+    {
+        fputs(imgcrypt_help, stderr);
+        return -1;
+    }
+
+    initial = strtoul(argv[2], &end, 0);
+    if ((0 != imgcrypt_parse_hex(argv[1], counter, IMGCRYPT_NONCE_SIZE)) || ('\0' != *end) || (0xffffffffUL < initial))
+    {
+        fprintf(stderr, "imgcrypt: nonce must be 24 hex digits, counter a 32-bit number\n");
+        return -1;
+    }
+
+    counter[12] = (uint8_t)(initial >> 24);
+    counter[13] = (uint8_t)(initial >> 16);
+    counter[14] = (uint8_t)(initial >> 8);
+    counter[15] = (uint8_t)(initial);
+
+    if (0 != imgcrypt_key(argv[0], &ctx))
+    {
+        return -1;
+    }
+
+    data = imgcrypt_read_file(argv[3], MCRYPTO_AES_BLOCK_SIZE, &size);
+    if (NULL == data)
+    {
+        mcrypto_aes_ctx_cleanup(&ctx);
+        return -1;
+    }
+
+    /* The 32-bit counter of the Python pipeline must not wrap */
+    if ((uint64_t) initial + size / MCRYPTO_AES_BLOCK_SIZE > 0x100000000ULL)
+    {
+        fprintf(stderr, "imgcrypt: counter overflow\n");
+    }
+    else if (NULL != (tasks = (imgcrypt_task_t*) calloc(size / IMGCRYPT_SEGMENT_SIZE + 1, sizeof(imgcrypt_task_t))))
+    {
+        size_t count = imgcrypt_ctr_tasks(tasks, &ctx, counter, data, data, size);
+
+        if ((0 == imgcrypt_run(tasks, count, threads)) && (0 == imgcrypt_write_file(argv[4], data, size)))
+        {
+            ret = 0;
+        }
+        free(tasks);
+    }
+
+    mcrypto_aes_ctx_cleanup(&ctx);
+    free(data);
+    return ret;
+}
+
+static int imgcrypt_cmd_enchash(int argc, char** argv, int threads)
+{
+    mcrypto_aes_ctx_t ctx;
+    uint8_t iv[MCRYPTO_AES_BLOCK_SIZE];
+    imgcrypt_task_t* tasks;
+    uint8_t* plain;
+    uint8_t* cipher;
+    size_t size;
+    size_t count;
+    int ret = -1;
+
+    if (4 != argc)
+    {
+        fputs(imgcrypt_help, stderr);
+        return -1;
+    }
+
+    if (0 != imgcrypt_parse_hex(argv[1], iv, sizeof(iv)))
+    {
+        fprintf(stderr, "imgcrypt: iv must be 32 hex digits\n");
+        return -1;
+    }
+
+    if (0 != imgcrypt_key(argv[0], &ctx))
+    {
+        return -1;
+    }
+
+    plain = imgcrypt_read_file(argv[2], MCRYPTO_AES_BLOCK_SIZE, &size);
+    if (NULL == plain)
+    {
+        mcrypto_aes_ctx_cleanup(&ctx);
+        return -1;
+    }
+
+    tasks = (imgcrypt_task_t*) calloc(size / IMGCRYPT_SEGMENT_SIZE + 2, sizeof(imgcrypt_task_t));
+    cipher = (uint8_t*) malloc(size + IMG_SHA256_SIZE + sizeof(iv));
+
+    if ((NULL != cipher) && (NULL != tasks))
+    {
+        /* The hash first, so that it starts on a core of its own */
+        tasks[0].input = plain;
+        tasks[0].output = cipher + size;
+        tasks[0].size = size;
+        count = 1 + imgcrypt_ctr_tasks(&tasks[1], &ctx, iv, plain, cipher, size);
+
+        memcpy((void*) (cipher + size + IMG_SHA256_SIZE), (const void*) iv, sizeof(iv));
+
+        if ((0 == imgcrypt_run(tasks, count, threads)) &&
+            (0 == imgcrypt_write_file(argv[3], cipher, size + IMG_SHA256_SIZE + sizeof(iv))))
+        {
+            ret = 0;
+        }
+    }
+
+    mcrypto_aes_ctx_cleanup(&ctx);
+    free(tasks);
+    free(cipher);
+    free(plain);
+    return ret;
+}
+
+static int imgcrypt_cmd_sha256(int argc, char** argv, int threads)
+{
+    imgcrypt_task_t* tasks;
+    uint8_t* digests;
+    int ret = -1;
+    int i, j;
+
+    if (0 == argc)
+    {
+        fputs(imgcrypt_help, stderr);
+        return -1;
+    }
+
+    tasks = (imgcrypt_task_t*) calloc((size_t) argc, sizeof(imgcrypt_task_t));
+    digests = (uint8_t*) malloc((size_t) argc * IMG_SHA256_SIZE);
+
+    for (i = 0; (NULL != tasks) && (NULL != digests) && (i < argc); ++i)
+    {
+        tasks[i].input = imgcrypt_read_file(argv[i], 1, &tasks[i].size);
+        tasks[i].output = digests + i * IMG_SHA256_SIZE;
+        if (NULL == tasks[i].input)
+        {
+            break;
+        }
+    }
+
+    if ((i == argc) && (0 == imgcrypt_run(tasks, (size_t) argc, threads)))
+    {
+        for (i = 0; i < argc; ++i)
+        {
+            for (j = 0; j < (int) IMG_SHA256_SIZE; ++j)
+            {
+                printf("%02x", digests[i * IMG_SHA256_SIZE + j]);
+            }
+            printf("  %s\n", argv[i]);
+        }
+        ret = 0;
+    }
+
+    for (i = 0; (NULL != tasks) && (i < argc); ++i)
+    {
+        free((void*) tasks[i].input);
+    }
+    free(tasks);
+    free(digests);
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int arg = 1;
+
+    if ((arg + 1 < argc) && (0 == strcmp(argv[arg], "-j")))
+    {
+        threads = strtol(argv[arg + 1], NULL, 0);
+        arg += 2;
+    }
+
+    if (threads < 1)
+    {
+        threads = 1;
+    }
+    if (threads > IMGCRYPT_MAX_THREADS)
+    {
+        threads = IMGCRYPT_MAX_THREADS;
+    }
+
+    if (arg >= argc)
+    {
+        fputs(imgcrypt_help, stderr);
+        return 2;
+    }
+
+    if (0 == strcmp(argv[arg], "ctr"))
+    {
+        return (0 == imgcrypt_cmd_ctr(argc - arg - 1, &argv[arg + 1], (int) threads)) ? 0 : 1;
+    }
+    if (0 == strcmp(argv[arg], "enchash"))
+    {
+        return (0 == imgcrypt_cmd_enchash(argc - arg - 1, &argv[arg + 1], (int) threads)) ? 0 : 1;
+    }
+    if (0 == strcmp(argv[arg], "sha256"))
+    {
+        return (0 == imgcrypt_cmd_sha256(argc - arg - 1, &argv[arg + 1], (int) threads)) ? 0 : 1;
+    }
+    if (0 == strcmp(argv[arg], "engines"))
+    {
+        printf("aes %s\nsha256 %s\nthreads %ld\n", mcrypto_get_host_aes_engine(), img_sha256_engine(), threads);
+        return 0;
+    }
+
+    fputs(imgcrypt_help, stderr);
+    return 2;
+}
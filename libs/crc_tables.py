@@ -0,0 +1,83 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+# Generates crc_tables.h, the slicing-by-8 lookup tables of crc.c.
+#   python libs/crc_tables.py > crc_tables.h
+
+
+def reflected_table(poly, width):
+    mask = (1 << width) - 1
+    table = []
+    for i in range(256):
+        crc = i
+        for _ in range(8):
+            crc = (crc >> 1) ^ poly if crc & 1 else crc >> 1
+        table.append(crc & mask)
+    return table
+
+
+def normal_table(poly, width):
+    mask = (1 << width) - 1
+    top = 1 << (width - 1)
+    table = []
+    for i in range(256):
+        crc = i << (width - 8)
+        for _ in range(8):
+            crc = ((crc << 1) ^ poly) if crc & top else crc << 1
+        table.append(crc & mask)
+    return table
+
+
+def reflected_slices(poly, width):
+    t = [reflected_table(poly, width)]
+    for k in range(1, 8):
+        t.append([(t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF] for i in range(256)])
+    return t
+
+
+def normal_slices(poly, width):
+    mask = (1 << width) - 1
+    t = [normal_table(poly, width)]
+    for k in range(1, 8):
+        t.append([((t[k - 1][i] << 8) & mask) ^ t[0][t[k - 1][i] >> (width - 8)] for i in range(256)])
+    return t
+
+
+def emit_rows(name, ctype, digits, slices):
+    print('static const %s %s[CRC_TABLE_SLICES][256] = {' % (ctype, name))
+    for k, row in enumerate(slices):
+        if k == 1:
+            print('#if CRC_CFG_SLICE_BY8')
+        print('  {')
+        for i in range(0, 256, 8):
+            print('    ' + ', '.join('0x%0*X' % (digits, v) for v in row[i:i + 8]) + ',')
+        print('  },')
+    print('#endif')
+    print('};')
+    print('')
+
+
+def main():
+    print('/* Generated by libs/crc_tables.py, do not edit. */')
+    print('')
+    print('#ifndef __CRC_TABLES_H__')
+    print('#define __CRC_TABLES_H__')
+    print('')
+    print('/* CRC-16/MODBUS, reflected polynomial 0xA001 */')
+    emit_rows('crc16_modbus_table', 'uint16_t', 4, reflected_slices(0xA001, 16))
+    print('/* CRC-16/CCITT, polynomial 0x1021 */')
+    emit_rows('crc16_ccitt_table', 'uint16_t', 4, normal_slices(0x1021, 16))
+    print('/* CRC-32, reflected polynomial 0xEDB88320 */')
+    emit_rows('crc32_ieee_table', 'uint32_t', 8, reflected_slices(0xEDB88320, 32))
+    print('/* CRC-8 of the BACnet MS/TP header, polynomial x^8 + x^7 + 1 (reflected 0x81) */')
+    print('static const uint8_t crc8_mstp_table[256] = {')
+    row = reflected_table(0x81, 8)
+    for i in range(0, 256, 8):
+        print('  ' + ', '.join('0x%02X' % v for v in row[i:i + 8]) + ',')
+    print('};')
+    print('')
+    print('#endif')
+
+
+if __name__ == '__main__':
+    main()
@@ -30,6 +30,14 @@ const uint32_t mcrypto_xts_data_unit_size = 1024U;
 /* GF(2^128) primitive element contant for 128-bit blocks */
 #define RB_CONSTANT 0x87
 
+/**
+ * @brief Number of data units whose tweaks and blocks go to the AES engine in one call each.
+ * Bounds the stack used for the encrypted tweaks to 16 bytes per unit.
+ */
+#ifndef MCRYPTO_XTS_BATCH_UNITS
+#define MCRYPTO_XTS_BATCH_UNITS 8U
+#endif
+
 /* Encryption / decryption function pointer type */
 typedef mcrypto_status_t (*mcrypto_aes_ecb_crypt_func_t)(mcrypto_aes_ctx_t* ctx, const uint8_t* plaintext, uint8_t* ciphertext, size_t size);
 
@@ -39,6 +47,10 @@ static void mcrypto_multiply_by_alpha_le(uint32_t* value);
 static mcrypto_status_t mcrypto_aes_xts_internal(mcrypto_aes_ecb_crypt_func_t crypto_funct, mcrypto_aes_xts_ctx_t* ctx, uint64_t address,
                                             const uint8_t* input, uint8_t* output, uint32_t size);
 
+/* XOR the tweak sequence of consecutive data units, starting at block aes_block_index of the first one */
+static void mcrypto_xts_whiten(uint32_t tweaks[][MCRYPTO_AES_BLOCK_SIZE / sizeof(uint32_t)], uint32_t aes_block_index,
+                               const uint8_t* input, uint8_t* output, uint32_t size);
+
 mcrypto_status_t mcrypto_aes_xts_ctx_init(mcrypto_aes_xts_ctx_t* ctx, mcrypto_secret_key_t* key1, mcrypto_secret_key_t* key2)
 {
     if ((NULL == ctx) || (NULL == key1) || (NULL == key2))
@@ -106,19 +118,24 @@ static mcrypto_status_t mcrypto_aes_xts_internal(mcrypto_aes_ecb_crypt_func_t cr
     }
 
     mcrypto_status_t status;
-    uint32_t i;
+    uint32_t units;
+    uint32_t segment_size;
+    uint32_t unit_bytes;
     uint32_t input_i = 0;
 
-    alignas(4) uint8_t tweak[MCRYPTO_AES_BLOCK_SIZE];
-    alignas(4) uint8_t buffer[MCRYPTO_AES_BLOCK_SIZE];
+    /* Encrypted tweaks of the data units of one segment */
+    alignas(4) uint32_t tweaks[MCRYPTO_XTS_BATCH_UNITS][MCRYPTO_AES_BLOCK_SIZE / sizeof(uint32_t)];
 
-    uint32_t aes_block_index; /* Index of the 16-byte block inside the data block */
+    uint32_t aes_block_index; /* Index of the 16-byte block inside the first data unit */
 
     while (input_i < size)
     {
-        /* Encrypt all the data that are inside a single data unit */
+        /*
+         * Process the data of up to MCRYPTO_XTS_BATCH_UNITS data units as one segment:
+         * one ECB call for all their tweaks, one ECB call for all their blocks.
+         */
 
-        memset(tweak, 0x00, sizeof(tweak));
+        memset(tweaks, 0x00, sizeof(tweaks));
 
         /* Split the input address to:
          *  - data unit index - index of the data unit that the address is within
@@ -127,60 +144,97 @@ static mcrypto_status_t mcrypto_aes_xts_internal(mcrypto_aes_ecb_crypt_func_t cr
 
         /* mcrypto_xts_data_unit_size is a power of 2 */
         aes_block_index = ((uint32_t)(address) % mcrypto_xts_data_unit_size) / MCRYPTO_AES_BLOCK_SIZE;
-        *(uint64_t*)(tweak) = address / mcrypto_xts_data_unit_size;
 
-        /* Encrypt the tweak in place using the key2 */
-        status = mcrypto_aes_ecb_encrypt(&(ctx->aes_ctx2), tweak, tweak, sizeof(tweak));
+        units = 0;
+        segment_size = 0;
+        unit_bytes = mcrypto_xts_data_unit_size - aes_block_index * MCRYPTO_AES_BLOCK_SIZE;
+        while ((units < MCRYPTO_XTS_BATCH_UNITS) && (input_i + segment_size < size))
+        {
+            /* Little endian data unit index */
+            tweaks[units][0] = (uint32_t)(address / mcrypto_xts_data_unit_size + units);
+            tweaks[units][1] = (uint32_t)((address / mcrypto_xts_data_unit_size + units) >> 32);
+
+            if (unit_bytes > size - input_i - segment_size)
+            {
+                unit_bytes = size - input_i - segment_size;
+            }
+            segment_size += unit_bytes;
+            unit_bytes = mcrypto_xts_data_unit_size;
+            units++;
+        }
+
+        /* Encrypt the tweaks in place using the key2 */
+        status = mcrypto_aes_ecb_encrypt(&(ctx->aes_ctx2), (uint8_t*)tweaks, (uint8_t*)tweaks, units * MCRYPTO_AES_BLOCK_SIZE);
         if (MCRYPTO_OK != status)
         {
             return status;
         }
 
-        /* Modify the tweak based on the aes_block_index */
-        for (i = 0; i < aes_block_index; ++i)
+        /* XOR the tweaks with the input, encrypt / decrypt, XOR them again after */
+        mcrypto_xts_whiten(tweaks, aes_block_index, input + input_i, output + input_i, segment_size);
+
+        status = crypto_funct(&(ctx->aes_ctx1), output + input_i, output + input_i, segment_size);
+        if (MCRYPTO_OK != status)
         {
-            mcrypto_multiply_by_alpha_le((uint32_t*)tweak);
+            return status;
         }
 
-        /* Encrypt/Decrypt all blocks inside this data unit */
-        while ((input_i < size) && (aes_block_index*MCRYPTO_AES_BLOCK_SIZE < mcrypto_xts_data_unit_size))
-        {
-            /* XOR the tweak with the input */
-            for(i=0;i<MCRYPTO_AES_BLOCK_SIZE;i++)
-            {
-                buffer[i] = input[input_i+i] ^ tweak[i];
-            }
+        mcrypto_xts_whiten(tweaks, aes_block_index, output + input_i, output + input_i, segment_size);
 
-            status = crypto_funct(&(ctx->aes_ctx1), buffer, buffer, sizeof(buffer));
-            if (MCRYPTO_OK != status)
-            {
-                return status;
-            }
+        input_i += segment_size;
+        address += segment_size;
+    }
 
-            /* XOR the tweak after the encryption / decryption and write it to the result */
-            for(i=0;i<MCRYPTO_AES_BLOCK_SIZE;i++)
-            {
-                buffer[i] = buffer[i] ^ tweak[i];
-                output[input_i+i] = buffer[i];
-            }
+    return MCRYPTO_OK;
+}
 
-            /* Prepare the tweak for the next block */
-            /* Unlike in XEX, we use also aes_block_index = 0 */
-            mcrypto_multiply_by_alpha_le((uint32_t*)tweak);
+static void mcrypto_xts_whiten(uint32_t tweaks[][MCRYPTO_AES_BLOCK_SIZE / sizeof(uint32_t)], uint32_t aes_block_index,
+                               const uint8_t* input, uint8_t* output, uint32_t size)
+{
+    alignas(4) uint32_t tweak[MCRYPTO_AES_BLOCK_SIZE / sizeof(uint32_t)];
+    uint32_t block[MCRYPTO_AES_BLOCK_SIZE / sizeof(uint32_t)];
+    const uint32_t blocks_per_unit = mcrypto_xts_data_unit_size / MCRYPTO_AES_BLOCK_SIZE;
+    uint32_t blocks = size / MCRYPTO_AES_BLOCK_SIZE;
+    uint32_t unit = 0;
+    uint32_t i;
 
-            input_i += MCRYPTO_AES_BLOCK_SIZE;
-            aes_block_index += 1;
-        }
+    memcpy(tweak, tweaks[0], sizeof(tweak));
 
-        /**
-         * We have encrypted all the data that are inside one data unit.
-         * Before continuing to the next data unit with the rest of the data (if any),
-         * adjust the address to the start of the next data unit.
-         */
-        address = address - (address % mcrypto_xts_data_unit_size) + mcrypto_xts_data_unit_size;
+    /* Modify the tweak based on the aes_block_index */
+    for (i = 0; i < aes_block_index; ++i)
+    {
+        mcrypto_multiply_by_alpha_le(tweak);
     }
 
-    return MCRYPTO_OK;
+    while (blocks > 0)
+    {
+        /* A word at a time; the caller's buffers may be unaligned, memcpy compiles to plain loads / stores */
+        memcpy(block, input, sizeof(block));
+        block[0] ^= tweak[0];
+        block[1] ^= tweak[1];
+        block[2] ^= tweak[2];
+        block[3] ^= tweak[3];
+        memcpy(output, block, sizeof(block));
+        input += MCRYPTO_AES_BLOCK_SIZE;
+        output += MCRYPTO_AES_BLOCK_SIZE;
+        blocks--;
+
+        /* Prepare the tweak for the next block */
+        /* Unlike in XEX, we use also aes_block_index = 0 */
+        if (++aes_block_index == blocks_per_unit)
+        {
+            /* First block of the next data unit */
+            aes_block_index = 0;
+            if (blocks > 0)
+            {
+                memcpy(tweak, tweaks[++unit], sizeof(tweak));
+            }
+        }
+        else
+        {
+            mcrypto_multiply_by_alpha_le(tweak);
+        }
+    }
 }
 
 static void mcrypto_multiply_by_alpha_le(uint32_t* value)
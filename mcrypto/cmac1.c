@@ -93,12 +93,38 @@ mcrypto_status_t mcrypto_aes_cmac(mcrypto_aes_ctx_t* ctx, const void* data, uint
     mcrypto_status_t status;
     uint32_t i;
 
-    alignas(4) uint8_t buffer[MCRYPTO_AES_BLOCK_SIZE] = {0U};
+    /* The subkey block followed by the chaining block, so both can go to one ECB call */
+    alignas(4) uint8_t blocks[2 * MCRYPTO_AES_BLOCK_SIZE] = {0U};
 
-    alignas(4) uint8_t subkey[MCRYPTO_AES_BLOCK_SIZE] = {0U};
+    uint8_t* subkey = blocks;
+
+    uint8_t* buffer = blocks + MCRYPTO_AES_BLOCK_SIZE;
+
+    bool subkey_ready = false;
 
     uint8_t* message = (uint8_t*) data;
 
+    /* --------------- Generate subkey1 together with the first message block --------------- */
+
+    /*
+     * L = AES(0) doesn't depend on the message, encrypt it along with the first block.
+     * The following blocks are chained and need one ECB call each.
+     */
+    if (size > MCRYPTO_AES_BLOCK_SIZE)
+    {
+        memcpy((void*) buffer, (const void*) message, MCRYPTO_AES_BLOCK_SIZE);
+        message += MCRYPTO_AES_BLOCK_SIZE;
+
+        status = mcrypto_aes_ecb_encrypt(ctx, blocks, blocks, sizeof(blocks));
+        if(MCRYPTO_OK != status)
+        {
+            return status;
+        }
+
+        subkey_ready = true;
+        size -= MCRYPTO_AES_BLOCK_SIZE;
+    }
+
     /* --------------- Process all message blocks expect the last one --------------- */
 
     while (size > MCRYPTO_AES_BLOCK_SIZE)
@@ -110,7 +136,7 @@ mcrypto_status_t mcrypto_aes_cmac(mcrypto_aes_ctx_t* ctx, const void* data, uint
         }
 
         /* Encrypt with AES in ECB mode */
-        status = mcrypto_aes_ecb_encrypt(ctx, buffer, buffer, sizeof(buffer));
+        status = mcrypto_aes_ecb_encrypt(ctx, buffer, buffer, MCRYPTO_AES_BLOCK_SIZE);
 
         if(MCRYPTO_OK != status)
         {
@@ -120,12 +146,15 @@ mcrypto_status_t mcrypto_aes_cmac(mcrypto_aes_ctx_t* ctx, const void* data, uint
         size -= MCRYPTO_AES_BLOCK_SIZE;
     }
 
-    /* --------------- Generate subkey1 --------------- */
+    /* --------------- Generate subkey1 for a single block message --------------- */
 
-    status = mcrypto_aes_ecb_encrypt(ctx, subkey, subkey, sizeof(subkey));
-    if(MCRYPTO_OK != status)
+    if (!subkey_ready)
     {
-        return status;
+        status = mcrypto_aes_ecb_encrypt(ctx, subkey, subkey, MCRYPTO_AES_BLOCK_SIZE);
+        if(MCRYPTO_OK != status)
+        {
+            return status;
+        }
     }
 
     mcrypto_multiply_by_alpha(subkey);
@@ -154,14 +183,14 @@ mcrypto_status_t mcrypto_aes_cmac(mcrypto_aes_ctx_t* ctx, const void* data, uint
     }
 
     /* Encrypt with AES in ECB mode */
-    status = mcrypto_aes_ecb_encrypt(ctx, buffer, buffer, sizeof(buffer));
+    status = mcrypto_aes_ecb_encrypt(ctx, buffer, buffer, MCRYPTO_AES_BLOCK_SIZE);
     if(MCRYPTO_OK != status)
     {
         return status;
     }
 
     /* Copy the result */
-    memcpy((void*) auth_tag->data, (void*) buffer, sizeof(buffer));
+    memcpy((void*) auth_tag->data, (void*) buffer, MCRYPTO_AES_BLOCK_SIZE);
 
     return MCRYPTO_OK;
 }
@@ -21,7 +21,7 @@
  */
 
 #include <assert.h>
-#include "kdf.h"
+#include "key_cache.h"
 #include "cmac1.h"
 #include "data_authentication.h"
 
@@ -32,32 +32,13 @@ mcrypto_status_t mcrypto_dauth_ctx_init(mcrypto_dauth_ctx_t* ctx)
         return MCRYPTO_INVALID_ARGS;
     }
 
-    mcrypto_status_t status;
-    mcrypto_secret_key_t key;
-
     /* Key generation inputs */
-    unsigned char label[] = "MCrypto Data Authentication";
-    unsigned char context[] = { 0xCA, 0xFE, 0xBA, 0xBE }; /* There is no context (in the NIST SP800 sense), so use fixed magic value */
-    
-    /* Generate the secret key for data authentication from the device protected key */
-    status = mcrypto_kdf_with_device_key((uint8_t*)(key.data), sizeof(key.data), label, sizeof(label), context, sizeof(context));
-
-    if (MCRYPTO_OK != status)
-    {
-        return status;
-    }
+    static const unsigned char label[] = "MCrypto Data Authentication";
+    static const unsigned char context[] = { 0xCA, 0xFE, 0xBA, 0xBE }; /* There is no context (in the NIST SP800 sense), so use fixed magic value */
 
-    /* Initialize the context with the derived key */
-    status = mcrypto_aes_ctx_init_with_key((mcrypto_aes_ctx_t*)ctx, &key);
-
-    memset(&key, 0x00, sizeof(mcrypto_secret_key_t));
-
-    if (MCRYPTO_OK != status)
-    {
-        return status;
-    }
-
-    return MCRYPTO_OK;
+    /* Initialize the context with the secret key for data authentication derived from the device protected key,
+       the derivation is cached so that the *_easy functions don't repeat it on every call */
+    return mcrypto_key_cache_get(label, sizeof(label), context, sizeof(context), 1U, (mcrypto_aes_ctx_t*)ctx);
 }
 
 mcrypto_status_t mcrypto_dauth_ctx_cleanup(mcrypto_dauth_ctx_t* ctx)
@@ -25,8 +25,13 @@
  * Include platform dependent headers.
  * These must define the aes context type mcrypto_aes_ctx_t 
  * and optionally other platform dependent functions.
+ * MCRYPTO_HAL_HOST selects the host backend, used by the tooling and tests.
  */
+#if defined(MCRYPTO_HAL_HOST)
+#include "hal_aes_host.h"
+#else
 #include "hal_aes_imxrt.h"
+#endif
 
 #if defined(__cplusplus)
 extern "C" {
@@ -0,0 +1,683 @@
+/**
+ * @file hal_aes_host.c
+ * @brief AES HAL implementation for a host computer
+ * @date 2026-10-19
+ *
+ * This module implements AES functions on x86 with the AES-NI instructions, on
+ * ARMv8 with the cryptography extension and elsewhere in portable C. AES-NI is
+ * detected at run time, the ARMv8 extension when compiling.
+ *
+ * The hardware paths keep MCRYPTO_HOST_PIPELINE_BLOCKS blocks in flight, the AES
+ * instructions have a latency of several cycles but a throughput of one per cycle.
+ * Multi-block ECB calls (XTS, CMAC subkey) and CTR benefit from it.
+ *
+ * @copyright Copyright 2020 Honeywell International Inc. All rights reserved.
+ */
+/*
+ * THIS DOCUMENT CONTAINS PROPRIETARY INFORMATION OF HONEYWELL INTERNATIONAL INC.
+ * NEITHER THIS DOCUMENT NOR THE INFORMATION CONTAINED HEREIN MAY BE REPRODUCED, USED,
+ * DISTRIBUTED OR DISCLOSED TO OTHERS WITHOUT THE WRITTEN CONSENT OF HONEYWELL.
+ */
+#include <stddef.h>
+#include "mcrypto.h"
+#include "hal_aes.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#define MCRYPTO_HOST_AESNI
+#elif defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES)
+#include <arm_neon.h>
+#define MCRYPTO_HOST_ARMV8_CE
+#endif
+
+/**
+ * @brief Number of blocks processed in parallel by the hardware paths.
+ */
+#ifndef MCRYPTO_HOST_PIPELINE_BLOCKS
+#define MCRYPTO_HOST_PIPELINE_BLOCKS 8U
+#endif
+
+static const uint8_t mcrypto_sbox[256] =
+{
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+static const uint8_t mcrypto_inv_sbox[256] =
+{
+    0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
+    0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
+    0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+    0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
+    0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
+    0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+    0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
+    0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
+    0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+    0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
+    0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
+    0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+    0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
+    0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
+    0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+    0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d
+};
+
+static const uint8_t mcrypto_rcon[MCRYPTO_AES_ROUNDS] =
+{
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36
+};
+
+/* Key of mcrypto_aes_ctx_init_with_devkey() */
+static mcrypto_secret_key_t mcrypto_host_devkey;
+static bool mcrypto_host_devkey_set = false;
+
+/* Incremented by mcrypto_set_host_devkey(), checked by the key cache */
+static uint32_t mcrypto_host_devkey_generation = 0;
+
+/* Set by mcrypto_set_host_aes_portable() */
+static bool mcrypto_host_portable = false;
+
+/* Local functions */
+static void mcrypto_encrypt_blocks(const mcrypto_aes_ctx_t* ctx, const uint8_t* input, uint8_t* output, size_t blocks);
+static void mcrypto_decrypt_blocks(const mcrypto_aes_ctx_t* ctx, const uint8_t* input, uint8_t* output, size_t blocks);
+
+static uint8_t mcrypto_xtime(uint8_t value)
+{
+    return (uint8_t)((value << 1) ^ ((value & 0x80) ? 0x1b : 0x00));
+}
+
+/* MixColumns of one 4-byte column */
+static void mcrypto_mix_column(uint8_t* column)
+{
+    uint8_t a0 = column[0];
+    uint8_t a1 = column[1];
+    uint8_t a2 = column[2];
+    uint8_t a3 = column[3];
+    uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+
+    column[0] = a0 ^ all ^ mcrypto_xtime(a0 ^ a1);
+    column[1] = a1 ^ all ^ mcrypto_xtime(a1 ^ a2);
+    column[2] = a2 ^ all ^ mcrypto_xtime(a2 ^ a3);
+    column[3] = a3 ^ all ^ mcrypto_xtime(a3 ^ a0);
+}
+
+/* InvMixColumns of one 4-byte column, as a pre-multiplication followed by MixColumns */
+static void mcrypto_inv_mix_column(uint8_t* column)
+{
+    uint8_t u = mcrypto_xtime(mcrypto_xtime(column[0] ^ column[2]));
+    uint8_t v = mcrypto_xtime(mcrypto_xtime(column[1] ^ column[3]));
+
+    column[0] ^= u;
+    column[1] ^= v;
+    column[2] ^= u;
+    column[3] ^= v;
+
+    mcrypto_mix_column(column);
+}
+
+static void mcrypto_expand_key(mcrypto_aes_ctx_t* ctx, const uint8_t* key)
+{
+    uint32_t round;
+    uint32_t i;
+
+    memcpy((void*) ctx->enc_keys[0], (const void*) key, MCRYPTO_AES_BLOCK_SIZE);
+
+    for (round = 1; round <= MCRYPTO_AES_ROUNDS; ++round)
+    {
+        const uint8_t* prev = ctx->enc_keys[round - 1];
+        uint8_t* next = ctx->enc_keys[round];
+
+        /* RotWord, SubWord and Rcon of the last word of the previous round key */
+        next[0] = prev[0] ^ mcrypto_sbox[prev[13]] ^ mcrypto_rcon[round - 1];
+        next[1] = prev[1] ^ mcrypto_sbox[prev[14]];
+        next[2] = prev[2] ^ mcrypto_sbox[prev[15]];
+        next[3] = prev[3] ^ mcrypto_sbox[prev[12]];
+
+        for (i = 4; i < MCRYPTO_AES_BLOCK_SIZE; ++i)
+        {
+            next[i] = prev[i] ^ next[i - 4];
+        }
+    }
+
+    /* Equivalent inverse cipher: reversed order, InvMixColumns applied to the inner round keys */
+    for (round = 0; round <= MCRYPTO_AES_ROUNDS; ++round)
+    {
+        memcpy((void*) ctx->dec_keys[round], (const void*) ctx->enc_keys[MCRYPTO_AES_ROUNDS - round], MCRYPTO_AES_BLOCK_SIZE);
+
+        if ((0 < round) && (MCRYPTO_AES_ROUNDS > round))
+        {
+            for (i = 0; i < MCRYPTO_AES_BLOCK_SIZE; i += 4)
+            {
+                mcrypto_inv_mix_column(&(ctx->dec_keys[round][i]));
+            }
+        }
+    }
+}
+
+/* --------------- Portable implementation --------------- */
+
+/* The state is kept in the FIPS-197 byte order, the byte at row r and column c is at index 4 * c + r */
+
+static void mcrypto_portable_encrypt_block(const mcrypto_aes_ctx_t* ctx, const uint8_t* input, uint8_t* output)
+{
+    uint8_t state[MCRYPTO_AES_BLOCK_SIZE];
+    uint8_t tmp[MCRYPTO_AES_BLOCK_SIZE];
+    uint32_t round;
+    uint32_t c, r;
+
+    for (c = 0; c < MCRYPTO_AES_BLOCK_SIZE; ++c)
+    {
+        state[c] = input[c] ^ ctx->enc_keys[0][c];
+    }
+
+    for (round = 1; round <= MCRYPTO_AES_ROUNDS; ++round)
+    {
+        /* SubBytes and ShiftRows */
+        for (c = 0; c < 4; ++c)
+        {
+            for (r = 0; r < 4; ++r)
+            {
+                tmp[4 * c + r] = mcrypto_sbox[state[4 * ((c + r) % 4) + r]];
+            }
+        }
+
+        if (MCRYPTO_AES_ROUNDS > round)
+        {
+            for (c = 0; c < MCRYPTO_AES_BLOCK_SIZE; c += 4)
+            {
+                mcrypto_mix_column(&tmp[c]);
+            }
+        }
+
+        for (c = 0; c < MCRYPTO_AES_BLOCK_SIZE; ++c)
+        {
+            state[c] = tmp[c] ^ ctx->enc_keys[round][c];
+        }
+    }
+
+    memcpy((void*) output, (const void*) state, MCRYPTO_AES_BLOCK_SIZE);
+}
+
+static void mcrypto_portable_decrypt_block(const mcrypto_aes_ctx_t* ctx, const uint8_t* input, uint8_t* output)
+{
+    uint8_t state[MCRYPTO_AES_BLOCK_SIZE];
+    uint8_t tmp[MCRYPTO_AES_BLOCK_SIZE];
+    uint32_t round;
+    uint32_t c, r;
+
+    for (c = 0; c < MCRYPTO_AES_BLOCK_SIZE; ++c)
+    {
+        state[c] = input[c] ^ ctx->dec_keys[0][c];
+    }
+
+    for (round = 1; round <= MCRYPTO_AES_ROUNDS; ++round)
+    {
+        /* InvSubBytes and InvShiftRows */
+        for (c = 0; c < 4; ++c)
+        {
+            for (r = 0; r < 4; ++r)
+            {
+                tmp[4 * c + r] = mcrypto_inv_sbox[state[4 * ((c + 4 - r) % 4) + r]];
+            }
+        }
+
+        if (MCRYPTO_AES_ROUNDS > round)
+        {
+            for (c = 0; c < MCRYPTO_AES_BLOCK_SIZE; c += 4)
+            {
+                mcrypto_inv_mix_column(&tmp[c]);
+            }
+        }
+
+        for (c = 0; c < MCRYPTO_AES_BLOCK_SIZE; ++c)
+        {
+            state[c] = tmp[c] ^ ctx->dec_keys[round][c];
+        }
+    }
+
+    memcpy((void*) output, (const void*) state, MCRYPTO_AES_BLOCK_SIZE);
+}
+
+/* --------------- x86 AES-NI --------------- */
+
+#if defined(MCRYPTO_HOST_AESNI)
+
+static bool mcrypto_aesni_available(void)
+{
+    return (0 != __builtin_cpu_supports("aes"));
+}
+
+__attribute__((target("aes,sse2")))
+static void mcrypto_aesni_encrypt_blocks(const mcrypto_aes_ctx_t* ctx, const uint8_t* input, uint8_t* output, size_t blocks)
+{
+    __m128i keys[MCRYPTO_AES_ROUNDS + 1U];
+    __m128i state[MCRYPTO_HOST_PIPELINE_BLOCKS];
+    size_t count;
+    size_t i;
+    uint32_t round;
+
+    for (round = 0; round <= MCRYPTO_AES_ROUNDS; ++round)
+    {
+        keys[round] = _mm_load_si128((const __m128i*) ctx->enc_keys[round]);
+    }
+
+    while (blocks > 0)
+    {
+        count = (blocks < MCRYPTO_HOST_PIPELINE_BLOCKS) ? blocks : MCRYPTO_HOST_PIPELINE_BLOCKS;
+
+        for (i = 0; i < count; ++i)
+        {
+            state[i] = _mm_xor_si128(_mm_loadu_si128((const __m128i*) (input + i * MCRYPTO_AES_BLOCK_SIZE)), keys[0]);
+        }
+
+        for (round = 1; round < MCRYPTO_AES_ROUNDS; ++round)
+        {
+            for (i = 0; i < count; ++i)
+            {
+                state[i] = _mm_aesenc_si128(state[i], keys[round]);
+            }
+        }
+
+        for (i = 0; i < count; ++i)
+        {
+            _mm_storeu_si128((__m128i*) (output + i * MCRYPTO_AES_BLOCK_SIZE), _mm_aesenclast_si128(state[i], keys[MCRYPTO_AES_ROUNDS]));
+        }
+
+        input += count * MCRYPTO_AES_BLOCK_SIZE;
+        output += count * MCRYPTO_AES_BLOCK_SIZE;
+        blocks -= count;
+    }
+}
+
+__attribute__((target("aes,sse2")))
+static void mcrypto_aesni_decrypt_blocks(const mcrypto_aes_ctx_t* ctx, const uint8_t* input, uint8_t* output, size_t blocks)
+{
+    __m128i keys[MCRYPTO_AES_ROUNDS + 1U];
+    __m128i state[MCRYPTO_HOST_PIPELINE_BLOCKS];
+    size_t count;
+    size_t i;
+    uint32_t round;
+
+    for (round = 0; round <= MCRYPTO_AES_ROUNDS; ++round)
+    {
+        keys[round] = _mm_load_si128((const __m128i*) ctx->dec_keys[round]);
+    }
+
+    while (blocks > 0)
+    {
+        count = (blocks < MCRYPTO_HOST_PIPELINE_BLOCKS) ? blocks : MCRYPTO_HOST_PIPELINE_BLOCKS;
+
+        for (i = 0; i < count; ++i)
+        {
+            state[i] = _mm_xor_si128(_mm_loadu_si128((const __m128i*) (input + i * MCRYPTO_AES_BLOCK_SIZE)), keys[0]);
+        }
+
+        for (round = 1; round < MCRYPTO_AES_ROUNDS; ++round)
+        {
+            for (i = 0; i < count; ++i)
+            {
+                state[i] = _mm_aesdec_si128(state[i], keys[round]);
+            }
+        }
+
+        for (i = 0; i < count; ++i)
+        {
+            _mm_storeu_si128((__m128i*) (output + i * MCRYPTO_AES_BLOCK_SIZE), _mm_aesdeclast_si128(state[i], keys[MCRYPTO_AES_ROUNDS]));
+        }
+
+        input += count * MCRYPTO_AES_BLOCK_SIZE;
+        output += count * MCRYPTO_AES_BLOCK_SIZE;
+        blocks -= count;
+    }
+}
+
+#endif /* MCRYPTO_HOST_AESNI */
+
+/* --------------- ARMv8 cryptography extension --------------- */
+
+#if defined(MCRYPTO_HOST_ARMV8_CE)
+
+/*
+ * AESE does AddRoundKey, SubBytes and ShiftRows, AESD AddRoundKey, InvShiftRows
+ * and InvSubBytes: the round key is added first, the last one separately.
+ */
+
+static void mcrypto_armce_encrypt_blocks(const mcrypto_aes_ctx_t* ctx, const uint8_t* input, uint8_t* output, size_t blocks)
+{
+    uint8x16_t keys[MCRYPTO_AES_ROUNDS + 1U];
+    uint8x16_t state[MCRYPTO_HOST_PIPELINE_BLOCKS];
+    size_t count;
+    size_t i;
+    uint32_t round;
+
+    for (round = 0; round <= MCRYPTO_AES_ROUNDS; ++round)
+    {
+        keys[round] = vld1q_u8(ctx->enc_keys[round]);
+    }
+
+    while (blocks > 0)
+    {
+        count = (blocks < MCRYPTO_HOST_PIPELINE_BLOCKS) ? blocks : MCRYPTO_HOST_PIPELINE_BLOCKS;
+
+        for (i = 0; i < count; ++i)
+        {
+            state[i] = vld1q_u8(input + i * MCRYPTO_AES_BLOCK_SIZE);
+        }
+
+        for (round = 0; round < (MCRYPTO_AES_ROUNDS - 1U); ++round)
+        {
+            for (i = 0; i < count; ++i)
+            {
+                state[i] = vaesmcq_u8(vaeseq_u8(state[i], keys[round]));
+            }
+        }
+
+        for (i = 0; i < count; ++i)
+        {
+            state[i] = veorq_u8(vaeseq_u8(state[i], keys[MCRYPTO_AES_ROUNDS - 1U]), keys[MCRYPTO_AES_ROUNDS]);
+            vst1q_u8(output + i * MCRYPTO_AES_BLOCK_SIZE, state[i]);
+        }
+
+        input += count * MCRYPTO_AES_BLOCK_SIZE;
+        output += count * MCRYPTO_AES_BLOCK_SIZE;
+        blocks -= count;
+    }
+}
+
+static void mcrypto_armce_decrypt_blocks(const mcrypto_aes_ctx_t* ctx, const uint8_t* input, uint8_t* output, size_t blocks)
+{
+    uint8x16_t keys[MCRYPTO_AES_ROUNDS + 1U];
+    uint8x16_t state[MCRYPTO_HOST_PIPELINE_BLOCKS];
+    size_t count;
+    size_t i;
+    uint32_t round;
+
+    for (round = 0; round <= MCRYPTO_AES_ROUNDS; ++round)
+    {
+        keys[round] = vld1q_u8(ctx->dec_keys[round]);
+    }
+
+    while (blocks > 0)
+    {
+        count = (blocks < MCRYPTO_HOST_PIPELINE_BLOCKS) ? blocks : MCRYPTO_HOST_PIPELINE_BLOCKS;
+
+        for (i = 0; i < count; ++i)
+        {
+            state[i] = vld1q_u8(input + i * MCRYPTO_AES_BLOCK_SIZE);
+        }
+
+        for (round = 0; round < (MCRYPTO_AES_ROUNDS - 1U); ++round)
+        {
+            for (i = 0; i < count; ++i)
+            {
+                state[i] = vaesimcq_u8(vaesdq_u8(state[i], keys[round]));
+            }
+        }
+
+        for (i = 0; i < count; ++i)
+        {
+            state[i] = veorq_u8(vaesdq_u8(state[i], keys[MCRYPTO_AES_ROUNDS - 1U]), keys[MCRYPTO_AES_ROUNDS]);
+            vst1q_u8(output + i * MCRYPTO_AES_BLOCK_SIZE, state[i]);
+        }
+
+        input += count * MCRYPTO_AES_BLOCK_SIZE;
+        output += count * MCRYPTO_AES_BLOCK_SIZE;
+        blocks -= count;
+    }
+}
+
+#endif /* MCRYPTO_HOST_ARMV8_CE */
+
+static void mcrypto_encrypt_blocks(const mcrypto_aes_ctx_t* ctx, const uint8_t* input, uint8_t* output, size_t blocks)
+{
+#if defined(MCRYPTO_HOST_AESNI)
+    if (!mcrypto_host_portable && mcrypto_aesni_available())
+    {
+        mcrypto_aesni_encrypt_blocks(ctx, input, output, blocks);
+        return;
+    }
+#elif defined(MCRYPTO_HOST_ARMV8_CE)
+    if (!mcrypto_host_portable)
+    {
+        mcrypto_armce_encrypt_blocks(ctx, input, output, blocks);
+        return;
+    }
+#endif
+
+    while (blocks-- > 0)
+    {
+        mcrypto_portable_encrypt_block(ctx, input, output);
+        input += MCRYPTO_AES_BLOCK_SIZE;
+        output += MCRYPTO_AES_BLOCK_SIZE;
+    }
+}
+
+static void mcrypto_decrypt_blocks(const mcrypto_aes_ctx_t* ctx, const uint8_t* input, uint8_t* output, size_t blocks)
+{
+#if defined(MCRYPTO_HOST_AESNI)
+    if (!mcrypto_host_portable && mcrypto_aesni_available())
+    {
+        mcrypto_aesni_decrypt_blocks(ctx, input, output, blocks);
+        return;
+    }
+#elif defined(MCRYPTO_HOST_ARMV8_CE)
+    if (!mcrypto_host_portable)
+    {
+        mcrypto_armce_decrypt_blocks(ctx, input, output, blocks);
+        return;
+    }
+#endif
+
+    while (blocks-- > 0)
+    {
+        mcrypto_portable_decrypt_block(ctx, input, output);
+        input += MCRYPTO_AES_BLOCK_SIZE;
+        output += MCRYPTO_AES_BLOCK_SIZE;
+    }
+}
+
+/* --------------- HAL functions --------------- */
+
+mcrypto_status_t mcrypto_aes_ctx_init_with_key(mcrypto_aes_ctx_t* ctx, const mcrypto_secret_key_t* key)
+{
+    if ((NULL == ctx) || (NULL == key))
+    {
+        return MCRYPTO_INVALID_ARGS;
+    }
+
+    mcrypto_aes_ctx_cleanup(ctx);
+
+    mcrypto_expand_key(ctx, (const uint8_t*)(key->data));
+    ctx->initialized = true;
+
+    return MCRYPTO_OK;
+}
+
+mcrypto_status_t mcrypto_aes_ctx_init_with_devkey(mcrypto_aes_ctx_t* ctx)
+{
+    if (NULL == ctx)
+    {
+        return MCRYPTO_INVALID_ARGS;
+    }
+
+    mcrypto_aes_ctx_cleanup(ctx);
+
+    if (!mcrypto_host_devkey_set)
+    {
+        return MCRYPTO_FAILURE;
+    }
+
+    return mcrypto_aes_ctx_init_with_key(ctx, &mcrypto_host_devkey);
+}
+
+mcrypto_status_t mcrypto_aes_ctx_cleanup(mcrypto_aes_ctx_t* ctx)
+{
+    if (NULL != ctx)
+    {
+        memset ( (void*) ctx, 0x00, sizeof(mcrypto_aes_ctx_t));
+    }
+
+    return MCRYPTO_OK;
+}
+
+bool mcrypto_aes_ctx_initialized(mcrypto_aes_ctx_t* ctx)
+{
+    if(NULL == ctx)
+    {
+        return false;
+    }
+
+    /* Compare to true to ensure that a random value ( != 1 ) in ctx->initialized does pass the test */
+    return (true == ctx->initialized);
+}
+
+mcrypto_status_t mcrypto_aes_ecb_encrypt(mcrypto_aes_ctx_t* ctx, const uint8_t* plaintext, uint8_t* ciphertext, size_t size)
+{
+    if ((NULL == ctx) || (NULL == plaintext) || (NULL == ciphertext) || (0 == size) || (size & 0x0f))
+    {
+        return MCRYPTO_INVALID_ARGS;
+    }
+
+    if (!mcrypto_aes_ctx_initialized(ctx))
+    {
+        return MCRYPTO_CTX_NOT_INITIALIZED;
+    }
+
+    mcrypto_encrypt_blocks(ctx, plaintext, ciphertext, size / MCRYPTO_AES_BLOCK_SIZE);
+
+    return MCRYPTO_OK;
+}
+
+mcrypto_status_t mcrypto_aes_ecb_decrypt(mcrypto_aes_ctx_t* ctx, const uint8_t* ciphertext, uint8_t* plaintext, size_t size)
+{
+    if ((NULL == ctx) || (NULL == ciphertext) || (NULL == plaintext) || (0 == size) || (size & 0x0f))
+    {
+        return MCRYPTO_INVALID_ARGS;
+    }
+
+    if (!mcrypto_aes_ctx_initialized(ctx))
+    {
+        return MCRYPTO_CTX_NOT_INITIALIZED;
+    }
+
+    mcrypto_decrypt_blocks(ctx, ciphertext, plaintext, size / MCRYPTO_AES_BLOCK_SIZE);
+
+    return MCRYPTO_OK;
+}
+
+/* Platform specific functions */
+
+mcrypto_status_t mcrypto_set_host_devkey(const mcrypto_secret_key_t* key)
+{
+    if (NULL == key)
+    {
+        memset((void*) &mcrypto_host_devkey, 0x00, sizeof(mcrypto_host_devkey));
+        mcrypto_host_devkey_set = false;
+        ++mcrypto_host_devkey_generation;
+        return MCRYPTO_OK;
+    }
+
+    memcpy((void*) &mcrypto_host_devkey, (const void*) key, sizeof(mcrypto_host_devkey));
+    mcrypto_host_devkey_set = true;
+    ++mcrypto_host_devkey_generation;
+
+    return MCRYPTO_OK;
+}
+
+uint32_t mcrypto_get_host_devkey_generation(void)
+{
+    return mcrypto_host_devkey_generation;
+}
+
+void mcrypto_set_host_aes_portable(bool portable)
+{
+    mcrypto_host_portable = portable;
+}
+
+const char* mcrypto_get_host_aes_engine(void)
+{
+#if defined(MCRYPTO_HOST_AESNI)
+    if (!mcrypto_host_portable && mcrypto_aesni_available())
+    {
+        return "aes-ni";
+    }
+#elif defined(MCRYPTO_HOST_ARMV8_CE)
+    if (!mcrypto_host_portable)
+    {
+        return "armv8-ce";
+    }
+#endif
+
+    return "portable";
+}
+
+mcrypto_status_t mcrypto_aes_ctr_crypt(mcrypto_aes_ctx_t* ctx, uint8_t* counter, const uint8_t* input, uint8_t* output, size_t size)
+{
+    if ((NULL == ctx) || (NULL == counter) || (NULL == input) || (NULL == output) || (0 == size))
+    {
+        return MCRYPTO_INVALID_ARGS;
+    }
+
+    if (!mcrypto_aes_ctx_initialized(ctx))
+    {
+        return MCRYPTO_CTX_NOT_INITIALIZED;
+    }
+
+    /* Key stream of one pipeline of blocks */
+    alignas(16) uint8_t stream[MCRYPTO_HOST_PIPELINE_BLOCKS * MCRYPTO_AES_BLOCK_SIZE];
+    size_t chunk;
+    size_t blocks;
+    size_t i;
+    int j;
+
+    while (size > 0)
+    {
+        chunk = (size < sizeof(stream)) ? size : sizeof(stream);
+        blocks = (chunk + MCRYPTO_AES_BLOCK_SIZE - 1U) / MCRYPTO_AES_BLOCK_SIZE;
+
+        for (i = 0; i < blocks; ++i)
+        {
+            memcpy((void*) &stream[i * MCRYPTO_AES_BLOCK_SIZE], (const void*) counter, MCRYPTO_AES_BLOCK_SIZE);
+
+            /* Increment the 128-bit big endian counter */
+            for (j = (MCRYPTO_AES_BLOCK_SIZE - 1); j >= 0; --j)
+            {
+                if (0 != ++counter[j])
+                {
+                    break;
+                }
+            }
+        }
+
+        mcrypto_encrypt_blocks(ctx, stream, stream, blocks);
+
+        for (i = 0; i < chunk; ++i)
+        {
+            output[i] = input[i] ^ stream[i];
+        }
+
+        input += chunk;
+        output += chunk;
+        size -= chunk;
+    }
+
+    memset((void*) stream, 0x00, sizeof(stream));
+
+    return MCRYPTO_OK;
+}
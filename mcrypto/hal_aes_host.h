@@ -0,0 +1,108 @@
+/**
+ * @file hal_aes_host.h
+ * @brief AES platform specific functions on a host computer
+ * @date 2026-10-19
+ *
+ * Host backend of hal_aes.h, selected by defining MCRYPTO_HAL_HOST. It lets the
+ * MCRYPTO library run in the factory image tooling and in the tests on Linux.
+ *
+ * @copyright Copyright 2020 Honeywell International Inc. All rights reserved.
+ */
+/*
+ * THIS DOCUMENT CONTAINS PROPRIETARY INFORMATION OF HONEYWELL INTERNATIONAL INC.
+ * NEITHER THIS DOCUMENT NOR THE INFORMATION CONTAINED HEREIN MAY BE REPRODUCED, USED,
+ * DISTRIBUTED OR DISCLOSED TO OTHERS WITHOUT THE WRITTEN CONSENT OF HONEYWELL.
+ */
+
+
+#ifndef MCRYPTO_HAL_AES_HOST_H
+#define MCRYPTO_HAL_AES_HOST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdalign.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * @brief Number of AES-128 rounds
+ */
+#define MCRYPTO_AES_ROUNDS (10U)
+
+/**
+ * @brief Platform dependent AES context
+ */
+typedef struct tag_mcrypto_aes_ctx {
+
+    /** @brief Round keys of the cipher */
+    alignas(16) uint8_t enc_keys[MCRYPTO_AES_ROUNDS + 1U][MCRYPTO_AES_BLOCK_SIZE];
+
+    /** @brief Round keys of the equivalent inverse cipher, in the order of use */
+    alignas(16) uint8_t dec_keys[MCRYPTO_AES_ROUNDS + 1U][MCRYPTO_AES_BLOCK_SIZE];
+
+    /** @brief Trues if the context is initialized */
+    bool initialized;
+} mcrypto_aes_ctx_t;
+
+/**
+ * @brief Set the key used by mcrypto_aes_ctx_init_with_devkey().
+ *
+ * A host has no device unique key, the tooling provides the key of the device
+ * it prepares the data for. Until it is set, mcrypto_aes_ctx_init_with_devkey() fails.
+ * Setting or forgetting it increments the device key generation, so the key cache
+ * (key_cache.h) drops the keys derived from the previous key on its next lookup.
+ *
+ * @param key Device key, NULL forgets it
+ * @return mcrypto_status_t
+ */
+mcrypto_status_t mcrypto_set_host_devkey(const mcrypto_secret_key_t* key);
+
+/**
+ * @brief Get the device key generation, incremented by each mcrypto_set_host_devkey() call.
+ *
+ * @return uint32_t Generation
+ */
+uint32_t mcrypto_get_host_devkey_generation(void);
+
+/**
+ * @brief Use the portable AES implementation even if the CPU has AES instructions.
+ *
+ * For benchmarks and tests of the portable code, not to be changed while AES
+ * operations are running.
+ *
+ * @param portable True for the portable implementation, false for the fastest one
+ */
+void mcrypto_set_host_aes_portable(bool portable);
+
+/**
+ * @brief Get the name of the AES implementation in use.
+ *
+ * @return "aes-ni", "armv8-ce" or "portable"
+ */
+const char* mcrypto_get_host_aes_engine(void);
+
+/**
+ * @brief Encrypt or decrypt with AES in CTR mode.
+ *
+ * The counter block is incremented as a 128-bit big endian number and is updated
+ * to the counter of the next block, so a stream can be processed in several calls.
+ * Only the last call may have a size which is not a multiple of 16.
+ * The input and output can overlap in memory.
+ *
+ * @param ctx AES context
+ * @param[in,out] counter 16-byte counter block
+ * @param input Input data
+ * @param[out] output Output data
+ * @param size Size of input and output in bytes
+ * @return mcrypto_status_t
+ */
+mcrypto_status_t mcrypto_aes_ctr_crypt(mcrypto_aes_ctx_t* ctx, uint8_t* counter, const uint8_t* input, uint8_t* output, size_t size);
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus*/
+
+#endif /* MCRYPTO_HAL_AES_HOST_H */
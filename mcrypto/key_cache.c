@@ -0,0 +1,254 @@
+/**
+ * @file key_cache.c
+ * @brief Cache of keys derived from the device protected key
+ * @date 2026-10-19
+ *
+ * @copyright Copyright 2020 Honeywell International Inc. All rights reserved.
+ */
+/*
+ * THIS DOCUMENT CONTAINS PROPRIETARY INFORMATION OF HONEYWELL INTERNATIONAL INC.
+ * NEITHER THIS DOCUMENT NOR THE INFORMATION CONTAINED HEREIN MAY BE REPRODUCED, USED,
+ * DISTRIBUTED OR DISCLOSED TO OTHERS WITHOUT THE WRITTEN CONSENT OF HONEYWELL.
+ */
+
+#include <string.h>
+#include "kdf.h"
+#include "key_cache.h"
+
+#ifndef MCRYPTO_KEY_CACHE_LOCK
+#if defined(FREERTOS) && (MCRYPTO_KEY_CACHE_ENTRIES > 0)
+#include "rt_mutex_hal.h"
+
+/* Own mutex, the key derivation done under it takes dcp_lock */
+static rt_lock_t mcrypto_key_cache_lock;
+
+static void mcrypto_key_cache_lock_take(void)
+{
+    if (NULL == mcrypto_key_cache_lock.lock_mtx)
+    {
+        (void) rt_init_mutex(&mcrypto_key_cache_lock);
+    }
+
+    (void) rt_lock_mutex(&mcrypto_key_cache_lock);
+}
+
+#define MCRYPTO_KEY_CACHE_LOCK()    mcrypto_key_cache_lock_take()
+#define MCRYPTO_KEY_CACHE_UNLOCK()  (void) rt_unlock_mutex(&mcrypto_key_cache_lock)
+#else
+#define MCRYPTO_KEY_CACHE_LOCK()
+#define MCRYPTO_KEY_CACHE_UNLOCK()
+#endif
+#endif
+
+#if (MCRYPTO_KEY_CACHE_ENTRIES > 0)
+
+/**
+ * @brief Cache entry, unused if key_count is 0
+ */
+typedef struct tag_mcrypto_key_cache_entry
+{
+    /** @brief Derivation inputs: label followed by context */
+    uint8_t input[MCRYPTO_KEY_CACHE_INPUT_SIZE];
+    uint32_t label_len;
+    uint32_t context_len;
+
+    /** @brief Number of cached keys, part of the lookup key as the KDF output depends on its length */
+    uint32_t key_count;
+
+    /** @brief Value of mcrypto_key_cache_clock at the last use */
+    uint32_t last_use;
+
+    /** @brief Contexts initialized with the derived keys */
+    mcrypto_aes_ctx_t ctx[MCRYPTO_KEY_CACHE_MAX_KEYS];
+} mcrypto_key_cache_entry_t;
+
+static mcrypto_key_cache_entry_t mcrypto_key_cache[MCRYPTO_KEY_CACHE_ENTRIES];
+
+static uint32_t mcrypto_key_cache_clock = 0;
+
+#if defined(MCRYPTO_HAL_HOST)
+/* Device key generation the cached keys were derived from */
+static uint32_t mcrypto_key_cache_devkey_generation = 0;
+#endif
+
+static void mcrypto_key_cache_zeroize(mcrypto_key_cache_entry_t* entry)
+{
+    uint32_t i;
+
+    for (i = 0; i < MCRYPTO_KEY_CACHE_MAX_KEYS; ++i)
+    {
+        mcrypto_aes_ctx_cleanup(&(entry->ctx[i]));
+    }
+
+    memset((void*) entry, 0x00, sizeof(mcrypto_key_cache_entry_t));
+}
+
+static mcrypto_key_cache_entry_t* mcrypto_key_cache_find(const unsigned char* label, uint32_t label_len, const unsigned char* context, uint32_t context_len,
+                                                         uint32_t key_count)
+{
+    uint32_t i;
+
+    for (i = 0; i < MCRYPTO_KEY_CACHE_ENTRIES; ++i)
+    {
+        mcrypto_key_cache_entry_t* entry = &mcrypto_key_cache[i];
+
+        if ((0 != entry->key_count) && ((0 == key_count) || (key_count == entry->key_count)) && (label_len == entry->label_len) && (context_len == entry->context_len) &&
+            (0 == memcmp(entry->input, label, label_len)) && (0 == memcmp(&(entry->input[label_len]), context, context_len)))
+        {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+#endif /* MCRYPTO_KEY_CACHE_ENTRIES */
+
+/* Derives the keys straight into the contexts */
+static mcrypto_status_t mcrypto_key_cache_derive(const unsigned char* label, uint32_t label_len, const unsigned char* context, uint32_t context_len,
+                                                 uint32_t key_count, mcrypto_aes_ctx_t* ctx)
+{
+    mcrypto_status_t status;
+    mcrypto_secret_key_t keys[MCRYPTO_KEY_CACHE_MAX_KEYS];
+    uint32_t i;
+
+    status = mcrypto_kdf_with_device_key((uint8_t*)keys, key_count * sizeof(mcrypto_secret_key_t), label, label_len, context, context_len);
+
+    for (i = 0; (MCRYPTO_OK == status) && (i < key_count); ++i)
+    {
+        status = mcrypto_aes_ctx_init_with_key(&ctx[i], &keys[i]);
+    }
+
+    if (MCRYPTO_OK != status)
+    {
+        for (i = 0; i < key_count; ++i)
+        {
+            mcrypto_aes_ctx_cleanup(&ctx[i]);
+        }
+    }
+
+    memset((void*) keys, 0x00, sizeof(keys));
+
+    return status;
+}
+
+mcrypto_status_t mcrypto_key_cache_get(const unsigned char* label, uint32_t label_len, const unsigned char* context, uint32_t context_len,
+                                       uint32_t key_count, mcrypto_aes_ctx_t* ctx)
+{
+    if ((NULL == label) || (0 == label_len) || (NULL == context) || (0 == context_len) || (NULL == ctx) ||
+        (0 == key_count) || (MCRYPTO_KEY_CACHE_MAX_KEYS < key_count))
+    {
+        return MCRYPTO_INVALID_ARGS;
+    }
+
+#if (MCRYPTO_KEY_CACHE_ENTRIES > 0)
+    mcrypto_status_t status;
+    mcrypto_key_cache_entry_t* entry;
+    uint32_t i;
+
+    if (MCRYPTO_KEY_CACHE_INPUT_SIZE < label_len + context_len)
+    {
+        return mcrypto_key_cache_derive(label, label_len, context, context_len, key_count, ctx);
+    }
+
+    MCRYPTO_KEY_CACHE_LOCK();
+
+#if defined(MCRYPTO_HAL_HOST)
+    /* The tooling changed the device key, the cached keys were derived from the previous one */
+    if (mcrypto_get_host_devkey_generation() != mcrypto_key_cache_devkey_generation)
+    {
+        for (i = 0; i < MCRYPTO_KEY_CACHE_ENTRIES; ++i)
+        {
+            mcrypto_key_cache_zeroize(&mcrypto_key_cache[i]);
+        }
+        mcrypto_key_cache_devkey_generation = mcrypto_get_host_devkey_generation();
+    }
+#endif
+
+    entry = mcrypto_key_cache_find(label, label_len, context, context_len, key_count);
+
+    if (NULL == entry)
+    {
+        /* A free entry, else the least recently used one */
+        entry = &mcrypto_key_cache[0];
+        for (i = 0; i < MCRYPTO_KEY_CACHE_ENTRIES; ++i)
+        {
+            if (0 == mcrypto_key_cache[i].key_count)
+            {
+                entry = &mcrypto_key_cache[i];
+                break;
+            }
+
+            if ((mcrypto_key_cache_clock - mcrypto_key_cache[i].last_use) > (mcrypto_key_cache_clock - entry->last_use))
+            {
+                entry = &mcrypto_key_cache[i];
+            }
+        }
+
+        mcrypto_key_cache_zeroize(entry);
+
+        status = mcrypto_key_cache_derive(label, label_len, context, context_len, key_count, entry->ctx);
+        if (MCRYPTO_OK != status)
+        {
+            mcrypto_key_cache_zeroize(entry);
+            MCRYPTO_KEY_CACHE_UNLOCK();
+            return status;
+        }
+
+        memcpy((void*) entry->input, (const void*) label, label_len);
+        memcpy((void*) &(entry->input[label_len]), (const void*) context, context_len);
+        entry->label_len = label_len;
+        entry->context_len = context_len;
+        entry->key_count = key_count;
+    }
+
+    entry->last_use = ++mcrypto_key_cache_clock;
+    memcpy((void*) ctx, (const void*) entry->ctx, key_count * sizeof(mcrypto_aes_ctx_t));
+
+    MCRYPTO_KEY_CACHE_UNLOCK();
+
+    return MCRYPTO_OK;
+#else
+    return mcrypto_key_cache_derive(label, label_len, context, context_len, key_count, ctx);
+#endif
+}
+
+mcrypto_status_t mcrypto_key_cache_evict(const unsigned char* label, uint32_t label_len, const unsigned char* context, uint32_t context_len)
+{
+    if ((NULL == label) || (0 == label_len) || (NULL == context) || (0 == context_len))
+    {
+        return MCRYPTO_INVALID_ARGS;
+    }
+
+#if (MCRYPTO_KEY_CACHE_ENTRIES > 0)
+    mcrypto_key_cache_entry_t* entry;
+
+    MCRYPTO_KEY_CACHE_LOCK();
+
+    /* Key count 0 matches the entries of any key count */
+    while (NULL != (entry = mcrypto_key_cache_find(label, label_len, context, context_len, 0U)))
+    {
+        mcrypto_key_cache_zeroize(entry);
+    }
+
+    MCRYPTO_KEY_CACHE_UNLOCK();
+#endif
+
+    return MCRYPTO_OK;
+}
+
+void mcrypto_key_cache_clear(void)
+{
+#if (MCRYPTO_KEY_CACHE_ENTRIES > 0)
+    uint32_t i;
+
+    MCRYPTO_KEY_CACHE_LOCK();
+
+    for (i = 0; i < MCRYPTO_KEY_CACHE_ENTRIES; ++i)
+    {
+        mcrypto_key_cache_zeroize(&mcrypto_key_cache[i]);
+    }
+
+    MCRYPTO_KEY_CACHE_UNLOCK();
+#endif
+}
@@ -0,0 +1,96 @@
+/**
+ * @file key_cache.h
+ * @brief Cache of keys derived from the device protected key
+ * @date 2026-10-19
+ *
+ * Key derivation (kdf.h) costs several CMAC computations with the device key. The cache
+ * keeps the AES contexts initialized with the derived keys, keyed by the exact (label, context)
+ * of the derivation, and hands out copies of them. mcrypto_memenc_ctx_init() and
+ * mcrypto_dauth_ctx_init() go through the cache, so repeated initializations, including
+ * the *_easy data authentication functions, derive their keys only once.
+ *
+ * The least recently used entry is evicted when the cache is full, evicted entries are
+ * zeroized. MCRYPTO_KEY_CACHE_ENTRIES 0 disables the cache: every lookup derives the keys.
+ *
+ * The cache is a global table. With FREERTOS it is guarded by its own rt_lock_t mutex, created
+ * on first use, so make the first call before the tasks that share it start. Elsewhere define
+ * MCRYPTO_KEY_CACHE_LOCK() and MCRYPTO_KEY_CACHE_UNLOCK() if it is used from more than one task.
+ * The lock must not be dcp_lock: the key derivation takes dcp_lock while the cache is locked.
+ *
+ * @copyright Copyright 2020 Honeywell International Inc. All rights reserved.
+ */
+/*
+ * THIS DOCUMENT CONTAINS PROPRIETARY INFORMATION OF HONEYWELL INTERNATIONAL INC.
+ * NEITHER THIS DOCUMENT NOR THE INFORMATION CONTAINED HEREIN MAY BE REPRODUCED, USED,
+ * DISTRIBUTED OR DISCLOSED TO OTHERS WITHOUT THE WRITTEN CONSENT OF HONEYWELL.
+ */
+
+#ifndef MCRYPTO_KEY_CACHE_H
+#define MCRYPTO_KEY_CACHE_H
+
+#include <stdint.h>
+#include "mcrypto.h"
+#include "hal_aes.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * @brief Number of cached (label, context) pairs
+ */
+#ifndef MCRYPTO_KEY_CACHE_ENTRIES
+#define MCRYPTO_KEY_CACHE_ENTRIES (4U)
+#endif
+
+/**
+ * @brief Maximum label_len + context_len of a cached pair, longer ones are always derived.
+ */
+#ifndef MCRYPTO_KEY_CACHE_INPUT_SIZE
+#define MCRYPTO_KEY_CACHE_INPUT_SIZE (64U)
+#endif
+
+/**
+ * @brief Maximum number of 16-byte keys derived from one (label, context) pair
+ */
+#define MCRYPTO_KEY_CACHE_MAX_KEYS (2U)
+
+/**
+ * @brief Get AES contexts initialized with keys derived from the device protected key.
+ *
+ * The keys are the key_count * 16 bytes output of mcrypto_kdf_with_device_key(label, context)
+ * split into 16-byte keys. The output depends on its length, so the entries of the same
+ * (label, context) with another key count are different keys. The contexts are copies owned by the
+ * caller, to be released with mcrypto_aes_ctx_cleanup() as usual.
+ *
+ * @param label Label used in key derivation. Must not be NULL.
+ * @param label_len Label byte length. Must not be zero.
+ * @param context Context used in key derivation. Must not be NULL.
+ * @param context_len Context byte length. Must not be zero.
+ * @param key_count Number of keys, 1 to MCRYPTO_KEY_CACHE_MAX_KEYS
+ * @param[out] ctx Array of key_count AES contexts
+ * @return mcrypto_status_t
+ */
+mcrypto_status_t mcrypto_key_cache_get(const unsigned char* label, uint32_t label_len, const unsigned char* context, uint32_t context_len,
+                                       uint32_t key_count, mcrypto_aes_ctx_t* ctx);
+
+/**
+ * @brief Evict and zeroize the keys derived from one (label, context) pair, for any key count.
+ *
+ * @return mcrypto_status_t MCRYPTO_OK also if the pair was not cached
+ */
+mcrypto_status_t mcrypto_key_cache_evict(const unsigned char* label, uint32_t label_len, const unsigned char* context, uint32_t context_len);
+
+/**
+ * @brief Evict and zeroize all cached keys.
+ *
+ * To be called when the keys must not stay in RAM any longer, e.g. before a low power
+ * mode or a firmware update.
+ */
+void mcrypto_key_cache_clear(void);
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus*/
+
+#endif /* MCRYPTO_KEY_CACHE_H */
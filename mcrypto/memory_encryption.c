@@ -25,7 +25,8 @@
  */
 
 #include <assert.h>
-#include "kdf.h"
+#include <string.h>
+#include "key_cache.h"
 #include "aes-xts.h"
 #include "memory_encryption.h"
 
@@ -37,23 +38,23 @@ mcrypto_status_t mcrypto_memenc_ctx_init(mcrypto_memenc_ctx_t* ctx, const unsign
     }
 
     mcrypto_status_t status;
-    uint8_t keys[sizeof(mcrypto_secret_key_t)*2];
+    mcrypto_aes_ctx_t aes_ctx[2];
 
-    /* Derive AES XTS keys using the KDF with device protected key and provided inputs */
-    status = mcrypto_kdf_with_device_key(keys, sizeof(keys), label, label_len, context, context_len);
+    /* Get the contexts of the AES XTS keys derived by the KDF with device protected key and provided inputs,
+       the derivation is done once per label and context */
+    status = mcrypto_key_cache_get(label, label_len, context, context_len, 2U, aes_ctx);
 
     if (MCRYPTO_OK != status)
     {
-        goto exit;
+        return status;
     }
 
-    /* Initialize the context with the generated keys */
-    status = mcrypto_aes_xts_ctx_init((mcrypto_aes_xts_ctx_t*)(ctx), (mcrypto_secret_key_t *)keys, (mcrypto_secret_key_t *)(keys + sizeof(mcrypto_secret_key_t)));
+    ctx->aes_ctx1 = aes_ctx[0];
+    ctx->aes_ctx2 = aes_ctx[1];
 
-    exit:
-    memset(keys, 0x00, sizeof(keys));
+    memset(aes_ctx, 0x00, sizeof(aes_ctx));
 
-    return status;
+    return MCRYPTO_OK;
 }
 
 mcrypto_status_t mcrypto_memenc_ctx_cleanup(mcrypto_memenc_ctx_t* ctx)
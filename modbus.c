@@ -12,84 +12,15 @@
 
 #include "modbus_rtu.h"
 #include "modbus.h"
-
-
-/* Table of CRC values for high-order byte */
-const uint8_t table_crc_hi[] = {
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0,
-    0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-    0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0,
-    0x80, 0x41, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1,
-    0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41,
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1,
-    0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0,
-    0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40,
-    0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1,
-    0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0,
-    0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40,
-    0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0,
-    0x80, 0x41, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0,
-    0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-    0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0,
-    0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-    0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0,
-    0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40,
-    0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1,
-    0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0,
-    0x80, 0x41, 0x00, 0xC1, 0x81, 0x40
-};
-
-/* Table of CRC values for low-order byte */
- const uint8_t table_crc_lo[] = {
-    0x00, 0xC0, 0xC1, 0x01, 0xC3, 0x03, 0x02, 0xC2, 0xC6, 0x06,
-    0x07, 0xC7, 0x05, 0xC5, 0xC4, 0x04, 0xCC, 0x0C, 0x0D, 0xCD,
-    0x0F, 0xCF, 0xCE, 0x0E, 0x0A, 0xCA, 0xCB, 0x0B, 0xC9, 0x09,
-    0x08, 0xC8, 0xD8, 0x18, 0x19, 0xD9, 0x1B, 0xDB, 0xDA, 0x1A,
-    0x1E, 0xDE, 0xDF, 0x1F, 0xDD, 0x1D, 0x1C, 0xDC, 0x14, 0xD4,
-    0xD5, 0x15, 0xD7, 0x17, 0x16, 0xD6, 0xD2, 0x12, 0x13, 0xD3,
-    0x11, 0xD1, 0xD0, 0x10, 0xF0, 0x30, 0x31, 0xF1, 0x33, 0xF3,
-    0xF2, 0x32, 0x36, 0xF6, 0xF7, 0x37, 0xF5, 0x35, 0x34, 0xF4,
-    0x3C, 0xFC, 0xFD, 0x3D, 0xFF, 0x3F, 0x3E, 0xFE, 0xFA, 0x3A,
-    0x3B, 0xFB, 0x39, 0xF9, 0xF8, 0x38, 0x28, 0xE8, 0xE9, 0x29,
-    0xEB, 0x2B, 0x2A, 0xEA, 0xEE, 0x2E, 0x2F, 0xEF, 0x2D, 0xED,
-    0xEC, 0x2C, 0xE4, 0x24, 0x25, 0xE5, 0x27, 0xE7, 0xE6, 0x26,
-    0x22, 0xE2, 0xE3, 0x23, 0xE1, 0x21, 0x20, 0xE0, 0xA0, 0x60,
-    0x61, 0xA1, 0x63, 0xA3, 0xA2, 0x62, 0x66, 0xA6, 0xA7, 0x67,
-    0xA5, 0x65, 0x64, 0xA4, 0x6C, 0xAC, 0xAD, 0x6D, 0xAF, 0x6F,
-    0x6E, 0xAE, 0xAA, 0x6A, 0x6B, 0xAB, 0x69, 0xA9, 0xA8, 0x68,
-    0x78, 0xB8, 0xB9, 0x79, 0xBB, 0x7B, 0x7A, 0xBA, 0xBE, 0x7E,
-    0x7F, 0xBF, 0x7D, 0xBD, 0xBC, 0x7C, 0xB4, 0x74, 0x75, 0xB5,
-    0x77, 0xB7, 0xB6, 0x76, 0x72, 0xB2, 0xB3, 0x73, 0xB1, 0x71,
-    0x70, 0xB0, 0x50, 0x90, 0x91, 0x51, 0x93, 0x53, 0x52, 0x92,
-    0x96, 0x56, 0x57, 0x97, 0x55, 0x95, 0x94, 0x54, 0x9C, 0x5C,
-    0x5D, 0x9D, 0x5F, 0x9F, 0x9E, 0x5E, 0x5A, 0x9A, 0x9B, 0x5B,
-    0x99, 0x59, 0x58, 0x98, 0x88, 0x48, 0x49, 0x89, 0x4B, 0x8B,
-    0x8A, 0x4A, 0x4E, 0x8E, 0x8F, 0x4F, 0x8D, 0x4D, 0x4C, 0x8C,
-    0x44, 0x84, 0x85, 0x45, 0x87, 0x47, 0x46, 0x86, 0x82, 0x42,
-    0x43, 0x83, 0x41, 0x81, 0x80, 0x40
-};
-
+#include "crc.h"
 
 
 uint16_t crc16(uint8_t *buffer, uint16_t buffer_length)
 {
-    uint8_t crc_hi = 0xFF; /* high CRC byte initialized */
-    uint8_t crc_lo = 0xFF; /* low CRC byte initialized */
-    unsigned int i; /* will index into CRC lookup */
-
-    /* pass through message buffer */
-    while (buffer_length--) {
-        i = crc_hi ^ *buffer++; /* calculate the CRC  */
-        crc_hi = crc_lo ^ table_crc_hi[i];
-        crc_lo = table_crc_lo[i];
-    }
+    /* The CRC is sent low byte first, the callers expect the first byte in the high byte. */
+    uint16_t crc = crc16_modbus(buffer, buffer_length);
 
-    return (crc_hi << 8 | crc_lo);
+    return (uint16_t)((crc << 8) | (crc >> 8));
 }
 
 
@@ -298,6 +229,19 @@ int modbus_set_slave(modbus_t *ctx, int slave)
 
 
 
+/* Receives the indication request from the socket of the context (server side) */
+int modbus_receive(modbus_t *ctx, uint8_t *req)
+{
+	if (ctx == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return ctx->backend->receive(ctx, req);
+}
+
+
+
 
 
 modbus_backend_t _modbus_rtu_backend = {
@@ -743,33 +687,365 @@ int modbus_write_bit(modbus_t *ctx, int addr, int status)
 
 
 
+/* Checks the address range of a request, requests above the PDU limits are
+   split by the callers */
+static int check_range(modbus_t *ctx, int addr, int nb)
+{
+    if (nb < 1 || addr < 0 || addr + nb > 0x10000) {
+        if (ctx->debug) {
+            fprintf(stderr,
+                    "ERROR Invalid address range (%d, %d)\n", addr, nb);
+        }
+        errno = EINVAL;
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/* Reads the boolean status of bits in blocks of at most MODBUS_MAX_READ_BITS */
+static int read_bits_split(modbus_t *ctx, int function, int addr, int nb, uint8_t *dest)
+{
+    int done;
+
+    if (ctx == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (check_range(ctx, addr, nb) == -1)
+        return -1;
+
+    for (done = 0; done < nb; ) {
+        int chunk = nb - done;
+
+        if (chunk > MODBUS_MAX_READ_BITS)
+            chunk = MODBUS_MAX_READ_BITS;
+
+        if (read_io_status(ctx, function, addr + done, chunk, dest + done) == -1)
+            return -1;
+        done += chunk;
+    }
+
+    return nb;
+}
+
+
 /* Reads the boolean status of bits and sets the array elements
    in the destination to TRUE or FALSE (single bits). */
 int modbus_read_bits(modbus_t *ctx, int addr, int nb, uint8_t *dest)
+{
+    return read_bits_split(ctx, MODBUS_FC_READ_COILS, addr, nb, dest);
+}
+
+
+/* Same as modbus_read_bits but reads the remote device input table */
+int modbus_read_input_bits(modbus_t *ctx, int addr, int nb, uint8_t *dest)
+{
+    return read_bits_split(ctx, MODBUS_FC_READ_DISCRETE_INPUTS, addr, nb, dest);
+}
+
+
+/* Copies the register values of a read response */
+static void copy_registers(modbus_t *ctx, const uint8_t *rsp, int nb, uint16_t *dest)
+{
+    const int offset = ctx->backend->header_length + 2;
+    int i;
+
+    for (i = 0; i < nb; i++) {
+        /* shift reg hi_byte to temp OR with lo_byte */
+        dest[i] = (rsp[offset + (i << 1)] << 8) | rsp[offset + 1 + (i << 1)];
+    }
+}
+
+
+/* Reads the data from a remote device and put that data into an array */
+int modbus_read_registers_fc(modbus_t *ctx, int function, int addr, int nb, uint16_t *dest)
 {
     int rc;
+    int req_length;
+    uint8_t req[_MIN_REQ_LENGTH];
+    uint8_t rsp[MAX_MESSAGE_LENGTH];
+
+    if (nb > MODBUS_MAX_READ_REGISTERS) {
+        if (ctx->debug) {
+            fprintf(stderr,
+                    "ERROR Too many registers requested (%d > %d)\n",
+                    nb, MODBUS_MAX_READ_REGISTERS);
+        }
+        errno = EMBMDATA;
+        return -1;
+    }
+
+    req_length = ctx->backend->build_request_basis(ctx, function, addr, nb, req);
+
+    rc = send_msg(ctx, req, req_length);
+    if (rc > 0) {
+        rc = _modbus_receive_msg(ctx, rsp, MSG_CONFIRMATION);
+        if (rc == -1)
+            return -1;
+
+        rc = check_confirmation(ctx, req, rsp, rc);
+        if (rc == -1)
+            return -1;
+
+        copy_registers(ctx, rsp, rc, dest);
+    }
+
+    return rc;
+}
+
+
+/* Reads registers in blocks of at most MODBUS_MAX_READ_REGISTERS */
+static int read_registers_split(modbus_t *ctx, int function, int addr, int nb, uint16_t *dest)
+{
+    int done;
 
     if (ctx == NULL) {
         errno = EINVAL;
         return -1;
     }
 
-    if (nb > MODBUS_MAX_READ_BITS) {
-        if (ctx->debug) {
-            fprintf(stderr,
-                    "ERROR Too many bits requested (%d > %d)\n",
-                    nb, MODBUS_MAX_READ_BITS);
+    if (check_range(ctx, addr, nb) == -1)
+        return -1;
+
+    for (done = 0; done < nb; ) {
+        int chunk = nb - done;
+
+        if (chunk > MODBUS_MAX_READ_REGISTERS)
+            chunk = MODBUS_MAX_READ_REGISTERS;
+
+        if (modbus_read_registers_fc(ctx, function, addr + done, chunk, dest + done) == -1)
+            return -1;
+        done += chunk;
+    }
+
+    return nb;
+}
+
+
+/* Reads the holding registers of remote device and put the data into an
+   array */
+int modbus_read_registers(modbus_t *ctx, int addr, int nb, uint16_t *dest)
+{
+    return read_registers_split(ctx, MODBUS_FC_READ_HOLDING_REGISTERS, addr, nb, dest);
+}
+
+
+/* Reads the input registers of remote device and put the data into an array */
+int modbus_read_input_registers(modbus_t *ctx, int addr, int nb, uint16_t *dest)
+{
+    return read_registers_split(ctx, MODBUS_FC_READ_INPUT_REGISTERS, addr, nb, dest);
+}
+
+
+/* Writes a value in one register of the remote device */
+int modbus_write_register(modbus_t *ctx, int addr, const uint16_t value)
+{
+    return write_single(ctx, MODBUS_FC_WRITE_SINGLE_REGISTER, addr, value);
+}
+
+
+/* Sends a write request and checks the confirmation */
+static int write_request(modbus_t *ctx, uint8_t *req, int req_length)
+{
+    int rc;
+
+    rc = send_msg(ctx, req, req_length);
+    if (rc > 0) {
+        uint8_t rsp[MAX_MESSAGE_LENGTH];
+
+        rc = _modbus_receive_msg(ctx, rsp, MSG_CONFIRMATION);
+        if (rc == -1)
+            return -1;
+
+        rc = check_confirmation(ctx, req, rsp, rc);
+    }
+
+    return rc;
+}
+
+
+/* Packs the bits of src (one value per byte) into req, returns the new length */
+static int pack_bits(uint8_t *req, int req_length, int nb, const uint8_t *src)
+{
+    int byte_count = (nb / 8) + ((nb % 8) ? 1 : 0);
+    int pos = 0;
+    int i;
+
+    req[req_length++] = byte_count;
+    for (i = 0; i < byte_count; i++) {
+        int bit;
+
+        req[req_length] = 0;
+        for (bit = 0x01; (bit & 0xff) && (pos < nb); bit <<= 1) {
+            if (src[pos++])
+                req[req_length] |= bit;
         }
-        errno = EMBMDATA;
+        req_length++;
+    }
+
+    return req_length;
+}
+
+
+/* Packs big endian register values into req, returns the new length */
+static int pack_registers(uint8_t *req, int req_length, int nb, const uint16_t *src)
+{
+    int i;
+
+    req[req_length++] = nb * 2;
+    for (i = 0; i < nb; i++) {
+        req[req_length++] = src[i] >> 8;
+        req[req_length++] = src[i] & 0x00FF;
+    }
+
+    return req_length;
+}
+
+
+/* Writes the bits of the array in the remote device, in blocks of at most
+   MODBUS_MAX_WRITE_BITS */
+int modbus_write_bits(modbus_t *ctx, int addr, int nb, const uint8_t *src)
+{
+    int done;
+
+    if (ctx == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (check_range(ctx, addr, nb) == -1)
+        return -1;
+
+    for (done = 0; done < nb; ) {
+        uint8_t req[MAX_MESSAGE_LENGTH];
+        int req_length;
+        int chunk = nb - done;
+
+        if (chunk > MODBUS_MAX_WRITE_BITS)
+            chunk = MODBUS_MAX_WRITE_BITS;
+
+        req_length = ctx->backend->build_request_basis(ctx, MODBUS_FC_WRITE_MULTIPLE_COILS,
+                                                       addr + done, chunk, req);
+        req_length = pack_bits(req, req_length, chunk, src + done);
+
+        if (write_request(ctx, req, req_length) == -1)
+            return -1;
+        done += chunk;
+    }
+
+    return nb;
+}
+
+
+/* Writes the values from the array to the registers of the remote device, in
+   blocks of at most MODBUS_MAX_WRITE_REGISTERS */
+int modbus_write_registers(modbus_t *ctx, int addr, int nb, const uint16_t *src)
+{
+    int done;
+
+    if (ctx == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (check_range(ctx, addr, nb) == -1)
+        return -1;
+
+    for (done = 0; done < nb; ) {
+        uint8_t req[MAX_MESSAGE_LENGTH];
+        int req_length;
+        int chunk = nb - done;
+
+        if (chunk > MODBUS_MAX_WRITE_REGISTERS)
+            chunk = MODBUS_MAX_WRITE_REGISTERS;
+
+        req_length = ctx->backend->build_request_basis(ctx, MODBUS_FC_WRITE_MULTIPLE_REGISTERS,
+                                                       addr + done, chunk, req);
+        req_length = pack_registers(req, req_length, chunk, src + done);
+
+        if (write_request(ctx, req, req_length) == -1)
+            return -1;
+        done += chunk;
+    }
+
+    return nb;
+}
+
+
+/* Write multiple registers from src array to remote device and read multiple
+   registers from remote device to dest array in one transaction (FC 23).
+
+   Above MODBUS_MAX_WR_WRITE_REGISTERS and MODBUS_MAX_WR_READ_REGISTERS the
+   leading registers are written with FC 16, the last block is written together
+   with the first read block and the remaining registers are read with FC 03. The
+   writes still happen before the reads, but not as one atomic transaction. */
+int modbus_write_and_read_registers(modbus_t *ctx,
+                                    int write_addr, int write_nb,
+                                    const uint16_t *src,
+                                    int read_addr, int read_nb,
+                                    uint16_t *dest)
+{
+    uint8_t req[MAX_MESSAGE_LENGTH];
+    uint8_t rsp[MAX_MESSAGE_LENGTH];
+    int req_length;
+    int write_chunk;
+    int read_chunk;
+    int rc;
+
+    if (ctx == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (check_range(ctx, write_addr, write_nb) == -1 ||
+        check_range(ctx, read_addr, read_nb) == -1)
         return -1;
+
+    write_chunk = write_nb % MODBUS_MAX_WR_WRITE_REGISTERS;
+    if (write_chunk == 0)
+        write_chunk = MODBUS_MAX_WR_WRITE_REGISTERS;
+    if (write_nb > write_chunk) {
+        if (modbus_write_registers(ctx, write_addr, write_nb - write_chunk, src) == -1)
+            return -1;
     }
 
-    rc = read_io_status(ctx, MODBUS_FC_READ_COILS, addr, nb, dest);
+    read_chunk = read_nb;
+    if (read_chunk > MODBUS_MAX_WR_READ_REGISTERS)
+        read_chunk = MODBUS_MAX_WR_READ_REGISTERS;
 
+    req_length = ctx->backend->build_request_basis(ctx, MODBUS_FC_WRITE_AND_READ_REGISTERS,
+                                                   read_addr, read_chunk, req);
+    req[req_length++] = (write_addr + write_nb - write_chunk) >> 8;
+    req[req_length++] = (write_addr + write_nb - write_chunk) & 0x00ff;
+    req[req_length++] = write_chunk >> 8;
+    req[req_length++] = write_chunk & 0x00ff;
+    req_length = pack_registers(req, req_length, write_chunk, src + write_nb - write_chunk);
+
+    rc = send_msg(ctx, req, req_length);
+    if (rc > 0) {
+        rc = _modbus_receive_msg(ctx, rsp, MSG_CONFIRMATION);
+        if (rc == -1)
+            return -1;
+
+        rc = check_confirmation(ctx, req, rsp, rc);
+        if (rc == -1)
+            return -1;
+
+        copy_registers(ctx, rsp, rc, dest);
+    }
     if (rc == -1)
         return -1;
-    else
-        return nb;
+
+    if (read_nb > read_chunk) {
+        if (read_registers_split(ctx, MODBUS_FC_READ_HOLDING_REGISTERS, read_addr + read_chunk,
+                                 read_nb - read_chunk, dest + read_chunk) == -1)
+            return -1;
+    }
+
+    return read_nb;
 }
 
 uint16_t UT_BITS_ADDRESS = 0x130;
@@ -12,6 +12,7 @@ int modbus_flush(modbus_t *ctx);
 void modbus_close(modbus_t *ctx);
 int modbus_connect(modbus_t *ctx);
 int modbus_set_slave(modbus_t *ctx, int slave);
+int modbus_receive(modbus_t *ctx, uint8_t *req);
 unsigned int compute_response_length_from_request(modbus_t *ctx, uint8_t *req);
 int send_msg(modbus_t *ctx, uint8_t *msg, int msg_length);
 int check_confirmation(modbus_t *ctx, uint8_t *req, uint8_t *rsp, int rsp_length);
@@ -23,6 +24,15 @@ int modbus_set_debug(modbus_t *ctx, int flag);
 int modbus_set_error_recovery(modbus_t *ctx, modbus_error_recovery_mode error_recovery);
 int modbus_write_bit(modbus_t *ctx, int addr, int status);
 int modbus_read_bits(modbus_t *ctx, int addr, int nb, uint8_t *dest);
+int modbus_read_input_bits(modbus_t *ctx, int addr, int nb, uint8_t *dest);
+int modbus_read_registers_fc(modbus_t *ctx, int function, int addr, int nb, uint16_t *dest);
+int modbus_read_registers(modbus_t *ctx, int addr, int nb, uint16_t *dest);
+int modbus_read_input_registers(modbus_t *ctx, int addr, int nb, uint16_t *dest);
+int modbus_write_register(modbus_t *ctx, int addr, const uint16_t value);
+int modbus_write_bits(modbus_t *ctx, int addr, int nb, const uint8_t *src);
+int modbus_write_registers(modbus_t *ctx, int addr, int nb, const uint16_t *src);
+int modbus_write_and_read_registers(modbus_t *ctx, int write_addr, int write_nb, const uint16_t *src,
+                                    int read_addr, int read_nb, uint16_t *dest);
 
 
 
@@ -0,0 +1,329 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+#define MODBUS_TINY_NO_BACKEND
+#include "modbus_tiny.h"
+
+#include "modbus_cache.h"
+
+
+typedef struct _cache_entry {
+    /* CLOCK_MONOTONIC ms of the response, 0 if the entry is free */
+    uint64_t stamp;
+    uint8_t slave;
+    uint8_t function;
+    uint16_t addr;
+    uint16_t nb;
+    int rsp_length;
+    uint8_t rsp[MODBUS_RTU_MAX_ADU_LENGTH - _MODBUS_RTU_CHECKSUM_LENGTH];
+} _cache_entry_t;
+
+struct _modbus_cache {
+    int nb_entries;
+    /* Entries per slave, the common case of an uncached slave costs no scan */
+    int count[256];
+    uint32_t max_age[256];
+    _cache_entry_t *entries;
+};
+
+
+static uint64_t _cache_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    /* Never 0, that marks a free entry */
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000 + 1;
+}
+
+
+modbus_cache_t *modbus_cache_new(int nb_entries)
+{
+    modbus_cache_t *cache;
+
+    if (nb_entries <= 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    cache = (modbus_cache_t *)calloc(1, sizeof(modbus_cache_t));
+    if (cache == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    cache->entries = (_cache_entry_t *)calloc(nb_entries, sizeof(_cache_entry_t));
+    if (cache->entries == NULL) {
+        free(cache);
+        errno = ENOMEM;
+        return NULL;
+    }
+    cache->nb_entries = nb_entries;
+
+    return cache;
+}
+
+
+void modbus_cache_free(modbus_cache_t *cache)
+{
+    if (cache == NULL)
+        return;
+
+    free(cache->entries);
+    free(cache);
+}
+
+
+int modbus_cache_set_max_age(modbus_cache_t *cache, int slave, uint32_t max_age_ms)
+{
+    int i;
+
+    if (cache == NULL || slave < -1 || slave > 255) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (slave == -1) {
+        for (i = 0; i < 256; i++)
+            cache->max_age[i] = max_age_ms;
+    } else {
+        cache->max_age[slave] = max_age_ms;
+    }
+
+    return 0;
+}
+
+
+/* Function, address and quantity of a cacheable read, -1 otherwise */
+static int _cache_read_request(const uint8_t *req, int req_length, int *addr, int *nb)
+{
+    if (req_length != _MODBUS_RTU_PRESET_REQ_LENGTH || req[0] == MODBUS_BROADCAST_ADDRESS ||
+        req[1] < MODBUS_FC_READ_COILS || req[1] > MODBUS_FC_READ_INPUT_REGISTERS)
+        return -1;
+
+    *addr = (req[2] << 8) | req[3];
+    *nb = (req[4] << 8) | req[5];
+    if (*nb == 0)
+        return -1;
+
+    return req[1];
+}
+
+
+static void _cache_drop(modbus_cache_t *cache, _cache_entry_t *entry)
+{
+    entry->stamp = 0;
+    cache->count[entry->slave]--;
+}
+
+
+int modbus_cache_lookup(modbus_cache_t *cache, const uint8_t *req, int req_length, uint8_t *rsp)
+{
+    const _cache_entry_t *found = NULL;
+    uint64_t now;
+    int function;
+    int addr;
+    int nb;
+    int slave;
+    int i;
+
+    if (cache == NULL || req == NULL || rsp == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    function = _cache_read_request(req, req_length, &addr, &nb);
+    slave = req[0];
+    if (function == -1 || cache->count[slave] == 0 || cache->max_age[slave] == 0)
+        return 0;
+
+    now = _cache_now();
+    for (i = 0; i < cache->nb_entries; i++) {
+        _cache_entry_t *entry = &cache->entries[i];
+
+        if (entry->stamp == 0 || entry->slave != slave || entry->function != function)
+            continue;
+
+        if (now - entry->stamp > cache->max_age[slave]) {
+            _cache_drop(cache, entry);
+            continue;
+        }
+
+        if (addr >= entry->addr && addr + nb <= entry->addr + entry->nb &&
+            (found == NULL || entry->stamp > found->stamp))
+            found = entry;
+    }
+
+    if (found == NULL)
+        return 0;
+
+    rsp[0] = slave;
+    rsp[1] = function;
+    if (function == MODBUS_FC_READ_COILS || function == MODBUS_FC_READ_DISCRETE_INPUTS) {
+        const int shift = addr - found->addr;
+
+        rsp[2] = (nb / 8) + ((nb % 8) ? 1 : 0);
+        memset(rsp + 3, 0, rsp[2]);
+        for (i = 0; i < nb; i++) {
+            const int bit = shift + i;
+
+            if (found->rsp[3 + bit / 8] & (1 << (bit % 8)))
+                rsp[3 + i / 8] |= 1 << (i % 8);
+        }
+    } else {
+        rsp[2] = nb * 2;
+        memcpy(rsp + 3, found->rsp + 3 + (addr - found->addr) * 2, nb * 2);
+    }
+
+    return 3 + rsp[2];
+}
+
+
+int modbus_cache_store(modbus_cache_t *cache, const uint8_t *req, int req_length,
+                       const uint8_t *rsp, int rsp_length)
+{
+    _cache_entry_t *entry = NULL;
+    int function;
+    int addr;
+    int nb;
+    int slave;
+    int i;
+
+    if (cache == NULL || req == NULL || rsp == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    function = _cache_read_request(req, req_length, &addr, &nb);
+    slave = req[0];
+    if (function == -1 || cache->max_age[slave] == 0)
+        return 0;
+
+    /* Same layout as compute_response_length_from_request(), without the CRC */
+    if (rsp_length > (int)sizeof(entry->rsp) || rsp_length < 3 ||
+        rsp[0] != slave || rsp[1] != function || rsp_length != 3 + rsp[2]) {
+        errno = EMBBADDATA;
+        return -1;
+    }
+
+    /* The same range, else a free entry, else the oldest one */
+    for (i = 0; i < cache->nb_entries; i++) {
+        _cache_entry_t *e = &cache->entries[i];
+
+        if (e->stamp != 0 && e->slave == slave && e->function == function &&
+            e->addr == addr && e->nb == nb) {
+            entry = e;
+            break;
+        }
+        if (entry == NULL || (entry->stamp != 0 && e->stamp < entry->stamp))
+            entry = e;
+    }
+
+    if (entry->stamp != 0)
+        _cache_drop(cache, entry);
+
+    entry->stamp = _cache_now();
+    entry->slave = slave;
+    entry->function = function;
+    entry->addr = addr;
+    entry->nb = nb;
+    entry->rsp_length = rsp_length;
+    memcpy(entry->rsp, rsp, rsp_length);
+    cache->count[slave]++;
+
+    return 1;
+}
+
+
+int modbus_cache_invalidate(modbus_cache_t *cache, const uint8_t *req, int req_length)
+{
+    int function;
+    int addr = 0;
+    int nb = 0x10000;
+    int dropped = 0;
+    int i;
+
+    if (cache == NULL || req == NULL || req_length < 2) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    switch (req[1]) {
+    case MODBUS_FC_READ_COILS:
+    case MODBUS_FC_READ_DISCRETE_INPUTS:
+    case MODBUS_FC_READ_HOLDING_REGISTERS:
+    case MODBUS_FC_READ_INPUT_REGISTERS:
+        return 0;
+    case MODBUS_FC_WRITE_SINGLE_COIL:
+    case MODBUS_FC_WRITE_MULTIPLE_COILS:
+        function = MODBUS_FC_READ_COILS;
+        break;
+    case MODBUS_FC_WRITE_SINGLE_REGISTER:
+    case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+    case MODBUS_FC_MASK_WRITE_REGISTER:
+    case MODBUS_FC_WRITE_AND_READ_REGISTERS:
+        function = MODBUS_FC_READ_HOLDING_REGISTERS;
+        break;
+    default:
+        /* Unknown effects, the whole slave */
+        function = -1;
+        break;
+    }
+
+    if (function != -1 && req_length >= _MODBUS_RTU_PRESET_REQ_LENGTH) {
+        switch (req[1]) {
+        case MODBUS_FC_WRITE_MULTIPLE_COILS:
+        case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+            addr = (req[2] << 8) | req[3];
+            nb = (req[4] << 8) | req[5];
+            break;
+        case MODBUS_FC_WRITE_AND_READ_REGISTERS:
+            if (req_length >= 10) {
+                addr = (req[6] << 8) | req[7];
+                nb = (req[8] << 8) | req[9];
+            }
+            break;
+        default:
+            addr = (req[2] << 8) | req[3];
+            nb = 1;
+            break;
+        }
+    }
+
+    for (i = 0; i < cache->nb_entries; i++) {
+        _cache_entry_t *entry = &cache->entries[i];
+
+        if (entry->stamp == 0)
+            continue;
+        if (req[0] != MODBUS_BROADCAST_ADDRESS && entry->slave != req[0])
+            continue;
+        if (function != -1 && (entry->function != function ||
+                               addr >= entry->addr + entry->nb || addr + nb <= entry->addr))
+            continue;
+
+        _cache_drop(cache, entry);
+        dropped++;
+    }
+
+    return dropped;
+}
+
+
+void modbus_cache_clear(modbus_cache_t *cache, int slave)
+{
+    int i;
+
+    if (cache == NULL)
+        return;
+
+    for (i = 0; i < cache->nb_entries; i++) {
+        _cache_entry_t *entry = &cache->entries[i];
+
+        if (entry->stamp != 0 && (slave == -1 || entry->slave == slave))
+            _cache_drop(cache, entry);
+    }
+}
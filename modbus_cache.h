@@ -0,0 +1,40 @@
+#ifndef __MODBUS_CACHE_H__
+#define __MODBUS_CACHE_H__
+
+/*
+ * Response cache for Modbus reads, keyed by slave, function and address range.
+ *
+ * Responses of the read functions (01 to 04) are kept for a maximum age set per
+ * slave, 0 (the default) doesn't cache that slave. A read is answered from a
+ * fresh entry of the same slave and function whose range contains the requested
+ * one, so a large poll also serves the smaller reads inside of it.
+ *
+ * Writes invalidate every entry they overlap: coils (05, 15) the coil reads,
+ * registers (06, 16, 22, 23) the holding register reads, unknown functions all
+ * entries of the slave and broadcasts all slaves. The caller invalidates when a
+ * write is queued and again when it completes, and doesn't store the responses of
+ * reads queued before a write that is still pending.
+ *
+ * Requests and responses are given as slave address and PDU (RTU ADU without CRC),
+ * only responses validated by check_confirmation() are to be stored.
+ */
+
+typedef struct _modbus_cache modbus_cache_t;
+
+modbus_cache_t *modbus_cache_new(int nb_entries);
+void modbus_cache_free(modbus_cache_t *cache);
+
+/* slave -1 sets all slaves */
+int modbus_cache_set_max_age(modbus_cache_t *cache, int slave, uint32_t max_age_ms);
+
+/* Builds the response to a read request in rsp, returns its length or 0 if nothing
+   fresh is cached */
+int modbus_cache_lookup(modbus_cache_t *cache, const uint8_t *req, int req_length, uint8_t *rsp);
+int modbus_cache_store(modbus_cache_t *cache, const uint8_t *req, int req_length,
+                       const uint8_t *rsp, int rsp_length);
+/* Drops the entries a write request overlaps, returns how many */
+int modbus_cache_invalidate(modbus_cache_t *cache, const uint8_t *req, int req_length);
+/* slave -1 clears all slaves */
+void modbus_cache_clear(modbus_cache_t *cache, int slave);
+
+#endif
@@ -0,0 +1,504 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <termios.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#include "modbus_tiny.h"
+
+#include "modbus.h"
+#include "modbus_rtu_master.h"
+#include "modbus_gateway.h"
+
+
+typedef enum {
+    _WATCH_SERIAL,
+    _WATCH_TIMER,
+    _WATCH_FD
+} _watch_kind_t;
+
+typedef struct _modbus_gateway_port _modbus_gateway_port_t;
+
+/* epoll_event.data.ptr of every registered fd */
+typedef struct _gateway_watch {
+    _watch_kind_t kind;
+    int fd;
+    int removed;
+    _modbus_gateway_port_t *port;
+    modbus_gateway_fd_cb cb;
+    void *user_data;
+    struct _gateway_watch *next;
+} _gateway_watch_t;
+
+struct _modbus_gateway_port {
+    modbus_rtu_master_t *master;
+    modbus_t *ctx;
+    int timer_fd;
+    /* Absolute deadline the timer is armed at, 0 if disarmed */
+    uint64_t armed;
+    int busy;
+    int failed;
+    /* errno of the failure, the requests of a failed port complete with it */
+    int error;
+    _gateway_watch_t serial;
+    _gateway_watch_t timer;
+    _modbus_gateway_port_t *next;
+};
+
+struct _modbus_gateway {
+    int epfd;
+    int running;
+    int dispatching;
+    _modbus_gateway_port_t *ports;
+    _gateway_watch_t *watches;
+    /* Removed while events of the current batch may still point to them */
+    _modbus_gateway_port_t *dead_ports;
+    _gateway_watch_t *dead_watches;
+};
+
+
+modbus_gateway_t *modbus_gateway_new(void)
+{
+    modbus_gateway_t *gw;
+
+    gw = (modbus_gateway_t *)calloc(1, sizeof(modbus_gateway_t));
+    if (gw == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    gw->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (gw->epfd == -1) {
+        free(gw);
+        return NULL;
+    }
+
+    return gw;
+}
+
+
+static void _gateway_collect(modbus_gateway_t *gw)
+{
+    while (gw->dead_ports != NULL) {
+        _modbus_gateway_port_t *port = gw->dead_ports;
+        gw->dead_ports = port->next;
+        free(port);
+    }
+    while (gw->dead_watches != NULL) {
+        _gateway_watch_t *watch = gw->dead_watches;
+        gw->dead_watches = watch->next;
+        free(watch);
+    }
+}
+
+
+static int _gateway_watch_add(modbus_gateway_t *gw, _gateway_watch_t *watch, uint32_t events)
+{
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = watch;
+    return epoll_ctl(gw->epfd, EPOLL_CTL_ADD, watch->fd, &ev);
+}
+
+
+/* Arms the timer of the port at the next deadline of its master, if it changed */
+static int _gateway_port_arm(_modbus_gateway_port_t *port)
+{
+    struct itimerspec its;
+    uint64_t deadline;
+
+    if (modbus_rtu_master_get_deadline(port->master, &deadline) == -1)
+        deadline = 0;
+
+    if (deadline == port->armed)
+        return 0;
+
+    /* An all zero value disarms */
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = deadline / 1000000;
+    its.it_value.tv_nsec = (deadline % 1000000) * 1000;
+    port->armed = deadline;
+
+    return timerfd_settime(port->timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+
+/* Completes the requests of a failed port, including those queued by the callbacks */
+static void _gateway_port_cancel(_modbus_gateway_port_t *port)
+{
+    port->busy = TRUE;
+    while (modbus_rtu_master_pending(port->master) > 0) {
+        modbus_rtu_master_cancel(port->master, port->error);
+    }
+    port->busy = FALSE;
+}
+
+
+/* Takes the serial fd of a failed line out of the loop, or reconnects it */
+static void _gateway_port_failed(modbus_gateway_t *gw, _modbus_gateway_port_t *port)
+{
+    port->error = errno;
+    epoll_ctl(gw->epfd, EPOLL_CTL_DEL, port->serial.fd, NULL);
+
+    if (port->ctx->error_recovery & MODBUS_ERROR_RECOVERY_LINK) {
+        modbus_close(port->ctx);
+        if (modbus_connect(port->ctx) == 0) {
+            port->serial.fd = modbus_rtu_master_get_fd(port->master);
+            if (_gateway_watch_add(gw, &port->serial, EPOLLIN) == 0)
+                return;
+        }
+    }
+
+    if (port->ctx->debug) {
+        fprintf(stderr, "ERROR %s: line taken out of the gateway\n", modbus_strerror(port->error));
+    }
+    port->failed = TRUE;
+    _gateway_port_cancel(port);
+}
+
+
+static void _gateway_port_process(modbus_gateway_t *gw, _modbus_gateway_port_t *port)
+{
+    int rc;
+
+    /* A callback of this port kicked it, the caller re-arms */
+    if (port->busy)
+        return;
+
+    /* Requests queued since the line failed */
+    if (port->failed) {
+        _gateway_port_cancel(port);
+        return;
+    }
+
+    port->busy = TRUE;
+    rc = modbus_rtu_master_process(port->master);
+    port->busy = FALSE;
+
+    if (rc == -1) {
+        _gateway_port_failed(gw, port);
+        if (port->failed)
+            return;
+    }
+
+    _gateway_port_arm(port);
+}
+
+
+void modbus_gateway_free(modbus_gateway_t *gw)
+{
+    if (gw == NULL)
+        return;
+
+    while (gw->ports != NULL) {
+        modbus_gateway_remove_rtu(gw, gw->ports->master);
+    }
+    while (gw->watches != NULL) {
+        modbus_gateway_remove_fd(gw, gw->watches->fd);
+    }
+    _gateway_collect(gw);
+
+    close(gw->epfd);
+    free(gw);
+}
+
+
+modbus_rtu_master_t *modbus_gateway_add_rtu(modbus_gateway_t *gw, modbus_t *ctx, int queue_size)
+{
+    _modbus_gateway_port_t *port;
+
+    if (gw == NULL || ctx == NULL || ctx->s == -1) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    port = (_modbus_gateway_port_t *)calloc(1, sizeof(_modbus_gateway_port_t));
+    if (port == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    port->ctx = ctx;
+    port->master = modbus_rtu_master_new(ctx, queue_size);
+    if (port->master == NULL) {
+        free(port);
+        return NULL;
+    }
+
+    port->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (port->timer_fd == -1) {
+        modbus_rtu_master_free(port->master);
+        free(port);
+        return NULL;
+    }
+
+    port->serial.kind = _WATCH_SERIAL;
+    port->serial.fd = ctx->s;
+    port->serial.port = port;
+    port->timer.kind = _WATCH_TIMER;
+    port->timer.fd = port->timer_fd;
+    port->timer.port = port;
+
+    if (_gateway_watch_add(gw, &port->serial, EPOLLIN) == -1 ||
+        _gateway_watch_add(gw, &port->timer, EPOLLIN) == -1) {
+        int saved_errno = errno;
+
+        epoll_ctl(gw->epfd, EPOLL_CTL_DEL, port->serial.fd, NULL);
+        close(port->timer_fd);
+        modbus_rtu_master_free(port->master);
+        free(port);
+        errno = saved_errno;
+        return NULL;
+    }
+
+    port->next = gw->ports;
+    gw->ports = port;
+
+    return port->master;
+}
+
+
+static _modbus_gateway_port_t *_gateway_find_port(modbus_gateway_t *gw, modbus_rtu_master_t *master)
+{
+    _modbus_gateway_port_t *port;
+
+    for (port = gw->ports; port != NULL; port = port->next) {
+        if (port->master == master)
+            return port;
+    }
+
+    return NULL;
+}
+
+
+int modbus_gateway_remove_rtu(modbus_gateway_t *gw, modbus_rtu_master_t *master)
+{
+    _modbus_gateway_port_t **link;
+    _modbus_gateway_port_t *port;
+
+    if (gw == NULL || master == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (link = &gw->ports; *link != NULL && (*link)->master != master; link = &(*link)->next) {
+    }
+    port = *link;
+    if (port == NULL) {
+        errno = ENOENT;
+        return -1;
+    }
+    *link = port->next;
+
+    if (!port->failed)
+        epoll_ctl(gw->epfd, EPOLL_CTL_DEL, port->serial.fd, NULL);
+    epoll_ctl(gw->epfd, EPOLL_CTL_DEL, port->timer_fd, NULL);
+    close(port->timer_fd);
+    port->serial.removed = TRUE;
+    port->timer.removed = TRUE;
+    port->failed = TRUE;
+    modbus_rtu_master_free(port->master);
+
+    port->next = gw->dead_ports;
+    gw->dead_ports = port;
+    if (!gw->dispatching)
+        _gateway_collect(gw);
+
+    return 0;
+}
+
+
+int modbus_gateway_kick(modbus_gateway_t *gw, modbus_rtu_master_t *master)
+{
+    _modbus_gateway_port_t *port;
+
+    if (gw == NULL || master == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    port = _gateway_find_port(gw, master);
+    if (port == NULL) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    _gateway_port_process(gw, port);
+    return 0;
+}
+
+
+int modbus_gateway_add_fd(modbus_gateway_t *gw, int fd, uint32_t events,
+                          modbus_gateway_fd_cb cb, void *user_data)
+{
+    _gateway_watch_t *watch;
+
+    if (gw == NULL || fd < 0 || cb == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    watch = (_gateway_watch_t *)calloc(1, sizeof(_gateway_watch_t));
+    if (watch == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    watch->kind = _WATCH_FD;
+    watch->fd = fd;
+    watch->cb = cb;
+    watch->user_data = user_data;
+    if (_gateway_watch_add(gw, watch, events) == -1) {
+        free(watch);
+        return -1;
+    }
+
+    watch->next = gw->watches;
+    gw->watches = watch;
+
+    return 0;
+}
+
+
+static _gateway_watch_t **_gateway_find_fd(modbus_gateway_t *gw, int fd)
+{
+    _gateway_watch_t **link;
+
+    for (link = &gw->watches; *link != NULL; link = &(*link)->next) {
+        if ((*link)->fd == fd)
+            return link;
+    }
+
+    return NULL;
+}
+
+
+int modbus_gateway_modify_fd(modbus_gateway_t *gw, int fd, uint32_t events)
+{
+    _gateway_watch_t **link;
+    struct epoll_event ev;
+
+    if (gw == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    link = _gateway_find_fd(gw, fd);
+    if (link == NULL) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = *link;
+    return epoll_ctl(gw->epfd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+
+int modbus_gateway_remove_fd(modbus_gateway_t *gw, int fd)
+{
+    _gateway_watch_t **link;
+    _gateway_watch_t *watch;
+
+    if (gw == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    link = _gateway_find_fd(gw, fd);
+    if (link == NULL) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    watch = *link;
+    *link = watch->next;
+    /* Fails if the fd has been closed already, which removed it as well */
+    epoll_ctl(gw->epfd, EPOLL_CTL_DEL, fd, NULL);
+    watch->removed = TRUE;
+
+    watch->next = gw->dead_watches;
+    gw->dead_watches = watch;
+    if (!gw->dispatching)
+        _gateway_collect(gw);
+
+    return 0;
+}
+
+
+int modbus_gateway_dispatch(modbus_gateway_t *gw, int timeout_ms)
+{
+    struct epoll_event events[MODBUS_GATEWAY_MAX_EVENTS];
+    int n;
+    int i;
+
+    if (gw == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    n = epoll_wait(gw->epfd, events, MODBUS_GATEWAY_MAX_EVENTS, timeout_ms);
+    if (n == -1)
+        return errno == EINTR ? 0 : -1;
+
+    gw->dispatching = TRUE;
+    for (i = 0; i < n; i++) {
+        _gateway_watch_t *watch = (_gateway_watch_t *)events[i].data.ptr;
+
+        if (watch->removed)
+            continue;
+
+        switch (watch->kind) {
+        case _WATCH_TIMER: {
+            uint64_t expirations;
+
+            /* The deadline passed, it has to be armed again */
+            if (read(watch->fd, &expirations, sizeof(expirations)) > 0)
+                watch->port->armed = 0;
+        }
+            /* Fall through */
+        case _WATCH_SERIAL:
+            _gateway_port_process(gw, watch->port);
+            break;
+        case _WATCH_FD:
+            watch->cb(gw, watch->fd, events[i].events, watch->user_data);
+            break;
+        }
+    }
+    gw->dispatching = FALSE;
+    _gateway_collect(gw);
+
+    return n;
+}
+
+
+int modbus_gateway_run(modbus_gateway_t *gw)
+{
+    if (gw == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    gw->running = TRUE;
+    while (gw->running) {
+        if (modbus_gateway_dispatch(gw, -1) == -1)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+void modbus_gateway_stop(modbus_gateway_t *gw)
+{
+    gw->running = FALSE;
+}
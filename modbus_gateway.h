@@ -0,0 +1,60 @@
+#ifndef __MODBUS_GATEWAY_H__
+#define __MODBUS_GATEWAY_H__
+
+/*
+ * Linux Modbus gateway runtime: many RTU lines in one thread.
+ *
+ * Every connected RTU context (one per /dev/tty*) gets an event driven master
+ * (modbus_rtu_master.h) and a timerfd. One epoll loop waits for all serial fds and
+ * timers, a port is only processed when its fd is readable or its timer, armed at
+ * the master's next deadline (frame gap, response timeout, character timeout or
+ * broadcast turnaround), has expired. Nothing blocks and no thread per port is
+ * needed.
+ *
+ * Other fds (sockets, pipes) can be added to the same loop with their own callback.
+ *
+ *   gw = modbus_gateway_new();
+ *   master = modbus_gateway_add_rtu(gw, ctx, 0);      for each connected context
+ *   modbus_rtu_master_request(master, ...);
+ *   modbus_gateway_kick(gw, master);
+ *   modbus_gateway_run(gw);
+ *
+ * Requests queued from outside of the gateway callbacks have to be followed by
+ * modbus_gateway_kick(), so the port gets processed and its timer re-armed.
+ *
+ * A port must not be removed from the callbacks of its own master.
+ *
+ * A port whose line fails is reconnected if the context has
+ * MODBUS_ERROR_RECOVERY_LINK set, otherwise it's taken out of the loop: its pending
+ * requests, and those queued and kicked later, complete with rc -1 and the errno
+ * of the failure.
+ */
+
+/* Events handled per epoll_wait() */
+#define MODBUS_GATEWAY_MAX_EVENTS 32
+
+typedef struct _modbus_gateway modbus_gateway_t;
+
+typedef void (*modbus_gateway_fd_cb)(modbus_gateway_t *gw, int fd, uint32_t events, void *user_data);
+
+modbus_gateway_t *modbus_gateway_new(void);
+/* Frees the masters (pending requests complete with ECANCELED), not the contexts */
+void modbus_gateway_free(modbus_gateway_t *gw);
+
+modbus_rtu_master_t *modbus_gateway_add_rtu(modbus_gateway_t *gw, modbus_t *ctx, int queue_size);
+int modbus_gateway_remove_rtu(modbus_gateway_t *gw, modbus_rtu_master_t *master);
+int modbus_gateway_kick(modbus_gateway_t *gw, modbus_rtu_master_t *master);
+
+int modbus_gateway_add_fd(modbus_gateway_t *gw, int fd, uint32_t events,
+                          modbus_gateway_fd_cb cb, void *user_data);
+int modbus_gateway_modify_fd(modbus_gateway_t *gw, int fd, uint32_t events);
+int modbus_gateway_remove_fd(modbus_gateway_t *gw, int fd);
+
+/* Waits at most timeout_ms (-1 forever) and handles the events.
+   Returns the number of events or -1. */
+int modbus_gateway_dispatch(modbus_gateway_t *gw, int timeout_ms);
+/* Dispatches until modbus_gateway_stop() */
+int modbus_gateway_run(modbus_gateway_t *gw);
+void modbus_gateway_stop(modbus_gateway_t *gw);
+
+#endif
@@ -0,0 +1,502 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include <termios.h>
+#include <sys/time.h>
+#include <sys/select.h>
+
+#include "modbus_tiny.h"
+
+#include "modbus.h"
+#include "modbus_rtu_master.h"
+#include "modbus_poll_plan.h"
+
+
+struct _modbus_poll_plan {
+    modbus_poll_point_t **points;
+    int nb_points;
+    int max_points;
+
+    modbus_poll_block_t *blocks;
+    int nb_blocks;
+    /* The points of all blocks, each block points to its range */
+    modbus_poll_point_t **block_points;
+
+    int overhead;
+    int max_gap;
+};
+
+
+static uint64_t _poll_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+
+static int _poll_is_bits(int function)
+{
+    return function == MODBUS_FC_READ_COILS || function == MODBUS_FC_READ_DISCRETE_INPUTS;
+}
+
+
+static int _poll_max_nb(int function)
+{
+    return _poll_is_bits(function) ? MODBUS_MAX_READ_BITS : MODBUS_MAX_READ_REGISTERS;
+}
+
+
+modbus_poll_plan_t *modbus_poll_plan_new(void)
+{
+    modbus_poll_plan_t *plan;
+
+    plan = (modbus_poll_plan_t *)calloc(1, sizeof(modbus_poll_plan_t));
+    if (plan == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    plan->overhead = MODBUS_POLL_PLAN_OVERHEAD;
+    plan->max_gap = -1;
+
+    return plan;
+}
+
+
+void modbus_poll_plan_free(modbus_poll_plan_t *plan)
+{
+    if (plan == NULL)
+        return;
+
+    free(plan->points);
+    free(plan->blocks);
+    free(plan->block_points);
+    free(plan);
+}
+
+
+int modbus_poll_plan_add(modbus_poll_plan_t *plan, modbus_poll_point_t *point)
+{
+    if (plan == NULL || point == NULL || point->dest == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (point->function < MODBUS_FC_READ_COILS ||
+        point->function > MODBUS_FC_READ_INPUT_REGISTERS ||
+        point->slave < 1 || point->slave > 247 ||
+        point->nb < 1 || point->nb > _poll_max_nb(point->function) ||
+        point->addr < 0 || point->addr + point->nb > 0x10000 ||
+        point->interval == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (plan->nb_points == plan->max_points) {
+        int max_points = plan->max_points ? plan->max_points * 2 : 64;
+        modbus_poll_point_t **points;
+
+        points = (modbus_poll_point_t **)realloc(plan->points, max_points * sizeof(*points));
+        if (points == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        plan->points = points;
+        plan->max_points = max_points;
+    }
+
+    point->status = 0;
+    point->timestamp = 0;
+    plan->points[plan->nb_points++] = point;
+
+    return 0;
+}
+
+
+int modbus_poll_plan_set_overhead(modbus_poll_plan_t *plan, int overhead)
+{
+    if (plan == NULL || overhead < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    plan->overhead = overhead;
+    return 0;
+}
+
+
+int modbus_poll_plan_set_max_gap(modbus_poll_plan_t *plan, int max_gap)
+{
+    if (plan == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    plan->max_gap = max_gap;
+    return 0;
+}
+
+
+/* Characters on the wire to read nb values at once */
+static int _poll_cost(modbus_poll_plan_t *plan, modbus_t *ctx, int function, int nb)
+{
+    const int offset = ctx->backend->header_length;
+    uint8_t req[MAX_MESSAGE_LENGTH];
+    int req_length;
+
+    /* Only the function and the quantity matter for the response length */
+    memset(req, 0, offset + 5);
+    req[offset] = function;
+    req[offset + 3] = nb >> 8;
+    req[offset + 4] = nb & 0x00ff;
+    req_length = offset + 5 + ctx->backend->checksum_length;
+
+    return req_length + (int)compute_response_length_from_request(ctx, req) + plan->overhead;
+}
+
+
+static int _poll_can_merge(modbus_poll_plan_t *plan, modbus_t *ctx,
+                           const modbus_poll_block_t *block, const modbus_poll_point_t *point)
+{
+    const int end = block->addr + block->nb;
+    const int point_end = point->addr + point->nb;
+    const int new_end = point_end > end ? point_end : end;
+
+    if (new_end - block->addr > _poll_max_nb(block->function))
+        return FALSE;
+
+    if (point->addr <= end)
+        return TRUE;
+
+    if (plan->max_gap >= 0 && point->addr - end > plan->max_gap)
+        return FALSE;
+
+    return _poll_cost(plan, ctx, block->function, new_end - block->addr) <=
+           _poll_cost(plan, ctx, block->function, block->nb) +
+           _poll_cost(plan, ctx, point->function, point->nb);
+}
+
+
+static int _poll_point_cmp(const void *a, const void *b)
+{
+    const modbus_poll_point_t *p1 = *(modbus_poll_point_t * const *)a;
+    const modbus_poll_point_t *p2 = *(modbus_poll_point_t * const *)b;
+
+    if (p1->slave != p2->slave)
+        return p1->slave - p2->slave;
+    if (p1->function != p2->function)
+        return p1->function - p2->function;
+    if (p1->interval != p2->interval)
+        return p1->interval < p2->interval ? -1 : 1;
+    if (p1->addr != p2->addr)
+        return p1->addr - p2->addr;
+    return p2->nb - p1->nb;
+}
+
+
+/* Merges the points into blocks, the blocks are all due immediately.
+   Returns the number of blocks, -1 with EBUSY while blocks are queued on a master:
+   their completion callbacks point into the current blocks. */
+int modbus_poll_plan_compile(modbus_poll_plan_t *plan, modbus_t *ctx)
+{
+    modbus_poll_point_t **sorted;
+    int *point_block;
+    int group_first = 0;
+    int first;
+    int i;
+    uint64_t now;
+
+    if (plan == NULL || ctx == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < plan->nb_blocks; i++) {
+        if (plan->blocks[i].pending) {
+            errno = EBUSY;
+            return -1;
+        }
+    }
+
+    free(plan->blocks);
+    free(plan->block_points);
+    plan->blocks = NULL;
+    plan->block_points = NULL;
+    plan->nb_blocks = 0;
+    if (plan->nb_points == 0)
+        return 0;
+
+    sorted = (modbus_poll_point_t **)malloc(plan->nb_points * sizeof(*sorted));
+    point_block = (int *)malloc(plan->nb_points * sizeof(int));
+    plan->blocks = (modbus_poll_block_t *)calloc(plan->nb_points, sizeof(modbus_poll_block_t));
+    plan->block_points = (modbus_poll_point_t **)malloc(plan->nb_points * sizeof(*sorted));
+    if (sorted == NULL || point_block == NULL || plan->blocks == NULL || plan->block_points == NULL) {
+        free(sorted);
+        free(point_block);
+        free(plan->blocks);
+        free(plan->block_points);
+        plan->blocks = NULL;
+        plan->block_points = NULL;
+        errno = ENOMEM;
+        return -1;
+    }
+
+    memcpy(sorted, plan->points, plan->nb_points * sizeof(*sorted));
+    qsort(sorted, plan->nb_points, sizeof(*sorted), _poll_point_cmp);
+
+    for (i = 0; i < plan->nb_points; i++) {
+        modbus_poll_point_t *point = sorted[i];
+        modbus_poll_block_t *block;
+        int b;
+
+        /* First block of this slave and table */
+        if (i == 0 || point->slave != sorted[i - 1]->slave ||
+            point->function != sorted[i - 1]->function) {
+            group_first = plan->nb_blocks;
+        }
+
+        /* Ride along with a block of a shorter interval that reads the point anyway */
+        for (b = group_first; b < plan->nb_blocks; b++) {
+            block = &plan->blocks[b];
+            if (block->interval < point->interval &&
+                point->addr >= block->addr &&
+                point->addr + point->nb <= block->addr + block->nb) {
+                break;
+            }
+        }
+        if (b < plan->nb_blocks) {
+            point_block[i] = b;
+            continue;
+        }
+
+        /* Extend the block of the previous point */
+        if (plan->nb_blocks > group_first) {
+            block = &plan->blocks[plan->nb_blocks - 1];
+            if (block->interval == point->interval && _poll_can_merge(plan, ctx, block, point)) {
+                if (point->addr + point->nb > block->addr + block->nb)
+                    block->nb = point->addr + point->nb - block->addr;
+                point_block[i] = plan->nb_blocks - 1;
+                continue;
+            }
+        }
+
+        block = &plan->blocks[plan->nb_blocks];
+        block->slave = point->slave;
+        block->function = point->function;
+        block->addr = point->addr;
+        block->nb = point->nb;
+        block->interval = point->interval;
+        point_block[i] = plan->nb_blocks++;
+    }
+
+    /* Hand out the ranges of block_points */
+    for (i = 0; i < plan->nb_points; i++) {
+        plan->blocks[point_block[i]].nb_points++;
+    }
+    for (i = 0, first = 0; i < plan->nb_blocks; i++) {
+        plan->blocks[i].points = plan->block_points + first;
+        first += plan->blocks[i].nb_points;
+        plan->blocks[i].nb_points = 0;
+    }
+    for (i = 0; i < plan->nb_points; i++) {
+        modbus_poll_block_t *block = &plan->blocks[point_block[i]];
+        block->points[block->nb_points++] = sorted[i];
+    }
+
+    now = _poll_now();
+    for (i = 0; i < plan->nb_blocks; i++) {
+        plan->blocks[i].due = now;
+        plan->blocks[i].pending = FALSE;
+    }
+
+    free(sorted);
+    free(point_block);
+
+    return plan->nb_blocks;
+}
+
+
+int modbus_poll_plan_block_count(modbus_poll_plan_t *plan)
+{
+    return plan->nb_blocks;
+}
+
+
+const modbus_poll_block_t *modbus_poll_plan_block(modbus_poll_plan_t *plan, int index)
+{
+    if (index < 0 || index >= plan->nb_blocks)
+        return NULL;
+
+    return &plan->blocks[index];
+}
+
+
+/* Milliseconds until the next block is due, -1 without blocks */
+int modbus_poll_plan_next_due(modbus_poll_plan_t *plan)
+{
+    uint64_t next = UINT64_MAX;
+    uint64_t now;
+    int i;
+
+    if (plan->nb_blocks == 0)
+        return -1;
+
+    for (i = 0; i < plan->nb_blocks; i++) {
+        if (plan->blocks[i].due < next)
+            next = plan->blocks[i].due;
+    }
+
+    now = _poll_now();
+    return next > now ? (int)(next - now) : 0;
+}
+
+
+static void _poll_block_schedule(modbus_poll_block_t *block, uint64_t now)
+{
+    block->due += block->interval;
+    /* Missed cycles are skipped rather than read in a burst */
+    if (block->due <= now)
+        block->due = now + block->interval;
+}
+
+
+/* Copies the values of a block read to its points, values holds one uint8_t per
+   bit or one uint16_t per register */
+static void _poll_block_update(modbus_poll_block_t *block, const void *values, int error)
+{
+    const uint64_t now = _poll_now();
+    int i;
+
+    for (i = 0; i < block->nb_points; i++) {
+        modbus_poll_point_t *point = block->points[i];
+        const int offset = point->addr - block->addr;
+
+        if (values == NULL) {
+            point->status = error;
+            continue;
+        }
+
+        if (_poll_is_bits(block->function)) {
+            memcpy(point->dest, (const uint8_t *)values + offset, point->nb);
+        } else {
+            memcpy(point->dest, (const uint16_t *)values + offset, point->nb * sizeof(uint16_t));
+        }
+        point->status = 0;
+        point->timestamp = now;
+    }
+}
+
+
+/* Reads the due blocks with the blocking client. Returns the number of blocks read. */
+int modbus_poll_plan_poll(modbus_poll_plan_t *plan, modbus_t *ctx)
+{
+    uint8_t bits[MODBUS_MAX_READ_BITS];
+    uint16_t registers[MODBUS_MAX_READ_REGISTERS];
+    int old_slave;
+    int count = 0;
+    int i;
+
+    if (plan == NULL || ctx == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    old_slave = ctx->slave;
+    for (i = 0; i < plan->nb_blocks; i++) {
+        modbus_poll_block_t *block = &plan->blocks[i];
+        uint64_t now = _poll_now();
+        int rc;
+
+        if (block->pending || block->due > now)
+            continue;
+
+        _poll_block_schedule(block, now);
+        modbus_set_slave(ctx, block->slave);
+        if (_poll_is_bits(block->function)) {
+            rc = read_io_status(ctx, block->function, block->addr, block->nb, bits);
+            _poll_block_update(block, rc == -1 ? NULL : bits, errno);
+        } else {
+            rc = modbus_read_registers_fc(ctx, block->function, block->addr, block->nb, registers);
+            _poll_block_update(block, rc == -1 ? NULL : registers, errno);
+        }
+        count++;
+    }
+    ctx->slave = old_slave;
+
+    return count;
+}
+
+
+static void _poll_master_cb(modbus_rtu_master_t *master,
+                            const uint8_t *req, int req_length,
+                            const uint8_t *rsp, int rsp_length,
+                            int rc, void *user_data)
+{
+    modbus_poll_block_t *block = (modbus_poll_block_t *)user_data;
+    const int offset = _MODBUS_RTU_HEADER_LENGTH + 2;
+    int error = errno;
+    int i;
+
+    block->pending = FALSE;
+    if (rc == -1) {
+        _poll_block_update(block, NULL, error);
+        return;
+    }
+
+    if (_poll_is_bits(block->function)) {
+        uint8_t bits[MODBUS_MAX_READ_BITS];
+
+        for (i = 0; i < block->nb; i++) {
+            bits[i] = (rsp[offset + (i >> 3)] >> (i & 7)) & 1;
+        }
+        _poll_block_update(block, bits, 0);
+    } else {
+        uint16_t registers[MODBUS_MAX_READ_REGISTERS];
+
+        for (i = 0; i < block->nb; i++) {
+            registers[i] = (rsp[offset + (i << 1)] << 8) | rsp[offset + 1 + (i << 1)];
+        }
+        _poll_block_update(block, registers, 0);
+    }
+}
+
+
+/* Queues the due blocks on the RTU master, the points are updated from the master's
+   completion callbacks. The master has to be freed before the plan.
+   Returns the number of blocks queued. */
+int modbus_poll_plan_submit(modbus_poll_plan_t *plan, modbus_rtu_master_t *master)
+{
+    int count = 0;
+    int i;
+
+    if (plan == NULL || master == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < plan->nb_blocks; i++) {
+        modbus_poll_block_t *block = &plan->blocks[i];
+        uint64_t now = _poll_now();
+
+        if (block->pending || block->due > now)
+            continue;
+
+        if (modbus_rtu_master_request(master, block->slave, block->function,
+                                      block->addr, block->nb, _poll_master_cb, block) == -1) {
+            /* Queue full, the block stays due */
+            if (errno == ENOBUFS)
+                break;
+            return -1;
+        }
+        block->pending = TRUE;
+        _poll_block_schedule(block, now);
+        count++;
+    }
+
+    return count;
+}
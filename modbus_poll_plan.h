@@ -0,0 +1,86 @@
+#ifndef __MODBUS_POLL_PLAN_H__
+#define __MODBUS_POLL_PLAN_H__
+
+/*
+ * Poll plan: turns a list of scattered points into a minimal set of block reads.
+ *
+ * The points of a slave and table (coils, discrete inputs, holding or input
+ * registers) are sorted by refresh interval and address. Neighbouring points are
+ * merged into one block as long as the block stays within MODBUS_MAX_READ_BITS or
+ * MODBUS_MAX_READ_REGISTERS, and as long as one transaction for the merged range is
+ * cheaper on the wire than two: the request and response lengths come from
+ * compute_response_length_from_request(), every transaction costs an additional
+ * overhead (frame gaps and slave turnaround) in characters. Reading a few unused
+ * registers is usually far cheaper than another transaction.
+ *
+ * A point that lies within a block of a shorter interval rides along with that block
+ * instead of getting its own. Each block is read at the shortest interval of its
+ * points.
+ *
+ * The points are owned by the caller and have to stay valid while the plan exists.
+ * A successful read updates dest, status and timestamp, a failed one only status.
+ * A plan can be recompiled after points were added, except while blocks are still
+ * queued on an RTU master (EBUSY): let modbus_rtu_master_process() complete them, or
+ * free the master, which cancels them, first.
+ *
+ *   modbus_poll_plan_add(plan, &point) for every point
+ *   modbus_poll_plan_compile(plan, ctx)
+ *   loop:
+ *       modbus_poll_plan_poll(plan, ctx)          blocking client
+ *       or modbus_poll_plan_submit(plan, master)  event driven RTU master
+ *       sleep at most modbus_poll_plan_next_due(plan) ms
+ */
+
+/* Characters per transaction besides the request and response: two frame gaps of
+   3.5 characters and about 5 characters of slave turnaround */
+#define MODBUS_POLL_PLAN_OVERHEAD 12
+
+typedef struct _modbus_poll_point {
+    int slave;
+    /* MODBUS_FC_READ_COILS, _DISCRETE_INPUTS, _HOLDING_REGISTERS or _INPUT_REGISTERS */
+    int function;
+    int addr;
+    int nb;
+    /* Refresh interval in ms */
+    uint32_t interval;
+    /* nb uint8_t for bits, nb uint16_t for registers */
+    void *dest;
+    /* 0 or the errno of the last read */
+    int status;
+    /* Monotonic time of the last successful read in ms */
+    uint64_t timestamp;
+} modbus_poll_point_t;
+
+typedef struct _modbus_poll_block {
+    int slave;
+    int function;
+    int addr;
+    int nb;
+    uint32_t interval;
+    uint64_t due;
+    int pending;
+    modbus_poll_point_t **points;
+    int nb_points;
+} modbus_poll_block_t;
+
+typedef struct _modbus_poll_plan modbus_poll_plan_t;
+
+modbus_poll_plan_t *modbus_poll_plan_new(void);
+void modbus_poll_plan_free(modbus_poll_plan_t *plan);
+
+int modbus_poll_plan_add(modbus_poll_plan_t *plan, modbus_poll_point_t *point);
+/* Transaction overhead in characters, MODBUS_POLL_PLAN_OVERHEAD by default */
+int modbus_poll_plan_set_overhead(modbus_poll_plan_t *plan, int overhead);
+/* Largest number of unused addresses read between two points, for slaves that
+   reject reads of unmapped addresses. -1 (default) leaves it to the cost model. */
+int modbus_poll_plan_set_max_gap(modbus_poll_plan_t *plan, int max_gap);
+int modbus_poll_plan_compile(modbus_poll_plan_t *plan, modbus_t *ctx);
+
+int modbus_poll_plan_block_count(modbus_poll_plan_t *plan);
+const modbus_poll_block_t *modbus_poll_plan_block(modbus_poll_plan_t *plan, int index);
+
+int modbus_poll_plan_next_due(modbus_poll_plan_t *plan);
+int modbus_poll_plan_poll(modbus_poll_plan_t *plan, modbus_t *ctx);
+int modbus_poll_plan_submit(modbus_poll_plan_t *plan, modbus_rtu_master_t *master);
+
+#endif
@@ -0,0 +1,592 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include <termios.h>
+#include <sys/time.h>
+#include <sys/select.h>
+
+#include "modbus_tiny.h"
+
+#include "modbus_rtu.h"
+#include "modbus.h"
+#include "modbus_rtu_master.h"
+
+
+typedef enum {
+    /* No request on the wire, the next one is sent at bus_free */
+    _MASTER_IDLE,
+    /* A request was sent, waiting for the response */
+    _MASTER_WAIT_RESPONSE,
+    /* A broadcast was sent, waiting for the turnaround delay */
+    _MASTER_WAIT_TURNAROUND
+} _master_state_t;
+
+
+typedef struct _modbus_rtu_master_req {
+    /* Slave address, PDU and CRC */
+    uint8_t adu[MODBUS_RTU_MAX_ADU_LENGTH];
+    int adu_length;
+    /* Length of the response computed from the request, MSG_LENGTH_UNDEFINED if
+       it is given by the response */
+    int rsp_length;
+    modbus_rtu_master_cb cb;
+    void *user_data;
+} _modbus_rtu_master_req_t;
+
+
+struct _modbus_rtu_master {
+    modbus_t *ctx;
+    _master_state_t state;
+
+    /* Ring of queued requests */
+    _modbus_rtu_master_req_t *queue;
+    int queue_size;
+    int queue_head;
+    int queue_count;
+
+    /* The request on the wire */
+    _modbus_rtu_master_req_t active;
+    uint8_t rsp[MODBUS_RTU_MAX_ADU_LENGTH];
+    int rsp_length;
+
+    /* Timing in microseconds */
+    uint32_t char_time;
+    uint32_t frame_gap;
+    uint32_t char_timeout;
+    uint32_t turnaround_delay;
+
+    /* Monotonic time stamps in microseconds */
+    uint64_t bus_free;
+    uint64_t deadline;
+    uint64_t last_rx;
+};
+
+
+static uint64_t _master_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+
+static uint64_t _master_timeval_us(const struct timeval *tv)
+{
+    return (uint64_t)tv->tv_sec * 1000000 + (uint64_t)tv->tv_usec;
+}
+
+
+/* Modbus over serial line V1.02, 2.5.1.1: a frame ends after 3.5 character times of
+   silence. Above 19200 bauds fixed values are used, 1750 us for the frame gap. */
+static void _master_compute_timing(modbus_rtu_master_t *master)
+{
+    modbus_rtu_t *ctx_rtu = master->ctx->backend_data;
+    const uint32_t baud = ctx_rtu->baud;
+    /* Start bit, data bits, parity and stop bits */
+    const uint32_t bits = 1 + ctx_rtu->data_bit + (ctx_rtu->parity == 'N' ? 0 : 1) + ctx_rtu->stop_bit;
+
+    master->char_time = (bits * 1000000 + baud - 1) / baud;
+    if (baud > 19200) {
+        master->frame_gap = 1750;
+    } else {
+        master->frame_gap = (7 * bits * 1000000 + 2 * baud - 1) / (2 * baud);
+    }
+
+    /* A silence longer than the byte timeout of the context (or at least the frame
+       gap) in the middle of a response is a broken frame */
+    master->char_timeout = master->frame_gap;
+    if (_master_timeval_us(&master->ctx->byte_timeout) > master->char_timeout) {
+        master->char_timeout = (uint32_t)_master_timeval_us(&master->ctx->byte_timeout);
+    }
+}
+
+
+modbus_rtu_master_t *modbus_rtu_master_new(modbus_t *ctx, int queue_size)
+{
+    modbus_rtu_master_t *master;
+
+    if (ctx == NULL || ctx->backend->backend_type != _MODBUS_BACKEND_TYPE_RTU) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (queue_size <= 0) {
+        queue_size = MODBUS_RTU_MASTER_QUEUE_SIZE;
+    }
+
+    master = (modbus_rtu_master_t *)calloc(1, sizeof(modbus_rtu_master_t));
+    if (master == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    master->queue = (_modbus_rtu_master_req_t *)malloc(queue_size * sizeof(_modbus_rtu_master_req_t));
+    if (master->queue == NULL) {
+        free(master);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    master->ctx = ctx;
+    master->state = _MASTER_IDLE;
+    master->queue_size = queue_size;
+    master->turnaround_delay = MODBUS_RTU_MASTER_TURNAROUND_DELAY;
+    _master_compute_timing(master);
+
+    /* The line may have been in use, wait one frame gap before the first request */
+    master->bus_free = _master_now() + master->frame_gap;
+
+    return master;
+}
+
+
+static void _master_complete(modbus_rtu_master_t *master, int rc, int error,
+                             const uint8_t *rsp, int rsp_length)
+{
+    _modbus_rtu_master_req_t *req = &master->active;
+
+    master->state = _MASTER_IDLE;
+    if (req->cb != NULL) {
+        errno = error;
+        /* The request is passed without its CRC */
+        req->cb(master, req->adu, req->adu_length - _MODBUS_RTU_CHECKSUM_LENGTH,
+                rsp, rsp_length, rc, req->user_data);
+    }
+}
+
+
+void modbus_rtu_master_free(modbus_rtu_master_t *master)
+{
+    if (master == NULL)
+        return;
+
+    /* Give the owners of the pending requests the chance to release their data */
+    while (modbus_rtu_master_pending(master) > 0) {
+        modbus_rtu_master_cancel(master, ECANCELED);
+    }
+
+    free(master->queue);
+    free(master);
+}
+
+
+/* Completes the request in progress and the queued ones with rc -1 and errno error.
+   Requests queued by their callbacks are kept. Returns the number of requests. */
+int modbus_rtu_master_cancel(modbus_rtu_master_t *master, int error)
+{
+    int queued;
+    int count = 0;
+
+    if (master == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    queued = master->queue_count;
+    if (master->state != _MASTER_IDLE) {
+        /* A late response is drained as noise */
+        master->bus_free = _master_now() + master->frame_gap;
+        _master_complete(master, -1, error, NULL, 0);
+        count++;
+    }
+    while (queued-- > 0) {
+        master->active = master->queue[master->queue_head];
+        master->queue_head = (master->queue_head + 1) % master->queue_size;
+        master->queue_count--;
+        _master_complete(master, -1, error, NULL, 0);
+        count++;
+    }
+
+    return count;
+}
+
+
+int modbus_rtu_master_set_turnaround_delay(modbus_rtu_master_t *master, uint32_t to_usec)
+{
+    if (master == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    master->turnaround_delay = to_usec;
+    return 0;
+}
+
+
+uint32_t modbus_rtu_master_get_frame_gap(modbus_rtu_master_t *master)
+{
+    return master->frame_gap;
+}
+
+
+int modbus_rtu_master_send_raw_request(modbus_rtu_master_t *master, const uint8_t *raw_req,
+                                       int raw_req_length, modbus_rtu_master_cb cb, void *user_data)
+{
+    _modbus_rtu_master_req_t *req;
+    int rsp_length;
+
+    if (master == NULL || raw_req == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* Slave address and function code at least, room for the CRC */
+    if (raw_req_length < 2 || raw_req_length > MODBUS_RTU_MAX_ADU_LENGTH - _MODBUS_RTU_CHECKSUM_LENGTH) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (raw_req[0] > 247) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (master->queue_count == master->queue_size) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    req = &master->queue[(master->queue_head + master->queue_count) % master->queue_size];
+    memcpy(req->adu, raw_req, raw_req_length);
+    req->adu_length = master->ctx->backend->send_msg_pre(req->adu, raw_req_length);
+
+    rsp_length = (int)compute_response_length_from_request(master->ctx, req->adu);
+    if (rsp_length > MODBUS_RTU_MAX_ADU_LENGTH) {
+        errno = EMBMDATA;
+        return -1;
+    }
+    req->rsp_length = rsp_length;
+    req->cb = cb;
+    req->user_data = user_data;
+    master->queue_count++;
+
+    return 0;
+}
+
+
+int modbus_rtu_master_request(modbus_rtu_master_t *master, int slave, int function,
+                              int addr, int nb, modbus_rtu_master_cb cb, void *user_data)
+{
+    uint8_t req[_MODBUS_RTU_PRESET_REQ_LENGTH];
+
+    /* Same layout as _modbus_rtu_build_request_basis, for an explicit slave */
+    req[0] = slave;
+    req[1] = function;
+    req[2] = addr >> 8;
+    req[3] = addr & 0x00ff;
+    req[4] = nb >> 8;
+    req[5] = nb & 0x00ff;
+
+    if (slave < 0 || slave > 247) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return modbus_rtu_master_send_raw_request(master, req, sizeof(req), cb, user_data);
+}
+
+
+int modbus_rtu_master_pending(modbus_rtu_master_t *master)
+{
+    return master->queue_count + (master->state != _MASTER_IDLE ? 1 : 0);
+}
+
+
+int modbus_rtu_master_get_fd(modbus_rtu_master_t *master)
+{
+    return master->ctx->s;
+}
+
+
+static uint64_t _master_next_deadline(modbus_rtu_master_t *master)
+{
+    switch (master->state) {
+    case _MASTER_WAIT_RESPONSE:
+        if (master->rsp_length > 0)
+            return master->last_rx + master->char_timeout;
+        return master->deadline;
+    case _MASTER_WAIT_TURNAROUND:
+        return master->deadline;
+    default:
+        return master->queue_count > 0 ? master->bus_free : 0;
+    }
+}
+
+
+/* Time until modbus_rtu_master_process() has to be called again if the fd stays
+   quiet. Returns -1 if there is nothing to wait for. */
+int modbus_rtu_master_get_timeout(modbus_rtu_master_t *master, struct timeval *tv)
+{
+    uint64_t deadline = _master_next_deadline(master);
+    uint64_t now;
+
+    if (deadline == 0)
+        return -1;
+
+    now = _master_now();
+    deadline = deadline > now ? deadline - now : 0;
+    tv->tv_sec = deadline / 1000000;
+    tv->tv_usec = deadline % 1000000;
+
+    return 0;
+}
+
+
+/* Monotonic time (CLOCK_MONOTONIC) in microseconds by when modbus_rtu_master_process()
+   has to be called again if the fd stays quiet. Returns -1 if there is nothing to wait for. */
+int modbus_rtu_master_get_deadline(modbus_rtu_master_t *master, uint64_t *deadline)
+{
+    *deadline = _master_next_deadline(master);
+
+    return *deadline != 0 ? 0 : -1;
+}
+
+
+/* Length of the response given what has been received so far, 0 if it's not known yet */
+static int _master_expected_length(modbus_rtu_master_t *master)
+{
+    const int offset = _MODBUS_RTU_HEADER_LENGTH;
+
+    if (master->rsp_length < offset + 1)
+        return 0;
+
+    /* Exception: slave, function | 0x80, code and CRC */
+    if (master->rsp[offset] & 0x80)
+        return offset + 2 + _MODBUS_RTU_CHECKSUM_LENGTH;
+
+    if (master->active.rsp_length != MSG_LENGTH_UNDEFINED)
+        return master->active.rsp_length;
+
+    /* Report slave ID, the byte count follows the function code */
+    if (master->rsp_length < offset + 2)
+        return 0;
+    return offset + 2 + master->rsp[offset + 1] + _MODBUS_RTU_CHECKSUM_LENGTH;
+}
+
+
+static void _master_finish_response(modbus_rtu_master_t *master, int length)
+{
+    modbus_t *ctx = master->ctx;
+    uint16_t crc_calculated;
+    uint16_t crc_received;
+    int recovery;
+    int rc;
+
+    if (ctx->debug) {
+        int i;
+        for (i = 0; i < length; i++)
+            printf("<%.2X>", master->rsp[i]);
+        printf("\n");
+    }
+
+    crc_calculated = crc16(master->rsp, length - 2);
+    crc_received = (master->rsp[length - 2] << 8) | master->rsp[length - 1];
+    if (crc_calculated != crc_received) {
+        if (ctx->debug) {
+            fprintf(stderr, "ERROR CRC received 0x%0X != CRC calculated 0x%0X\n",
+                    crc_received, crc_calculated);
+        }
+        _master_complete(master, -1, EMBBADCRC, master->rsp, length);
+        return;
+    }
+
+    /* The protocol recovery of check_confirmation sleeps and flushes, the master
+       resynchronizes on the frame gap instead */
+    recovery = ctx->error_recovery;
+    ctx->error_recovery &= ~MODBUS_ERROR_RECOVERY_PROTOCOL;
+    rc = check_confirmation(ctx, master->active.adu, master->rsp, length);
+    ctx->error_recovery = recovery;
+
+    _master_complete(master, rc, rc == -1 ? errno : 0, master->rsp, length);
+}
+
+
+static int _master_send_next(modbus_rtu_master_t *master, uint64_t now)
+{
+    modbus_t *ctx = master->ctx;
+    _modbus_rtu_master_req_t *req;
+    ssize_t rc;
+    uint64_t tx_end;
+
+    master->active = master->queue[master->queue_head];
+    master->queue_head = (master->queue_head + 1) % master->queue_size;
+    master->queue_count--;
+    req = &master->active;
+
+    if (ctx->debug) {
+        int i;
+        for (i = 0; i < req->adu_length; i++)
+            printf("[%.2X]", req->adu[i]);
+        printf("\n");
+    }
+
+    rc = ctx->backend->send(ctx, req->adu, req->adu_length);
+    if (rc != req->adu_length) {
+        int error = rc == -1 ? errno : EMBBADDATA;
+
+        _error_print(ctx, "send");
+        master->bus_free = now + master->frame_gap;
+        _master_complete(master, -1, error, NULL, 0);
+        return -1;
+    }
+
+    /* write() returns when the frame is in the driver, the timeouts start when it has
+       left the UART */
+    tx_end = now + (uint64_t)req->adu_length * master->char_time;
+    master->rsp_length = 0;
+    if (req->adu[0] == MODBUS_BROADCAST_ADDRESS) {
+        master->state = _MASTER_WAIT_TURNAROUND;
+        master->deadline = tx_end + master->turnaround_delay;
+    } else {
+        master->state = _MASTER_WAIT_RESPONSE;
+        master->deadline = tx_end + _master_timeval_us(&ctx->response_timeout);
+    }
+
+    return 0;
+}
+
+
+/* Reads what the driver has, handles the timeouts and sends the next request.
+   Returns the number of completed requests or -1 if the line failed. */
+int modbus_rtu_master_process(modbus_rtu_master_t *master)
+{
+    modbus_t *ctx;
+    uint64_t now;
+    int completed = 0;
+
+    if (master == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    ctx = master->ctx;
+
+    for (;;) {
+        uint8_t noise[64];
+        uint8_t *dest;
+        int room;
+        ssize_t rc;
+
+        now = _master_now();
+
+        /* Drain the receiver, without a response expected the bytes are noise or a
+           late response and only delay the next request */
+        if (master->state == _MASTER_WAIT_RESPONSE &&
+            master->rsp_length < MODBUS_RTU_MAX_ADU_LENGTH) {
+            dest = master->rsp + master->rsp_length;
+            room = MODBUS_RTU_MAX_ADU_LENGTH - master->rsp_length;
+        } else {
+            dest = noise;
+            room = sizeof(noise);
+        }
+
+        rc = ctx->backend->recv(ctx, dest, room);
+        if (rc == -1 && errno != EAGAIN && errno != EINTR) {
+            int error = errno;
+
+            _error_print(ctx, "read");
+            if (master->state != _MASTER_IDLE) {
+                _master_complete(master, -1, error, NULL, 0);
+                completed++;
+            }
+            master->bus_free = now + master->frame_gap;
+            errno = error;
+            return -1;
+        }
+
+        if (rc > 0) {
+            master->last_rx = now;
+            if (dest == noise) {
+                master->bus_free = now + master->frame_gap;
+                if (ctx->debug) {
+                    printf("%d bytes ignored\n", (int)rc);
+                }
+            } else {
+                master->rsp_length += rc;
+            }
+        }
+
+        if (master->state == _MASTER_WAIT_RESPONSE) {
+            int expected = _master_expected_length(master);
+
+            if (expected > MODBUS_RTU_MAX_ADU_LENGTH) {
+                errno = EMBBADDATA;
+                _error_print(ctx, "too many data");
+                master->bus_free = now + master->frame_gap;
+                _master_complete(master, -1, EMBBADDATA, master->rsp, master->rsp_length);
+                completed++;
+            } else if (expected > 0 && master->rsp_length >= expected) {
+                /* Anything after the frame is dropped with the next read */
+                master->bus_free = now + master->frame_gap;
+                _master_finish_response(master, expected);
+                completed++;
+            } else if (master->rsp_length > 0 && now >= master->last_rx + master->char_timeout) {
+                if (ctx->debug) {
+                    fprintf(stderr, "ERROR incomplete frame (%d bytes)\n", master->rsp_length);
+                }
+                master->bus_free = now + master->frame_gap;
+                _master_complete(master, -1, EMBBADDATA, master->rsp, master->rsp_length);
+                completed++;
+            } else if (master->rsp_length == 0 && now >= master->deadline) {
+                master->bus_free = now + master->frame_gap;
+                _master_complete(master, -1, ETIMEDOUT, NULL, 0);
+                completed++;
+            }
+        } else if (master->state == _MASTER_WAIT_TURNAROUND && now >= master->deadline) {
+            master->bus_free = now;
+            _master_complete(master, 0, 0, NULL, 0);
+            completed++;
+        }
+
+        if (master->state == _MASTER_IDLE && master->queue_count > 0 && now >= master->bus_free) {
+            if (_master_send_next(master, now) == -1) {
+                completed++;
+            }
+            /* Nothing can have arrived yet */
+            break;
+        }
+
+        /* The driver had less than asked for, nothing more to read */
+        if (rc < room)
+            break;
+    }
+
+    return completed;
+}
+
+
+/* Processes the queue until it's empty */
+int modbus_rtu_master_run(modbus_rtu_master_t *master)
+{
+    int completed = 0;
+
+    if (master == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    while (modbus_rtu_master_pending(master) > 0) {
+        fd_set rset;
+        struct timeval tv;
+        struct timeval *p_tv;
+        int rc;
+
+        FD_ZERO(&rset);
+        FD_SET(master->ctx->s, &rset);
+        p_tv = modbus_rtu_master_get_timeout(master, &tv) == 0 ? &tv : NULL;
+        rc = select(master->ctx->s + 1, &rset, NULL, NULL, p_tv);
+        if (rc == -1 && errno != EINTR)
+            return -1;
+
+        rc = modbus_rtu_master_process(master);
+        if (rc == -1)
+            return -1;
+        completed += rc;
+    }
+
+    return completed;
+}
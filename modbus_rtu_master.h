@@ -0,0 +1,68 @@
+#ifndef __MODBUS_RTU_MASTER_H__
+#define __MODBUS_RTU_MASTER_H__
+
+/*
+ * Event driven Modbus RTU master.
+ *
+ * The master owns a connected RTU context (modbus_new_rtu + modbus_connect) and
+ * keeps a queue of requests for any number of slaves on that line. A request is
+ * put on the wire as soon as the previous one is resolved (response, exception,
+ * timeout or broadcast turnaround) and the line has been silent for 3.5 character
+ * times, the timing is derived from the baud rate of the context. Received bytes are
+ * read in as large chunks as the driver has available, and a response is complete
+ * when the length expected from its request has arrived.
+ *
+ * The master never blocks (except for the RTS toggling of the RTU backend). It is
+ * driven either by modbus_rtu_master_run(), or by an external event loop:
+ *
+ *   fd = modbus_rtu_master_get_fd(master);
+ *   for (;;) {
+ *       struct timeval tv;
+ *       wait for fd readable, at most tv if modbus_rtu_master_get_timeout(master, &tv) == 0
+ *       modbus_rtu_master_process(master);
+ *   }
+ *
+ * The completion callback gets the request (slave address and PDU, no CRC) and the
+ * response ADU. rc is the result of check_confirmation() (the number of values) or -1,
+ * errno holds the reason then (ETIMEDOUT, EMBBADCRC, EMBBADDATA, the exception codes
+ * EMBX*, ECANCELED when the master is freed, the error given to
+ * modbus_rtu_master_cancel()). Broadcast requests complete with rc 0 after the
+ * turnaround delay. The callback may submit new requests.
+ */
+
+#define MODBUS_RTU_MASTER_QUEUE_SIZE        32
+/* Modbus over serial line V1.02, 2.4.1: the turnaround delay after a broadcast is 100 to 200 ms */
+#define MODBUS_RTU_MASTER_TURNAROUND_DELAY  100000
+
+typedef struct _modbus_rtu_master modbus_rtu_master_t;
+
+typedef void (*modbus_rtu_master_cb)(modbus_rtu_master_t *master,
+                                     const uint8_t *req, int req_length,
+                                     const uint8_t *rsp, int rsp_length,
+                                     int rc, void *user_data);
+
+modbus_rtu_master_t *modbus_rtu_master_new(modbus_t *ctx, int queue_size);
+void modbus_rtu_master_free(modbus_rtu_master_t *master);
+
+int modbus_rtu_master_set_turnaround_delay(modbus_rtu_master_t *master, uint32_t to_usec);
+uint32_t modbus_rtu_master_get_frame_gap(modbus_rtu_master_t *master);
+
+/* Queues a request with the 6 byte basis (reads, single writes) */
+int modbus_rtu_master_request(modbus_rtu_master_t *master, int slave, int function,
+                              int addr, int nb, modbus_rtu_master_cb cb, void *user_data);
+/* Queues a request given as slave address and PDU, the CRC is appended */
+int modbus_rtu_master_send_raw_request(modbus_rtu_master_t *master, const uint8_t *raw_req,
+                                       int raw_req_length, modbus_rtu_master_cb cb, void *user_data);
+
+/* Number of requests queued or in progress */
+int modbus_rtu_master_pending(modbus_rtu_master_t *master);
+/* Completes the request in progress and the queued ones with rc -1 and errno error */
+int modbus_rtu_master_cancel(modbus_rtu_master_t *master, int error);
+
+int modbus_rtu_master_get_fd(modbus_rtu_master_t *master);
+int modbus_rtu_master_get_timeout(modbus_rtu_master_t *master, struct timeval *tv);
+int modbus_rtu_master_get_deadline(modbus_rtu_master_t *master, uint64_t *deadline);
+int modbus_rtu_master_process(modbus_rtu_master_t *master);
+int modbus_rtu_master_run(modbus_rtu_master_t *master);
+
+#endif
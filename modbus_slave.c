@@ -0,0 +1,532 @@
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+/* Only the protocol definitions are used, no POSIX serial headers needed */
+#define MODBUS_TINY_NO_BACKEND
+#include "modbus_tiny.h"
+
+#include "crc.h"
+#include "modbus_slave.h"
+
+#if MODBUS_SLAVE_PORT_OSCOM
+#include "rtos/cmsis-rtos-ext/osCom.h"
+#else
+#include "com_uart_port.h"
+#endif
+
+
+int modbus_slave_init(modbus_slave_t *slave, int address,
+                      const modbus_slave_range_t *ranges, int nb_ranges, uint32_t baud)
+{
+    uint32_t frame_gap;
+    int i;
+
+    if (slave == NULL || address < 1 || address > 247 || baud == 0 ||
+        (ranges == NULL && nb_ranges > 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < nb_ranges; i++) {
+        const modbus_slave_range_t *range = &ranges[i];
+
+        if (range->table < MODBUS_SLAVE_COILS || range->table > MODBUS_SLAVE_INPUT_REGISTERS ||
+            range->nb == 0 || range->data == NULL ||
+            (int)range->start + range->nb > 0x10000) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        /* The lookup is a binary search */
+        if (i > 0 && (ranges[i - 1].table > range->table ||
+                      (ranges[i - 1].table == range->table &&
+                       (int)ranges[i - 1].start + ranges[i - 1].nb > range->start))) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    memset(slave, 0, sizeof(*slave));
+    slave->address = address;
+    slave->ranges = ranges;
+    slave->nb_ranges = nb_ranges;
+
+    /* 3.5 characters of 11 bits, fixed 1750 us above 19200 bauds */
+    frame_gap = baud > 19200 ? 1750 : (38500000 + baud - 1) / baud;
+    slave->frame_gap_ms = (frame_gap + 999) / 1000;
+
+    return 0;
+}
+
+
+/* The range that holds addr .. addr + nb - 1 of the table, NULL if there is none */
+static const modbus_slave_range_t *_slave_find(const modbus_slave_t *slave, int table, int addr, int nb)
+{
+    int lo = 0;
+    int hi = slave->nb_ranges - 1;
+
+    while (lo <= hi) {
+        const int mid = (lo + hi) / 2;
+        const modbus_slave_range_t *range = &slave->ranges[mid];
+
+        if (range->table < table ||
+            (range->table == table && range->start + range->nb <= addr)) {
+            lo = mid + 1;
+        } else if (range->table > table || range->start > addr) {
+            hi = mid - 1;
+        } else {
+            return addr + nb <= range->start + range->nb ? range : NULL;
+        }
+    }
+
+    return NULL;
+}
+
+
+static int _slave_call(modbus_slave_cb cb, const modbus_slave_range_t *range, int addr, int nb)
+{
+    return cb != NULL ? cb(range, addr, nb, range->user_data) : 0;
+}
+
+
+static int _slave_read_bits(const modbus_slave_t *slave, int table, int addr, int nb, uint8_t *rsp)
+{
+    const modbus_slave_range_t *range;
+    const uint8_t *bits;
+    int byte_count;
+    int exception;
+    int pos = 0;
+    int i;
+
+    if (nb < 1 || nb > MODBUS_MAX_READ_BITS)
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+
+    range = _slave_find(slave, table, addr, nb);
+    if (range == NULL)
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+
+    exception = _slave_call(range->read, range, addr, nb);
+    if (exception)
+        return exception;
+
+    bits = (const uint8_t *)range->data + (addr - range->start);
+    byte_count = (nb / 8) + ((nb % 8) ? 1 : 0);
+    rsp[0] = byte_count;
+    for (i = 1; i <= byte_count; i++) {
+        int bit;
+
+        rsp[i] = 0;
+        for (bit = 0x01; (bit & 0xff) && (pos < nb); bit <<= 1) {
+            if (bits[pos++])
+                rsp[i] |= bit;
+        }
+    }
+
+    return 0;
+}
+
+
+static int _slave_read_registers(const modbus_slave_t *slave, int table, int addr, int nb, uint8_t *rsp)
+{
+    const modbus_slave_range_t *range;
+    const uint16_t *registers;
+    int exception;
+    int i;
+
+    if (nb < 1 || nb > MODBUS_MAX_READ_REGISTERS)
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+
+    range = _slave_find(slave, table, addr, nb);
+    if (range == NULL)
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+
+    exception = _slave_call(range->read, range, addr, nb);
+    if (exception)
+        return exception;
+
+    registers = (const uint16_t *)range->data + (addr - range->start);
+    *rsp++ = nb * 2;
+    for (i = 0; i < nb; i++) {
+        *rsp++ = registers[i] >> 8;
+        *rsp++ = registers[i] & 0x00FF;
+    }
+
+    return 0;
+}
+
+
+static int _slave_write_registers(const modbus_slave_t *slave, int addr, int nb, const uint8_t *values)
+{
+    const modbus_slave_range_t *range;
+    uint16_t *registers;
+    int i;
+
+    range = _slave_find(slave, MODBUS_SLAVE_HOLDING_REGISTERS, addr, nb);
+    if (range == NULL)
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+
+    registers = (uint16_t *)range->data + (addr - range->start);
+    for (i = 0; i < nb; i++) {
+        registers[i] = (values[i << 1] << 8) | values[(i << 1) + 1];
+    }
+
+    return _slave_call(range->write, range, addr, nb);
+}
+
+
+/* Answers a request ADU without CRC */
+int modbus_slave_reply(modbus_slave_t *slave, const uint8_t *req, int req_length, uint8_t *rsp)
+{
+    const modbus_slave_range_t *range;
+    int function;
+    int addr;
+    int nb;
+    int exception = 0;
+    int rsp_length = 2;
+    uint16_t crc;
+
+    if (req_length < 2 || (req[0] != slave->address && req[0] != MODBUS_BROADCAST_ADDRESS))
+        return 0;
+
+    function = req[1];
+    addr = req_length >= 4 ? (req[2] << 8) | req[3] : 0;
+    nb = req_length >= 6 ? (req[4] << 8) | req[5] : 0;
+    rsp[0] = slave->address;
+    rsp[1] = function;
+
+    switch (function) {
+    case MODBUS_FC_READ_COILS:
+    case MODBUS_FC_READ_DISCRETE_INPUTS:
+        if (req_length != 6) {
+            exception = MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+            break;
+        }
+        exception = _slave_read_bits(slave, function == MODBUS_FC_READ_COILS ?
+                                     MODBUS_SLAVE_COILS : MODBUS_SLAVE_DISCRETE_INPUTS,
+                                     addr, nb, rsp + 2);
+        rsp_length = 3 + rsp[2];
+        break;
+    case MODBUS_FC_READ_HOLDING_REGISTERS:
+    case MODBUS_FC_READ_INPUT_REGISTERS:
+        if (req_length != 6) {
+            exception = MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+            break;
+        }
+        exception = _slave_read_registers(slave, function == MODBUS_FC_READ_HOLDING_REGISTERS ?
+                                          MODBUS_SLAVE_HOLDING_REGISTERS : MODBUS_SLAVE_INPUT_REGISTERS,
+                                          addr, nb, rsp + 2);
+        rsp_length = 3 + rsp[2];
+        break;
+    case MODBUS_FC_WRITE_SINGLE_COIL:
+        if (req_length != 6 || (nb != 0xFF00 && nb != 0)) {
+            exception = MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+            break;
+        }
+        range = _slave_find(slave, MODBUS_SLAVE_COILS, addr, 1);
+        if (range == NULL) {
+            exception = MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+            break;
+        }
+        ((uint8_t *)range->data)[addr - range->start] = nb ? ON : OFF;
+        exception = _slave_call(range->write, range, addr, 1);
+        /* The response is an echo of the request */
+        memcpy(rsp + 2, req + 2, 4);
+        rsp_length = 6;
+        break;
+    case MODBUS_FC_WRITE_SINGLE_REGISTER:
+        if (req_length != 6) {
+            exception = MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+            break;
+        }
+        exception = _slave_write_registers(slave, addr, 1, req + 4);
+        memcpy(rsp + 2, req + 2, 4);
+        rsp_length = 6;
+        break;
+    case MODBUS_FC_WRITE_MULTIPLE_COILS: {
+        const int byte_count = req_length >= 7 ? req[6] : 0;
+        uint8_t *bits;
+        int i;
+
+        if (nb < 1 || nb > MODBUS_MAX_WRITE_BITS ||
+            byte_count != (nb / 8) + ((nb % 8) ? 1 : 0) || req_length != 7 + byte_count) {
+            exception = MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+            break;
+        }
+        range = _slave_find(slave, MODBUS_SLAVE_COILS, addr, nb);
+        if (range == NULL) {
+            exception = MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+            break;
+        }
+        bits = (uint8_t *)range->data + (addr - range->start);
+        for (i = 0; i < nb; i++) {
+            bits[i] = (req[7 + (i >> 3)] >> (i & 7)) & 1;
+        }
+        exception = _slave_call(range->write, range, addr, nb);
+        memcpy(rsp + 2, req + 2, 4);
+        rsp_length = 6;
+    }
+        break;
+    case MODBUS_FC_WRITE_MULTIPLE_REGISTERS: {
+        const int byte_count = req_length >= 7 ? req[6] : 0;
+
+        if (nb < 1 || nb > MODBUS_MAX_WRITE_REGISTERS ||
+            byte_count != nb * 2 || req_length != 7 + byte_count) {
+            exception = MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+            break;
+        }
+        exception = _slave_write_registers(slave, addr, nb, req + 7);
+        memcpy(rsp + 2, req + 2, 4);
+        rsp_length = 6;
+    }
+        break;
+    case MODBUS_FC_MASK_WRITE_REGISTER: {
+        uint16_t *value;
+        uint16_t and_mask;
+        uint16_t or_mask;
+
+        if (req_length != 8) {
+            exception = MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+            break;
+        }
+        range = _slave_find(slave, MODBUS_SLAVE_HOLDING_REGISTERS, addr, 1);
+        if (range == NULL) {
+            exception = MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+            break;
+        }
+        value = (uint16_t *)range->data + (addr - range->start);
+        and_mask = (req[4] << 8) | req[5];
+        or_mask = (req[6] << 8) | req[7];
+        *value = (*value & and_mask) | (or_mask & ~and_mask);
+        exception = _slave_call(range->write, range, addr, 1);
+        memcpy(rsp + 2, req + 2, 6);
+        rsp_length = 8;
+    }
+        break;
+    case MODBUS_FC_WRITE_AND_READ_REGISTERS: {
+        const int write_addr = req_length >= 11 ? (req[6] << 8) | req[7] : 0;
+        const int write_nb = req_length >= 11 ? (req[8] << 8) | req[9] : 0;
+        const int byte_count = req_length >= 11 ? req[10] : 0;
+
+        if (nb < 1 || nb > MODBUS_MAX_WR_READ_REGISTERS ||
+            write_nb < 1 || write_nb > MODBUS_MAX_WR_WRITE_REGISTERS ||
+            byte_count != write_nb * 2 || req_length != 11 + byte_count) {
+            exception = MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+            break;
+        }
+        /* Check both ranges before anything is written */
+        if (_slave_find(slave, MODBUS_SLAVE_HOLDING_REGISTERS, addr, nb) == NULL) {
+            exception = MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+            break;
+        }
+        exception = _slave_write_registers(slave, write_addr, write_nb, req + 11);
+        if (exception)
+            break;
+        exception = _slave_read_registers(slave, MODBUS_SLAVE_HOLDING_REGISTERS, addr, nb, rsp + 2);
+        rsp_length = 3 + rsp[2];
+    }
+        break;
+    default:
+        exception = MODBUS_EXCEPTION_ILLEGAL_FUNCTION;
+        break;
+    }
+
+    /* No response to broadcasts */
+    if (req[0] == MODBUS_BROADCAST_ADDRESS)
+        return 0;
+
+    if (exception) {
+        rsp[1] = function | 0x80;
+        rsp[2] = exception;
+        rsp_length = 3;
+    }
+
+    /* CRC low byte first */
+    crc = crc16_modbus(rsp, rsp_length);
+    rsp[rsp_length++] = crc & 0x00FF;
+    rsp[rsp_length++] = crc >> 8;
+
+    return rsp_length;
+}
+
+
+/* Number of bytes still missing from the request in rx, 0 if it's complete, -1 if
+   the length can't be told from the header (the frame ends with the frame gap) */
+static int _slave_need(const uint8_t *rx, int length)
+{
+    int total;
+
+    if (length < 2)
+        return 2 - length;
+
+    switch (rx[1]) {
+    case MODBUS_FC_READ_COILS:
+    case MODBUS_FC_READ_DISCRETE_INPUTS:
+    case MODBUS_FC_READ_HOLDING_REGISTERS:
+    case MODBUS_FC_READ_INPUT_REGISTERS:
+    case MODBUS_FC_WRITE_SINGLE_COIL:
+    case MODBUS_FC_WRITE_SINGLE_REGISTER:
+        total = 8;
+        break;
+    case MODBUS_FC_WRITE_MULTIPLE_COILS:
+    case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+        if (length < 7)
+            return 7 - length;
+        total = 9 + rx[6];
+        break;
+    case MODBUS_FC_MASK_WRITE_REGISTER:
+        total = 10;
+        break;
+    case MODBUS_FC_WRITE_AND_READ_REGISTERS:
+        if (length < 11)
+            return 11 - length;
+        total = 13 + rx[10];
+        break;
+    default:
+        return -1;
+    }
+
+    if (total > MODBUS_RTU_MAX_ADU_LENGTH)
+        return -1;
+
+    return total > length ? total - length : 0;
+}
+
+
+/* Checks the CRC of the request in rx and sends the response */
+static int _slave_answer(modbus_slave_t *slave, const modbus_slave_port_t *port)
+{
+    const int length = slave->rx_length;
+    int rsp_length;
+
+    slave->rx_length = 0;
+
+    /* The CRC over a frame including its CRC is 0 */
+    if (length < 4 || crc16_modbus(slave->rx, length) != 0)
+        return 0;
+
+    rsp_length = modbus_slave_reply(slave, slave->rx, length - _MODBUS_RTU_CHECKSUM_LENGTH, slave->tx);
+    if (rsp_length == 0)
+        return 0;
+
+    if (port->write(port->handle, slave->tx, rsp_length) != rsp_length)
+        return -1;
+
+    return 1;
+}
+
+
+int modbus_slave_poll(modbus_slave_t *slave, const modbus_slave_port_t *port, int timeout_ms)
+{
+    for (;;) {
+        uint8_t *dest;
+        int len;
+        int wait;
+        int rc;
+
+        if (slave->skip) {
+            /* The transmit buffer is free while receiving */
+            dest = slave->tx;
+            len = sizeof(slave->tx);
+        } else {
+            dest = slave->rx + slave->rx_length;
+            len = _slave_need(slave->rx, slave->rx_length);
+            if (len < 0) {
+                len = MODBUS_RTU_MAX_ADU_LENGTH - slave->rx_length;
+                if (len == 0) {
+                    slave->skip = TRUE;
+                    slave->rx_length = 0;
+                    continue;
+                }
+            }
+        }
+
+        wait = (slave->rx_length == 0 && !slave->skip) ? timeout_ms : slave->frame_gap_ms;
+        rc = port->read(port->handle, dest, len, wait);
+        if (rc == -1)
+            return -1;
+
+        if (rc == 0) {
+            /* Silence: nothing arrived, or the end of a frame */
+            if (slave->skip) {
+                slave->skip = FALSE;
+                return 0;
+            }
+            if (slave->rx_length == 0)
+                return 0;
+            if (_slave_need(slave->rx, slave->rx_length) < 0)
+                return _slave_answer(slave, port);
+            /* Incomplete frame */
+            slave->rx_length = 0;
+            return 0;
+        }
+
+        if (slave->skip)
+            continue;
+
+        slave->rx_length += rc;
+        if (slave->rx[0] != slave->address && slave->rx[0] != MODBUS_BROADCAST_ADDRESS) {
+            /* Request or response of another slave */
+            slave->skip = TRUE;
+            slave->rx_length = 0;
+            continue;
+        }
+
+        if (_slave_need(slave->rx, slave->rx_length) == 0)
+            return _slave_answer(slave, port);
+    }
+}
+
+
+#if MODBUS_SLAVE_PORT_OSCOM
+
+static int _slave_oscom_read(void *handle, uint8_t *buf, int len, int timeout_ms)
+{
+    int rc = osComRead((int)(intptr_t)handle, (char *)buf, len, timeout_ms, false);
+
+    /* -1 means no character, the other ARM_DRIVER_ERROR_* codes are errors */
+    if (rc == -1)
+        return 0;
+    if (rc < 0) {
+        errno = EIO;
+        return -1;
+    }
+    return rc;
+}
+
+
+static int _slave_oscom_write(void *handle, const uint8_t *buf, int len)
+{
+    return osComWrite((int)(intptr_t)handle, (const char *)buf, len) == len ? len : -1;
+}
+
+
+void modbus_slave_port_oscom(modbus_slave_port_t *port, int fd)
+{
+    port->read = _slave_oscom_read;
+    port->write = _slave_oscom_write;
+    port->handle = (void *)(intptr_t)fd;
+}
+
+#else
+
+static int _slave_tty_read(void *handle, uint8_t *buf, int len, int timeout_ms)
+{
+    return com_recv((int)(intptr_t)handle, (char *)buf, len, timeout_ms);
+}
+
+
+static int _slave_tty_write(void *handle, const uint8_t *buf, int len)
+{
+    return com_send((int)(intptr_t)handle, (char *)buf, len);
+}
+
+
+void modbus_slave_port_tty(modbus_slave_port_t *port, int fd)
+{
+    port->read = _slave_tty_read;
+    port->write = _slave_tty_write;
+    port->handle = (void *)(intptr_t)fd;
+}
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef __MODBUS_SLAVE_H__
+#define __MODBUS_SLAVE_H__
+
+/*
+ * Modbus RTU slave.
+ *
+ * The data model is a table of ranges, each one maps an address range of one of the
+ * four Modbus tables onto memory: one uint8_t per coil or discrete input, one
+ * uint16_t per register. A request is answered in one pass straight from that
+ * memory, without allocation, the slave context holds the receive and transmit
+ * buffers. A request has to lie within one range, otherwise it's answered with an
+ * illegal data address exception.
+ *
+ * The optional callbacks of a range are called before the values of a read are
+ * taken from memory (to refresh them) and after the values of a write have been
+ * stored (to act on them). They return 0 or a MODBUS_EXCEPTION_* code, which is
+ * sent instead of the response.
+ *
+ * The frame length is computed from the function code and the byte count as the
+ * bytes arrive, so the response goes out as soon as the last byte of the request is
+ * in, not after the 3.5 character silence. Frames for other slaves and broken frames
+ * are skipped up to the next silence.
+ *
+ * Supported functions: 01, 02, 03, 04, 05, 06, 15, 16, 22 and 23.
+ *
+ *   static uint16_t holding[100];
+ *   static const modbus_slave_range_t ranges[] = {
+ *       { MODBUS_SLAVE_HOLDING_REGISTERS, 0, 100, holding, NULL, NULL, NULL },
+ *   };
+ *   static modbus_slave_t slave;
+ *   modbus_slave_port_t port;
+ *
+ *   modbus_slave_init(&slave, 17, ranges, 1, 115200);
+ *   modbus_slave_port_tty(&port, init_com_port(USER_COM0, 115200));
+ *   for (;;)
+ *       modbus_slave_poll(&slave, &port, 1000);
+ *
+ * Requires modbus_tiny.h, the firmware builds define MODBUS_TINY_NO_BACKEND.
+ */
+
+/* Use osComRead()/osComWrite() for modbus_slave_port_oscom() instead of a tty */
+#ifndef MODBUS_SLAVE_PORT_OSCOM
+#define MODBUS_SLAVE_PORT_OSCOM 0
+#endif
+
+enum {
+    MODBUS_SLAVE_COILS,
+    MODBUS_SLAVE_DISCRETE_INPUTS,
+    MODBUS_SLAVE_HOLDING_REGISTERS,
+    MODBUS_SLAVE_INPUT_REGISTERS
+};
+
+typedef struct _modbus_slave_range modbus_slave_range_t;
+
+typedef int (*modbus_slave_cb)(const modbus_slave_range_t *range, int addr, int nb, void *user_data);
+
+struct _modbus_slave_range {
+    /* MODBUS_SLAVE_COILS .. MODBUS_SLAVE_INPUT_REGISTERS */
+    int table;
+    uint16_t start;
+    uint16_t nb;
+    /* nb uint8_t (bits) or nb uint16_t (registers) */
+    void *data;
+    modbus_slave_cb read;
+    modbus_slave_cb write;
+    void *user_data;
+};
+
+/* Byte transport of the slave */
+typedef struct _modbus_slave_port {
+    /* Reads up to len bytes, waits at most timeout_ms for the first one.
+       Returns the number of bytes, 0 on timeout or -1 on error. */
+    int (*read)(void *handle, uint8_t *buf, int len, int timeout_ms);
+    /* Returns len or -1 */
+    int (*write)(void *handle, const uint8_t *buf, int len);
+    void *handle;
+} modbus_slave_port_t;
+
+typedef struct _modbus_slave {
+    int address;
+    /* Sorted by table and start, not overlapping */
+    const modbus_slave_range_t *ranges;
+    int nb_ranges;
+    /* 3.5 characters, rounded up to ms */
+    int frame_gap_ms;
+    /* Drop everything up to the next frame gap */
+    int skip;
+    int rx_length;
+    uint8_t rx[MODBUS_RTU_MAX_ADU_LENGTH];
+    uint8_t tx[MODBUS_RTU_MAX_ADU_LENGTH];
+} modbus_slave_t;
+
+int modbus_slave_init(modbus_slave_t *slave, int address,
+                      const modbus_slave_range_t *ranges, int nb_ranges, uint32_t baud);
+
+/* Answers a request ADU without its CRC (checked by the caller), returns the length
+   of the response ADU in rsp including the CRC, 0 if there is no response. */
+int modbus_slave_reply(modbus_slave_t *slave, const uint8_t *req, int req_length, uint8_t *rsp);
+
+/* Receives and answers. Waits at most timeout_ms for a request to start.
+   Returns 1 if a response was sent, 0 if not, -1 on port errors. */
+int modbus_slave_poll(modbus_slave_t *slave, const modbus_slave_port_t *port, int timeout_ms);
+
+#if MODBUS_SLAVE_PORT_OSCOM
+void modbus_slave_port_oscom(modbus_slave_port_t *port, int fd);
+#else
+/* A tty opened by init_com_port() of com_uart_port.c */
+void modbus_slave_port_tty(modbus_slave_port_t *port, int fd);
+#endif
+
+#endif
@@ -0,0 +1,526 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <termios.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "modbus_tiny.h"
+#include "modbus_rtu.h"
+#include "modbus.h"
+#include "modbus_tcp.h"
+#include "modbus_slave.h"
+
+
+/* The unit identifier is used by gateways, 0 to 255 (MODBUS_TCP_SLAVE) */
+int _modbus_tcp_set_slave(modbus_t *ctx, int slave)
+{
+	if (slave >= 0 && slave <= 255) {
+		ctx->slave = slave;
+	} else {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/* Builds a TCP request header */
+int _modbus_tcp_build_request_basis(modbus_t *ctx, int function,
+		int addr, int nb,
+		uint8_t *req)
+{
+	modbus_tcp_t *ctx_tcp = ctx->backend_data;
+
+	/* Increase transaction ID */
+	ctx_tcp->t_id++;
+	req[0] = ctx_tcp->t_id >> 8;
+	req[1] = ctx_tcp->t_id & 0x00ff;
+
+	/* Protocol Modbus */
+	req[2] = 0;
+	req[3] = 0;
+
+	/* Length will be defined later by send_msg_pre (4 and 5) */
+
+	req[6] = ctx->slave;
+	req[7] = function;
+	req[8] = addr >> 8;
+	req[9] = addr & 0x00ff;
+	req[10] = nb >> 8;
+	req[11] = nb & 0x00ff;
+
+	return _MODBUS_TCP_PRESET_REQ_LENGTH;
+}
+
+
+/* Builds a TCP response header */
+int _modbus_tcp_build_response_basis(sft_t *sft, uint8_t *rsp)
+{
+	/* Extract from MODBUS Messaging on TCP/IP Implementation Guide V1.0b
+	   (page 23/46): the transaction identifier is copied by the server
+	   from the received request. */
+	rsp[0] = sft->t_id >> 8;
+	rsp[1] = sft->t_id & 0x00ff;
+
+	/* Protocol Modbus */
+	rsp[2] = 0;
+	rsp[3] = 0;
+
+	/* Length will be set later by send_msg_pre (4 and 5) */
+
+	/* The slave ID is copied from the indication */
+	rsp[6] = sft->slave;
+	rsp[7] = sft->function;
+
+	return _MODBUS_TCP_PRESET_RSP_LENGTH;
+}
+
+
+int _modbus_tcp_prepare_response_tid(const uint8_t *req, int *req_length)
+{
+	return (req[0] << 8) + req[1];
+}
+
+
+int _modbus_tcp_send_msg_pre(uint8_t *req, int req_length)
+{
+	/* Subtract the header length to the message length */
+	int mbap_length = req_length - 6;
+
+	req[4] = mbap_length >> 8;
+	req[5] = mbap_length & 0x00FF;
+
+	return req_length;
+}
+
+
+ssize_t _modbus_tcp_send(modbus_t *ctx, const uint8_t *req, int req_length)
+{
+	/* MSG_NOSIGNAL
+	   Requests not to send SIGPIPE on errors on stream oriented
+	   sockets when the other end breaks the connection. The EPIPE
+	   error is still returned. */
+	return send(ctx->s, (const char *)req, req_length, MSG_NOSIGNAL);
+}
+
+
+int _modbus_tcp_receive(modbus_t *ctx, uint8_t *req)
+{
+	return _modbus_receive_msg(ctx, req, MSG_INDICATION);
+}
+
+
+ssize_t _modbus_tcp_recv(modbus_t *ctx, uint8_t *rsp, int rsp_length)
+{
+	return recv(ctx->s, (char *)rsp, rsp_length, 0);
+}
+
+
+/* The length of the message is checked by the receive steps, TCP has no checksum */
+int _modbus_tcp_check_integrity(modbus_t *ctx, uint8_t *msg, const int msg_length)
+{
+	return msg_length;
+}
+
+
+int _modbus_tcp_pre_check_confirmation(modbus_t *ctx, const uint8_t *req,
+		const uint8_t *rsp, int rsp_length)
+{
+	/* Check transaction ID */
+	if (req[0] != rsp[0] || req[1] != rsp[1]) {
+		if (ctx->debug) {
+			fprintf(stderr, "Invalid transaction ID received 0x%X (not 0x%X)\n",
+					(rsp[0] << 8) + rsp[1], (req[0] << 8) + req[1]);
+		}
+		errno = EMBBADDATA;
+		return -1;
+	}
+
+	/* Check protocol ID */
+	if (rsp[2] != 0x0 || rsp[3] != 0x0) {
+		if (ctx->debug) {
+			fprintf(stderr, "Invalid protocol ID received 0x%X (not 0x0)\n",
+					(rsp[2] << 8) + rsp[3]);
+		}
+		errno = EMBBADDATA;
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static int _modbus_tcp_set_ipv4_options(int s)
+{
+	int rc;
+	int option;
+
+	/* Set the TCP no delay flag, requests and responses are small and
+	   shouldn't wait for the Nagle algorithm */
+	option = 1;
+	rc = setsockopt(s, IPPROTO_TCP, TCP_NODELAY,
+			(const void *)&option, sizeof(int));
+	if (rc == -1) {
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/* Waits at most the response timeout for a non blocking connect() */
+static int _connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen,
+		const struct timeval *ro_tv)
+{
+	int rc = connect(sockfd, addr, addrlen);
+
+	if (rc == -1 && errno == EINPROGRESS) {
+		fd_set wset;
+		int optval;
+		socklen_t optlen = sizeof(optval);
+		struct timeval tv = *ro_tv;
+
+		/* Wait to be available in writing */
+		FD_ZERO(&wset);
+		FD_SET(sockfd, &wset);
+		rc = select(sockfd + 1, NULL, &wset, NULL, &tv);
+		if (rc <= 0) {
+			/* Timeout or fail */
+			if (rc == 0)
+				errno = ETIMEDOUT;
+			return -1;
+		}
+
+		/* The connection is established if SO_ERROR and optval are set to 0 */
+		rc = getsockopt(sockfd, SOL_SOCKET, SO_ERROR, (void *)&optval, &optlen);
+		if (rc == 0 && optval == 0) {
+			return 0;
+		} else {
+			errno = ECONNREFUSED;
+			return -1;
+		}
+	}
+
+	return rc;
+}
+
+
+/* Establishes a modbus TCP connection with a Modbus server. */
+int _modbus_tcp_connect(modbus_t *ctx)
+{
+	int rc;
+	int flags;
+	struct sockaddr_in addr;
+	modbus_tcp_t *ctx_tcp = ctx->backend_data;
+
+	ctx->s = socket(PF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (ctx->s == -1) {
+		return -1;
+	}
+
+	rc = _modbus_tcp_set_ipv4_options(ctx->s);
+	if (rc == -1) {
+		close(ctx->s);
+		ctx->s = -1;
+		return -1;
+	}
+
+	if (ctx->debug) {
+		printf("Connecting to %s:%d\n", ctx_tcp->ip, ctx_tcp->port);
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(ctx_tcp->port);
+	if (inet_pton(AF_INET, ctx_tcp->ip, &addr.sin_addr) != 1) {
+		if (ctx->debug) {
+			fprintf(stderr, "Invalid IP address %s\n", ctx_tcp->ip);
+		}
+		close(ctx->s);
+		ctx->s = -1;
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* The connect is bounded by the response timeout, the socket is blocking
+	   afterwards as the receive steps select() before each recv() */
+	flags = fcntl(ctx->s, F_GETFL, 0);
+	fcntl(ctx->s, F_SETFL, flags | O_NONBLOCK);
+	rc = _connect(ctx->s, (struct sockaddr *)&addr, sizeof(addr), &ctx->response_timeout);
+	if (rc == -1) {
+		int saved_errno = errno;
+
+		close(ctx->s);
+		ctx->s = -1;
+		errno = saved_errno;
+		return -1;
+	}
+	fcntl(ctx->s, F_SETFL, flags);
+
+	return 0;
+}
+
+
+/* Closes the network connection and socket in TCP mode */
+void _modbus_tcp_close(modbus_t *ctx)
+{
+	if (ctx->s != -1) {
+		shutdown(ctx->s, SHUT_RDWR);
+		close(ctx->s);
+		ctx->s = -1;
+	}
+}
+
+
+int _modbus_tcp_flush(modbus_t *ctx)
+{
+	int rc;
+	int rc_sum = 0;
+
+	do {
+		/* Extract the garbage from the socket */
+		char devnull[MODBUS_TCP_MAX_ADU_LENGTH];
+
+		rc = recv(ctx->s, devnull, MODBUS_TCP_MAX_ADU_LENGTH, MSG_DONTWAIT);
+		if (rc > 0) {
+			rc_sum += rc;
+		}
+	} while (rc == MODBUS_TCP_MAX_ADU_LENGTH);
+
+	return rc_sum;
+}
+
+
+int _modbus_tcp_select(modbus_t *ctx, fd_set *rset, struct timeval *tv, int length_to_read)
+{
+	int s_rc;
+	while ((s_rc = select(ctx->s+1, rset, NULL, NULL, tv)) == -1) {
+		if (errno == EINTR) {
+			if (ctx->debug) {
+				fprintf(stderr, "A non blocked signal was caught\n");
+			}
+			/* Necessary after an error */
+			FD_ZERO(rset);
+			FD_SET(ctx->s, rset);
+		} else {
+			return -1;
+		}
+	}
+
+	if (s_rc == 0) {
+		errno = ETIMEDOUT;
+		return -1;
+	}
+
+	return s_rc;
+}
+
+
+void _modbus_tcp_free(modbus_t *ctx) {
+	free(ctx->backend_data);
+	free(ctx);
+}
+
+
+modbus_backend_t _modbus_tcp_backend = {
+	_MODBUS_BACKEND_TYPE_TCP,
+	_MODBUS_TCP_HEADER_LENGTH,
+	_MODBUS_TCP_CHECKSUM_LENGTH,
+	MODBUS_TCP_MAX_ADU_LENGTH,
+	_modbus_tcp_set_slave,
+	_modbus_tcp_build_request_basis,
+	_modbus_tcp_build_response_basis,
+	_modbus_tcp_prepare_response_tid,
+	_modbus_tcp_send_msg_pre,
+	_modbus_tcp_send,
+	_modbus_tcp_receive,
+	_modbus_tcp_recv,
+	_modbus_tcp_check_integrity,
+	_modbus_tcp_pre_check_confirmation,
+	_modbus_tcp_connect,
+	_modbus_tcp_close,
+	_modbus_tcp_flush,
+	_modbus_tcp_select,
+	_modbus_tcp_free
+};
+
+
+modbus_t* modbus_new_tcp(const char *ip, int port)
+{
+	modbus_t *ctx;
+	modbus_tcp_t *ctx_tcp;
+
+	ctx = (modbus_t *)malloc(sizeof(modbus_t));
+	if (ctx == NULL) {
+		return NULL;
+	}
+	_modbus_init_common(ctx);
+
+	/* Could be changed after to reach a remote serial Modbus device */
+	ctx->slave = MODBUS_TCP_SLAVE;
+
+	ctx->backend = &_modbus_tcp_backend;
+
+	ctx->backend_data = (modbus_tcp_t *)malloc(sizeof(modbus_tcp_t));
+	if (ctx->backend_data == NULL) {
+		modbus_free(ctx);
+		errno = ENOMEM;
+		return NULL;
+	}
+	ctx_tcp = (modbus_tcp_t *)ctx->backend_data;
+
+	if (ip != NULL) {
+		size_t dest_size = sizeof(char) * 16;
+		size_t ret_size;
+
+		ret_size = strlen(ip);
+		if (ret_size == 0 || ret_size >= dest_size) {
+			fprintf(stderr, "The IP string is empty or too long\n");
+			modbus_free(ctx);
+			errno = EINVAL;
+			return NULL;
+		}
+		strcpy(ctx_tcp->ip, ip);
+	} else {
+		ctx_tcp->ip[0] = '0';
+		ctx_tcp->ip[1] = '\0';
+	}
+	ctx_tcp->port = port;
+	ctx_tcp->t_id = 0;
+
+	return ctx;
+}
+
+
+/* Listens for any request from one or many modbus masters in TCP */
+int modbus_tcp_listen(modbus_t *ctx, int nb_connection)
+{
+	int new_s;
+	int enable;
+	struct sockaddr_in addr;
+	modbus_tcp_t *ctx_tcp;
+
+	if (ctx == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	ctx_tcp = ctx->backend_data;
+
+	new_s = socket(PF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+	if (new_s == -1) {
+		return -1;
+	}
+
+	enable = 1;
+	if (setsockopt(new_s, SOL_SOCKET, SO_REUSEADDR,
+			(char *)&enable, sizeof(enable)) == -1) {
+		close(new_s);
+		return -1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	/* If the modbus port is < to 1024, we need the setuid root. */
+	addr.sin_port = htons(ctx_tcp->port);
+	if (ctx_tcp->ip[0] == '0') {
+		/* Listen any addresses */
+		addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	} else if (inet_pton(AF_INET, ctx_tcp->ip, &addr.sin_addr) != 1) {
+		close(new_s);
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (bind(new_s, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+		close(new_s);
+		return -1;
+	}
+
+	if (listen(new_s, nb_connection) == -1) {
+		close(new_s);
+		return -1;
+	}
+
+	return new_s;
+}
+
+
+int modbus_tcp_accept(modbus_t *ctx, int *s)
+{
+	struct sockaddr_in addr;
+	socklen_t addrlen;
+
+	if (ctx == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	addrlen = sizeof(addr);
+	ctx->s = accept4(*s, (struct sockaddr *)&addr, &addrlen, SOCK_CLOEXEC);
+	if (ctx->s == -1) {
+		return -1;
+	}
+
+	if (_modbus_tcp_set_ipv4_options(ctx->s) == -1) {
+		close(ctx->s);
+		ctx->s = -1;
+		return -1;
+	}
+
+	if (ctx->debug) {
+		char buf[INET_ADDRSTRLEN];
+
+		if (inet_ntop(AF_INET, &(addr.sin_addr), buf, INET_ADDRSTRLEN) != NULL) {
+			printf("The client connection from %s is accepted\n", buf);
+		}
+	}
+
+	return ctx->s;
+}
+
+
+int modbus_tcp_slave_reply(modbus_t *ctx, modbus_slave_t *slave, const uint8_t *req, int req_length)
+{
+	/* Unit id and PDU, without CRC */
+	uint8_t adu[MODBUS_RTU_MAX_ADU_LENGTH];
+	/* The slave appends a CRC, room for it after the MBAP header */
+	uint8_t rsp[_MODBUS_TCP_HEADER_LENGTH - 1 + MODBUS_RTU_MAX_ADU_LENGTH];
+	const int header_length = _MODBUS_TCP_HEADER_LENGTH - 1;
+	int adu_length = req_length - header_length;
+	int unit;
+	int rc;
+
+	if (ctx == NULL || slave == NULL || req_length <= _MODBUS_TCP_HEADER_LENGTH ||
+		adu_length > MODBUS_RTU_MAX_ADU_LENGTH - _MODBUS_RTU_CHECKSUM_LENGTH) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memcpy(adu, req + header_length, adu_length);
+	unit = adu[0];
+	if (unit == MODBUS_TCP_SLAVE)
+		adu[0] = slave->address;
+
+	rc = modbus_slave_reply(slave, adu, adu_length, rsp + header_length);
+	if (rc == 0)
+		return 0;
+
+	/* Same transaction and protocol id, the unit id of the request */
+	memcpy(rsp, req, 4);
+	rsp[header_length] = unit;
+
+	return send_msg(ctx, rsp, header_length + rc - _MODBUS_RTU_CHECKSUM_LENGTH);
+}
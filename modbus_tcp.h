@@ -0,0 +1,54 @@
+#ifndef __MODBUS_TCP_H__
+#define __MODBUS_TCP_H__
+
+/*
+ * Modbus TCP backend (IPv4), the same context API as the RTU backend.
+ *
+ * Client:
+ *   ctx = modbus_new_tcp("192.168.0.5", MODBUS_TCP_DEFAULT_PORT);
+ *   modbus_connect(ctx);
+ *   modbus_set_slave(ctx, MODBUS_TCP_SLAVE);
+ *   modbus_read_registers(ctx, 0, 10, dest);
+ *
+ * Server:
+ *   ctx = modbus_new_tcp(NULL, MODBUS_TCP_DEFAULT_PORT);
+ *   server = modbus_tcp_listen(ctx, 1);
+ *   modbus_tcp_accept(ctx, &server);
+ *   for (;;) {
+ *       rc = modbus_receive(ctx, req);
+ *       if (rc > 0)
+ *           modbus_tcp_slave_reply(ctx, &slave, req, rc);
+ *   }
+ *
+ * The server answers from the data model of modbus_slave.h, the unit id
+ * MODBUS_TCP_SLAVE is accepted as the address of the slave.
+ */
+
+int _modbus_tcp_set_slave(modbus_t *ctx, int slave);
+int _modbus_tcp_build_request_basis(modbus_t *ctx, int function, int addr, int nb, uint8_t *req);
+int _modbus_tcp_build_response_basis(sft_t *sft, uint8_t *rsp);
+int _modbus_tcp_prepare_response_tid(const uint8_t *req, int *req_length);
+int _modbus_tcp_send_msg_pre(uint8_t *req, int req_length);
+ssize_t _modbus_tcp_send(modbus_t *ctx, const uint8_t *req, int req_length);
+int _modbus_tcp_receive(modbus_t *ctx, uint8_t *req);
+ssize_t _modbus_tcp_recv(modbus_t *ctx, uint8_t *rsp, int rsp_length);
+int _modbus_tcp_check_integrity(modbus_t *ctx, uint8_t *msg, const int msg_length);
+int _modbus_tcp_pre_check_confirmation(modbus_t *ctx, const uint8_t *req, const uint8_t *rsp, int rsp_length);
+int _modbus_tcp_connect(modbus_t *ctx);
+void _modbus_tcp_close(modbus_t *ctx);
+int _modbus_tcp_flush(modbus_t *ctx);
+int _modbus_tcp_select(modbus_t *ctx, fd_set *rset, struct timeval *tv, int length_to_read);
+void _modbus_tcp_free(modbus_t *ctx);
+
+modbus_t* modbus_new_tcp(const char *ip, int port);
+/* Returns the listening socket */
+int modbus_tcp_listen(modbus_t *ctx, int nb_connection);
+/* Accepts a client on the listening socket *s, it becomes the socket of the context */
+int modbus_tcp_accept(modbus_t *ctx, int *s);
+
+struct _modbus_slave;
+/* Answers an indication received by modbus_receive(), returns the number of bytes sent,
+   0 if there is no response (another unit, broadcast) or -1 */
+int modbus_tcp_slave_reply(modbus_t *ctx, struct _modbus_slave *slave, const uint8_t *req, int req_length);
+
+#endif
@@ -0,0 +1,656 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <termios.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "modbus_tiny.h"
+
+#include "modbus.h"
+#include "modbus_tcp.h"
+#include "modbus_rtu_master.h"
+#include "modbus_gateway.h"
+#include "modbus_cache.h"
+#include "modbus_tcp_bridge.h"
+
+
+/* Transaction id, protocol id and length of the MBAP header, the unit id follows */
+#define _BRIDGE_MBAP_LENGTH (_MODBUS_TCP_HEADER_LENGTH - 1)
+
+typedef struct _bridge_client {
+    modbus_tcp_bridge_t *bridge;
+    int s;
+    int closed;
+    /* Requests of this client on a bus, the client is freed when they are done */
+    int pending;
+    int rx_length;
+    uint8_t rx[MODBUS_TCP_MAX_ADU_LENGTH];
+    /* Responses the socket didn't take yet */
+    uint8_t *tx;
+    int tx_length;
+    int tx_size;
+    struct _bridge_client *next;
+} _bridge_client_t;
+
+/* A client request answered by a bus transaction */
+typedef struct _bridge_waiter {
+    _bridge_client_t *client;
+    uint8_t t_id[2];
+    uint8_t unit;
+    struct _bridge_waiter *next;
+} _bridge_waiter_t;
+
+/* One request on a bus */
+typedef struct _bridge_txn {
+    /* NULL once the bridge is freed, the master still owns the request */
+    modbus_tcp_bridge_t *bridge;
+    modbus_rtu_master_t *master;
+    /* Slave address and PDU */
+    int req_length;
+    uint8_t req[MODBUS_RTU_MAX_ADU_LENGTH];
+    /* Cleared when a write to the slave is queued behind this read */
+    int joinable;
+    _bridge_waiter_t *waiters;
+    struct _bridge_txn *next;
+} _bridge_txn_t;
+
+struct _modbus_tcp_bridge {
+    modbus_gateway_t *gw;
+    modbus_t *ctx;
+    int s;
+    int max_clients;
+    int nb_clients;
+    _bridge_client_t *clients;
+    /* Transactions queued or on the wire, searched for reads to merge */
+    _bridge_txn_t *txns;
+    modbus_rtu_master_t *routes[256];
+    modbus_cache_t *cache;
+    modbus_tcp_bridge_stats_t stats;
+};
+
+
+static void _bridge_accept(modbus_gateway_t *gw, int fd, uint32_t events, void *user_data);
+static void _bridge_client_event(modbus_gateway_t *gw, int fd, uint32_t events, void *user_data);
+
+
+modbus_tcp_bridge_t *modbus_tcp_bridge_new(modbus_gateway_t *gw, modbus_t *ctx, int max_clients)
+{
+    modbus_tcp_bridge_t *bridge;
+
+    if (gw == NULL || ctx == NULL || max_clients <= 0 ||
+        ctx->backend->backend_type != _MODBUS_BACKEND_TYPE_TCP) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    bridge = (modbus_tcp_bridge_t *)calloc(1, sizeof(modbus_tcp_bridge_t));
+    if (bridge == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    bridge->gw = gw;
+    bridge->ctx = ctx;
+    bridge->max_clients = max_clients;
+
+    bridge->cache = modbus_cache_new(MODBUS_TCP_BRIDGE_CACHE_ENTRIES);
+    if (bridge->cache == NULL) {
+        free(bridge);
+        return NULL;
+    }
+
+    bridge->s = modbus_tcp_listen(ctx, max_clients);
+    if (bridge->s == -1) {
+        modbus_cache_free(bridge->cache);
+        free(bridge);
+        return NULL;
+    }
+
+    if (modbus_gateway_add_fd(gw, bridge->s, EPOLLIN, _bridge_accept, bridge) == -1) {
+        int saved_errno = errno;
+
+        close(bridge->s);
+        modbus_cache_free(bridge->cache);
+        free(bridge);
+        errno = saved_errno;
+        return NULL;
+    }
+
+    return bridge;
+}
+
+
+static void _bridge_client_free(_bridge_client_t *client)
+{
+    free(client->tx);
+    free(client);
+}
+
+
+/* Takes the client out of the loop, it's freed when no request of it is left on a bus */
+static void _bridge_client_close(_bridge_client_t *client)
+{
+    modbus_tcp_bridge_t *bridge = client->bridge;
+    _bridge_client_t **link;
+
+    if (bridge->ctx->debug) {
+        printf("Bridge client %d closed\n", client->s);
+    }
+
+    modbus_gateway_remove_fd(bridge->gw, client->s);
+    close(client->s);
+    client->s = -1;
+    client->closed = TRUE;
+
+    for (link = &bridge->clients; *link != NULL; link = &(*link)->next) {
+        if (*link == client) {
+            *link = client->next;
+            break;
+        }
+    }
+    bridge->nb_clients--;
+
+    if (client->pending == 0)
+        _bridge_client_free(client);
+}
+
+
+void modbus_tcp_bridge_free(modbus_tcp_bridge_t *bridge)
+{
+    _bridge_txn_t *txn;
+
+    if (bridge == NULL)
+        return;
+
+    /* The masters complete these later, without anybody to answer */
+    for (txn = bridge->txns; txn != NULL; txn = txn->next) {
+        while (txn->waiters != NULL) {
+            _bridge_waiter_t *waiter = txn->waiters;
+
+            _bridge_client_t *client = waiter->client;
+
+            txn->waiters = waiter->next;
+            client->pending--;
+            /* Already closed clients are no longer in the client list */
+            if (client->closed && client->pending == 0)
+                _bridge_client_free(client);
+            free(waiter);
+        }
+        txn->bridge = NULL;
+    }
+
+    while (bridge->clients != NULL) {
+        _bridge_client_close(bridge->clients);
+    }
+
+    modbus_gateway_remove_fd(bridge->gw, bridge->s);
+    close(bridge->s);
+    modbus_cache_free(bridge->cache);
+    free(bridge);
+}
+
+
+int modbus_tcp_bridge_add_route(modbus_tcp_bridge_t *bridge, int first, int last,
+                                modbus_rtu_master_t *master)
+{
+    int unit;
+
+    if (bridge == NULL || first < 0 || last > 247 || first > last) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (unit = first; unit <= last; unit++) {
+        bridge->routes[unit] = master;
+        /* Cached values of another bus */
+        modbus_cache_clear(bridge->cache, unit);
+    }
+
+    return 0;
+}
+
+
+int modbus_tcp_bridge_set_max_age(modbus_tcp_bridge_t *bridge, int first, int last,
+                                  uint32_t max_age_ms)
+{
+    int unit;
+
+    if (bridge == NULL || first < 1 || last > 247 || first > last) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (unit = first; unit <= last; unit++) {
+        modbus_cache_set_max_age(bridge->cache, unit, max_age_ms);
+        if (max_age_ms == 0)
+            modbus_cache_clear(bridge->cache, unit);
+    }
+
+    return 0;
+}
+
+
+int modbus_tcp_bridge_get_stats(modbus_tcp_bridge_t *bridge, modbus_tcp_bridge_stats_t *stats)
+{
+    if (bridge == NULL || stats == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *stats = bridge->stats;
+    return 0;
+}
+
+
+static void _bridge_accept(modbus_gateway_t *gw, int fd, uint32_t events, void *user_data)
+{
+    modbus_tcp_bridge_t *bridge = (modbus_tcp_bridge_t *)user_data;
+    _bridge_client_t *client;
+    int option = 1;
+    int s;
+
+    s = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (s == -1)
+        return;
+
+    if (bridge->nb_clients >= bridge->max_clients) {
+        if (bridge->ctx->debug) {
+            fprintf(stderr, "Bridge client refused, %d connections\n", bridge->nb_clients);
+        }
+        close(s);
+        return;
+    }
+
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const void *)&option, sizeof(int));
+
+    client = (_bridge_client_t *)calloc(1, sizeof(_bridge_client_t));
+    if (client == NULL) {
+        close(s);
+        return;
+    }
+    client->bridge = bridge;
+    client->s = s;
+
+    if (modbus_gateway_add_fd(gw, s, EPOLLIN, _bridge_client_event, client) == -1) {
+        close(s);
+        free(client);
+        return;
+    }
+
+    client->next = bridge->clients;
+    bridge->clients = client;
+    bridge->nb_clients++;
+
+    if (bridge->ctx->debug) {
+        printf("Bridge client %d accepted\n", s);
+    }
+}
+
+
+/* Sends what the socket takes, queues the rest until it's writable.
+   The client may be closed (and freed) on return. */
+static void _bridge_client_send(_bridge_client_t *client, const uint8_t *msg, int msg_length)
+{
+    modbus_tcp_bridge_t *bridge = client->bridge;
+    ssize_t rc = 0;
+
+    /* Keep the order of the responses */
+    if (client->tx_length == 0) {
+        rc = send(client->s, msg, msg_length, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (rc == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                _bridge_client_close(client);
+                return;
+            }
+            rc = 0;
+        }
+        if (rc == msg_length)
+            return;
+    }
+
+    msg += rc;
+    msg_length -= rc;
+    if (client->tx_length + msg_length > MODBUS_TCP_BRIDGE_MAX_TX) {
+        _bridge_client_close(client);
+        return;
+    }
+
+    if (client->tx_length + msg_length > client->tx_size) {
+        int size = client->tx_size ? client->tx_size : MODBUS_TCP_MAX_ADU_LENGTH * 4;
+        uint8_t *tx;
+
+        while (size < client->tx_length + msg_length)
+            size *= 2;
+        tx = (uint8_t *)realloc(client->tx, size);
+        if (tx == NULL) {
+            _bridge_client_close(client);
+            return;
+        }
+        client->tx = tx;
+        client->tx_size = size;
+    }
+
+    if (client->tx_length == 0)
+        modbus_gateway_modify_fd(bridge->gw, client->s, EPOLLIN | EPOLLOUT);
+    memcpy(client->tx + client->tx_length, msg, msg_length);
+    client->tx_length += msg_length;
+}
+
+
+static void _bridge_client_reply(_bridge_client_t *client, const uint8_t *t_id, int unit,
+                                 const uint8_t *pdu, int pdu_length)
+{
+    uint8_t rsp[MODBUS_TCP_MAX_ADU_LENGTH];
+
+    rsp[0] = t_id[0];
+    rsp[1] = t_id[1];
+    rsp[2] = 0;
+    rsp[3] = 0;
+    rsp[6] = unit;
+    memcpy(rsp + _MODBUS_TCP_HEADER_LENGTH, pdu, pdu_length);
+
+    _bridge_client_send(client, rsp,
+                        _modbus_tcp_send_msg_pre(rsp, _MODBUS_TCP_HEADER_LENGTH + pdu_length));
+}
+
+
+static void _bridge_client_exception(_bridge_client_t *client, const uint8_t *t_id, int unit,
+                                     int function, int exception)
+{
+    uint8_t pdu[2];
+
+    pdu[0] = function | 0x80;
+    pdu[1] = exception;
+    client->bridge->stats.exceptions++;
+    _bridge_client_reply(client, t_id, unit, pdu, sizeof(pdu));
+}
+
+
+/* Completion of a bus transaction, answers every client request merged into it */
+static void _bridge_bus_done(modbus_rtu_master_t *master,
+                             const uint8_t *req, int req_length,
+                             const uint8_t *rsp, int rsp_length,
+                             int rc, void *user_data)
+{
+    _bridge_txn_t *txn = (_bridge_txn_t *)user_data;
+    modbus_tcp_bridge_t *bridge = txn->bridge;
+    const int error = errno;
+    const uint8_t *pdu = NULL;
+    int pdu_length = 0;
+    int exception = 0;
+    _bridge_txn_t **link;
+
+    if (bridge == NULL) {
+        free(txn);
+        return;
+    }
+
+    for (link = &bridge->txns; *link != NULL; link = &(*link)->next) {
+        if (*link == txn) {
+            *link = txn->next;
+            break;
+        }
+    }
+
+    /* The master checked the response with check_confirmation(), a read with a
+       write queued behind it is outdated once the write is done */
+    if (rsp != NULL && rc >= 0 && txn->joinable)
+        modbus_cache_store(bridge->cache, req, req_length, rsp,
+                           rsp_length - _MODBUS_RTU_CHECKSUM_LENGTH);
+    /* Reads of the slave stored while the write was queued are older than it */
+    modbus_cache_invalidate(bridge->cache, req, req_length);
+
+    /* Responses and the exceptions of the slave are forwarded as they are */
+    if (rsp != NULL && (rc >= 0 || (error >= EMBXILFUN && error <= EMBXGTAR))) {
+        pdu = rsp + _MODBUS_RTU_HEADER_LENGTH;
+        pdu_length = rsp_length - _MODBUS_RTU_HEADER_LENGTH - _MODBUS_RTU_CHECKSUM_LENGTH;
+    } else if (error == ECANCELED) {
+        exception = MODBUS_EXCEPTION_GATEWAY_PATH;
+    } else {
+        exception = MODBUS_EXCEPTION_GATEWAY_TARGET;
+    }
+
+    if (bridge->ctx->debug && exception) {
+        fprintf(stderr, "Bus request to slave %d failed: %s\n", req[0], modbus_strerror(error));
+    }
+
+    while (txn->waiters != NULL) {
+        _bridge_waiter_t *waiter = txn->waiters;
+        _bridge_client_t *client = waiter->client;
+
+        txn->waiters = waiter->next;
+        /* The pending count of this waiter keeps the client allocated if the
+           send closes it, another waiter may belong to the same client */
+        if (client->closed) {
+            /* Nobody to answer */
+        } else if (exception) {
+            _bridge_client_exception(client, waiter->t_id, waiter->unit, req[1], exception);
+        } else {
+            _bridge_client_reply(client, waiter->t_id, waiter->unit, pdu, pdu_length);
+        }
+        client->pending--;
+        if (client->closed && client->pending == 0)
+            _bridge_client_free(client);
+        free(waiter);
+    }
+
+    free(txn);
+}
+
+
+static int _bridge_add_waiter(_bridge_txn_t *txn, _bridge_client_t *client, const uint8_t *mbap)
+{
+    _bridge_waiter_t *waiter;
+    _bridge_waiter_t **link;
+
+    waiter = (_bridge_waiter_t *)malloc(sizeof(_bridge_waiter_t));
+    if (waiter == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    waiter->client = client;
+    waiter->t_id[0] = mbap[0];
+    waiter->t_id[1] = mbap[1];
+    waiter->unit = mbap[_BRIDGE_MBAP_LENGTH];
+    waiter->next = NULL;
+
+    /* Answered in the order of arrival */
+    for (link = &txn->waiters; *link != NULL; link = &(*link)->next) {
+    }
+    *link = waiter;
+    client->pending++;
+
+    return 0;
+}
+
+
+/* Handles one complete request of a client, mbap points to its MBAP header */
+static void _bridge_request(_bridge_client_t *client, const uint8_t *mbap, int length)
+{
+    modbus_tcp_bridge_t *bridge = client->bridge;
+    const uint8_t *adu = mbap + _BRIDGE_MBAP_LENGTH;
+    const int unit = adu[0];
+    const int function = adu[1];
+    modbus_rtu_master_t *master;
+    _bridge_txn_t *txn;
+
+    bridge->stats.requests++;
+
+    master = unit <= 247 ? bridge->routes[unit] : NULL;
+    if (master == NULL) {
+        _bridge_client_exception(client, mbap, unit, function, MODBUS_EXCEPTION_GATEWAY_PATH);
+        return;
+    }
+
+    if (unit != MODBUS_BROADCAST_ADDRESS && function >= MODBUS_FC_READ_COILS &&
+        function <= MODBUS_FC_READ_INPUT_REGISTERS) {
+        uint8_t rsp[MODBUS_RTU_MAX_ADU_LENGTH];
+        int rsp_length;
+
+        rsp_length = modbus_cache_lookup(bridge->cache, adu, length, rsp);
+        if (rsp_length > 0) {
+            bridge->stats.cached++;
+            _bridge_client_reply(client, mbap, unit, rsp + _MODBUS_RTU_HEADER_LENGTH,
+                                 rsp_length - _MODBUS_RTU_HEADER_LENGTH);
+            return;
+        }
+
+        /* A read already on its way to the bus answers this one too */
+        for (txn = bridge->txns; txn != NULL; txn = txn->next) {
+            if (txn->joinable && txn->master == master && txn->req_length == length &&
+                memcmp(txn->req, adu, length) == 0) {
+                if (_bridge_add_waiter(txn, client, mbap) == 0) {
+                    bridge->stats.coalesced++;
+                } else {
+                    _bridge_client_exception(client, mbap, unit, function,
+                                             MODBUS_EXCEPTION_SLAVE_OR_SERVER_BUSY);
+                }
+                return;
+            }
+        }
+    } else {
+        /* Reads after this write must not get values from before it */
+        modbus_cache_invalidate(bridge->cache, adu, length);
+        for (txn = bridge->txns; txn != NULL; txn = txn->next) {
+            if (txn->master == master &&
+                (unit == MODBUS_BROADCAST_ADDRESS || txn->req[0] == unit))
+                txn->joinable = FALSE;
+        }
+    }
+
+    txn = (_bridge_txn_t *)calloc(1, sizeof(_bridge_txn_t));
+    if (txn == NULL || (unit != MODBUS_BROADCAST_ADDRESS &&
+                        _bridge_add_waiter(txn, client, mbap) == -1)) {
+        free(txn);
+        _bridge_client_exception(client, mbap, unit, function,
+                                 MODBUS_EXCEPTION_SLAVE_OR_SERVER_BUSY);
+        return;
+    }
+    txn->bridge = bridge;
+    txn->master = master;
+    txn->joinable = TRUE;
+    txn->req_length = length;
+    memcpy(txn->req, adu, length);
+
+    if (modbus_rtu_master_send_raw_request(master, txn->req, length, _bridge_bus_done, txn) == -1) {
+        int exception = errno == ENOBUFS ? MODBUS_EXCEPTION_SLAVE_OR_SERVER_BUSY :
+                                           MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+
+        if (txn->waiters != NULL) {
+            client->pending--;
+            free(txn->waiters);
+        }
+        free(txn);
+        _bridge_client_exception(client, mbap, unit, function, exception);
+        return;
+    }
+
+    txn->next = bridge->txns;
+    bridge->txns = txn;
+    bridge->stats.transactions++;
+
+    modbus_gateway_kick(bridge->gw, master);
+}
+
+
+static void _bridge_client_read(_bridge_client_t *client)
+{
+    ssize_t rc;
+    int offset = 0;
+
+    rc = recv(client->s, client->rx + client->rx_length,
+              sizeof(client->rx) - client->rx_length, MSG_DONTWAIT);
+    if (rc == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return;
+    if (rc <= 0) {
+        _bridge_client_close(client);
+        return;
+    }
+    client->rx_length += rc;
+
+    /* A request may already close the client (send failure), the pending count
+       keeps it allocated until the loop is done */
+    client->pending++;
+    while (!client->closed && client->rx_length - offset >= _MODBUS_TCP_HEADER_LENGTH + 1) {
+        const uint8_t *mbap = client->rx + offset;
+        const int length = (mbap[4] << 8) | mbap[5];
+
+        /* Unit id and function code at least, the slave address and PDU have to
+           fit into an RTU frame */
+        if (mbap[2] != 0 || mbap[3] != 0 || length < 2 ||
+            length > MODBUS_RTU_MAX_ADU_LENGTH - _MODBUS_RTU_CHECKSUM_LENGTH) {
+            if (client->bridge->ctx->debug) {
+                fprintf(stderr, "Bridge client %d sent an invalid MBAP header\n", client->s);
+            }
+            _bridge_client_close(client);
+            break;
+        }
+
+        if (client->rx_length - offset < _BRIDGE_MBAP_LENGTH + length)
+            break;
+
+        _bridge_request(client, mbap, length);
+        offset += _BRIDGE_MBAP_LENGTH + length;
+    }
+    client->pending--;
+
+    if (client->closed) {
+        if (client->pending == 0)
+            _bridge_client_free(client);
+        return;
+    }
+
+    client->rx_length -= offset;
+    memmove(client->rx, client->rx + offset, client->rx_length);
+}
+
+
+/* Returns -1 if the client has been closed */
+static int _bridge_client_write(_bridge_client_t *client)
+{
+    ssize_t rc;
+
+    rc = send(client->s, client->tx, client->tx_length, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (rc == -1) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            _bridge_client_close(client);
+            return -1;
+        }
+        return 0;
+    }
+
+    client->tx_length -= rc;
+    memmove(client->tx, client->tx + rc, client->tx_length);
+    if (client->tx_length == 0)
+        modbus_gateway_modify_fd(client->bridge->gw, client->s, EPOLLIN);
+
+    return 0;
+}
+
+
+static void _bridge_client_event(modbus_gateway_t *gw, int fd, uint32_t events, void *user_data)
+{
+    _bridge_client_t *client = (_bridge_client_t *)user_data;
+
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        _bridge_client_close(client);
+        return;
+    }
+
+    if ((events & EPOLLOUT) && _bridge_client_write(client) == -1)
+        return;
+
+    if (events & EPOLLIN)
+        _bridge_client_read(client);
+}
@@ -0,0 +1,72 @@
+#ifndef __MODBUS_TCP_BRIDGE_H__
+#define __MODBUS_TCP_BRIDGE_H__
+
+/*
+ * Modbus TCP to RTU bridge on top of the gateway runtime (modbus_gateway.h).
+ *
+ * TCP clients connect to the listening socket of a TCP context, their requests are
+ * routed by unit id onto the RTU masters of the gateway. Every bus works on one
+ * request at a time (the queue of its master), different buses run concurrently
+ * in the same epoll loop, and a client may pipeline requests.
+ *
+ * The bus side has no transaction id: the transaction id of the client is kept
+ * with its request and put back into the response. Reads (functions 01 to 04)
+ * identical to one still queued or on the wire, from any client, are not sent
+ * again but answered from that one bus transaction. Writes are never merged.
+ *
+ * Reads can also be answered from a response cache (modbus_cache.h) with a maximum
+ * age per unit id, disabled by default. Writes invalidate the cached ranges they
+ * touch and keep later reads from joining a read queued before them.
+ *
+ * Unrouted unit ids are answered with the gateway path unavailable exception,
+ * timeouts and broken responses with gateway target failed to respond, a full bus
+ * queue with server busy. Broadcasts (unit id 0) are forwarded without response.
+ *
+ *   gw = modbus_gateway_new();
+ *   master = modbus_gateway_add_rtu(gw, rtu_ctx, 0);
+ *   bridge = modbus_tcp_bridge_new(gw, modbus_new_tcp(NULL, MODBUS_TCP_DEFAULT_PORT), 16);
+ *   modbus_tcp_bridge_add_route(bridge, 1, 247, master);
+ *   modbus_gateway_run(gw);
+ *
+ * Remove the routes to a master before it is removed from the gateway. The bridge is
+ * freed before the gateway.
+ */
+
+/* Cached read responses, shared by all buses */
+#define MODBUS_TCP_BRIDGE_CACHE_ENTRIES 256
+
+/* Bytes of responses queued for a client that doesn't read, it's disconnected above */
+#define MODBUS_TCP_BRIDGE_MAX_TX    65536
+
+typedef struct _modbus_tcp_bridge modbus_tcp_bridge_t;
+
+typedef struct _modbus_tcp_bridge_stats {
+    /* Requests received from the clients */
+    uint32_t requests;
+    /* Requests put on a bus */
+    uint32_t transactions;
+    /* Reads answered from the transaction of another request */
+    uint32_t coalesced;
+    /* Reads answered from the cache */
+    uint32_t cached;
+    /* Exceptions generated by the bridge */
+    uint32_t exceptions;
+} modbus_tcp_bridge_stats_t;
+
+/* Listens on the address of the TCP context, at most max_clients connections */
+modbus_tcp_bridge_t *modbus_tcp_bridge_new(modbus_gateway_t *gw, modbus_t *ctx, int max_clients);
+/* Closes the connections, the TCP context is left to the caller */
+void modbus_tcp_bridge_free(modbus_tcp_bridge_t *bridge);
+
+/* Routes the unit ids first to last to the master, NULL removes the route */
+int modbus_tcp_bridge_add_route(modbus_tcp_bridge_t *bridge, int first, int last,
+                                modbus_rtu_master_t *master);
+
+/* Answers reads of the unit ids first to last from responses up to max_age_ms old,
+   0 disables the cache */
+int modbus_tcp_bridge_set_max_age(modbus_tcp_bridge_t *bridge, int first, int last,
+                                  uint32_t max_age_ms);
+
+int modbus_tcp_bridge_get_stats(modbus_tcp_bridge_t *bridge, modbus_tcp_bridge_stats_t *stats);
+
+#endif
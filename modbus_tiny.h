@@ -60,6 +60,18 @@ enum {
 #define MODBUS_MAX_READ_BITS              2000
 #define MODBUS_MAX_WRITE_BITS             1968
 
+/* Modbus_Application_Protocol_V1_1b.pdf (chapter 6 section 3 page 15)
+ * Quantity of Registers to read (2 bytes): 1 to 125 (0x7D)
+ * (chapter 6 section 12 page 31)
+ * Quantity of Registers to write (2 bytes) 1 to 123 (0x7B)
+ * (chapter 6 section 17 page 38)
+ * Quantity of Registers to write in R/W registers (2 bytes) 1 to 121 (0x79)
+ */
+#define MODBUS_MAX_READ_REGISTERS          125
+#define MODBUS_MAX_WRITE_REGISTERS         123
+#define MODBUS_MAX_WR_WRITE_REGISTERS      121
+#define MODBUS_MAX_WR_READ_REGISTERS       125
+
 /* Protocol exceptions */
 enum {
     MODBUS_EXCEPTION_ILLEGAL_FUNCTION = 0x01,
@@ -146,6 +158,21 @@ enum {
 #define MODBUS_RTU_MAX_ADU_LENGTH  256
 
 
+/* MBAP header: transaction id (2), protocol id (2), length (2), unit id (1) */
+#define _MODBUS_TCP_HEADER_LENGTH      7
+#define _MODBUS_TCP_PRESET_REQ_LENGTH 12
+#define _MODBUS_TCP_PRESET_RSP_LENGTH  8
+
+#define _MODBUS_TCP_CHECKSUM_LENGTH    0
+
+#define MODBUS_TCP_DEFAULT_PORT   502
+/* Unit id of a server that isn't behind a gateway */
+#define MODBUS_TCP_SLAVE         0xFF
+/* Modbus Messaging on TCP/IP Implementation Guide V1.0b (page 18):
+ * MBAP header (7) + PDU (253) */
+#define MODBUS_TCP_MAX_ADU_LENGTH 260
+
+
 
 typedef enum
 {
@@ -209,6 +236,11 @@ typedef struct _sft {
 
 typedef struct _modbus modbus_t;
 
+/* The backend and context types need the POSIX serial headers (termios, select).
+ * Code that only uses the protocol definitions, e.g. modbus_slave.c on the
+ * firmware, defines MODBUS_TINY_NO_BACKEND. */
+#ifndef MODBUS_TINY_NO_BACKEND
+
 typedef struct _modbus_backend {
     unsigned int backend_type;
     unsigned int header_length;
@@ -279,5 +311,19 @@ typedef struct _modbus_rtu {
 } modbus_rtu_t;
 
 
+typedef struct _modbus_tcp {
+    /* Extract from MODBUS Messaging on TCP/IP Implementation Guide V1.0b
+       (page 23/46): the transaction identifier is used to associate the
+       future response with the request. */
+    uint16_t t_id;
+    /* TCP port */
+    int port;
+    /* IP address, NULL or "0.0.0.0" to listen on any address */
+    char ip[16];
+} modbus_tcp_t;
+
+#endif /* MODBUS_TINY_NO_BACKEND */
+
+
 
 #endif
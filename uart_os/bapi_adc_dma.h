@@ -0,0 +1,80 @@
+/*
+ * bapi_adc_dma.h
+ *
+ */
+
+/**************************************************************************//**
+ * \file
+ * \brief This file declares board API interface functions that let the ADC
+ * write a whole scan sequence by DMA into ping-pong sample buffers.
+ *
+ * A DMA scan is set up once for a list of ADC channels. Each call of
+ * \ref bapi_adc_triggerDmaScan converts all channels of the list once and
+ * the DMA stores the results interleaved in the active buffer:
+ *   buffer[scanIndex * channelCount + channelIndex]
+ * When scansPerBuffer scans are stored, the DMA switches to the other buffer
+ * and the batch callback is invoked once in ISR context. No per conversion
+ * interrupt is raised for channels of a DMA scan.
+ *****************************************************************************/
+
+#ifndef BAPI_ADC_DMA_H_
+#define BAPI_ADC_DMA_H_
+
+#include "baseplate.h"
+#include "boards/board-api/bapi_io.h"
+
+/**
+ * \ingroup bapi_adc
+ * \brief The number of sample buffers a DMA scan alternates between.
+ */
+enum { bapi_adc_DmaBufferCount = 2 };
+
+/**
+ * \ingroup bapi_adc
+ * \brief Handle of a DMA scan. Negative values signal an error.
+ */
+typedef int bapi_adc_DmaScan_t;
+
+/**
+ * \ingroup bapi_adc
+ * \brief Callback that is invoked in ISR context when a sample buffer is full.
+ *
+ * @param bufferIndex The index of the buffer that was completed. The DMA continues
+ *   with the other buffer.
+ * @param cookie      The cookie that was passed to \ref bapi_adc_startDmaScan.
+ */
+typedef void (*bapi_adc_DmaBatchCallback_t)(unsigned bufferIndex, void* cookie);
+
+/**
+ * \ingroup bapi_adc
+ * \brief Set up a DMA scan for a list of ADC channels.
+ *
+ * @param channels       The ADC channels of the scan sequence.
+ * @param channelCount   The number of channels.
+ * @param buffers        The sample buffers. Each must hold scansPerBuffer * channelCount samples.
+ * @param scansPerBuffer The number of scans until a buffer is complete.
+ * @param callback       Invoked in ISR context for each completed buffer.
+ * @param cookie         Passed to the callback.
+ *
+ * @return A handle >= 0 on success. A negative value if the board does not support
+ *   DMA scans or has no free DMA channel. In that case the caller falls back to
+ *   per conversion callbacks.
+ */
+C_FUNC bapi_adc_DmaScan_t bapi_adc_startDmaScan(const bapi_E_AdcChannel* channels, unsigned channelCount
+  , uint16_t* const buffers[bapi_adc_DmaBufferCount], unsigned scansPerBuffer
+  , bapi_adc_DmaBatchCallback_t callback, void* cookie);
+
+/**
+ * \ingroup bapi_adc
+ * \brief Start one conversion of all channels of a DMA scan.
+ */
+C_FUNC void bapi_adc_triggerDmaScan(bapi_adc_DmaScan_t scan);
+
+/**
+ * \ingroup bapi_adc
+ * \brief Stop a DMA scan and release its DMA channel. The callback will not be
+ *   invoked anymore when this function returns.
+ */
+C_FUNC void bapi_adc_stopDmaScan(bapi_adc_DmaScan_t scan);
+
+#endif /* BAPI_ADC_DMA_H_ */
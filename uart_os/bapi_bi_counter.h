@@ -0,0 +1,99 @@
+/*
+ * bapi_bi_counter.h
+ *
+ */
+
+/**************************************************************************//**
+ * \file
+ * \brief This file declares board API interface functions that count the
+ * pulses of a Binary Input with timer/counter capture hardware (e.g. QTMR or
+ * TPM in external clock mode) instead of one interrupt per edge.
+ *
+ * The hardware counts the rising edges of the pin and captures the timer value
+ * of the last edges, so that the pulse period can be measured as well. The
+ * board extends narrow hardware counters to 32 bit (e.g. by the overflow
+ * interrupt of a 16 bit counter), which raises at most one interrupt per
+ * 65536 pulses. The caller extends the 32 bit count to 64 bit.
+ *
+ * A host build can link bapi_bi_counter_sim.cpp, which simulates the counters.
+ *****************************************************************************/
+
+#ifndef BAPI_BI_COUNTER_H_
+#define BAPI_BI_COUNTER_H_
+
+#include "baseplate.h"
+#include "boards/board-api/bapi_io.h"
+
+/**
+ * \ingroup bapi_bi
+ * \brief A consistent reading of a hardware pulse counter.
+ */
+typedef struct bapi_bi_CounterCapture {
+  uint32_t m_count;        /**< Rising edges since bapi_bi_counterStart(). Wraps around. */
+  uint32_t m_lastEdgeTick; /**< Capture timer value at the last edge. */
+  uint32_t m_nowTick;      /**< Capture timer value when the capture was read. */
+  uint32_t m_periodTicks;  /**< Capture timer ticks between the last two edges, 0 if unknown
+                                (less than two edges or the period exceeded the timer range). */
+} bapi_bi_CounterCapture;
+
+/**
+ * \ingroup bapi_bi
+ * \brief Route a Binary Input to capture hardware and start counting from 0.
+ *
+ * \note The per edge interrupt of the Binary Input is not enabled by this function.
+ *   A channel should not be member of an active Binary Input group while it is counted.
+ *
+ * @return true on success. false if the board has no capture hardware for this channel.
+ */
+C_FUNC bool bapi_bi_counterStart(bapi_E_BiChannel biChannel);
+
+/**
+ * \ingroup bapi_bi
+ * \brief Stop counting and release the capture hardware of a Binary Input.
+ */
+C_FUNC void bapi_bi_counterStop(bapi_E_BiChannel biChannel);
+
+/**
+ * \ingroup bapi_bi
+ * \brief Read the counter and the captured period of a Binary Input. May be called from
+ * any context.
+ *
+ * @return false if the channel is not counted by hardware.
+ */
+C_FUNC bool bapi_bi_counterRead(bapi_E_BiChannel biChannel, bapi_bi_CounterCapture* capture);
+
+/**
+ * \ingroup bapi_bi
+ * \brief The frequency of the capture timer, which is the unit of
+ * bapi_bi_CounterCapture::m_periodTicks. 0 if the board has no capture hardware.
+ */
+C_FUNC uint32_t bapi_bi_counterTickFrequency();
+
+/**
+ * \ingroup bapi_bi
+ * \brief Read the current level of a Binary Input pin, without waiting for a state change
+ * interrupt. Used to seed the state of a Binary Input group on activation. May be called
+ * from any context.
+ *
+ * @return true if the input is active. false if it is inactive or the board cannot read it.
+ */
+C_FUNC bool bapi_bi_getPinLevel(bapi_E_BiChannel biChannel);
+
+#if ENABLE_BI_COUNTER_SIMULATION > 0
+/**
+ * \ingroup bapi_bi
+ * \brief Host simulation only: let the counter of a started channel see pulses.
+ *
+ * @param pulses      The number of rising edges to add.
+ * @param periodTicks The pulse period in capture timer ticks.
+ */
+C_FUNC void bapi_bi_counterSimulatePulses(bapi_E_BiChannel biChannel, uint32_t pulses, uint32_t periodTicks);
+
+/**
+ * \ingroup bapi_bi
+ * \brief Host simulation only: let the capture timer of a started channel run without pulses.
+ */
+C_FUNC void bapi_bi_counterSimulateIdle(bapi_E_BiChannel biChannel, uint32_t ticks);
+#endif /* #if ENABLE_BI_COUNTER_SIMULATION > 0 */
+
+#endif /* BAPI_BI_COUNTER_H_ */
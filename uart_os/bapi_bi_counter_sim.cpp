@@ -0,0 +1,90 @@
+/*
+ * bapi_bi_counter_sim.cpp
+ *
+ */
+
+/** \file
+ * \brief
+ * Host simulation of the BI pulse counter board API declared in bapi_bi_counter.h.
+ * The counters see pulses only by bapi_bi_counterSimulatePulses(), and the capture timer
+ * runs only by bapi_bi_counterSimulatePulses() and bapi_bi_counterSimulateIdle().
+ */
+
+#include "baseplate.h"
+#include "boards/board-api/bapi_irq.h"
+#include "boards/board-api/bapi_bi_counter.h"
+
+/* ENABLE_BI_COUNTER_SIMULATION may be set to 0 or 1 by product_config.h */
+#if ENABLE_BI_COUNTER_SIMULATION > 0
+
+/** The simulated capture timer runs at 1 MHz, so periods are given in microseconds. */
+enum { BI_COUNTER_SIM_TICK_FREQUENCY = 1000000 };
+
+typedef struct _bi_counter_sim {
+  bool m_started;
+  bapi_bi_CounterCapture m_capture;
+} _bi_counter_sim;
+
+STATIC _bi_counter_sim g_biCounterSim[bapi_bi_E_Ch_Count];
+
+C_FUNC bool bapi_bi_counterStart(bapi_E_BiChannel biChannel) {
+  if(S_CAST(unsigned, biChannel) >= bapi_bi_E_Ch_Count) {
+    return false;
+  }
+  bapi_irq_enterCritical();
+  MEMSET(&g_biCounterSim[biChannel], 0, sizeof(g_biCounterSim[biChannel]));
+  g_biCounterSim[biChannel].m_started = true;
+  bapi_irq_exitCritical();
+  return true;
+}
+
+C_FUNC void bapi_bi_counterStop(bapi_E_BiChannel biChannel) {
+  if(S_CAST(unsigned, biChannel) < bapi_bi_E_Ch_Count) {
+    g_biCounterSim[biChannel].m_started = false;
+  }
+}
+
+C_FUNC bool bapi_bi_counterRead(bapi_E_BiChannel biChannel, bapi_bi_CounterCapture* capture) {
+  if((S_CAST(unsigned, biChannel) >= bapi_bi_E_Ch_Count) || !g_biCounterSim[biChannel].m_started) {
+    return false;
+  }
+  bapi_irq_enterCritical();
+  *capture = g_biCounterSim[biChannel].m_capture;
+  bapi_irq_exitCritical();
+  return true;
+}
+
+C_FUNC uint32_t bapi_bi_counterTickFrequency() {
+  return BI_COUNTER_SIM_TICK_FREQUENCY;
+}
+
+C_FUNC void bapi_bi_counterSimulatePulses(bapi_E_BiChannel biChannel, uint32_t pulses, uint32_t periodTicks) {
+  ASSERT(S_CAST(unsigned, biChannel) < bapi_bi_E_Ch_Count);
+  _bi_counter_sim* sim = &g_biCounterSim[biChannel];
+  if(!sim->m_started || !pulses) {
+    return;
+  }
+
+  bapi_irq_enterCritical();
+  const bool hadEdge = (sim->m_capture.m_count != 0) || (sim->m_capture.m_lastEdgeTick != 0);
+  sim->m_capture.m_count += pulses;
+  sim->m_capture.m_lastEdgeTick = sim->m_capture.m_nowTick + pulses * periodTicks;
+  sim->m_capture.m_nowTick = sim->m_capture.m_lastEdgeTick;
+  /* Like the hardware, the period is known only after two edges were captured. */
+  sim->m_capture.m_periodTicks = (hadEdge || (pulses > 1)) ? periodTicks : 0;
+  bapi_irq_exitCritical();
+}
+
+C_FUNC void bapi_bi_counterSimulateIdle(bapi_E_BiChannel biChannel, uint32_t ticks) {
+  ASSERT(S_CAST(unsigned, biChannel) < bapi_bi_E_Ch_Count);
+  _bi_counter_sim* sim = &g_biCounterSim[biChannel];
+  if(!sim->m_started) {
+    return;
+  }
+
+  bapi_irq_enterCritical();
+  sim->m_capture.m_nowTick += ticks;
+  bapi_irq_exitCritical();
+}
+
+#endif /* #if ENABLE_BI_COUNTER_SIMULATION > 0 */
@@ -0,0 +1,68 @@
+/*
+ * bapi_i2c_async.h
+ *
+ */
+
+/**************************************************************************//**
+ * \file
+ * \brief This file declares board API interface functions for I2C master
+ * transfers that run in the background, driven by the I2C FIFO interrupt or
+ * by DMA (e.g. LPI2C_MasterTransferNonBlocking / LPI2C_MasterTransferEDMA).
+ *
+ * The transfer functions return as soon as the transfer was started. Completion
+ * is signalled by a callback in ISR context. Interrupts stay enabled during the
+ * whole bus transaction.
+ *****************************************************************************/
+
+#ifndef BAPI_I2C_ASYNC_H_
+#define BAPI_I2C_ASYNC_H_
+
+#include "baseplate.h"
+#include "boards/board-api/bapi_i2c.h"
+
+/**
+ * \ingroup bapi_i2c
+ * \brief Callback that is invoked in ISR context when a background transfer ended.
+ *
+ * @param event       ARM_I2C_EVENT_ADDRESS_NACK, ARM_I2C_EVENT_ARBITRATION_LOST or
+ *   ARM_I2C_EVENT_BUS_ERROR if the transfer failed. 0 on success.
+ * @param transferred The number of bytes that were transmitted and acknowledged, or received.
+ * @param cookie      The cookie that was passed to \ref bapi_i2c_startTransfer.
+ */
+typedef void (*bapi_i2c_TransferCallback_t)(uint32_t event, uint32_t transferred, void* cookie);
+
+/**
+ * \ingroup bapi_i2c
+ * \brief Start a master transfer in the background.
+ *
+ * @param i2cIndex     The I2C.
+ * @param addr         The slave address, optionally ORed with ARM_I2C_ADDRESS_10BIT.
+ * @param receive      true to read from the slave, false to write to it.
+ * @param data         The data buffer. It must stay valid until the callback was invoked.
+ * @param num          The number of bytes.
+ * @param xfer_pending true to omit the STOP condition.
+ * @param callback     Invoked in ISR context when the transfer ended.
+ * @param cookie       Passed to the callback.
+ *
+ * @return true if the transfer was started. false if the board does not support
+ *   background transfers for this I2C. The caller falls back to the blocking
+ *   _bapi_I2cWriteData() and _bapi_I2cReadData() then.
+ */
+C_FUNC bool bapi_i2c_startTransfer(bapi_E_I2cIndex i2cIndex, uint32_t addr, bool receive
+  , uint8_t* data, uint32_t num, bool xfer_pending
+  , bapi_i2c_TransferCallback_t callback, void* cookie);
+
+/**
+ * \ingroup bapi_i2c
+ * \brief The number of bytes a running background transfer has transferred so far.
+ */
+C_FUNC uint32_t bapi_i2c_getTransferCount(bapi_E_I2cIndex i2cIndex);
+
+/**
+ * \ingroup bapi_i2c
+ * \brief Abort a running background transfer. The callback will not be invoked
+ *   anymore when this function returns.
+ */
+C_FUNC void bapi_i2c_abortTransfer(bapi_E_I2cIndex i2cIndex);
+
+#endif /* BAPI_I2C_ASYNC_H_ */
@@ -0,0 +1,62 @@
+/*
+ * bapi_uio_scan.h
+ *
+ */
+
+/**************************************************************************//**
+ * \file
+ * \brief This file declares board API interface functions that access all
+ * channels of the SPI UIO devices in bursts, one SPI transaction sequence per
+ * device, instead of one transaction per channel.
+ *
+ * They are used by the UIO scan engine of osExUIO. Boards that don't implement
+ * them keep the weak defaults, and the scan engine falls back to the per
+ * channel functions bapi_io_uio_getValue() and bapi_io_uio_setValue().
+ *****************************************************************************/
+
+#ifndef BAPI_UIO_SCAN_H_
+#define BAPI_UIO_SCAN_H_
+
+#include "baseplate.h"
+#include "boards/board-api/bapi_io.h"
+
+/**
+ * \ingroup bapi_io
+ * \brief Read the AI raw values and BI states of all UIO channels.
+ *
+ * @param aiRawValues  Receives the AI raw value of each channel.
+ * @param biStates     Receives the BI state of each channel.
+ * @param channelCount The number of channels, i.e. the array sizes.
+ *
+ * @return false if the board has no burst access.
+ */
+C_FUNC bool bapi_uio_scanChannels(uint16_t* aiRawValues, bool* biStates, unsigned channelCount);
+
+/**
+ * \ingroup bapi_io
+ * \brief Write the AO values of several UIO channels, grouped by device.
+ *
+ * @param values      The AO value of each channel. Only the channels in channelMask are used.
+ * @param channelMask Bit n set means channel n is written.
+ *
+ * @return false if the board has no burst access.
+ */
+C_FUNC bool bapi_uio_writeAOValues(const uint32_t* values, uint32_t channelMask);
+
+/**
+ * \ingroup bapi_io
+ * \brief The UIO channel index of the first channel of a UIO device.
+ *
+ * @return -1 if the device is unknown.
+ */
+C_FUNC int bapi_uio_getFirstChannel(spi_bus_idx_t spiBusIndex, spi_dev_idx_t spiDeviceIndex);
+
+/**
+ * \ingroup bapi_io
+ * \brief The SPI bus of a UIO channel. osExUIO locks the bus instead of all UIO devices.
+ *
+ * @return -1 if unknown. The channel then shares the lock of the first bus.
+ */
+C_FUNC int bapi_uio_getChannelBus(uint8_t uioPinIndex);
+
+#endif /* BAPI_UIO_SCAN_H_ */
@@ -0,0 +1,318 @@
+/*
+ *  $HeadURL: $
+ *
+ *  $Date: $
+ *  $Author: $
+ */
+
+/**
+ * \file
+ * \brief
+ * This file implements a throughput and latency benchmark for the osFlash API, and
+ * a power loss harness for program and erase commands.
+ *
+ * Both run on the simulated flash device of Driver_Flash_Sim.h, which is attached
+ * to the Driver_Flash layer via \ref driver_flash_attachSimulation. Hence
+ * the product_config.h must set ENABLE_FLASH_SIMULATION to 1.
+ *
+ * The latency of each command is the measured host time of the osFlash stack plus the
+ * modeled busy time of the simulated device. The results are printed as CSV lines:
+ *   - osFlash,<op>,<size>,<align>,<iterations>,<ops_per_s>,<p50_us>,<p90_us>,<p99_us>,<max_us>
+ *   - osFlash,<op>,<size>,<align>,0,skipped,,,,    if no command succeeded, e.g. a program
+ *     command that is not aligned with the program unit and OS_FLASH_FLASH_PROGRAM_BYTES is 0
+ *   - powerloss,<op>,<step>,<ok|FAIL>
+ * Caching or queuing changes of the flash stack should be judged by comparing these lines.
+ */
+
+#include "baseplate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rtos/cmsis-rtos-ext/osFlash.h"
+#include "cmsis-driver/Driver_Flash.h"
+#include "cmsis-driver/Driver_Flash_Sim.h"
+
+#if ENABLE_FLASH_SIMULATION > 0
+
+enum {
+  BENCH_ITERATIONS   = 200,
+  BENCH_SECTOR_SIZE  = 0x1000,
+  BENCH_SECTOR_COUNT = 256,
+  BENCH_PAGE_SIZE    = 256,
+  BENCH_PROGRAM_UNIT = 8,
+  BENCH_TIMEOUT      = 1000
+};
+
+STATIC const enum bapi_E_FlashDevice s_benchDevice = bapi_E_FlashDev0;
+
+/* Sizes and start address offsets (relative to the program unit) to be benchmarked. */
+STATIC const uint32_t s_benchSizes[] = { 1, 16, 256, 4096 };
+STATIC const uint32_t s_benchAlignments[] = { 0, 1, BENCH_PROGRAM_UNIT / 2 };
+
+STATIC uint8_t s_benchBuffer[4096 + BENCH_PROGRAM_UNIT];
+
+
+/**
+ * \brief Latency samples of one benchmark run in microseconds.
+ */
+struct bench_samples {
+  uint32_t usec[BENCH_ITERATIONS];
+  unsigned cnt;
+};
+
+STATIC int _benchCompareU32(const void* a, const void* b) {
+  const uint32_t x = *S_CAST(const uint32_t*, a);
+  const uint32_t y = *S_CAST(const uint32_t*, b);
+  return (x > y) - (x < y);
+}
+
+STATIC uint32_t _benchPercentile(const struct bench_samples* samples, unsigned percent) {
+  const unsigned index = (samples->cnt * percent + 99) / 100;
+  return samples->usec[index ? index - 1 : 0];
+}
+
+STATIC void _benchPrint(const char* op, uint32_t size, uint32_t align, struct bench_samples* samples) {
+  if(!samples->cnt) {
+    printf("osFlash,%s,%lu,%lu,0,skipped,,,,\n", op, S_CAST(unsigned long, size), S_CAST(unsigned long, align));
+    return;
+  }
+
+  qsort(samples->usec, samples->cnt, sizeof(samples->usec[0]), _benchCompareU32);
+
+  uint64_t usecTotal = 0;
+  for(unsigned i = 0; i < samples->cnt; i++) {
+    usecTotal += samples->usec[i];
+  }
+
+  const uint32_t opsPerSec = usecTotal ? S_CAST(uint32_t, (S_CAST(uint64_t, samples->cnt) * 1000000) / usecTotal) : 0;
+
+  printf("osFlash,%s,%lu,%lu,%u,%lu,%lu,%lu,%lu,%lu\n", op, S_CAST(unsigned long, size)
+    , S_CAST(unsigned long, align), samples->cnt, S_CAST(unsigned long, opsPerSec)
+    , S_CAST(unsigned long, _benchPercentile(samples, 50))
+    , S_CAST(unsigned long, _benchPercentile(samples, 90))
+    , S_CAST(unsigned long, _benchPercentile(samples, 99))
+    , S_CAST(unsigned long, samples->usec[samples->cnt - 1]));
+}
+
+/**
+ * \brief Start a latency measurement.
+ */
+STATIC uint64_t _benchStart(uint32_t* timerStart) {
+  struct driver_flash_sim_stats stats;
+  driver_flash_sim_getStatistics(s_benchDevice, &stats);
+  *timerStart = osKernelGetSysTimerCount();
+  return stats.usecBusy;
+}
+
+/**
+ * \brief Conclude a latency measurement: host time plus modeled device time.
+ */
+STATIC void _benchStop(struct bench_samples* samples, uint32_t timerStart, uint64_t usecBusyStart) {
+  const uint32_t ticks = osKernelGetSysTimerCount() - timerStart;
+
+  struct driver_flash_sim_stats stats;
+  driver_flash_sim_getStatistics(s_benchDevice, &stats);
+
+  const uint64_t usecHost = (S_CAST(uint64_t, ticks) * 1000000) / osKernelGetSysTimerFreq();
+  samples->usec[samples->cnt++] = S_CAST(uint32_t, usecHost + (stats.usecBusy - usecBusyStart));
+}
+
+STATIC bool _benchWait(osFlasDevicehHandle_t h) {
+  return osFlashWaitCommandComplete(h, BENCH_TIMEOUT).result == osOK;
+}
+
+STATIC osStatus_t _benchProgram(osFlasDevicehHandle_t h, uint32_t addr, const void* data, uint32_t bytesCnt) {
+#if OS_FLASH_FLASH_PROGRAM_BYTES
+  return osFlashProgramBytes(h, 0, addr, data, bytesCnt, BENCH_TIMEOUT);
+#else
+  if((addr % BENCH_PROGRAM_UNIT) || (bytesCnt % BENCH_PROGRAM_UNIT)) {
+    return osErrorParameter;
+  }
+  return osFlashProgramData(h, 0, addr, data,
+    osFlashProgramData_BytesToDataItemCount(h, 0, bytesCnt), BENCH_TIMEOUT);
+#endif
+}
+
+STATIC void _benchRead(osFlasDevicehHandle_t h, uint32_t size, uint32_t align) {
+  struct bench_samples samples = { {0}, 0 };
+  const uint32_t stride = (size + align + BENCH_PROGRAM_UNIT - 1) & ~(BENCH_PROGRAM_UNIT - 1);
+
+  for(unsigned i = 0; i < BENCH_ITERATIONS; i++) {
+    const uint32_t addr = ((i * stride) % (BENCH_SECTOR_SIZE * (BENCH_SECTOR_COUNT - 2))) + align;
+
+    uint32_t timerStart;
+    const uint64_t usecBusyStart = _benchStart(&timerStart);
+    const osStatus_t status = osFlashReadBytes(h, 0, addr, s_benchBuffer, size, BENCH_TIMEOUT);
+    if((status == osOK) && _benchWait(h)) {
+      _benchStop(&samples, timerStart, usecBusyStart);
+    }
+  }
+  _benchPrint("read_bytes", size, align, &samples);
+}
+
+STATIC void _benchProgramRun(osFlasDevicehHandle_t h, uint32_t size, uint32_t align) {
+  struct bench_samples samples = { {0}, 0 };
+  const uint32_t stride = (size + align + BENCH_PROGRAM_UNIT - 1) & ~(BENCH_PROGRAM_UNIT - 1);
+
+  /* The partition is erased outside of the measurement. */
+  if((osFlashErasePartition(h, 0, BENCH_TIMEOUT) != osOK) || !_benchWait(h)) {
+    return;
+  }
+
+  MEMSET(s_benchBuffer, 0x5a, sizeof(s_benchBuffer));
+
+  for(unsigned i = 0; i < BENCH_ITERATIONS; i++) {
+    const uint32_t addr = i * stride + align;
+
+    uint32_t timerStart;
+    const uint64_t usecBusyStart = _benchStart(&timerStart);
+    const osStatus_t status = _benchProgram(h, addr, s_benchBuffer, size);
+    if((status == osOK) && _benchWait(h)) {
+      _benchStop(&samples, timerStart, usecBusyStart);
+    }
+  }
+  _benchPrint("program_bytes", size, align, &samples);
+}
+
+STATIC void _benchEraseSector(osFlasDevicehHandle_t h) {
+  struct bench_samples samples = { {0}, 0 };
+
+  for(unsigned i = 0; i < BENCH_ITERATIONS; i++) {
+    const uint32_t addr = (i % BENCH_SECTOR_COUNT) * BENCH_SECTOR_SIZE;
+
+    uint32_t timerStart;
+    const uint64_t usecBusyStart = _benchStart(&timerStart);
+    const osStatus_t status = osFlashEraseSector(h, 0, addr, BENCH_TIMEOUT);
+    if((status == osOK) && _benchWait(h)) {
+      _benchStop(&samples, timerStart, usecBusyStart);
+    }
+  }
+  _benchPrint("erase_sector", BENCH_SECTOR_SIZE, 0, &samples);
+}
+
+/**
+ * \brief Lose the power while programming one page, in each possible program unit.
+ *
+ * After the loss, all program units before the interrupted one must be programmed
+ * completely, and all units after it must still be erased.
+ */
+STATIC unsigned _powerLossProgram(osFlasDevicehHandle_t h) {
+  const uint8_t* memory = driver_flash_sim_memory(s_benchDevice);
+  unsigned failures = 0;
+
+  MEMSET(s_benchBuffer, 0x00, BENCH_PAGE_SIZE);
+
+  for(uint32_t step = 1; step <= BENCH_PAGE_SIZE / BENCH_PROGRAM_UNIT; step++) {
+    driver_flash_sim_powerCycle(s_benchDevice);
+    osFlashEraseSector(h, 0, 0, BENCH_TIMEOUT);
+    _benchWait(h);
+
+    driver_flash_sim_schedulePowerLoss(s_benchDevice, step);
+    _benchProgram(h, 0, s_benchBuffer, BENCH_PAGE_SIZE);
+    const bool reportedError = !_benchWait(h);
+    const bool lost = driver_flash_sim_isPowerLost(s_benchDevice);
+    driver_flash_sim_powerCycle(s_benchDevice);
+
+    bool ok = reportedError && lost;
+    for(uint32_t i = 0; ok && (i < BENCH_PAGE_SIZE); i++) {
+      const uint32_t unit = i / BENCH_PROGRAM_UNIT + 1;
+      if(unit < step) {
+        ok = (memory[i] == 0x00);
+      } else if(unit > step) {
+        ok = (memory[i] == 0xff);
+      }
+    }
+
+    failures += ok ? 0 : 1;
+    printf("powerloss,program,%lu,%s\n", S_CAST(unsigned long, step), ok ? "ok" : "FAIL");
+  }
+  return failures;
+}
+
+/**
+ * \brief Lose the power while erasing a programmed sector.
+ *
+ * After the loss, the sector must neither be fully erased nor fully programmed,
+ * and the erase command must have reported the error.
+ */
+STATIC unsigned _powerLossErase(osFlasDevicehHandle_t h) {
+  const uint8_t* memory = driver_flash_sim_memory(s_benchDevice);
+  uint32_t erased = 0;
+
+  driver_flash_sim_powerCycle(s_benchDevice);
+  MEMSET(s_benchBuffer, 0x00, BENCH_PAGE_SIZE);
+  for(uint32_t addr = 0; addr < BENCH_SECTOR_SIZE; addr += BENCH_PAGE_SIZE) {
+    _benchProgram(h, addr, s_benchBuffer, BENCH_PAGE_SIZE);
+    _benchWait(h);
+  }
+
+  driver_flash_sim_schedulePowerLoss(s_benchDevice, 1);
+  osFlashEraseSector(h, 0, 0, BENCH_TIMEOUT);
+  const bool reportedError = !_benchWait(h);
+  const bool lost = driver_flash_sim_isPowerLost(s_benchDevice);
+  driver_flash_sim_powerCycle(s_benchDevice);
+
+  for(uint32_t i = 0; i < BENCH_SECTOR_SIZE; i++) {
+    erased += (memory[i] == 0xff) ? 1 : 0;
+  }
+
+  const bool ok = reportedError && lost && (erased > 0) && (erased < BENCH_SECTOR_SIZE);
+  printf("powerloss,erase_sector,1,%s\n", ok ? "ok" : "FAIL");
+  return ok ? 0 : 1;
+}
+
+int main(void) {
+  struct driver_flash_sim_config config;
+  MEMSET(&config, 0, sizeof(config));
+
+  config.info.sector_info  = 0; /* Uniform sectors */
+  config.info.sector_count = BENCH_SECTOR_COUNT;
+  config.info.sector_size  = BENCH_SECTOR_SIZE;
+  config.info.page_size    = BENCH_PAGE_SIZE;
+  config.info.program_unit = BENCH_PROGRAM_UNIT;
+  config.info.erased_value = 0xff;
+  config.dataWidth         = 0; /* 8 bit data items */
+
+  /* Typical serial NOR flash timings. */
+  config.timing.nsecReadPerByte    = 80;
+  config.timing.usecProgramSetup   = 10;
+  config.timing.usecProgramPerPage = 700;
+  config.timing.usecEraseSector    = 45000;
+  config.timing.usecEraseBlock     = 150000;
+
+  if(driver_flash_sim_configure(s_benchDevice, &config) != ARM_DRIVER_OK) {
+    printf("osFlash-bench: cannot configure the simulated flash\n");
+    return 1;
+  }
+
+  driver_flash_attachSimulation(s_benchDevice, driver_flash_sim_getDriver(s_benchDevice));
+  osFlashStartupInit();
+
+  osFlasDevicehHandle_t h = osFlashOpenDevice(s_benchDevice, BENCH_TIMEOUT);
+  if(!h) {
+    printf("osFlash-bench: cannot open the simulated flash\n");
+    return 1;
+  }
+
+  printf("osFlash,op,size,align,iterations,ops_per_s,p50_us,p90_us,p99_us,max_us\n");
+
+  for(unsigned s = 0; s < ARRAY_SIZE(s_benchSizes); s++) {
+    for(unsigned a = 0; a < ARRAY_SIZE(s_benchAlignments); a++) {
+      _benchProgramRun(h, s_benchSizes[s], s_benchAlignments[a]);
+      _benchRead(h, s_benchSizes[s], s_benchAlignments[a]);
+    }
+  }
+  _benchEraseSector(h);
+
+  const unsigned failures = _powerLossProgram(h) + _powerLossErase(h);
+
+  osFlashCloseDevice(h);
+  driver_flash_attachSimulation(s_benchDevice, 0);
+  driver_flash_sim_release(s_benchDevice);
+
+  return failures ? 1 : 0;
+}
+
+#endif /* #if ENABLE_FLASH_SIMULATION > 0 */
@@ -1006,8 +1006,28 @@ static const struct _FlashDriverArray s_devicesFlashDrivers[] = {
 #endif
 };
 
+/* ENABLE_FLASH_SIMULATION may be set to 0 or 1 by product_config.h */
+#if ENABLE_FLASH_SIMULATION > 0
+
+/* The simulated drivers that replace the partitions of a flash device. */
+STATIC const struct _ARM_DRIVER_FLASH* s_simulatedFlashDrivers[bapi_E_FlashDevCount];
+
+void driver_flash_attachSimulation(enum bapi_E_FlashDevice flashDeviceIndex,
+  const struct _ARM_DRIVER_FLASH* driver) {
+  if(flashDeviceIndex < bapi_E_FlashDevCount) {
+    atomic_PtrReplace(const struct _ARM_DRIVER_FLASH*, &s_simulatedFlashDrivers[flashDeviceIndex], driver);
+  }
+}
+
+#endif /* #if ENABLE_FLASH_SIMULATION > 0 */
+
 const struct _ARM_DRIVER_FLASH* driver_flash_getDriver(enum bapi_E_FlashDevice flashDeviceIndex, unsigned partitionIndex) {
   if(flashDeviceIndex < bapi_E_FlashDevCount) {
+#if ENABLE_FLASH_SIMULATION > 0
+    if(s_simulatedFlashDrivers[flashDeviceIndex]) {
+      return (partitionIndex == 0) ? s_simulatedFlashDrivers[flashDeviceIndex] : 0;
+    }
+#endif
     if(partitionIndex < s_devicesFlashDrivers[flashDeviceIndex].m_numDrivers ) {
       return s_devicesFlashDrivers[flashDeviceIndex].m_driver[partitionIndex];
     }
@@ -1018,6 +1038,11 @@ const struct _ARM_DRIVER_FLASH* driver_flash_getDriver(enum bapi_E_FlashDevice f
 
 unsigned driver_flash_getPartitionCount(enum bapi_E_FlashDevice flashDeviceIndex) {
   if(flashDeviceIndex < bapi_E_FlashDevCount) {
+#if ENABLE_FLASH_SIMULATION > 0
+    if(s_simulatedFlashDrivers[flashDeviceIndex]) {
+      return 1;
+    }
+#endif
     return s_devicesFlashDrivers[flashDeviceIndex].m_numDrivers;
   }
   return 0;
@@ -427,6 +427,27 @@ C_INLINE uint32_t  driver_flash_calculateBlockSize(ARM_FLASH_INFO* flashInfo, ui
 C_FUNC unsigned driver_flash_getPartitionCount(enum bapi_E_FlashDevice flashDeviceIndex);
 
 
+/* ENABLE_FLASH_SIMULATION may be set to 0 or 1 in product_config.h */
+#if ENABLE_FLASH_SIMULATION > 0
+
+/**
+ * \brief
+ * Replace the partitions of a flash device by a simulated flash driver.
+ *
+ * After this call, \ref driver_flash_getDriver returns the given driver as the
+ * only partition of the flash device, so that the osFlash API operates on it.
+ * This is intended for benchmarks and fault injection on the host, refer to
+ * Driver_Flash_Sim.h.
+ *
+ * @param[in] flashDeviceIndex The flash device to replace.
+ * @param[in] driver           The simulated driver. Null restores the real partitions.
+ */
+C_FUNC void driver_flash_attachSimulation(enum bapi_E_FlashDevice flashDeviceIndex,
+  const struct _ARM_DRIVER_FLASH* driver);
+
+#endif /* #if ENABLE_FLASH_SIMULATION > 0 */
+
+
 enum {_FLASH_PARTITION_SIZE_UNIT=0x0400}; /* Partitions size in kilobytes (1Kbyte = 1024 bytes)*/
 typedef uint16_t _flash_partition_size_t;
 
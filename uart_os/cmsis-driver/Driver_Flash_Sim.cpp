@@ -0,0 +1,579 @@
+/*
+ *  $HeadURL: $
+ *
+ *  $Date: $
+ *  $Author: $
+ */
+
+
+/**
+ * /file
+ * /brief This file implements a RAM backed flash simulation that provides the
+ * cmsis-driver API for FLASH. Refer to Driver_Flash_Sim.h.
+ */
+
+
+#include "baseplate.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "boards/board-api/bapi_flash.h"
+#include "boards/board-api/bapi_atomic.h"
+#include "Driver_Flash_Sim.h"
+
+#if (BAPI_HAS_FLASH_DEVICE > 0)
+
+#define ARM_FLASH_SIM_DRV_VERSION    ARM_DRIVER_VERSION_MAJOR_MINOR(1, 0)  /* driver version */
+
+
+namespace Driver_FLASH_SIM {
+
+/**
+ * \ingroup _cmsis_driver_flash
+ * \brief Driver Version of the flash simulation
+ */
+STATIC const ARM_DRIVER_VERSION driverVersion = {
+    ARM_FLASH_API_VERSION,
+    ARM_FLASH_SIM_DRV_VERSION
+};
+
+
+/**
+ * \ingroup _cmsis_driver_flash
+ * \brief
+ *
+ * This class implements the API functions defined by the \ref struct _ARM_DRIVER_FLASH
+ *   on a RAM buffer for a single simulated flash device.
+ */
+class SimulatedFlash
+{
+  struct driver_flash_sim_config m_config;
+  struct driver_flash_sim_stats  m_stats;
+  ARM_Flash_SignalEvent_t m_eventCallback;
+  ARM_FLASH_STATUS        m_flashStatus;
+  uint8_t*                m_memory;
+  uint32_t                m_size;
+  uint32_t                m_stepsUntilLoss; /**< 0 if no power loss is scheduled. */
+  bool                    m_powerLost;
+
+  /**
+   * \brief Account a modeled busy time and signal the completion of a command.
+   */
+  int32_t complete(enum bapi_flash_E_Command_ID_ flashCommandID, uint32_t usecBusy, int32_t armDriverState) {
+    m_stats.usecLastCommand = usecBusy;
+    m_stats.usecBusy += usecBusy;
+    m_flashStatus.error = (armDriverState != ARM_DRIVER_OK);
+
+    if(m_eventCallback) {
+      uint32_t event = armDriverState == ARM_DRIVER_OK ? ARM_FLASH_EVENT_READY : (ARM_FLASH_EVENT_ERROR | ARM_FLASH_EVENT_READY);
+      m_eventCallback(flashDeviceIndex(), flashCommandID, event);
+    }
+    return armDriverState;
+  }
+
+  /**
+   * \brief Count down one step of a scheduled power loss.
+   * \return true if the power is lost during this step.
+   */
+  bool powerLostDuringStep() {
+    if(m_stepsUntilLoss) {
+      if(--m_stepsUntilLoss == 0) {
+        m_powerLost = true;
+      }
+    }
+    return m_powerLost;
+  }
+
+  /**
+   * \brief Checks that bytesCnt bytes from addr lie within the simulated device.
+   * Computed in 64 bit, so that neither the item count conversion nor the sum wraps around.
+   */
+  bool isInside(uint32_t addr, uint64_t bytesCnt) const {
+    return (S_CAST(uint64_t, addr) + bytesCnt) <= m_size;
+  }
+
+  /**
+   * \brief Find the sector that contains addr.
+   * \return The start address of the sector. The size is returned via sectorSize.
+   */
+  uint32_t sectorAt(uint32_t addr, uint32_t* sectorSize) const {
+    const ARM_FLASH_INFO* info = &m_config.info;
+
+    if(ARM_Flash_hasUniformSectors(info)) {
+      *sectorSize = info->sector_size;
+      return addr - (addr % info->sector_size);
+    }
+
+    uint32_t start = 0;
+    for(uint32_t i = 0; i < info->sector_count; i++) {
+      const uint32_t size = bapi_flash_sizeOfSectors(info, i, 1);
+      if(addr < start + size) {
+        *sectorSize = size;
+        return start;
+      }
+      start += size;
+    }
+    *sectorSize = 0;
+    return start;
+  }
+
+  /**
+   * \brief Erase a region as a single step of a scheduled power loss.
+   */
+  int32_t eraseRegion(uint32_t start, uint32_t size) {
+    if(powerLostDuringStep()) {
+      /* The power got lost in the middle of the erase cycle. */
+      MEMSET(&m_memory[start], m_config.info.erased_value, size / 2);
+      return ARM_DRIVER_ERROR;
+    }
+    MEMSET(&m_memory[start], m_config.info.erased_value, size);
+    return ARM_DRIVER_OK;
+  }
+
+public:
+  SimulatedFlash() : m_eventCallback(0), m_memory(0), m_size(0), m_stepsUntilLoss(0), m_powerLost(false) {
+    MEMSET(&m_config, 0, sizeof(m_config));
+    MEMSET(&m_stats, 0, sizeof(m_stats));
+    MEMSET(&m_flashStatus, 0, sizeof(m_flashStatus));
+  }
+
+  enum bapi_E_FlashDevice flashDeviceIndex() const;
+
+  int32_t Configure(const struct driver_flash_sim_config* config) {
+    if((!config) || (!config->info.sector_count) || (!config->info.program_unit)
+      || (config->info.page_size % config->info.program_unit)) {
+      return ARM_DRIVER_ERROR_PARAMETER;
+    }
+
+    Release();
+    m_config = *config;
+
+    m_size = driver_flash_calculateSize(&m_config.info);
+    m_memory = S_CAST(uint8_t*, malloc(m_size));
+    if(!m_memory) {
+      m_size = 0;
+      return ARM_DRIVER_ERROR;
+    }
+
+    MEMSET(m_memory, m_config.info.erased_value, m_size);
+    MEMSET(&m_stats, 0, sizeof(m_stats));
+    m_stepsUntilLoss = 0;
+    m_powerLost = false;
+    return ARM_DRIVER_OK;
+  }
+
+  void Release() {
+    free(m_memory);
+    m_memory = 0;
+    m_size = 0;
+  }
+
+  uint8_t* Memory() {
+    return m_memory;
+  }
+
+  void GetStatistics(struct driver_flash_sim_stats* stats) {
+    bapi_irq_enterCritical();
+    *stats = m_stats;
+    bapi_irq_exitCritical();
+  }
+
+  void ResetStatistics() {
+    bapi_irq_enterCritical();
+    MEMSET(&m_stats, 0, sizeof(m_stats));
+    bapi_irq_exitCritical();
+  }
+
+  void SchedulePowerLoss(uint32_t stepsUntilLoss) {
+    m_stepsUntilLoss = stepsUntilLoss;
+  }
+
+  bool IsPowerLost() const {
+    return m_powerLost;
+  }
+
+  void PowerCycle() {
+    m_stepsUntilLoss = 0;
+    m_powerLost = false;
+    m_flashStatus.error = 0;
+  }
+
+  /**
+   * \brief Implements function \ref struct _ARM_DRIVER_FLASH.GetCapabilities().
+   */
+  ARM_FLASH_CAPABILITIES GetCapabilities(void) const {
+    ARM_FLASH_CAPABILITIES capabilities;
+    MEMSET(&capabilities, 0, sizeof(capabilities));
+    capabilities.event_ready = 1;
+    capabilities.data_width  = m_config.dataWidth;
+    capabilities.erase_chip  = 1;
+    return capabilities;
+  }
+
+  int32_t Initialize(ARM_Flash_SignalEvent_t cb_event) {
+    if(!m_memory) {
+      return ARM_DRIVER_ERROR;
+    }
+    atomic_PtrReplace(ARM_Flash_SignalEvent_t, &m_eventCallback, cb_event);
+    return ARM_DRIVER_OK;
+  }
+
+  int32_t Uninitialize(void) {
+    atomic_PtrReplace(ARM_Flash_SignalEvent_t, &m_eventCallback, S_CAST(ARM_Flash_SignalEvent_t, 0));
+    return ARM_DRIVER_OK;
+  }
+
+  int32_t PowerControl(ARM_POWER_STATE UNUSED(state)) const {
+    return ARM_DRIVER_ERROR_UNSUPPORTED;
+  }
+
+  /**
+   * \brief Read data items from the simulated flash.
+   * \param  addr is relative to the simulated device
+   * \param  data pointer contains the buffer for the data
+   * \param  cnt  number of data items to read
+   * \return status code.
+   */
+  int32_t ReadData(uint32_t addr, void *data, uint32_t cnt) {
+    const uint64_t bytesCnt64 = S_CAST(uint64_t, cnt) * ARM_Flash_capabilitiesToDataWidthInBytes(GetCapabilities());
+
+    if(m_powerLost) {
+      return complete(bapi_flash_CMDID_ReadData, 0, ARM_DRIVER_ERROR);
+    }
+    if(!isInside(addr, bytesCnt64)) {
+      return complete(bapi_flash_CMDID_ReadData, 0, ARM_DRIVER_ERROR_PARAMETER);
+    }
+
+    const uint32_t bytesCnt = S_CAST(uint32_t, bytesCnt64);
+
+    MEMCPY(data, &m_memory[addr], bytesCnt);
+
+    m_stats.readCnt++;
+    m_stats.bytesRead += bytesCnt;
+    return complete(bapi_flash_CMDID_ReadData,
+      S_CAST(uint32_t, (S_CAST(uint64_t, bytesCnt) * m_config.timing.nsecReadPerByte) / 1000), ARM_DRIVER_OK);
+  }
+
+  /**
+   * \brief Program data items to the simulated flash.
+   * \param  addr is relative to the simulated device and aligned with the program unit
+   * \param  data pointer contains the buffer for the data to write
+   * \param  cnt  number of data items to write
+   * \return status code.
+   */
+  int32_t ProgramData(uint32_t addr, const void *data, uint32_t cnt) {
+    const uint32_t programUnit = m_config.info.program_unit;
+    const uint64_t bytesCnt64 = S_CAST(uint64_t, cnt) * ARM_Flash_capabilitiesToDataWidthInBytes(GetCapabilities());
+
+    if(m_powerLost) {
+      return complete(bapi_flash_CMDID_ProgramData, 0, ARM_DRIVER_ERROR);
+    }
+    if((!isInside(addr, bytesCnt64)) || (addr % programUnit) || (bytesCnt64 % programUnit)) {
+      return complete(bapi_flash_CMDID_ProgramData, 0, ARM_DRIVER_ERROR_PARAMETER);
+    }
+
+    const uint32_t bytesCnt = S_CAST(uint32_t, bytesCnt64);
+
+    const uint8_t* src = S_CAST(const uint8_t*, data);
+    int32_t result = ARM_DRIVER_OK;
+    uint32_t programmed = 0;
+
+    while((programmed < bytesCnt) && (result == ARM_DRIVER_OK)) {
+      /* The power is lost in the middle of a program unit. So only the first half gets programmed. */
+      const uint32_t unitBytes = powerLostDuringStep() ? programUnit / 2 : programUnit;
+
+      for(uint32_t i = 0; i < unitBytes; i++) {
+        m_memory[addr + programmed + i] &= src[programmed + i];
+      }
+
+      if(unitBytes != programUnit) {
+        result = ARM_DRIVER_ERROR;
+      }
+      programmed += unitBytes;
+    }
+
+    const uint32_t pageSize = m_config.info.page_size ? m_config.info.page_size : programUnit;
+    const uint32_t pages = (programmed + pageSize - 1) / pageSize;
+
+    m_stats.programCnt++;
+    m_stats.bytesProgrammed += programmed;
+    return complete(bapi_flash_CMDID_ProgramData,
+      m_config.timing.usecProgramSetup + pages * m_config.timing.usecProgramPerPage, result);
+  }
+
+  /**
+   * \brief Erase the sector that starts at addr.
+   */
+  int32_t EraseSector(uint32_t addr) {
+    uint32_t sectorSize = 0;
+    const uint32_t start = sectorAt(addr, &sectorSize);
+
+    if(m_powerLost) {
+      return complete(bapi_flash_CMDID_EraseSector, 0, ARM_DRIVER_ERROR);
+    }
+    if((addr >= m_size) || (start != addr)) {
+      return complete(bapi_flash_CMDID_EraseSector, 0, ARM_DRIVER_ERROR_PARAMETER);
+    }
+
+    m_stats.eraseCnt++;
+    return complete(bapi_flash_CMDID_EraseSector, m_config.timing.usecEraseSector, eraseRegion(start, sectorSize));
+  }
+
+  /**
+   * \brief Erase the block that starts at addr.
+   */
+  int32_t EraseBlock(uint32_t addr) {
+    if(m_powerLost) {
+      return complete(bapi_flash_CMDID_EraseBlock, 0, ARM_DRIVER_ERROR);
+    }
+
+    const uint32_t blockSize = (addr < m_size) ? driver_flash_calculateBlockSize(&m_config.info, addr) : 0;
+    if((!blockSize) || (addr % blockSize) || (!isInside(addr, blockSize))) {
+      return complete(bapi_flash_CMDID_EraseBlock, 0, ARM_DRIVER_ERROR_PARAMETER);
+    }
+
+    m_stats.eraseCnt++;
+    return complete(bapi_flash_CMDID_EraseBlock, m_config.timing.usecEraseBlock, eraseRegion(addr, blockSize));
+  }
+
+  /**
+   * \brief Erase all sectors one by one, so that a power loss can hit any of them.
+   */
+  int32_t EraseChip(void) {
+    if(m_powerLost) {
+      return complete(bapi_flash_CMDID_EraseSector, 0, ARM_DRIVER_ERROR);
+    }
+
+    int32_t result = ARM_DRIVER_OK;
+    uint32_t usecBusy = 0;
+    uint32_t addr = 0;
+
+    while((addr < m_size) && (result == ARM_DRIVER_OK)) {
+      uint32_t sectorSize = 0;
+      sectorAt(addr, &sectorSize);
+      result = eraseRegion(addr, sectorSize);
+      usecBusy += m_config.timing.usecEraseSector;
+      m_stats.eraseCnt++;
+      addr += sectorSize;
+    }
+
+    return complete(bapi_flash_CMDID_EraseSector, usecBusy, result);
+  }
+
+  ARM_FLASH_STATUS GetStatus(void) {
+    bapi_irq_enterCritical();
+    m_flashStatus.busy = 0; /* Commands complete synchronously. */
+    ARM_FLASH_STATUS retval = m_flashStatus;
+    bapi_irq_exitCritical();
+    return retval;
+  }
+
+  ARM_FLASH_INFO *GetInfo(void) {
+    return &m_config.info;
+  }
+
+  int32_t Unsupported() const {
+    return ARM_DRIVER_ERROR_UNSUPPORTED;
+  }
+};
+
+STATIC SimulatedFlash s_simulatedFlash[bapi_E_FlashDevCount];
+
+enum bapi_E_FlashDevice SimulatedFlash::flashDeviceIndex() const {
+  return S_CAST(enum bapi_E_FlashDevice, this - s_simulatedFlash);
+}
+
+} /* namespace Driver_FLASH_SIM */
+
+
+/**
+ * \ingroup ARM_FLASH_GetVersion
+ * \brief Get ARM driver version function of the flash simulation
+ */
+STATIC ARM_DRIVER_VERSION ARM_FLASH_SIM_GetVersion(void)
+{
+  return Driver_FLASH_SIM::driverVersion;
+}
+
+/**
+ * \ingroup _cmsis_driver_flash
+ * \brief template class for the FLASH API of a simulated flash device
+ */
+template<enum bapi_E_FlashDevice flashDeviceIndex> struct ARM_FLASH_SIM
+{
+  static Driver_FLASH_SIM::SimulatedFlash& sim() {
+    return Driver_FLASH_SIM::s_simulatedFlash[flashDeviceIndex];
+  }
+
+  static ARM_FLASH_CAPABILITIES GetCapabilities(void) {
+    return sim().GetCapabilities();
+  }
+
+  static int32_t Initialize(ARM_Flash_SignalEvent_t cb_event) {
+    return sim().Initialize(cb_event);
+  }
+
+  static int32_t Uninitialize(void) {
+    return sim().Uninitialize();
+  }
+
+  static int32_t PowerControl(ARM_POWER_STATE state) {
+    return sim().PowerControl(state);
+  }
+
+  static int32_t ReadData(uint32_t addr, void *data, uint32_t cnt) {
+    return sim().ReadData(addr, data, cnt);
+  }
+
+  static int32_t ProgramData(uint32_t addr, const void *data, uint32_t cnt) {
+    return sim().ProgramData(addr, data, cnt);
+  }
+
+  static int32_t EraseBlock(uint32_t addr) {
+    return sim().EraseBlock(addr);
+  }
+
+  static int32_t EraseSector(uint32_t addr) {
+    return sim().EraseSector(addr);
+  }
+
+  static int32_t EraseChip(void) {
+    return sim().EraseChip();
+  }
+
+  static ARM_FLASH_STATUS GetStatus(void) {
+    return sim().GetStatus();
+  }
+
+  static ARM_FLASH_INFO *GetInfo(void) {
+    return sim().GetInfo();
+  }
+
+  static enum bapi_E_FlashDevice GetFlashDeviceIndex(void) {
+    return flashDeviceIndex;
+  }
+
+  static uint32_t BaseAddress(void) {
+    return 0;
+  }
+
+  static int32_t EnableProtection(void) {
+    return sim().Unsupported();
+  }
+
+  static int32_t DisableProtection(void) {
+    return sim().Unsupported();
+  }
+
+  static int32_t ReadSectorLockdown(uint8_t* UNUSED(buffer), unsigned UNUSED(bufferSize)) {
+    return sim().Unsupported();
+  }
+
+  static int32_t ReadSectorProtection(uint8_t* UNUSED(buffer), unsigned UNUSED(bufferSize)) {
+    return sim().Unsupported();
+  }
+
+  static int32_t FreezeSectorLockdown() {
+    return sim().Unsupported();
+  }
+
+  static const struct _ARM_DRIVER_FLASH ms_driver;
+};
+
+template<enum bapi_E_FlashDevice flashDeviceIndex> const struct _ARM_DRIVER_FLASH
+  ARM_FLASH_SIM<flashDeviceIndex>::ms_driver = {
+     ARM_FLASH_SIM_GetVersion
+  ,  ARM_FLASH_SIM<flashDeviceIndex>::GetCapabilities
+  ,  ARM_FLASH_SIM<flashDeviceIndex>::Initialize
+  ,  ARM_FLASH_SIM<flashDeviceIndex>::Uninitialize
+  ,  ARM_FLASH_SIM<flashDeviceIndex>::PowerControl
+  ,  ARM_FLASH_SIM<flashDeviceIndex>::ReadData
+  ,  ARM_FLASH_SIM<flashDeviceIndex>::ProgramData
+  ,  ARM_FLASH_SIM<flashDeviceIndex>::EraseBlock
+  ,  ARM_FLASH_SIM<flashDeviceIndex>::EraseSector
+  ,  ARM_FLASH_SIM<flashDeviceIndex>::EraseChip
+  ,  ARM_FLASH_SIM<flashDeviceIndex>::GetStatus
+  ,  ARM_FLASH_SIM<flashDeviceIndex>::GetInfo
+  ,  ARM_FLASH_SIM<flashDeviceIndex>::GetFlashDeviceIndex
+  ,  ARM_FLASH_SIM<flashDeviceIndex>::BaseAddress
+  ,  ARM_FLASH_SIM<flashDeviceIndex>::EnableProtection
+  ,  ARM_FLASH_SIM<flashDeviceIndex>::DisableProtection
+  ,  ARM_FLASH_SIM<flashDeviceIndex>::ReadSectorLockdown
+  ,  ARM_FLASH_SIM<flashDeviceIndex>::ReadSectorProtection
+  ,  ARM_FLASH_SIM<flashDeviceIndex>::FreezeSectorLockdown
+};
+
+STATIC const struct _ARM_DRIVER_FLASH* const s_simulatedFlashDrivers[bapi_E_FlashDevCount] = {
+   &ARM_FLASH_SIM<bapi_E_FlashDev0>::ms_driver
+#if (BAPI_HAS_FLASH_DEVICE > 1)
+  ,&ARM_FLASH_SIM<bapi_E_FlashDev1>::ms_driver
+#endif
+#if (BAPI_HAS_FLASH_DEVICE > 2)
+  ,&ARM_FLASH_SIM<bapi_E_FlashDev2>::ms_driver
+#endif
+#if (BAPI_HAS_FLASH_DEVICE > 3)
+  ,&ARM_FLASH_SIM<bapi_E_FlashDev3>::ms_driver
+#endif
+#if (BAPI_HAS_FLASH_DEVICE > 4)
+#error "Too many flash devices defined, please enhance to the scheme above"
+#endif
+};
+
+
+int32_t driver_flash_sim_configure(enum bapi_E_FlashDevice flashDeviceIndex,
+  const struct driver_flash_sim_config* config) {
+  if(flashDeviceIndex < bapi_E_FlashDevCount) {
+    return Driver_FLASH_SIM::s_simulatedFlash[flashDeviceIndex].Configure(config);
+  }
+  return ARM_DRIVER_ERROR_PARAMETER;
+}
+
+void driver_flash_sim_release(enum bapi_E_FlashDevice flashDeviceIndex) {
+  if(flashDeviceIndex < bapi_E_FlashDevCount) {
+    Driver_FLASH_SIM::s_simulatedFlash[flashDeviceIndex].Release();
+  }
+}
+
+const struct _ARM_DRIVER_FLASH* driver_flash_sim_getDriver(enum bapi_E_FlashDevice flashDeviceIndex) {
+  if(flashDeviceIndex < bapi_E_FlashDevCount) {
+    return s_simulatedFlashDrivers[flashDeviceIndex];
+  }
+  return 0;
+}
+
+uint8_t* driver_flash_sim_memory(enum bapi_E_FlashDevice flashDeviceIndex) {
+  if(flashDeviceIndex < bapi_E_FlashDevCount) {
+    return Driver_FLASH_SIM::s_simulatedFlash[flashDeviceIndex].Memory();
+  }
+  return 0;
+}
+
+void driver_flash_sim_getStatistics(enum bapi_E_FlashDevice flashDeviceIndex,
+  struct driver_flash_sim_stats* stats) {
+  ASSERT(flashDeviceIndex < bapi_E_FlashDevCount);
+  Driver_FLASH_SIM::s_simulatedFlash[flashDeviceIndex].GetStatistics(stats);
+}
+
+void driver_flash_sim_resetStatistics(enum bapi_E_FlashDevice flashDeviceIndex) {
+  ASSERT(flashDeviceIndex < bapi_E_FlashDevCount);
+  Driver_FLASH_SIM::s_simulatedFlash[flashDeviceIndex].ResetStatistics();
+}
+
+void driver_flash_sim_schedulePowerLoss(enum bapi_E_FlashDevice flashDeviceIndex,
+  uint32_t stepsUntilLoss) {
+  ASSERT(flashDeviceIndex < bapi_E_FlashDevCount);
+  Driver_FLASH_SIM::s_simulatedFlash[flashDeviceIndex].SchedulePowerLoss(stepsUntilLoss);
+}
+
+bool driver_flash_sim_isPowerLost(enum bapi_E_FlashDevice flashDeviceIndex) {
+  ASSERT(flashDeviceIndex < bapi_E_FlashDevCount);
+  return Driver_FLASH_SIM::s_simulatedFlash[flashDeviceIndex].IsPowerLost();
+}
+
+void driver_flash_sim_powerCycle(enum bapi_E_FlashDevice flashDeviceIndex) {
+  ASSERT(flashDeviceIndex < bapi_E_FlashDevCount);
+  Driver_FLASH_SIM::s_simulatedFlash[flashDeviceIndex].PowerCycle();
+}
+
+#endif /* (BAPI_HAS_FLASH_DEVICE > 0) */
@@ -0,0 +1,151 @@
+/*
+ *  $HeadURL: $
+ *
+ *  $Date: $
+ *  $Author: $
+ */
+
+#ifndef __CMSIS_DRIVER_FLASH_SIM_H
+#define __CMSIS_DRIVER_FLASH_SIM_H
+
+#include "baseplate.h"
+#include "Driver_Flash.h"
+
+
+/**
+ * \file
+ * \brief
+ * This file declares a RAM backed flash simulation that provides the standard
+ * \ref struct _ARM_DRIVER_FLASH interface. It is used to measure the throughput
+ * and latency of the osFlash / Driver_Flash stack without real flash hardware,
+ * and to inject power losses at arbitrary points of program and erase commands.
+ *
+ * The simulated flash behaves like a NOR flash:
+ *   - programming can only clear bits (the new content is old content AND data).
+ *   - erasing sets all bytes of a sector or block to the erased value.
+ *
+ * All commands complete before the driver function returns, and the
+ * ARM_FLASH_EVENT_READY event is signaled from within the driver function. The
+ * configured timings are not waited for. They are accumulated as modeled device
+ * busy time instead. Refer to \ref driver_flash_sim_getStatistics.
+ */
+
+
+/**
+ * \addtogroup cmsis_driver_flash
+ */
+/**@{*/
+
+/**
+ * \brief Modeled timings of the simulated flash device.
+ */
+struct driver_flash_sim_timing {
+  uint32_t nsecReadPerByte;       /**< Read time per byte in nanoseconds. */
+  uint32_t usecProgramSetup;      /**< Time for each program command, independent of its size. */
+  uint32_t usecProgramPerPage;    /**< Time to program one page (page_size bytes). */
+  uint32_t usecEraseSector;       /**< Time to erase one sector. */
+  uint32_t usecEraseBlock;        /**< Time to erase one block. */
+};
+
+/**
+ * \brief Configuration of a simulated flash device.
+ *
+ * The member info carries the sector map in the same way as it is provided by
+ * a physical flash device. Uniform sectors are configured by setting sector_info to 0
+ * and sector_size to the size of each sector. Non uniform sectors are configured
+ * by providing sector_info and sector_info_count.
+ */
+struct driver_flash_sim_config {
+  ARM_FLASH_INFO info;                   /**< Sector map, page size, program unit and erased value. */
+  uint8_t dataWidth;                     /**< Data width as encoded in ARM_FLASH_CAPABILITIES.data_width. */
+  struct driver_flash_sim_timing timing; /**< The modeled timings. */
+};
+
+/**
+ * \brief Counters of a simulated flash device.
+ */
+struct driver_flash_sim_stats {
+  uint64_t usecBusy;         /**< The accumulated modeled busy time of all commands. */
+  uint32_t usecLastCommand;  /**< The modeled busy time of the last command. */
+  uint32_t readCnt;          /**< The number of read commands. */
+  uint32_t programCnt;       /**< The number of program commands. */
+  uint32_t eraseCnt;         /**< The number of sector and block erase commands. */
+  uint32_t bytesRead;        /**< The number of bytes read. */
+  uint32_t bytesProgrammed;  /**< The number of bytes programmed. */
+};
+
+
+/**
+ * \brief Configure a simulated flash device and allocate its memory.
+ *
+ * The whole memory is set to the erased value. A previous configuration of the
+ * same device is released before.
+ *
+ * @param[in] flashDeviceIndex The flash device to simulate.
+ * @param[in] config           The configuration. The sector_info array it refers to
+ *   must stay valid as long as the simulated device is used.
+ * @return ARM_DRIVER_OK on success. ARM_DRIVER_ERROR_PARAMETER if the configuration
+ *   is invalid. ARM_DRIVER_ERROR if the memory could not be allocated.
+ */
+C_FUNC int32_t driver_flash_sim_configure(enum bapi_E_FlashDevice flashDeviceIndex,
+  const struct driver_flash_sim_config* config);
+
+/**
+ * \brief Release the memory of a simulated flash device.
+ */
+C_FUNC void driver_flash_sim_release(enum bapi_E_FlashDevice flashDeviceIndex);
+
+/**
+ * \brief Obtain the CMSIS driver structure of a simulated flash device.
+ *
+ * The returned driver can be attached to the Driver_Flash layer by
+ * \ref driver_flash_attachSimulation, so that the osFlash API operates on it.
+ */
+C_FUNC const struct _ARM_DRIVER_FLASH* driver_flash_sim_getDriver(enum bapi_E_FlashDevice flashDeviceIndex);
+
+/**
+ * \brief Direct access to the simulated flash memory, e.g. to preload or verify contents.
+ * @return The memory, or null if the device is not configured.
+ */
+C_FUNC uint8_t* driver_flash_sim_memory(enum bapi_E_FlashDevice flashDeviceIndex);
+
+/**
+ * \brief Copy the counters of a simulated flash device.
+ */
+C_FUNC void driver_flash_sim_getStatistics(enum bapi_E_FlashDevice flashDeviceIndex,
+  struct driver_flash_sim_stats* stats);
+
+/**
+ * \brief Reset the counters of a simulated flash device.
+ */
+C_FUNC void driver_flash_sim_resetStatistics(enum bapi_E_FlashDevice flashDeviceIndex);
+
+/**
+ * \brief Schedule a power loss.
+ *
+ * Each programmed program unit and each erased sector or block counts as one step.
+ * The power is lost while the given step is executed: A program unit is left half
+ * programmed, a sector or block is left half erased. The command signals
+ * ARM_FLASH_EVENT_ERROR, and all subsequent commands fail until
+ * \ref driver_flash_sim_powerCycle is called.
+ *
+ * @param[in] flashDeviceIndex The simulated flash device.
+ * @param[in] stepsUntilLoss   The step (counting from 1) during which the power is lost.
+ *   0 cancels a scheduled power loss.
+ */
+C_FUNC void driver_flash_sim_schedulePowerLoss(enum bapi_E_FlashDevice flashDeviceIndex,
+  uint32_t stepsUntilLoss);
+
+/**
+ * \brief Query if a simulated flash device has lost its power.
+ */
+C_FUNC bool driver_flash_sim_isPowerLost(enum bapi_E_FlashDevice flashDeviceIndex);
+
+/**
+ * \brief Restore the power of a simulated flash device. The memory contents are kept.
+ */
+C_FUNC void driver_flash_sim_powerCycle(enum bapi_E_FlashDevice flashDeviceIndex);
+
+/**@} cmsis_driver_flash */
+
+#endif /* __CMSIS_DRIVER_FLASH_SIM_H */
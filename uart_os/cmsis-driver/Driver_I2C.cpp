@@ -16,6 +16,7 @@
 #include "baseplate.h"
 
 #include "boards/board-api/bapi_i2c.h"
+#include "boards/board-api/bapi_i2c_async.h"
 #include "cmsis-driver/Driver_I2C.h"
 #include "fsl_i2c.h"
 //#include "fsl_i2c_master_driver.h" //  We will use only I2c master in all the boards supported by BSP
@@ -46,6 +47,98 @@ namespace Driver_I2C {
  */
 namespace _driver_ARM_I2C {
 
+/**
+ * \ingroup _cmsis_driver_i2c
+ * \brief The state of the master transfer of an I2C.
+ */
+typedef struct _i2c_TransferState {
+  ARM_I2C_SignalEvent_t m_cbEvent;  /**< The callback that was registered by Initialize(). */
+  volatile bool m_busy;             /**< A transfer is running. */
+  volatile bool m_async;            /**< The running transfer is driven by the board in the background. */
+  volatile bool m_receiver;         /**< The running transfer is a MasterReceive(). */
+  uint32_t m_num;                   /**< The requested size of the last transfer. */
+  volatile int32_t m_dataCount;     /**< The bytes transferred by the last finished transfer. */
+  volatile uint32_t m_lastEvent;    /**< The events of the last finished transfer. */
+} _i2c_TransferState;
+
+STATIC _i2c_TransferState s_i2cTransferState[bapi_E_I2cCount];
+
+/**
+ * \ingroup _cmsis_driver_i2c
+ * \brief Invoked by the board in ISR context, when a background transfer ended.
+ */
+STATIC void onTransferComplete(uint32_t event, uint32_t transferred, void* cookie) {
+  _i2c_TransferState* state = S_CAST(_i2c_TransferState*, cookie);
+
+  event |= ARM_I2C_EVENT_TRANSFER_DONE;
+  if(transferred < state->m_num) {
+    event |= ARM_I2C_EVENT_TRANSFER_INCOMPLETE;
+  }
+  state->m_dataCount = S_CAST(int32_t, transferred);
+  state->m_lastEvent = event;
+  state->m_receiver = false;
+  state->m_busy = false;
+
+  if(state->m_cbEvent) {
+    state->m_cbEvent(event);
+  }
+}
+
+/**
+ * \ingroup _cmsis_driver_i2c
+ * \brief Starts a master transfer in the background. If the board has no background
+ * transfers for this I2C, the transfer is carried out blocking.
+ */
+STATIC int32_t startTransfer(const enum bapi_E_I2cIndex_ I2CIndex, uint32_t addr, uint8_t *data, uint32_t num
+  , bool xfer_pending, bool receive) {
+  if(!data || !num) {
+    return ARM_DRIVER_ERROR_PARAMETER;
+  }
+
+  _i2c_TransferState* state = &s_i2cTransferState[I2CIndex];
+  bapi_irq_enterCritical();
+  if(state->m_busy) {
+    bapi_irq_exitCritical();
+    return ARM_DRIVER_ERROR_BUSY;
+  }
+  state->m_busy = true;
+  bapi_irq_exitCritical();
+
+  state->m_receiver = receive;
+  state->m_num = num;
+  state->m_dataCount = 0;
+  state->m_lastEvent = 0;
+  state->m_async = true;
+
+  if(bapi_i2c_startTransfer(I2CIndex, addr, receive, data, num, xfer_pending, onTransferComplete, state)) {
+    return ARM_DRIVER_OK;
+  }
+
+  /* Fallback: the board transfers only blocking, and only with interrupts disabled. */
+  state->m_async = false;
+  int32_t retval;
+  bapi_irq_enterCritical();
+  if(receive) {
+    retval = _bapi_I2cReadData(I2CIndex, addr, data, num, xfer_pending);
+  } else {
+    retval = _bapi_I2cWriteData(I2CIndex, addr, data, num, xfer_pending);
+  }
+  bapi_irq_exitCritical();
+
+  state->m_dataCount = (retval == ARM_DRIVER_OK) ? S_CAST(int32_t, num) : 0;
+  state->m_lastEvent = ARM_I2C_EVENT_TRANSFER_DONE
+    | ((retval == ARM_DRIVER_OK) ? 0 : ARM_I2C_EVENT_TRANSFER_INCOMPLETE);
+  state->m_receiver = false;
+  state->m_busy = false;
+
+  /* Like a background transfer, a successful blocking transfer is signalled by the event.
+   * A failed one is reported by the return value only. */
+  if((retval == ARM_DRIVER_OK) && state->m_cbEvent) {
+    state->m_cbEvent(state->m_lastEvent);
+  }
+  return retval;
+}
+
 /**
  * \name _driver_ARM_I2C Functions.
  * ARM I2C driver corresponding interface functions with an additional
@@ -103,6 +196,19 @@ STATIC int32_t Control(const enum bapi_E_I2cIndex_ I2CIndex, uint32_t control, u
 		break;
 
 	case ARM_I2C_ABORT_TRANSFER:
+    if(s_i2cTransferState[I2CIndex].m_busy && s_i2cTransferState[I2CIndex].m_async) {
+      /* No completion callback will arrive after the abort, but one may have arrived
+       * just before. */
+      bapi_i2c_abortTransfer(I2CIndex);
+      bapi_irq_enterCritical();
+      if(s_i2cTransferState[I2CIndex].m_busy) {
+        s_i2cTransferState[I2CIndex].m_dataCount = S_CAST(int32_t, bapi_i2c_getTransferCount(I2CIndex));
+        s_i2cTransferState[I2CIndex].m_lastEvent = ARM_I2C_EVENT_TRANSFER_DONE | ARM_I2C_EVENT_TRANSFER_INCOMPLETE;
+        s_i2cTransferState[I2CIndex].m_receiver = false;
+        s_i2cTransferState[I2CIndex].m_busy = false;
+      }
+      bapi_irq_exitCritical();
+    }
     _bapi_I2cAbortTransfer(I2CIndex);
 
 		retval = ARM_DRIVER_OK;
@@ -124,7 +230,10 @@ STATIC int32_t Initialize(const enum bapi_E_I2cIndex_ I2CIndex, ARM_I2C_SignalEv
  // bapi_irq_enterCritical();
 
   int32_t retval = ARM_DRIVER_OK;
-  _bapi_I2cInitCallback(I2CIndex,cb_event);
+  /* Only this driver signals the events, for background and blocking transfers alike.
+   * The board must not signal them a second time. */
+  _bapi_I2cInitCallback(I2CIndex, 0);
+  s_i2cTransferState[I2CIndex].m_cbEvent = cb_event;
 
  // TBD
   
@@ -157,14 +266,7 @@ STATIC int32_t Uninitialize(const enum bapi_E_I2cIndex_ I2CIndex) {
  */
 STATIC int32_t MasterTransmit(const enum bapi_E_I2cIndex_ I2CIndex, uint32_t addr, uint8_t *data, uint32_t num, bool xfer_pending)
 {
-  int32_t retval;
-  if(!data || !num) {
-    return ARM_DRIVER_ERROR_PARAMETER;
-  }
-  bapi_irq_enterCritical();
-  retval = (_bapi_I2cWriteData(I2CIndex,addr,data,num,xfer_pending));
-  bapi_irq_exitCritical();
-  return retval;
+  return startTransfer(I2CIndex, addr, data, num, xfer_pending, false);
 }
 
 /**
@@ -176,18 +278,7 @@ STATIC int32_t MasterTransmit(const enum bapi_E_I2cIndex_ I2CIndex, uint32_t add
  */
 STATIC int32_t MasterReceive(const enum bapi_E_I2cIndex_ I2CIndex, uint32_t addr, uint8_t *data, uint32_t num, bool xfer_pending)
 {
-  int32_t retval;
-  if(!data || !num) {
-    return ARM_DRIVER_ERROR_PARAMETER;
-  }
-
-  retval = ARM_DRIVER_ERROR_BUSY;
-
-  bapi_irq_enterCritical();
-  retval = (_bapi_I2cReadData(I2CIndex,addr,data,num,xfer_pending));
-  bapi_irq_exitCritical();
-
-  return retval;
+  return startTransfer(I2CIndex, addr, data, num, xfer_pending, true);
 }
 
 /**
@@ -229,8 +320,13 @@ STATIC int32_t SlaveReceive(const enum bapi_E_I2cIndex_ I2CIndex, uint8_t *data,
  */
 STATIC ARM_I2C_STATUS GetStatus(const enum bapi_E_I2cIndex_ I2CIndex) {
   ARM_I2C_STATUS status = {0};
+  const _i2c_TransferState* state = &s_i2cTransferState[I2CIndex];
 
-  // TODO: support all status flags.
+  status.busy = state->m_busy;
+  status.mode = state->m_busy; /* Only the master mode is supported. */
+  status.direction = state->m_receiver;
+  status.arbitration_lost = (state->m_lastEvent & ARM_I2C_EVENT_ARBITRATION_LOST) ? 1 : 0;
+  status.bus_error = (state->m_lastEvent & ARM_I2C_EVENT_BUS_ERROR) ? 1 : 0;
   return status;
 }
 
@@ -243,7 +339,11 @@ STATIC ARM_I2C_STATUS GetStatus(const enum bapi_E_I2cIndex_ I2CIndex) {
  */
 STATIC int32_t GetDataCount(const enum bapi_E_I2cIndex_ I2CIndex)
 {
-  return ARM_DRIVER_ERROR_UNSUPPORTED;
+  const _i2c_TransferState* state = &s_i2cTransferState[I2CIndex];
+  if(state->m_busy && state->m_async) {
+    return S_CAST(int32_t, bapi_i2c_getTransferCount(I2CIndex));
+  }
+  return state->m_dataCount;
 }
 
 /**
@@ -0,0 +1,393 @@
+/*
+ *  $HeadURL: $
+ *
+ *  $Date: $
+ *  $Author: $
+ */
+
+
+/**
+ * /file
+ * /brief This file implements the I2C transaction scheduler. Refer to
+ * Driver_I2C_Scheduler.h.
+ */
+
+
+#include "baseplate.h"
+
+#include "boards/board-api/bapi_i2c.h"
+#include "boards/board-api/bapi_irq.h"
+#include "Driver_I2C_Scheduler.h"
+
+#if (BAPI_HAS_I2C > 0)
+
+namespace Driver_I2C_SCHEDULER {
+
+/**
+ * \ingroup _cmsis_driver_i2c
+ * \brief The states of a job.
+ */
+enum E_JobState {
+   JOB_IDLE = 0   /**< Not known to the scheduler. */
+  ,JOB_QUEUED     /**< In the queue of the bus. */
+  ,JOB_RUNNING    /**< Its steps are transferred. */
+  ,JOB_WAITING    /**< Periodic job that waits for its next period. */
+};
+
+/**
+ * \ingroup _cmsis_driver_i2c
+ * \brief The flags of a job.
+ */
+enum E_JobFlags {
+   JOB_F_DUE_TIME_VALID = 0x01  /**< _dueTime was set by driver_i2c_scheduler_poll. */
+  ,JOB_F_CANCEL         = 0x02  /**< The running job must not be resubmitted. */
+};
+
+/**
+ * \ingroup _cmsis_driver_i2c
+ * \brief The events that fail a step.
+ */
+enum { STEP_ERROR_EVENTS = ARM_I2C_EVENT_TRANSFER_INCOMPLETE | ARM_I2C_EVENT_ADDRESS_NACK
+  | ARM_I2C_EVENT_ARBITRATION_LOST | ARM_I2C_EVENT_BUS_ERROR };
+
+/**
+ * \ingroup _cmsis_driver_i2c
+ * \brief The scheduler of one I2C bus.
+ *
+ * The queue and the waiting list are modified within critical sections, because
+ * the completion event and the clients access them. Only one context drives the
+ * bus at a time: the one that found the bus idle, or the completion event.
+ */
+typedef struct _i2c_bus {
+  ARM_DRIVER_I2C* m_driver;
+  struct driver_i2c_job* m_queueHead;    /**< Jobs in submission order. */
+  struct driver_i2c_job* m_queueTail;
+  struct driver_i2c_job* m_waiting;      /**< Periodic jobs waiting for their next period. */
+  struct driver_i2c_job* m_current;      /**< The running job. */
+  volatile bool m_active;                /**< Somebody drives the bus. */
+  volatile bool m_inStart;               /**< A step is being started. The completion event is deferred. */
+  volatile bool m_stepDone;              /**< The completion event arrived while the step was started. */
+  volatile uint32_t m_stepEvent;         /**< The deferred completion event. */
+} _i2c_bus;
+
+STATIC _i2c_bus s_i2cBus[bapi_E_I2cCount];
+
+
+/* Must be called within a critical section. */
+STATIC void _enqueue(_i2c_bus* bus, struct driver_i2c_job* job) {
+  job->_next = 0;
+  job->_state = JOB_QUEUED;
+  if(bus->m_queueTail) {
+    bus->m_queueTail->_next = job;
+  } else {
+    bus->m_queueHead = job;
+  }
+  bus->m_queueTail = job;
+}
+
+/* Must be called within a critical section. */
+STATIC struct driver_i2c_job* _dequeue(_i2c_bus* bus) {
+  struct driver_i2c_job* job = bus->m_queueHead;
+  if(job) {
+    bus->m_queueHead = job->_next;
+    if(!bus->m_queueHead) {
+      bus->m_queueTail = 0;
+    }
+    job->_next = 0;
+  }
+  return job;
+}
+
+/* Must be called within a critical section. */
+STATIC bool _unlink(struct driver_i2c_job** head, struct driver_i2c_job** tail, struct driver_i2c_job* job) {
+  struct driver_i2c_job* predecessor = 0;
+  for(struct driver_i2c_job* j = *head; j; predecessor = j, j = j->_next) {
+    if(j == job) {
+      if(predecessor) {
+        predecessor->_next = j->_next;
+      } else {
+        *head = j->_next;
+      }
+      if(tail && (*tail == j)) {
+        *tail = predecessor;
+      }
+      j->_next = 0;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * \ingroup _cmsis_driver_i2c
+ * \brief Finishes the current job, invokes its callback and puts a periodic job
+ * into the waiting list.
+ */
+STATIC void _finishJob(_i2c_bus* bus, int32_t result) {
+  struct driver_i2c_job* job = bus->m_current;
+  bus->m_current = 0;
+  job->result = result;
+
+  bapi_irq_enterCritical();
+  if(job->period && !(job->_flags & JOB_F_CANCEL)) {
+    job->_state = JOB_WAITING;
+    job->_next = bus->m_waiting;
+    bus->m_waiting = job;
+  } else {
+    job->_state = JOB_IDLE;
+  }
+  bapi_irq_exitCritical();
+
+  if(job->callback) {
+    job->callback(job, result);
+  }
+}
+
+/**
+ * \ingroup _cmsis_driver_i2c
+ * \brief Finishes the current job after a step failed to start or to transfer.
+ *
+ * A previous step or the failed step itself may have kept the bus (xfer_pending),
+ * so the transfer is always aborted, which sends a STOP and releases the bus.
+ */
+STATIC void _failJob(_i2c_bus* bus, int32_t result) {
+  bus->m_driver->Control(ARM_I2C_ABORT_TRANSFER, 0);
+  _finishJob(bus, result);
+}
+
+/**
+ * \ingroup _cmsis_driver_i2c
+ * \brief Evaluates the completion event of a step.
+ * \return true if the next step of the current job must be started.
+ */
+STATIC bool _completeStep(_i2c_bus* bus, uint32_t event) {
+  struct driver_i2c_job* job = bus->m_current;
+
+  if(event & STEP_ERROR_EVENTS) {
+    _failJob(bus, ARM_DRIVER_ERROR);
+    return false;
+  }
+
+  if(++job->_stepIndex < job->stepCount) {
+    return true;
+  }
+  _finishJob(bus, ARM_DRIVER_OK);
+  return false;
+}
+
+/**
+ * \ingroup _cmsis_driver_i2c
+ * \brief Drives the bus until a step runs in the background or there is no job left.
+ *
+ * Is called by the context that owns the bus, that is the one that set m_active, or
+ * the completion event.
+ */
+STATIC void _run(_i2c_bus* bus) {
+  for(;;) {
+    if(!bus->m_current) {
+      bapi_irq_enterCritical();
+      struct driver_i2c_job* job = _dequeue(bus);
+      if(!job) {
+        bus->m_active = false;
+        bapi_irq_exitCritical();
+        return;
+      }
+      job->_state = JOB_RUNNING;
+      job->_stepIndex = 0;
+      bus->m_current = job;
+      bapi_irq_exitCritical();
+    }
+
+    struct driver_i2c_job* job = bus->m_current;
+    const struct driver_i2c_step* step = &job->steps[job->_stepIndex];
+    const bool xferPending = (job->_stepIndex + 1) < job->stepCount;
+
+    bus->m_stepDone = false;
+    bus->m_inStart = true;
+    const int32_t retval = step->read
+      ? bus->m_driver->MasterReceive(job->addr, step->data, step->num, xferPending)
+      : bus->m_driver->MasterTransmit(job->addr, step->data, step->num, xferPending);
+
+    uint32_t event = 0;
+    bool done;
+    bapi_irq_enterCritical();
+    bus->m_inStart = false;
+    done = bus->m_stepDone;
+    if(done) {
+      event = bus->m_stepEvent;
+    } else if((retval == ARM_DRIVER_OK) && !bus->m_driver->GetStatus().busy) {
+      /* The driver transferred the step blocking, without an event. */
+      done = true;
+      event = ARM_I2C_EVENT_TRANSFER_DONE;
+      if(bus->m_driver->GetDataCount() < S_CAST(int32_t, step->num)) {
+        event |= ARM_I2C_EVENT_TRANSFER_INCOMPLETE;
+      }
+    }
+    bapi_irq_exitCritical();
+
+    if(retval != ARM_DRIVER_OK) {
+      _failJob(bus, retval);
+      continue;
+    }
+    if(!done) {
+      return; /* The completion event continues. */
+    }
+    _completeStep(bus, event);
+  }
+}
+
+/**
+ * \ingroup _cmsis_driver_i2c
+ * \brief The ARM_I2C_SignalEvent of a scheduled bus.
+ */
+STATIC void _onEvent(_i2c_bus* bus, uint32_t event) {
+  /* Some drivers signal a bus error or a lost arbitration without TRANSFER_DONE. */
+  if(!(event & (ARM_I2C_EVENT_TRANSFER_DONE | STEP_ERROR_EVENTS)) || !bus->m_current) {
+    return;
+  }
+  if(bus->m_inStart) {
+    /* _run evaluates the event when the driver function returns. */
+    bus->m_stepEvent = event;
+    bus->m_stepDone = true;
+    return;
+  }
+  _completeStep(bus, event);
+  _run(bus);
+}
+
+template<enum bapi_E_I2cIndex_ I2cIndex> void onEvent(uint32_t event) {
+  _onEvent(&s_i2cBus[I2cIndex], event);
+}
+
+STATIC const ARM_I2C_SignalEvent_t s_onEvent[] = {
+   onEvent<bapi_E_I2c0>
+#if (BAPI_HAS_I2C > 1)
+  ,onEvent<bapi_E_I2c1>
+#endif
+#if (BAPI_HAS_I2C > 2)
+  ,onEvent<bapi_E_I2c2>
+#endif
+#if (BAPI_HAS_I2C > 3)
+  #error "More than 3 I2Cs defined. Please enhance according to the scheme above."
+#endif
+};
+
+/* Start driving the bus, if nobody else does. */
+STATIC void _kick(_i2c_bus* bus) {
+  bapi_irq_enterCritical();
+  const bool start = !bus->m_active && bus->m_queueHead;
+  if(start) {
+    bus->m_active = true;
+  }
+  bapi_irq_exitCritical();
+
+  if(start) {
+    _run(bus);
+  }
+}
+
+} /* namespace Driver_I2C_SCHEDULER */
+
+using namespace Driver_I2C_SCHEDULER;
+
+
+int32_t driver_i2c_scheduler_init(bapi_E_I2cIndex i2cIndex) {
+  ASSERT(!bapi_irq_isInterruptContext()); /* Not allowed in ISR context */
+  ARM_DRIVER_I2C* driver = driver_i2c_getDriver(i2cIndex);
+  if(!driver) {
+    return ARM_DRIVER_ERROR_PARAMETER;
+  }
+
+  _i2c_bus* bus = &s_i2cBus[i2cIndex];
+  MEMSET(bus, 0, sizeof(*bus));
+  bus->m_driver = driver;
+
+  int32_t retval = driver->Initialize(s_onEvent[i2cIndex]);
+  if(retval == ARM_DRIVER_OK) {
+    retval = driver->PowerControl(ARM_POWER_FULL);
+  }
+  return retval;
+}
+
+int32_t driver_i2c_scheduler_submit(bapi_E_I2cIndex i2cIndex, struct driver_i2c_job* job) {
+  ASSERT(S_CAST(unsigned, i2cIndex) < bapi_E_I2cCount);
+  _i2c_bus* bus = &s_i2cBus[i2cIndex];
+  ASSERT(bus->m_driver);
+
+  if(!job->stepCount || !job->steps) {
+    return ARM_DRIVER_ERROR_PARAMETER;
+  }
+
+  bapi_irq_enterCritical();
+  if(job->_state != JOB_IDLE) {
+    bapi_irq_exitCritical();
+    return ARM_DRIVER_ERROR_BUSY;
+  }
+  job->_flags = 0;
+  job->result = ARM_DRIVER_OK;
+  _enqueue(bus, job);
+  bapi_irq_exitCritical();
+
+  _kick(bus);
+  return ARM_DRIVER_OK;
+}
+
+void driver_i2c_scheduler_cancel(bapi_E_I2cIndex i2cIndex, struct driver_i2c_job* job) {
+  ASSERT(S_CAST(unsigned, i2cIndex) < bapi_E_I2cCount);
+  _i2c_bus* bus = &s_i2cBus[i2cIndex];
+
+  bapi_irq_enterCritical();
+  switch(job->_state) {
+  case JOB_QUEUED:
+    _unlink(&bus->m_queueHead, &bus->m_queueTail, job);
+    job->_state = JOB_IDLE;
+    break;
+  case JOB_WAITING:
+    _unlink(&bus->m_waiting, 0, job);
+    job->_state = JOB_IDLE;
+    break;
+  case JOB_RUNNING:
+    job->_flags |= JOB_F_CANCEL;
+    break;
+  default:
+    break;
+  }
+  bapi_irq_exitCritical();
+}
+
+void driver_i2c_scheduler_poll(bapi_E_I2cIndex i2cIndex, uint32_t now) {
+  ASSERT(S_CAST(unsigned, i2cIndex) < bapi_E_I2cCount);
+  _i2c_bus* bus = &s_i2cBus[i2cIndex];
+
+  bapi_irq_enterCritical();
+  struct driver_i2c_job** link = &bus->m_waiting;
+  while(*link) {
+    struct driver_i2c_job* job = *link;
+    if(!(job->_flags & JOB_F_DUE_TIME_VALID)) {
+      /* First poll after the first run. */
+      job->_dueTime = now + job->period;
+      job->_flags |= JOB_F_DUE_TIME_VALID;
+    }
+
+    if(S_CAST(int32_t, now - job->_dueTime) >= 0) {
+      *link = job->_next;
+      /* Keep the phase, but don't catch up with periods that were missed. */
+      job->_dueTime += job->period;
+      if(S_CAST(int32_t, now - job->_dueTime) >= 0) {
+        job->_dueTime = now + job->period;
+      }
+      _enqueue(bus, job);
+    } else {
+      link = &job->_next;
+    }
+  }
+  bapi_irq_exitCritical();
+
+  _kick(bus);
+}
+
+bool driver_i2c_scheduler_isPending(const struct driver_i2c_job* job) {
+  return job->_state != JOB_IDLE;
+}
+
+#endif /* #if (BAPI_HAS_I2C > 0) */
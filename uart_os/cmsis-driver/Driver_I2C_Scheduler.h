@@ -0,0 +1,162 @@
+/*
+ *  $HeadURL: $
+ *
+ *  $Date: $
+ *  $Author: $
+ */
+
+#ifndef __CMSIS_DRIVER_I2C_SCHEDULER_H
+#define __CMSIS_DRIVER_I2C_SCHEDULER_H
+
+#include "baseplate.h"
+#include "Driver_I2C.h"
+
+
+/**
+ * \file
+ * \brief
+ * This file declares a transaction scheduler on top of \ref struct _ARM_DRIVER_I2C.
+ *
+ * Devices that share an I2C bus (LED driver chips, EEPROM, knob sensors, ...) submit
+ * jobs to the scheduler of the bus instead of calling MasterTransmit / MasterReceive
+ * themselves. A job is a list of steps to one slave, e.g. a register address write
+ * followed by a repeated start read. All steps but the last one keep the bus
+ * (xfer_pending), the last one generates the STOP condition.
+ *
+ * Jobs run back to back in submission order. The next step or job is started from
+ * the transfer done event, so the bus does not wait for a thread to be scheduled.
+ * Periodic jobs are resubmitted by \ref driver_i2c_scheduler_poll, when their
+ * period elapsed.
+ *
+ * The job and step memory is provided by the caller and must stay valid until the
+ * job is finished (one shot jobs) or cancelled (periodic jobs). No memory is allocated.
+ *
+ * The scheduler takes over the \ref ARM_I2C_SignalEvent callback of the bus. Clients
+ * must not call the driver of a scheduled bus directly.
+ */
+
+
+/**
+ * \addtogroup cmsis_driver_i2c
+ */
+/**@{*/
+
+/**
+ * \brief A single transfer of a job.
+ */
+struct driver_i2c_step {
+  uint8_t* data;   /**< The data to write or the buffer to read into. */
+  uint16_t num;    /**< The number of bytes. */
+  bool read;       /**< true for a MasterReceive, false for a MasterTransmit. */
+};
+
+struct driver_i2c_job;
+
+/**
+ * \brief Invoked when a job finished. This is usually the ISR context of the transfer
+ * done event. It is the context of driver_i2c_scheduler_submit or driver_i2c_scheduler_poll,
+ * if the job finished before the function returned (e.g. when the board has no background
+ * transfers).
+ *
+ * @param result ARM_DRIVER_OK on success. ARM_DRIVER_ERROR if a step was not
+ *   completely transferred, e.g. because the slave did not acknowledge.
+ *   Otherwise the error code of the driver. A failed job has aborted the transfer,
+ *   so the bus is released (STOP) before the callback runs.
+ */
+typedef void (*driver_i2c_job_callback_t)(struct driver_i2c_job* job, int32_t result);
+
+/**
+ * \brief A transaction list to one slave. Initialize the public members, e.g. by
+ * \ref driver_i2c_job_initRegisterRead, before submitting the job.
+ */
+struct driver_i2c_job {
+  uint32_t addr;                        /**< The slave address. */
+  const struct driver_i2c_step* steps;  /**< The steps of the job. */
+  uint8_t stepCount;                    /**< The number of steps. */
+  uint32_t period;                      /**< 0 for a one shot job. Otherwise the period in the
+                                             time base of \ref driver_i2c_scheduler_poll. */
+  driver_i2c_job_callback_t callback;   /**< Invoked when the job finished, may be 0. */
+  void* cookie;                         /**< For use by the caller. */
+  int32_t result;                       /**< The result of the last run. */
+
+  /* Managed by the scheduler. */
+  struct driver_i2c_job* _next;
+  uint32_t _dueTime;
+  uint8_t _stepIndex;
+  volatile uint8_t _state;
+  volatile uint8_t _flags;
+};
+
+/**
+ * \brief Initialize a job that writes a register address and reads the register
+ * content after a repeated start.
+ *
+ * @param steps Memory for two steps.
+ */
+C_INLINE void driver_i2c_job_initRegisterRead(struct driver_i2c_job* job, struct driver_i2c_step steps[2]
+  , uint32_t addr, uint8_t* reg, uint16_t regLength, uint8_t* data, uint16_t num) {
+  MEMSET(job, 0, sizeof(*job));
+  steps[0].data = reg;
+  steps[0].num = regLength;
+  steps[0].read = false;
+  steps[1].data = data;
+  steps[1].num = num;
+  steps[1].read = true;
+  job->addr = addr;
+  job->steps = steps;
+  job->stepCount = 2;
+}
+
+/**
+ * \brief Initialize a job that writes a single burst, e.g. a register address
+ * followed by the register contents.
+ *
+ * @param step Memory for one step.
+ */
+C_INLINE void driver_i2c_job_initBurstWrite(struct driver_i2c_job* job, struct driver_i2c_step* step
+  , uint32_t addr, uint8_t* data, uint16_t num) {
+  MEMSET(job, 0, sizeof(*job));
+  step->data = data;
+  step->num = num;
+  step->read = false;
+  job->addr = addr;
+  job->steps = step;
+  job->stepCount = 1;
+}
+
+/**
+ * \brief Take over an I2C bus. Registers the scheduler as event callback of the
+ * bus driver, and powers the bus.
+ *
+ * \return ARM_DRIVER_OK on success, otherwise the error of the driver.
+ */
+C_FUNC int32_t driver_i2c_scheduler_init(bapi_E_I2cIndex i2cIndex);
+
+/**
+ * \brief Append a job to the queue of a bus. The job starts at once if the bus is idle.
+ *
+ * \return ARM_DRIVER_OK, ARM_DRIVER_ERROR_PARAMETER for an empty job, or
+ *   ARM_DRIVER_ERROR_BUSY if the job is still queued or running.
+ */
+C_FUNC int32_t driver_i2c_scheduler_submit(bapi_E_I2cIndex i2cIndex, struct driver_i2c_job* job);
+
+/**
+ * \brief Remove a job from the scheduler. A running job is finished, but not
+ * resubmitted anymore.
+ */
+C_FUNC void driver_i2c_scheduler_cancel(bapi_E_I2cIndex i2cIndex, struct driver_i2c_job* job);
+
+/**
+ * \brief Submit all periodic jobs of a bus that are due at time now. Call this
+ * regularly, e.g. from a timer with osKernelGetTickCount() as time base.
+ */
+C_FUNC void driver_i2c_scheduler_poll(bapi_E_I2cIndex i2cIndex, uint32_t now);
+
+/**
+ * \brief true if the job is queued, running or waiting for its next period.
+ */
+C_FUNC bool driver_i2c_scheduler_isPending(const struct driver_i2c_job* job);
+
+/**@}*/
+
+#endif /* __CMSIS_DRIVER_I2C_SCHEDULER_H */
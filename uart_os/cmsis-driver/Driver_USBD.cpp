@@ -32,6 +32,12 @@ STATIC const ARM_DRIVER_VERSION DriverVersion = {
     ARM_USBD_DRV_VERSION
 };
 
+/* The endpoint event callbacks of the USB device stack, per controller interface. */
+STATIC ARM_USBD_SignalEndpointEvent_t s_cbEndpointEvent[BAPI_HAS_USBDEV_CI];
+
+/* Set by the optional stream layer, refer to driver_usbd_setEndpointEventHook(). */
+STATIC volatile driver_usbd_EndpointEventHook_t s_endpointEventHook;
+
 }
 
 /*******************************************************************************
@@ -44,6 +50,17 @@ static ARM_DRIVER_VERSION  ARM_USBD_GetVersion (void){
 
 template<enum bapi_E_UsbDevCiIndex_ ciIndex> struct _ARM_USBD {
 
+  /* The endpoints served by the hook (e.g. started streams) bypass the stack. */
+  static void SignalEndpointEvent(uint8_t ep_addr, uint32_t event) {
+    const driver_usbd_EndpointEventHook_t hook = _driver_usbd::s_endpointEventHook;
+    if(!hook || !hook(driver_usbd_getDriver(ciIndex), ep_addr, event)) {
+      const ARM_USBD_SignalEndpointEvent_t cb_endpoint_event = _driver_usbd::s_cbEndpointEvent[ciIndex];
+      if(cb_endpoint_event) {
+        cb_endpoint_event(ep_addr, event);
+      }
+    }
+  }
+
   static ARM_USBD_CAPABILITIES GetCapabilities(void) {
     return *bapi_usbd_getCapabilities(ciIndex);
   }
@@ -56,7 +73,8 @@ template<enum bapi_E_UsbDevCiIndex_ ciIndex> struct _ARM_USBD {
 
     /* Clear the device address */
     controllerInterface->ciIndex = ciIndex;
-    controllerInterface->init(cb_device_event, cb_endpoint_event);
+    _driver_usbd::s_cbEndpointEvent[ciIndex] = cb_endpoint_event;
+    controllerInterface->init(cb_device_event, SignalEndpointEvent);
 
     /* Set the device to default state */
     return ARM_DRIVER_OK;
@@ -202,6 +220,10 @@ C_FUNC ARM_DRIVER_USBD* driver_usbd_getDriver(
   return &s_usbDrivers[ciIndex];
 }
 
+C_FUNC void driver_usbd_setEndpointEventHook(driver_usbd_EndpointEventHook_t hook) {
+  _driver_usbd::s_endpointEventHook = hook;
+}
+
 
 #endif /* #if BAPI_HAS_USBDEV_CI > 0 */
 
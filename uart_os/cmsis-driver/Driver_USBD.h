@@ -163,6 +163,24 @@ C_FUNC ARM_DRIVER_USBD* driver_usbd_getDriver(
   enum bapi_E_UsbDevCiIndex_ ciIndex /**< [in] The USBD index for which to obtain the driver. */
   );
 
+/**
+ * \ingroup cmsis_driver_usbd
+ * \brief
+ * Invoked with each endpoint event of a driver before the stack sees it, usually in the USB ISR.
+ *
+ * \return true if the hook served the event, which is then not passed to the
+ * \ref ARM_USBD_SignalEndpointEvent_t callback of the stack.
+ */
+typedef bool (*driver_usbd_EndpointEventHook_t)(ARM_DRIVER_USBD* driver, uint8_t ep_addr, uint32_t event);
+
+/**
+ * \ingroup cmsis_driver_usbd
+ * \brief
+ * Install the endpoint event hook of all drivers, e.g. the dispatcher of the optional
+ * stream layer, which installs itself by driver_usbd_stream_start(). 0 removes the hook.
+ */
+C_FUNC void driver_usbd_setEndpointEventHook(driver_usbd_EndpointEventHook_t hook);
+
 #if ((defined(FSL_USB_KHCI_COUNT)) && (FSL_USB_KHCI_COUNT > 0U))
 struct bapi_usbdev_ControllerInterface;
 /*!
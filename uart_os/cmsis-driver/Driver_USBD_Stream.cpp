@@ -0,0 +1,385 @@
+/*
+ *  $HeadURL: $
+ *
+ *  $Date: $
+ *  $Author: $
+ */
+
+
+/**
+ * /file
+ * /brief This file implements the USB device endpoint streaming layer. Refer to
+ * Driver_USBD_Stream.h.
+ */
+
+
+#include "baseplate.h"
+
+#include "boards/board-api/bapi_irq.h"
+#include "Driver_USBD_Stream.h"
+
+#if BAPI_HAS_USBDEV_CI > 0
+
+namespace Driver_USBD_STREAM {
+
+/* The started streams of all drivers, modified within a critical section. */
+STATIC struct driver_usbd_stream* s_startedStreams;
+
+/* Must be called within a critical section. */
+STATIC void _push(struct driver_usbd_stream_buffer** head, struct driver_usbd_stream_buffer* buffer) {
+  buffer->_next = *head;
+  *head = buffer;
+}
+
+/* Must be called within a critical section. */
+STATIC struct driver_usbd_stream_buffer* _pop(struct driver_usbd_stream_buffer** head) {
+  struct driver_usbd_stream_buffer* buffer = *head;
+  if(buffer) {
+    *head = buffer->_next;
+    buffer->_next = 0;
+  }
+  return buffer;
+}
+
+/* Must be called within a critical section. */
+STATIC void _enqueue(struct driver_usbd_stream_buffer** head, struct driver_usbd_stream_buffer** tail
+  , struct driver_usbd_stream_buffer* buffer) {
+  buffer->_next = 0;
+  if(*tail) {
+    (*tail)->_next = buffer;
+  } else {
+    *head = buffer;
+  }
+  *tail = buffer;
+}
+
+/* Must be called within a critical section. */
+STATIC struct driver_usbd_stream_buffer* _dequeue(struct driver_usbd_stream_buffer** head
+  , struct driver_usbd_stream_buffer** tail) {
+  struct driver_usbd_stream_buffer* buffer = _pop(head);
+  if(!*head) {
+    *tail = 0;
+  }
+  return buffer;
+}
+
+/* Must be called within a critical section. Moves all buffers of a list to a free list. */
+STATIC void _freeAll(struct driver_usbd_stream_buffer** head, struct driver_usbd_stream_buffer** freeList) {
+  struct driver_usbd_stream_buffer* buffer;
+  while((buffer = _pop(head)) != 0) {
+    _push(freeList, buffer);
+  }
+}
+
+/* Must be called within a critical section. */
+STATIC void _unlinkStarted(struct driver_usbd_stream* stream) {
+  struct driver_usbd_stream** link = &s_startedStreams;
+  while(*link) {
+    if(*link == stream) {
+      *link = stream->_nextStarted;
+      stream->_nextStarted = 0;
+      return;
+    }
+    link = &(*link)->_nextStarted;
+  }
+}
+
+/**
+ * \ingroup _cmsis_driver_usbd
+ * \brief Arm the OUT endpoint with the next free receive buffer, if it is not armed yet.
+ * Must be called within a critical section.
+ *
+ * \return 0 or DRIVER_USBD_STREAM_EVENT_ERROR.
+ */
+STATIC uint32_t _armRx(struct driver_usbd_stream* stream) {
+  if(!stream->_running || !stream->epOut || stream->_rxArmed) {
+    return 0;
+  }
+
+  struct driver_usbd_stream_buffer* buffer = _pop(&stream->_rxFree);
+  if(!buffer) {
+    /* All buffers are held by the application. The endpoint NAKs until one is released. */
+    return 0;
+  }
+
+  buffer->len = 0;
+  buffer->offset = 0;
+  stream->_rxArmed = buffer;
+  if(stream->driver->EndpointTransfer(stream->epOut, buffer->data, buffer->size) != ARM_DRIVER_OK) {
+    stream->_rxArmed = 0;
+    _push(&stream->_rxFree, buffer);
+    return DRIVER_USBD_STREAM_EVENT_ERROR;
+  }
+  return 0;
+}
+
+/**
+ * \ingroup _cmsis_driver_usbd
+ * \brief Start the next submitted buffer, if the IN endpoint is idle.
+ * Must be called within a critical section.
+ *
+ * \return 0 or DRIVER_USBD_STREAM_EVENT_ERROR.
+ */
+STATIC uint32_t _startTx(struct driver_usbd_stream* stream) {
+  uint32_t events = 0;
+  while(stream->_running && !stream->_txActive && !stream->_txZlp) {
+    struct driver_usbd_stream_buffer* buffer = _dequeue(&stream->_txHead, &stream->_txTail);
+    if(!buffer) {
+      break;
+    }
+    stream->_txActive = buffer;
+    if(stream->driver->EndpointTransfer(stream->epIn, buffer->data, buffer->len) == ARM_DRIVER_OK) {
+      break;
+    }
+    /* Drop the buffer and try the next one. */
+    stream->_txActive = 0;
+    _push(&stream->_txFree, buffer);
+    events |= DRIVER_USBD_STREAM_EVENT_ERROR;
+  }
+  return events;
+}
+
+STATIC void _signal(struct driver_usbd_stream* stream, uint32_t events) {
+  if(events && stream->callback) {
+    stream->callback(stream, events);
+  }
+}
+
+STATIC void _onOut(struct driver_usbd_stream* stream) {
+  uint32_t events = 0;
+
+  bapi_irq_enterCritical();
+  struct driver_usbd_stream_buffer* buffer = stream->_rxArmed;
+  stream->_rxArmed = 0;
+  if(buffer) {
+    buffer->len = stream->driver->EndpointTransferGetResult(stream->epOut);
+    if(buffer->len > 0) {
+      _enqueue(&stream->_rxReadyHead, &stream->_rxReadyTail, buffer);
+      events |= DRIVER_USBD_STREAM_EVENT_RX_READY;
+    } else {
+      _push(&stream->_rxFree, buffer);
+    }
+  }
+  /* Re-arm at once, so the host can continue while the application handles the data. */
+  events |= _armRx(stream);
+  bapi_irq_exitCritical();
+
+  _signal(stream, events);
+}
+
+STATIC void _onIn(struct driver_usbd_stream* stream) {
+  uint32_t events = 0;
+
+  bapi_irq_enterCritical();
+  if(stream->_txZlp) {
+    stream->_txZlp = false;
+  } else if(stream->_txActive) {
+    struct driver_usbd_stream_buffer* buffer = stream->_txActive;
+    stream->_txActive = 0;
+    const uint32_t sent = buffer->len;
+    _push(&stream->_txFree, buffer);
+    events |= DRIVER_USBD_STREAM_EVENT_TX_DONE;
+
+    /* A bulk transfer that ends on a packet boundary needs a zero length packet,
+     * otherwise the host waits for more data. A following buffer ends it as well. */
+    if((stream->epType == ARM_USB_ENDPOINT_BULK) && !stream->_txHead
+      && stream->_running && (sent > 0) && ((sent % stream->maxPacketSize) == 0)) {
+      stream->_txZlp = true;
+      if(stream->driver->EndpointTransfer(stream->epIn, buffer->data, 0) != ARM_DRIVER_OK) {
+        stream->_txZlp = false;
+        events |= DRIVER_USBD_STREAM_EVENT_ERROR;
+      }
+    }
+  }
+  events |= _startTx(stream);
+  if(!stream->_txActive && !stream->_txZlp && !stream->_txHead) {
+    events |= DRIVER_USBD_STREAM_EVENT_TX_IDLE;
+  }
+  bapi_irq_exitCritical();
+
+  _signal(stream, events);
+}
+
+} /* namespace Driver_USBD_STREAM */
+
+using namespace Driver_USBD_STREAM;
+
+
+int32_t driver_usbd_stream_init(struct driver_usbd_stream* stream
+  , ARM_DRIVER_USBD* driver, uint8_t epOut, uint8_t epIn
+  , enum _ARM_USB_ENDPOINT_TYPE epType, uint16_t maxPacketSize
+  , driver_usbd_stream_callback_t callback, void* cookie) {
+
+  if(!stream || !driver || (!epOut && !epIn) || !maxPacketSize
+    || ((epType != ARM_USB_ENDPOINT_BULK) && (epType != ARM_USB_ENDPOINT_ISOCHRONOUS))) {
+    return ARM_DRIVER_ERROR_PARAMETER;
+  }
+
+  MEMSET(stream, 0, sizeof(*stream));
+  stream->driver = driver;
+  stream->epOut = epOut;
+  stream->epIn = epIn;
+  stream->epType = S_CAST(uint8_t, epType);
+  stream->maxPacketSize = maxPacketSize;
+  stream->callback = callback;
+  stream->cookie = cookie;
+  return ARM_DRIVER_OK;
+}
+
+void driver_usbd_stream_addBuffer(struct driver_usbd_stream* stream
+  , struct driver_usbd_stream_buffer* buffer, uint8_t* data, uint32_t size, bool rx) {
+
+  ASSERT(stream && buffer && data);
+  /* An OUT transfer only ends early on a short packet. */
+  ASSERT((size >= stream->maxPacketSize) && ((size % stream->maxPacketSize) == 0));
+
+  buffer->data = data;
+  buffer->size = size;
+  buffer->len = 0;
+  buffer->offset = 0;
+
+  bapi_irq_enterCritical();
+  if(rx) {
+    _push(&stream->_rxFree, buffer);
+    const uint32_t events = _armRx(stream);
+    bapi_irq_exitCritical();
+    _signal(stream, events);
+  } else {
+    _push(&stream->_txFree, buffer);
+    bapi_irq_exitCritical();
+  }
+}
+
+int32_t driver_usbd_stream_start(struct driver_usbd_stream* stream) {
+  int32_t retval = ARM_DRIVER_OK;
+  const enum _ARM_USB_ENDPOINT_TYPE epType = S_CAST(enum _ARM_USB_ENDPOINT_TYPE, stream->epType);
+
+  if(stream->epOut) {
+    retval = stream->driver->EndpointConfigure(stream->epOut, epType, stream->maxPacketSize);
+  }
+  if((retval == ARM_DRIVER_OK) && stream->epIn) {
+    retval = stream->driver->EndpointConfigure(stream->epIn, epType, stream->maxPacketSize);
+  }
+  if(retval != ARM_DRIVER_OK) {
+    return retval;
+  }
+
+  driver_usbd_setEndpointEventHook(driver_usbd_stream_dispatchEndpointEvent);
+
+  bapi_irq_enterCritical();
+  _unlinkStarted(stream);
+  stream->_nextStarted = s_startedStreams;
+  s_startedStreams = stream;
+  stream->_running = true;
+  uint32_t events = _armRx(stream);
+  events |= _startTx(stream);
+  bapi_irq_exitCritical();
+
+  _signal(stream, events);
+  return (events & DRIVER_USBD_STREAM_EVENT_ERROR) ? ARM_DRIVER_ERROR : ARM_DRIVER_OK;
+}
+
+void driver_usbd_stream_stop(struct driver_usbd_stream* stream) {
+  stream->_running = false;
+
+  if(stream->epOut) {
+    stream->driver->EndpointTransferAbort(stream->epOut);
+    stream->driver->EndpointUnconfigure(stream->epOut);
+  }
+  if(stream->epIn) {
+    stream->driver->EndpointTransferAbort(stream->epIn);
+    stream->driver->EndpointUnconfigure(stream->epIn);
+  }
+
+  bapi_irq_enterCritical();
+  if(stream->_rxArmed) {
+    _push(&stream->_rxFree, stream->_rxArmed);
+    stream->_rxArmed = 0;
+  }
+  _freeAll(&stream->_rxReadyHead, &stream->_rxFree);
+  stream->_rxReadyTail = 0;
+  if(stream->_txActive) {
+    _push(&stream->_txFree, stream->_txActive);
+    stream->_txActive = 0;
+  }
+  _freeAll(&stream->_txHead, &stream->_txFree);
+  stream->_txTail = 0;
+  stream->_txZlp = false;
+  _unlinkStarted(stream);
+  bapi_irq_exitCritical();
+}
+
+bool driver_usbd_stream_onEndpointEvent(struct driver_usbd_stream* stream, uint8_t ep_addr, uint32_t event) {
+  if(stream->epOut && (ep_addr == stream->epOut)) {
+    if(event & ARM_USBD_EVENT_OUT) {
+      _onOut(stream);
+    }
+    return true;
+  }
+  if(stream->epIn && (ep_addr == stream->epIn)) {
+    if(event & ARM_USBD_EVENT_IN) {
+      _onIn(stream);
+    }
+    return true;
+  }
+  return false;
+}
+
+bool driver_usbd_stream_dispatchEndpointEvent(ARM_DRIVER_USBD* driver, uint8_t ep_addr, uint32_t event) {
+  struct driver_usbd_stream* stream = s_startedStreams;
+  for(; stream; stream = stream->_nextStarted) {
+    if((stream->driver == driver) && driver_usbd_stream_onEndpointEvent(stream, ep_addr, event)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+struct driver_usbd_stream_buffer* driver_usbd_stream_rxGet(struct driver_usbd_stream* stream) {
+  bapi_irq_enterCritical();
+  struct driver_usbd_stream_buffer* buffer = _dequeue(&stream->_rxReadyHead, &stream->_rxReadyTail);
+  bapi_irq_exitCritical();
+  return buffer;
+}
+
+void driver_usbd_stream_rxRelease(struct driver_usbd_stream* stream, struct driver_usbd_stream_buffer* buffer) {
+  bapi_irq_enterCritical();
+  _push(&stream->_rxFree, buffer);
+  const uint32_t events = _armRx(stream);
+  bapi_irq_exitCritical();
+  _signal(stream, events);
+}
+
+struct driver_usbd_stream_buffer* driver_usbd_stream_txAlloc(struct driver_usbd_stream* stream) {
+  bapi_irq_enterCritical();
+  struct driver_usbd_stream_buffer* buffer = _pop(&stream->_txFree);
+  bapi_irq_exitCritical();
+  if(buffer) {
+    buffer->len = 0;
+    buffer->offset = 0;
+  }
+  return buffer;
+}
+
+int32_t driver_usbd_stream_txSubmit(struct driver_usbd_stream* stream, struct driver_usbd_stream_buffer* buffer) {
+  ASSERT(buffer->len <= buffer->size);
+
+  bapi_irq_enterCritical();
+  if(!stream->_running || !stream->epIn || (buffer->len == 0)) {
+    _push(&stream->_txFree, buffer);
+    bapi_irq_exitCritical();
+    return (buffer->len == 0) && stream->_running ? ARM_DRIVER_OK : ARM_DRIVER_ERROR;
+  }
+  _enqueue(&stream->_txHead, &stream->_txTail, buffer);
+  const uint32_t events = _startTx(stream);
+  bapi_irq_exitCritical();
+
+  _signal(stream, events);
+  return ARM_DRIVER_OK;
+}
+
+bool driver_usbd_stream_txIdle(const struct driver_usbd_stream* stream) {
+  return !stream->_txActive && !stream->_txZlp && !stream->_txHead;
+}
+
+#endif /* #if BAPI_HAS_USBDEV_CI > 0 */
@@ -0,0 +1,190 @@
+/*
+ *  $HeadURL: $
+ *
+ *  $Date: $
+ *  $Author: $
+ */
+
+#ifndef __CMSIS_DRIVER_USBD_STREAM_H
+#define __CMSIS_DRIVER_USBD_STREAM_H
+
+#include "baseplate.h"
+#include "Driver_USBD.h"
+
+
+/**
+ * \file
+ * \brief
+ * This file declares a streaming layer for a pair of bulk or isochronous endpoints
+ * on top of \ref struct _ARM_DRIVER_USBD, e.g. the data interface of a CDC ACM
+ * service port.
+ *
+ * The stream owns a pool of endpoint transfer buffers that the caller provides.
+ * An OUT transfer is always armed as long as a receive buffer is free: the endpoint
+ * event re-arms the endpoint with the next free buffer before the received buffer is
+ * handed to the application. The application reads the data in place and releases
+ * the buffer afterwards (zero-copy). If all receive buffers are held by the
+ * application, the endpoint NAKs until a buffer is released.
+ *
+ * For transmission the application allocates a buffer, fills it in place and submits
+ * it. Submitted buffers are transferred back to back from the IN endpoint event.
+ * A bulk transfer that is a multiple of the max packet size is terminated by a zero
+ * length packet, if no further buffer is waiting.
+ *
+ * The USB device stack keeps the \ref ARM_USBD_SignalEndpointEvent_t callback of the
+ * driver. \ref driver_usbd_stream_start installs \ref driver_usbd_stream_dispatchEndpointEvent
+ * as the endpoint event hook of the driver, which passes the events of the endpoints of
+ * started streams to the streams instead of to the stack.
+ */
+
+
+/**
+ * \addtogroup cmsis_driver_usbd
+ */
+/**@{*/
+
+/**
+ * \brief A transfer buffer of the stream pool.
+ */
+struct driver_usbd_stream_buffer {
+  uint8_t* data;    /**< The buffer memory. Must meet the alignment requirements of the USB controller DMA. */
+  uint32_t size;    /**< The size of the buffer memory, a multiple of the max packet size. */
+  uint32_t len;     /**< The number of valid bytes: received bytes, or bytes to send. */
+  uint32_t offset;  /**< For use by the application, e.g. the number of bytes already consumed. Reset to 0 by the stream. */
+
+  /* Managed by the stream. */
+  struct driver_usbd_stream_buffer* _next;
+};
+
+/**
+ * \brief Stream events, passed to \ref driver_usbd_stream_callback_t.
+ */
+enum driver_usbd_stream_E_Event {
+   DRIVER_USBD_STREAM_EVENT_RX_READY = 0x01  /**< A received buffer can be taken by \ref driver_usbd_stream_rxGet. */
+  ,DRIVER_USBD_STREAM_EVENT_TX_DONE  = 0x02  /**< A submitted buffer was transferred and is free again. */
+  ,DRIVER_USBD_STREAM_EVENT_TX_IDLE  = 0x04  /**< All submitted buffers were transferred. */
+  ,DRIVER_USBD_STREAM_EVENT_ERROR    = 0x08  /**< An endpoint transfer could not be started. */
+};
+
+struct driver_usbd_stream;
+
+/**
+ * \brief Invoked in the context of the endpoint event, usually the USB ISR.
+ *
+ * @param events The ORed \ref driver_usbd_stream_E_Event.
+ */
+typedef void (*driver_usbd_stream_callback_t)(struct driver_usbd_stream* stream, uint32_t events);
+
+/**
+ * \brief A stream over one OUT and one IN endpoint. Initialize it by \ref driver_usbd_stream_init.
+ */
+struct driver_usbd_stream {
+  ARM_DRIVER_USBD* driver;
+  uint8_t epOut;                          /**< The OUT endpoint address, 0 for a transmit only stream. */
+  uint8_t epIn;                           /**< The IN endpoint address, 0 for a receive only stream. */
+  uint8_t epType;                         /**< ARM_USB_ENDPOINT_BULK or ARM_USB_ENDPOINT_ISOCHRONOUS. */
+  uint16_t maxPacketSize;
+  driver_usbd_stream_callback_t callback; /**< May be 0. */
+  void* cookie;                           /**< For use by the caller. */
+
+  /* Managed by the stream. */
+  struct driver_usbd_stream_buffer* _rxFree;      /**< Free receive buffers. */
+  struct driver_usbd_stream_buffer* _rxArmed;     /**< The buffer of the running OUT transfer. */
+  struct driver_usbd_stream_buffer* _rxReadyHead; /**< Received buffers in reception order. */
+  struct driver_usbd_stream_buffer* _rxReadyTail;
+  struct driver_usbd_stream_buffer* _txFree;      /**< Free transmit buffers. */
+  struct driver_usbd_stream_buffer* _txHead;      /**< Submitted buffers in submission order. */
+  struct driver_usbd_stream_buffer* _txTail;
+  struct driver_usbd_stream_buffer* _txActive;    /**< The buffer of the running IN transfer. */
+  volatile bool _running;
+  volatile bool _txZlp;                           /**< A zero length packet is being sent. */
+  struct driver_usbd_stream* _nextStarted;        /**< The list of started streams. */
+};
+
+/**
+ * \brief Initialize a stream. The stream does not touch the endpoints before
+ * \ref driver_usbd_stream_start.
+ *
+ * \return ARM_DRIVER_OK or ARM_DRIVER_ERROR_PARAMETER.
+ */
+C_FUNC int32_t driver_usbd_stream_init(struct driver_usbd_stream* stream
+  , ARM_DRIVER_USBD* driver, uint8_t epOut, uint8_t epIn
+  , enum _ARM_USB_ENDPOINT_TYPE epType, uint16_t maxPacketSize
+  , driver_usbd_stream_callback_t callback, void* cookie);
+
+/**
+ * \brief Add a buffer to the receive or transmit pool of a stream.
+ * The buffer memory must stay valid as long as the stream is used.
+ */
+C_FUNC void driver_usbd_stream_addBuffer(struct driver_usbd_stream* stream
+  , struct driver_usbd_stream_buffer* buffer, uint8_t* data, uint32_t size, bool rx);
+
+/**
+ * \brief Configure the endpoints and arm the OUT endpoint. Call this when the host
+ * selected the configuration (SET_CONFIGURATION) that contains the endpoints.
+ * From now on the endpoint events of the driver are dispatched to the stream.
+ *
+ * \return ARM_DRIVER_OK or the error of the driver.
+ */
+C_FUNC int32_t driver_usbd_stream_start(struct driver_usbd_stream* stream);
+
+/**
+ * \brief Abort the running transfers, unconfigure the endpoints and return all
+ * buffers that are not held by the application to the pools. Received data that
+ * was not taken yet and submitted data that was not sent yet is dropped.
+ * The endpoint events are no longer dispatched to the stream.
+ */
+C_FUNC void driver_usbd_stream_stop(struct driver_usbd_stream* stream);
+
+/**
+ * \brief Forward an endpoint event of the driver to the stream.
+ *
+ * \return true if the event belonged to an endpoint of the stream.
+ */
+C_FUNC bool driver_usbd_stream_onEndpointEvent(struct driver_usbd_stream* stream, uint8_t ep_addr, uint32_t event);
+
+/**
+ * \brief Forward an endpoint event of a driver to the started stream that owns the
+ * endpoint. Called by the endpoint event callback of the driver, usually in the USB ISR.
+ *
+ * \return true if the event belonged to a started stream, false if it is for the stack.
+ */
+C_FUNC bool driver_usbd_stream_dispatchEndpointEvent(ARM_DRIVER_USBD* driver, uint8_t ep_addr, uint32_t event);
+
+/**
+ * \brief Take the oldest received buffer. The data is at buffer->data, buffer->len bytes.
+ *
+ * \return 0 if nothing was received.
+ */
+C_FUNC struct driver_usbd_stream_buffer* driver_usbd_stream_rxGet(struct driver_usbd_stream* stream);
+
+/**
+ * \brief Return a buffer that was taken by \ref driver_usbd_stream_rxGet. Re-arms the
+ * OUT endpoint, if it was waiting for a free buffer.
+ */
+C_FUNC void driver_usbd_stream_rxRelease(struct driver_usbd_stream* stream, struct driver_usbd_stream_buffer* buffer);
+
+/**
+ * \brief Take a free transmit buffer to be filled by the application.
+ *
+ * \return 0 if all transmit buffers are in use.
+ */
+C_FUNC struct driver_usbd_stream_buffer* driver_usbd_stream_txAlloc(struct driver_usbd_stream* stream);
+
+/**
+ * \brief Queue a buffer from \ref driver_usbd_stream_txAlloc with buffer->len bytes to send.
+ * A buffer with len 0 is returned to the pool at once.
+ *
+ * \return ARM_DRIVER_OK, or ARM_DRIVER_ERROR if the stream is not started.
+ *   The buffer is returned to the pool in the error case.
+ */
+C_FUNC int32_t driver_usbd_stream_txSubmit(struct driver_usbd_stream* stream, struct driver_usbd_stream_buffer* buffer);
+
+/**
+ * \brief true if no submitted buffer is waiting or being transferred.
+ */
+C_FUNC bool driver_usbd_stream_txIdle(const struct driver_usbd_stream* stream);
+
+/**@}*/
+
+#endif /* __CMSIS_DRIVER_USBD_STREAM_H */
@@ -17,21 +17,42 @@
 #include <new>
 
 #include "osAdc.h"
+#include "boards/board-api/bapi_adc_dma.h"
 #include "rtos/c++/osMailQueue.hpp"
 
 uint16_t g_AllChannelAdcRawValue[bapi_adc_E_Ch_Count] = {0};
 
+/** The per channel filters of osAdcChannelFilterUpdate(). Zero initialized means pass through. */
+static struct sample_filter g_AdcChannelFilter[bapi_adc_E_Ch_Count];
+
 typedef osMessageQueueId_t AdcMailQueue_t;
 
 typedef struct osAdcGroupShort_ {
+  bapi_adc_DmaScan_t m_dmaScan;             /**< The DMA scan of the group, negative if not DMA driven. */
   adcFreqDivider_t m_sampleFrequencyDivider;  /**< Divide the main ADC sample frequency for this group */
   adcBatchSize_t m_sampleBatchSize;         /**< How many samples to take, before all a notification takes place */
   uint16_t m_groupMemberCount;        /**< Number of group members following. */
   bapi_E_AdcChannel m_groupMembers[bapi_adc_E_Ch_Count];/**< Group member ADC channel. */
 } osAdcGroupShort;
 
+/**
+ * The state of a DMA driven ADC group. It is allocated along with both DMA buffers
+ * when the group is activated by osAdcGroupActivateDma(osAdcGroupId, osMessageQueueId_t).
+ */
+struct _osAdcDmaState {
+  bapi_adc_DmaScan_t m_scan;                          /**< The DMA scan handle of the bapi layer. */
+  uint32_t           m_overrunCounter;                /**< Batches dropped because the buffer was not released. */
+  volatile uint8_t   m_inUse[bapi_adc_DmaBufferCount];/**< Buffer was sent and is not released yet. */
+  uint8_t            m_activeBuffer;                  /**< The buffer the DMA writes the next scan into. */
+  uint8_t            m_holding;                       /**< Scans are held, because the active buffer is in use. */
+  uint8_t            m_detached;                      /**< The group was deactivated. The last release frees the state. */
+  osAdcGroupShort    m_members;                       /**< Contiguous channel list of the scan sequence. */
+  adcSample_t*       m_buffers[bapi_adc_DmaBufferCount]; /**< The ping-pong buffers. */
+};
+
 typedef struct osAdcGroup_ {
   AdcMailQueue_t   m_mailQ;
+  struct _osAdcDmaState* m_dma;              /**< Null if the group is not DMA driven. */
   adcFreqDivider_t m_sampleFrequencyDivider;  /**< Divide the main ADC sample frequency for this group. */
   adcBatchSize_t m_sampleBatchSize;         /**< How many samples to take, before all a notification takes place. */
   adcGroupMemberIndex_t m_groupMemberCount;        /**< Number of group members following. */
@@ -39,6 +60,7 @@ typedef struct osAdcGroup_ {
 } osAdcGroup;
 
 C_INLINE void adcGroup2adcGroupShort(struct osAdcGroupShort_*dst, const osAdcGroup* src) {
+  dst->m_dmaScan = src->m_dma ? src->m_dma->m_scan : -1;
   dst->m_sampleFrequencyDivider = src->m_sampleFrequencyDivider;
   dst->m_sampleBatchSize = src->m_sampleBatchSize;
   dst->m_groupMemberCount = src->m_groupMemberCount;
@@ -149,7 +171,8 @@ class AdcGroupManager {
                                     which allows us to let interrupts enabled. */
     struct GroupMemberAddress retval;
     for(retval.m_groupIndex = 0; retval.m_groupIndex < m_activeAdcGroupsArraySize; retval.m_groupIndex++) {
-      if(m_activeAdcGroups[retval.m_groupIndex]) {
+      /* DMA driven groups do not receive per conversion callbacks. */
+      if(m_activeAdcGroups[retval.m_groupIndex] && !m_activeAdcGroups[retval.m_groupIndex]->m_dma) {
         const osAdcGroup* adcGroup = m_activeAdcGroups[retval.m_groupIndex];
 
 #ifdef _DEBUG
@@ -191,6 +214,49 @@ class AdcGroupManager {
     theGroupManager._onAdcConversionComplete(adcChannel, adcRawValue);
   }
 
+public:
+  /**
+   * The DMA has completed a sample buffer of a DMA driven group. This is the only
+   * interrupt per sample batch of the whole group.
+   */
+  static void onDmaBatchComplete(unsigned bufferIndex, void* cookie) {
+    ASSERT(bapi_irq_isInterruptContext()); /* must only be called by within the DMA callback context only. */
+
+    osAdcGroup* adcGroup = S_CAST(osAdcGroup*, cookie);
+    struct _osAdcDmaState* dma = adcGroup->m_dma;
+    ASSERT(dma && (bufferIndex < bapi_adc_DmaBufferCount));
+
+    const adcGroupMemberIndex_t memberCount = dma->m_members.m_groupMemberCount;
+    const adcSample_t* samples = dma->m_buffers[bufferIndex];
+
+    /* The DMA continues with the other buffer. */
+    dma->m_activeBuffer = S_CAST(uint8_t, (bufferIndex + 1) % bapi_adc_DmaBufferCount);
+
+    /* Publish the raw values of the most recent scan. */
+    const adcSample_t* lastScan = &samples[(adcGroup->m_sampleBatchSize - 1) * memberCount];
+    for(adcGroupMemberIndex_t m = 0; m < memberCount; m++) {
+      g_AllChannelAdcRawValue[dma->m_members.m_groupMembers[m]] = lastScan[m];
+    }
+
+    if(dma->m_inUse[bufferIndex] || !adcGroup->m_mailQ) {
+      /* Not expected, startAdcConversion() holds the scans while the receiver holds the buffer. */
+      ++dma->m_overrunCounter;
+      return;
+    }
+
+    const _osAdcDmaBatch batch = {
+      adcGroup, dma, samples, adcGroup->m_sampleBatchSize, memberCount, S_CAST(uint16_t, bufferIndex)
+    };
+
+    dma->m_inUse[bufferIndex] = 1;
+    if(osMessageQueuePut(adcGroup->m_mailQ, &batch, 0, 0) != osOK) {
+      dma->m_inUse[bufferIndex] = 0;
+      ++dma->m_overrunCounter;
+    }
+  }
+
+private:
+
 
   inline void disable() {
     bapi_adc_setConversionComplete_ISRCallback(m_oldISRCallback);
@@ -291,6 +357,33 @@ public:
     return;
   }
 
+private:
+  /**
+   * Trigger one scan of a DMA driven group. The group is checked and the scan is triggered
+   * within the critical section, because osAdcGroupDecativate() stops the scan and frees its
+   * state right after the group got removed.
+   */
+  inline void triggerDmaScan(size_t g, const osAdcGroup* adcGroup) {
+    bapi_irq_enterCritical();
+    if((m_activeAdcGroups[g] == adcGroup) && adcGroup->m_dma) {
+      struct _osAdcDmaState* dma = adcGroup->m_dma;
+
+      if(dma->m_inUse[dma->m_activeBuffer]) {
+        /* The receiver still holds the buffer the DMA writes next. Hold the scans
+         * instead of overwriting it, and count the dropped batch once. */
+        if(!dma->m_holding) {
+          dma->m_holding = 1;
+          ++dma->m_overrunCounter;
+        }
+      } else {
+        dma->m_holding = 0;
+        bapi_adc_triggerDmaScan(dma->m_scan);
+      }
+    }
+    bapi_irq_exitCritical();
+  }
+
+public:
   /* It is inline because there is only one caller. */
   inline void startAdcConversion() {
     atomic_Increment(&m_conversionCounter);
@@ -312,8 +405,13 @@ public:
 
         /* Skip conversion based on sample frequency divider of this group */
         if((m_conversionCounter % adcGroup.m_sampleFrequencyDivider) == 0) {
-          /* Start conversion for each ADC channel of this group */
-          bapi_adc_startAdcConversionByChannelList(adcGroup.m_groupMembers, adcGroup.m_groupMemberCount);
+          if(adcGroup.m_dmaScan >= 0) {
+            /* The DMA stores the whole scan sequence of this group */
+            triggerDmaScan(g, currentGroup);
+          } else {
+            /* Start conversion for each ADC channel of this group */
+            bapi_adc_startAdcConversionByChannelList(adcGroup.m_groupMembers, adcGroup.m_groupMemberCount);
+          }
         }
       } else {
         bapi_irq_exitCritical();
@@ -441,10 +539,109 @@ osStatus_t osAdcGroupActivate(osAdcGroupId adcGroup, osMessageQueueId_t queue_id
   return retval;
 }
 
+osMessageQueueId_t osAdcDmaMailQCreate(unsigned int adcMailQueueSize) {
+  const osMessageQueueAttr_t mssgQAtt = {NULL, 0, NULL, 0, NULL, 0};
+  return osMessageQueueNew(MAX(1, adcMailQueueSize), sizeof(_osAdcDmaBatch), &mssgQAtt);
+}
+
+osStatus_t osAdcGroupActivateDma(osAdcGroupId adcGroup, osMessageQueueId_t queue_id) {
+  ASSERT(!bapi_irq_isInterruptContext()); /* Not allowed in ISR context. */
+  ASSERT(queue_id);             /* Assert a nonzero mail queue.*/
+
+  if((osMessageQueueGetMsgSize(queue_id) < sizeof(_osAdcDmaBatch)) || adcGroup->m_mailQ) {
+    return osErrorParameter;
+  }
+
+  /* Allocate the DMA state along with both ping-pong buffers. */
+  const size_t bufferSamples = S_CAST(size_t, adcGroup->m_sampleBatchSize) * adcGroup->m_groupMemberCount;
+  struct _osAdcDmaState* dma = S_CAST(struct _osAdcDmaState*,
+    malloc(sizeof(struct _osAdcDmaState) + bapi_adc_DmaBufferCount * bufferSamples * sizeof(adcSample_t)));
+  if(!dma) {
+    return osErrorNoMemory;
+  }
+
+  memset(dma, 0, sizeof(struct _osAdcDmaState));
+  adcGroup2adcGroupShort(&dma->m_members, adcGroup);
+  adcSample_t* samples = R_CAST(adcSample_t*, dma + 1);
+  for(unsigned b = 0; b < bapi_adc_DmaBufferCount; b++) {
+    dma->m_buffers[b] = &samples[b * bufferSamples];
+  }
+
+  dma->m_scan = bapi_adc_startDmaScan(dma->m_members.m_groupMembers, dma->m_members.m_groupMemberCount
+    , dma->m_buffers, adcGroup->m_sampleBatchSize, AdcGroupManager::onDmaBatchComplete, adcGroup);
+  if(dma->m_scan < 0) {
+    free(dma);
+    return osErrorResource;
+  }
+
+  adcGroup->m_dma = dma;
+  adcGroup->m_mailQ = queue_id;
+
+  if(!AdcGroupManager::theGroupManager.addGroup(adcGroup)) {
+    bapi_adc_stopDmaScan(dma->m_scan);
+    adcGroup->m_mailQ = 0;
+    adcGroup->m_dma = 0;
+    free(dma);
+    return osError;
+  }
+  return osOK;
+}
+
+/* Must be called within a critical section. */
+STATIC bool _osAdcDmaIsHeld(const struct _osAdcDmaState* dma) {
+  for(unsigned b = 0; b < bapi_adc_DmaBufferCount; b++) {
+    if(dma->m_inUse[b]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void osAdcDmaBatchRelease(const _osAdcDmaBatch_* batch) {
+  /* Only the DMA state is accessed, because the group may have been deleted already. */
+  if(batch && batch->m_dma) {
+    struct _osAdcDmaState* dma = batch->m_dma;
+    ASSERT(batch->m_bufferIndex < bapi_adc_DmaBufferCount);
+    bapi_irq_enterCritical();
+    dma->m_inUse[batch->m_bufferIndex] = 0;
+    const bool lastRelease = dma->m_detached && !_osAdcDmaIsHeld(dma);
+    bapi_irq_exitCritical();
+    if(lastRelease) {
+      free(dma);
+    }
+  }
+}
+
+uint32_t osAdcDmaOverrunCountGet(osAdcGroupId adcGroup) {
+  return adcGroup->m_dma ? adcGroup->m_dma->m_overrunCounter : 0;
+}
+
+bapi_E_AdcChannel osAdcDmaBatchChannelGet(const _osAdcDmaBatch_* batch, adcGroupMemberIndex_t memberIndex) {
+  if(batch && batch->m_dma && (memberIndex < batch->m_memberCount)) {
+    return batch->m_dma->m_members.m_groupMembers[memberIndex];
+  }
+  return bapi_adc_E_Ch_INVALID;
+}
+
 osStatus_t osAdcGroupDecativate(osAdcGroupId adcGroup) {
   ASSERT(!bapi_irq_isInterruptContext()); /* Not allowed in ISR context */
   AdcGroupManager::theGroupManager.removeGroup(adcGroup);
   adcGroup->m_mailQ = 0; /* Assignment is atomic because mailQ is a pointer. */
+
+  if(adcGroup->m_dma) {
+    /* No batch callback will arrive after the scan was stopped. Batches that are
+     * still queued or held keep the buffers, the last release frees them. */
+    bapi_adc_stopDmaScan(adcGroup->m_dma->m_scan);
+    struct _osAdcDmaState* dma = adcGroup->m_dma;
+    adcGroup->m_dma = 0;
+    bapi_irq_enterCritical();
+    dma->m_detached = 1;
+    const bool held = _osAdcDmaIsHeld(dma);
+    bapi_irq_exitCritical();
+    if(!held) {
+      free(dma);
+    }
+  }
   return osOK;
 }
 
@@ -463,16 +660,40 @@ osStatus_t osAdcGroupDelete(osAdcGroupId adcGroup) {
 
 int32_t osAdcAverage(const _osAdcSampleBatch_& updateEvent)
   {
-  /* We are interested in the average, so add up each sample from the batch. */
-  int32_t sum = 0; /* The sample can be 16 bit wide, we need to provide more bits for building the sum. */
+  /* We are interested in the average, so add up each sample from the batch. The samples
+   * are contiguous, so the sum is built with SIMD instructions where available. */
   const adcSample_t* adcSample = osAdcUpdateGetFirst(&updateEvent);
+  adcBatchSize_t batchSize = osAdcUpdateBatchSizeGet(&updateEvent);
+  return sample_filter_average_u16(adcSample, batchSize);
+}
+
+int32_t osAdcDmaAverage(const _osAdcDmaBatch_& batch, adcGroupMemberIndex_t memberIndex)
+  {
+  ASSERT(memberIndex < batch.m_memberCount);
+
+  /* The samples of a member are strided by the member count within the DMA buffer. */
+  const uint32_t sum = sample_filter_sum_u16(&batch.m_samples[memberIndex], batch.m_scanCount, batch.m_memberCount);
+  return batch.m_scanCount ? S_CAST(int32_t, sum / batch.m_scanCount) : 0;
+}
 
-  while ( adcSample ) {
-    sum += *adcSample;
-    adcSample = osAdcUpdateGetNext(&updateEvent, adcSample);
+bool osAdcChannelFilterSet(bapi_E_AdcChannel adcChannel, enum sample_filter_E_Type type, uint8_t param) {
+  if(S_CAST(unsigned, adcChannel) >= bapi_adc_E_Ch_Count) {
+    return false;
   }
+  return sample_filter_init(&g_AdcChannelFilter[adcChannel], type, param);
+}
 
-  adcBatchSize_t batchSize = osAdcUpdateBatchSizeGet(&updateEvent);
-  const int32_t average = sum / batchSize;
-  return average;
+uint16_t osAdcChannelFilterUpdate(const _osAdcSampleBatch_& updateEvent) {
+  ASSERT(S_CAST(unsigned, updateEvent.m_adcChannel) < bapi_adc_E_Ch_Count);
+  struct sample_filter* filter = &g_AdcChannelFilter[updateEvent.m_adcChannel];
+  sample_filter_updateBatch(filter, updateEvent.m_sampleBatch, updateEvent.m_sampleCounter, 1);
+  return sample_filter_output(filter);
+}
+
+uint16_t osAdcDmaChannelFilterUpdate(const _osAdcDmaBatch_& batch, adcGroupMemberIndex_t memberIndex) {
+  const bapi_E_AdcChannel adcChannel = osAdcDmaBatchChannelGet(&batch, memberIndex);
+  ASSERT(adcChannel != bapi_adc_E_Ch_INVALID);
+  struct sample_filter* filter = &g_AdcChannelFilter[adcChannel];
+  sample_filter_updateBatch(filter, &batch.m_samples[memberIndex], batch.m_scanCount, batch.m_memberCount);
+  return sample_filter_output(filter);
 }
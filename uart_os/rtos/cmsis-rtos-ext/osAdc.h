@@ -21,6 +21,7 @@
 
 #include "boards/board-api/bapi_io.h"
 #include "rtos/cmsis-rtos/cmsis_os_redirect.h"
+#include "utils/sample_filter.h"
 
 #ifndef osMaxAdcGroups
   #define osMaxAdcGroups 3
@@ -63,6 +64,26 @@ typedef struct _osAdcSampleBatch_ {
                                             */
 } _osAdcSampleBatch;
 
+/**
+ * \ingroup _cmsis_os_ext_adc
+ * A structure that is put into the message queue of a DMA driven ADC group once
+ * per full sample batch. It refers to the DMA buffer rather than carrying a copy
+ * of the samples. The samples of all group members are interleaved in scan order:
+ *   m_samples[scanIndex * m_memberCount + memberIndex]
+ *
+ * The buffer belongs to the receiver until it calls osAdcDmaBatchRelease(const _osAdcDmaBatch_*),
+ * even if the group was deactivated or deleted in the meantime.
+ */
+struct _osAdcDmaState;
+typedef struct _osAdcDmaBatch_ {
+  osAdcGroupId          m_adcGroup;    /**< The ADC group that produced the batch. Not valid anymore once the group was deleted. */
+  struct _osAdcDmaState* m_dma;        /**< Internal: the DMA state that owns the buffer. */
+  const adcSample_t*    m_samples;     /**< The interleaved samples within the DMA buffer. */
+  adcBatchSize_t        m_scanCount;   /**< The number of scans in the batch (the sample batch size). */
+  adcGroupMemberIndex_t m_memberCount; /**< The number of group members per scan. */
+  uint16_t              m_bufferIndex; /**< The DMA buffer that holds the samples. */
+} _osAdcDmaBatch;
+
 extern uint16_t g_AllChannelAdcRawValue[bapi_adc_E_Ch_Count];
 /**
  * \ingroup cmsis_os_ext_adc
@@ -171,12 +192,85 @@ C_FUNC osStatus_t osAdcGroupActivate(
     , osMessageQueueId_t queue_id    /**< [in] The mail queue that shall receive ADC Value Update mails from the group. */
   );
 
+/**
+ * \ingroup cmsis_os_ext_adc
+ * \brief Creates a mail queue that can be used to receive the batch messages of DMA driven
+ * ADC groups. Refer to osAdcGroupActivateDma(osAdcGroupId adcGroup, osMessageQueueId_t queue_id).
+ *
+ * \note Works also in a Non RTOS environment.
+ */
+C_FUNC osMessageQueueId_t osAdcDmaMailQCreate(
+    unsigned int adcMailQueueSize   /**< The number of entries in the mail queue. */
+  );
+
+/**
+ * \ingroup cmsis_os_ext_adc
+ * \brief Activates an ADC group whose scan sequence is written by DMA into two
+ * ping-pong sample buffers.
+ *
+ * \note Works also in a Non RTOS environment.
+ *
+ * Other than with osAdcGroupActivate(osAdcGroupId adcGroup, osMessageQueueId_t queue_id), there
+ * is no interrupt per ADC conversion. Once the sample batch of the whole group is full, a single
+ * _osAdcDmaBatch message that refers to the DMA buffer is put into the queue. The receiver
+ * must pass it to osAdcDmaBatchRelease(const _osAdcDmaBatch_*) before the DMA has filled the
+ * other buffer. Otherwise the scans are held until the buffer is released, their samples are
+ * dropped and counted as one overrun. A held buffer is never overwritten.
+ *
+ * @return osOK on success. osErrorResource if the board does not support ADC DMA scans,
+ *   in which case osAdcGroupActivate(osAdcGroupId, osMessageQueueId_t) can be used instead.
+ */
+C_FUNC osStatus_t osAdcGroupActivateDma(
+      osAdcGroupId adcGroup          /**< [in] The ADC group to be activated. */
+    , osMessageQueueId_t queue_id    /**< [in] The queue created by osAdcDmaMailQCreate(unsigned int). */
+  );
+
+/**
+ * \ingroup cmsis_os_ext_adc
+ * \brief Hands a DMA buffer back to a DMA driven ADC group, after the receiver of
+ * a batch message has processed the samples.
+ *
+ * \note Works also in a Non RTOS environment.
+ *
+ * Batches that are still queued or held when the group is deactivated or deleted stay
+ * valid and must be released as well. The DMA buffers are freed by the last release.
+ */
+C_FUNC void osAdcDmaBatchRelease(const _osAdcDmaBatch_* batch);
+
+/**
+ * \ingroup cmsis_os_ext_adc
+ * \brief Returns the number of times a DMA driven ADC group dropped scans, because
+ * the receiver did not release the buffer in time.
+ */
+C_FUNC uint32_t osAdcDmaOverrunCountGet(osAdcGroupId adcGroup);
+
+/**
+ * \ingroup cmsis_os_ext_adc
+ * \brief Returns the ADC channel of a group member of a DMA batch message.
+ *
+ * \return The ADC channel, or bapi_adc_E_Ch_INVALID if the member index is out of range.
+ */
+C_FUNC bapi_E_AdcChannel osAdcDmaBatchChannelGet(const _osAdcDmaBatch_* batch, adcGroupMemberIndex_t memberIndex);
+
+/**
+ * \ingroup cmsis_os_ext_adc
+ * \brief Returns a sample of a group member from a DMA batch message.
+ */
+C_INLINE adcSample_t osAdcDmaBatchSampleGet(const _osAdcDmaBatch_* batch
+  , adcBatchSize_t scanIndex, adcGroupMemberIndex_t memberIndex) {
+  ASSERT((scanIndex < batch->m_scanCount) && (memberIndex < batch->m_memberCount));
+  return batch->m_samples[scanIndex * batch->m_memberCount + memberIndex];
+}
+
 /**
  * \ingroup cmsis_os_ext_adc
  * \brief Deactivates an ADC group. No ADC samples will be collected anymore and no ADC Value Update mails
  * will be generated anymore.
  * \note Works also in a Non RTOS environment.
  *
+ * The DMA buffers of a DMA driven group are freed at once if no batch is held. Otherwise
+ * they are freed when the last queued or held batch was passed to osAdcDmaBatchRelease().
+ *
  */
 C_FUNC osStatus_t osAdcGroupDecativate(
   osAdcGroupId adcGroup /**< [in] The ADC group to be de-activated. */
@@ -298,4 +392,42 @@ C_INLINE const adcSample_t* osAdcUpdateGetNext(
  */
 C_FUNC int32_t osAdcAverage(const _osAdcSampleBatch_& updateEvent);
 
+/**
+ * \ingroup cmsis_os_ext_adc
+ * \brief Calculates the average of a group member from a DMA batch message.
+ *
+ * \note Works also in a Non RTOS environment.
+ */
+C_FUNC int32_t osAdcDmaAverage(const _osAdcDmaBatch_& batch, adcGroupMemberIndex_t memberIndex);
+
+/**
+ * \ingroup cmsis_os_ext_adc
+ * \brief Selects the filter of an ADC channel that is applied by \ref osAdcChannelFilterUpdate
+ * and \ref osAdcDmaChannelFilterUpdate. Refer to sample_filter_init() for the parameter.
+ * The default filter passes the last sample through.
+ *
+ * \note The filter state of a channel is not locked. Set and update the filter of a
+ *   channel from the task that receives its sample batches.
+ *
+ * \return true on success, false if the channel or the parameter is invalid.
+ */
+C_FUNC bool osAdcChannelFilterSet(bapi_E_AdcChannel adcChannel, enum sample_filter_E_Type type, uint8_t param);
+
+/**
+ * \ingroup cmsis_os_ext_adc
+ * \brief Feeds all samples of an ADC Value Update mail into the filter of its channel.
+ *
+ * \return The filter output after the last sample.
+ */
+C_FUNC uint16_t osAdcChannelFilterUpdate(const _osAdcSampleBatch_& updateEvent);
+
+/**
+ * \ingroup cmsis_os_ext_adc
+ * \brief Feeds the samples of a group member from a DMA batch message into the filter
+ * of the member's channel.
+ *
+ * \return The filter output after the last sample.
+ */
+C_FUNC uint16_t osAdcDmaChannelFilterUpdate(const _osAdcDmaBatch_& batch, adcGroupMemberIndex_t memberIndex);
+
 #endif /* osIoAdc_H_ */
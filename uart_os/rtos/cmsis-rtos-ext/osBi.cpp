@@ -21,6 +21,7 @@
 #include "osBi.h"
 #include "rtos/c++/osMailQueue.hpp"
 #include "boards/board-api/bapi_io.h"
+#include "boards/board-api/bapi_bi_counter.h"
 #ifdef _DEBUG
 //  #define BIGROUP_DEBUG
 #endif
@@ -86,10 +87,48 @@ typedef struct osBiGroup_ {
   osMessageQueueId_t m_messageQ;
   _osBiGroupMembers m_groupMembers;
 
+  /* The shared state that is updated in place by the ISR and read by osBiSnapshotGet().
+   * m_sequence is odd while the ISR updates the state. There is a single writer, because
+   * BI irq nesting is disabled. */
+  volatile uint32_t m_sequence;
+  volatile bitfield_base_t m_sharedStateBitfield[BITFIELD_ARRAY_SIZE];
+  volatile uint32_t m_edgeCount[bapi_bi_E_Ch_Count];
+
+  /* When m_notifyThread is set, a state change only sets m_notifyFlags for this thread
+   * instead of posting a mail. */
+  osThreadId_t m_notifyThread;
+  uint32_t m_notifyFlags;
+
+  /* countEdge is false when the state is seeded from the pin level on activation. */
+  void updateSharedState(bapi_E_BiChannel biChannel, bool state, bool countEdge) {
+    const size_t index = biChannel / (BITS_PER_BYTE * sizeof(bitfield_base_t));
+    const bitfield_base_t mask = S_CAST(bitfield_base_t, 1) << (biChannel % (BITS_PER_BYTE * sizeof(bitfield_base_t)));
+
+    m_sequence = m_sequence + 1;
+    if(state) {
+      m_sharedStateBitfield[index] = m_sharedStateBitfield[index] | mask;
+    } else {
+      m_sharedStateBitfield[index] = m_sharedStateBitfield[index] & ~mask;
+    }
+    if(countEdge) {
+      m_edgeCount[biChannel] = m_edgeCount[biChannel] + 1;
+    }
+    m_sequence = m_sequence + 1;
+  }
+
   void onStateChange(bapi_E_BiChannel biChannel, bool state) {
 
     ASSERT(bapi_irq_isInterruptContext()); /* This must only be called from the ISR */
 
+    updateSharedState(biChannel, state, true);
+
+    const osThreadId_t notifyThread = m_notifyThread;
+    if(notifyThread) {
+      /* The consumer reads a coalesced snapshot, so there is nothing to copy here. */
+      osThreadFlagsSet(notifyThread, m_notifyFlags);
+      return;
+    }
+
     /** See if we need to update the info of a pending mail */
 
     _osBiGroupMembers front;
@@ -97,6 +136,10 @@ typedef struct osBiGroup_ {
     if( osOK != osMessageQueueGet(m_messageQ, &front, NULL, 0) ){
 //      memset(&front, sizeof(front), 0); //stupid mistake
 	  memset(&front, 0, sizeof(front));
+      /* A new mail starts from the current levels of all group members, not from 0. */
+      for(size_t index = 0; index < BITFIELD_ARRAY_SIZE; index++) {
+        front.m_biStateBitfield[index] = m_sharedStateBitfield[index];
+      }
     }
 
     /* The mail Q is 2 entries, so there must be a free one if BI irq nesting is disabled. */
@@ -162,6 +205,9 @@ theGroupManager.m_biGroup[biChannel]->m_groupMembers.pulse_counter[biChannel]++;
       if(m_biGroup[biChannel] == 0) {
         m_biGroup[biChannel] = biGroup;
         bapi_bi_setInterruptMode(biChannel, 1, true, true);
+        /* Seed the state from the pin level. It is read after the interrupt is enabled, so
+         * an edge in between is reported by the pending interrupt after the critical section. */
+        biGroup->updateSharedState(biChannel, bapi_bi_getPinLevel(biChannel), false);
         return true;
       } else if(m_biGroup[biChannel] == biGroup) {
         return true; /* Nothing has changed. */
@@ -319,44 +365,88 @@ void osBiStateChangeEventsFree(osBiGroupId biGroup, osBiStateChangeEvents *state
 
 /**
  * \ingroup _cmsis_os_ext_bi
+ * \brief Searches the next set bit in a change bit field, starting with channel start.
  */
-//STATIC bapi_E_BiChannel _osBiGetStateChange(unsigned int index, unsigned int bitNo, const osBiStateChangeEvents event, bool* state) {
-STATIC bapi_E_BiChannel _osBiGetStateChange(unsigned int index, unsigned int bitNo, const osBiStateChangeEvents* stateChangeEvents, bool* state) {
-  //if(event->status == osEventMail) {
-    //osBiStateChangeEvents *stateChangeEvents = S_CAST(osBiStateChangeEvents *, event->value.p);
-
-#ifdef BIGROUP_DEBUG
-    ASSERT(stateChangeEvents->m_mailTag == BIGROUP_MAILTAG);
-#endif
-
-    for(; index < BITFIELD_ARRAY_SIZE; index++) {
-      for(; bitNo < BITS_PER_BYTE * sizeof(bitfield_base_t); bitNo++) {
-        if( stateChangeEvents->m_biStateChangeBitfield[index] & (1 << bitNo)) {
-          int biChannel = sizeof(bitfield_base_t) * index + bitNo;
-          if(biChannel < bapi_bi_E_Ch_Count) {
-            *state = stateChangeEvents->m_biStateBitfield[index] & (1 << bitNo);
-          } else {
-            biChannel = bapi_bi_E_Invalid;
-          }
-          return S_CAST(bapi_E_BiChannel, biChannel);
-        }
-      }
+STATIC bapi_E_BiChannel _osBiGetStateChange(int start, const bitfield_base_t* changeBitfield
+  , const bitfield_base_t* stateBitfield, bool* state) {
+  enum { BITS_PER_FIELD = BITS_PER_BYTE * sizeof(bitfield_base_t) };
+
+  for(int biChannel = start; biChannel < bapi_bi_E_Ch_Count; biChannel++) {
+    const bitfield_base_t mask = S_CAST(bitfield_base_t, 1) << (biChannel % BITS_PER_FIELD);
+    if(changeBitfield[biChannel / BITS_PER_FIELD] & mask) {
+      *state = stateBitfield[biChannel / BITS_PER_FIELD] & mask;
+      return S_CAST(bapi_E_BiChannel, biChannel);
     }
-  //}
+  }
   return bapi_bi_E_Invalid;
 }
 
 //bapi_E_BiChannel osBiGetFirstStateChange(const osBiStateChangeEvents event, bool* state) {
 bapi_E_BiChannel osBiGetFirstStateChange(const osBiStateChangeEvents* stateChangeEvents, bool* state) {
-  return _osBiGetStateChange(0, 0, stateChangeEvents, state);
+#ifdef BIGROUP_DEBUG
+  ASSERT(stateChangeEvents->m_mailTag == BIGROUP_MAILTAG);
+#endif
+  return _osBiGetStateChange(0, stateChangeEvents->m_biStateChangeBitfield, stateChangeEvents->m_biStateBitfield, state);
 }
 
 //bapi_E_BiChannel osBiGetNextStateChange(const osBiStateChangeEvents event, bool* state, bapi_E_BiChannel predecessor) {
 bapi_E_BiChannel osBiGetNextStateChange(const osBiStateChangeEvents* stateChangeEvents, bool* state, bapi_E_BiChannel predecessor) {
   const int start = S_CAST(int, predecessor) + 1;
-  const unsigned int index = start / sizeof(bitfield_base_t);
-  const unsigned int bitNo = start % sizeof(bitfield_base_t);
-  return _osBiGetStateChange(index, bitNo, stateChangeEvents, state);
+  return _osBiGetStateChange(start, stateChangeEvents->m_biStateChangeBitfield, stateChangeEvents->m_biStateBitfield, state);
+}
+
+osStatus_t osBiGroupNotifySet(osBiGroupId biGroup, osThreadId_t thread, uint32_t flags) {
+  ASSERT(!bapi_irq_isInterruptContext()); /* Not allowed in ISR context */
+  bapi_irq_enterCritical();
+  biGroup->m_notifyFlags = flags;
+  biGroup->m_notifyThread = thread;
+  bapi_irq_exitCritical();
+  return osOK;
+}
+
+bool osBiSnapshotGet(osBiGroupId biGroup, osBiSnapshot* snapshot) {
+  ASSERT(!bapi_irq_isInterruptContext()); /* Not allowed in ISR context */
+  enum { BITS_PER_FIELD = BITS_PER_BYTE * sizeof(bitfield_base_t) };
+
+  /* The ISR preempts us, but never the other way round. So retry until no state
+   * change happened while we were copying. */
+  bitfield_base_t stateBitfield[BITFIELD_ARRAY_SIZE];
+  uint32_t edgeCount[bapi_bi_E_Ch_Count];
+  uint32_t sequence;
+  do {
+    sequence = biGroup->m_sequence;
+    for(size_t index = 0; index < BITFIELD_ARRAY_SIZE; index++) {
+      stateBitfield[index] = biGroup->m_sharedStateBitfield[index];
+    }
+    for(size_t biChannel = 0; biChannel < bapi_bi_E_Ch_Count; biChannel++) {
+      edgeCount[biChannel] = biGroup->m_edgeCount[biChannel];
+    }
+  } while((sequence & 1) || (sequence != biGroup->m_sequence));
+
+  /* Compare the edge counters against the previous snapshot to find the channels
+   * that changed in between, no matter how many edges happened. */
+  const bool changed = (sequence != snapshot->m_sequence);
+  MEMSET(snapshot->m_biStateChangeBitfield, 0, sizeof(snapshot->m_biStateChangeBitfield));
+  for(size_t biChannel = 0; biChannel < bapi_bi_E_Ch_Count; biChannel++) {
+    const uint32_t edgeDelta = edgeCount[biChannel] - snapshot->m_edgeCount[biChannel];
+    if(edgeDelta) {
+      snapshot->m_biStateChangeBitfield[biChannel / BITS_PER_FIELD] |= S_CAST(bitfield_base_t, 1) << (biChannel % BITS_PER_FIELD);
+    }
+    snapshot->m_edgeDelta[biChannel] = edgeDelta;
+    snapshot->m_edgeCount[biChannel] = edgeCount[biChannel];
+  }
+  MEMCPY(snapshot->m_biStateBitfield, stateBitfield, sizeof(snapshot->m_biStateBitfield));
+  snapshot->m_sequence = sequence;
+  return changed;
+}
+
+bapi_E_BiChannel osBiSnapshotGetFirstStateChange(const osBiSnapshot* snapshot, bool* state) {
+  return _osBiGetStateChange(0, snapshot->m_biStateChangeBitfield, snapshot->m_biStateBitfield, state);
+}
+
+bapi_E_BiChannel osBiSnapshotGetNextStateChange(const osBiSnapshot* snapshot, bool* state, bapi_E_BiChannel predecessor) {
+  const int start = S_CAST(int, predecessor) + 1;
+  return _osBiGetStateChange(start, snapshot->m_biStateChangeBitfield, snapshot->m_biStateBitfield, state);
 }
 
 //h242608
@@ -376,3 +466,127 @@ void osSetBiPulseCounter(osBiGroupId biGroup,bapi_E_BiChannel channel, uint64_t
 }
 
 
+/**
+ * \ingroup _cmsis_os_ext_bi
+ * \brief Extends the 32 bit hardware pulse count of a BI channel to 64 bit.
+ */
+typedef struct _osBiCounter {
+  bool m_active;
+  uint32_t m_lastRaw;  /**< The hardware count at the previous read. */
+  uint64_t m_count;    /**< The extended count at the previous read. */
+  uint32_t m_timeoutUs; /**< See osBiCounterTimeoutSet(), 0 if not configured. */
+} _osBiCounter;
+
+STATIC _osBiCounter g_biCounter[bapi_bi_E_Ch_Count];
+
+/* Must be called within a critical section. */
+STATIC bool _osBiCounterUpdate(bapi_E_BiChannel channel, bapi_bi_CounterCapture* capture) {
+  _osBiCounter* counter = &g_biCounter[channel];
+  if(!counter->m_active || !bapi_bi_counterRead(channel, capture)) {
+    return false;
+  }
+  /* Unsigned subtraction handles the wrap around of the hardware count. */
+  counter->m_count += capture->m_count - counter->m_lastRaw;
+  counter->m_lastRaw = capture->m_count;
+  return true;
+}
+
+osStatus_t osBiCounterStart(bapi_E_BiChannel channel) {
+  ASSERT(!bapi_irq_isInterruptContext()); /* Not allowed in ISR context */
+  if(S_CAST(unsigned, channel) >= bapi_bi_E_Ch_Count) {
+    return osErrorParameter;
+  }
+  if(!bapi_bi_counterStart(channel)) {
+    return osErrorResource;
+  }
+  bapi_irq_enterCritical();
+  g_biCounter[channel].m_lastRaw = 0;
+  g_biCounter[channel].m_count = 0;
+  g_biCounter[channel].m_active = true;
+  bapi_irq_exitCritical();
+  return osOK;
+}
+
+void osBiCounterStop(bapi_E_BiChannel channel) {
+  ASSERT(!bapi_irq_isInterruptContext()); /* Not allowed in ISR context */
+  if(S_CAST(unsigned, channel) < bapi_bi_E_Ch_Count) {
+    /* Fold in the pulses since the previous read, so osBiCounterGet() returns the final count. */
+    bapi_bi_CounterCapture capture;
+    bapi_irq_enterCritical();
+    _osBiCounterUpdate(channel, &capture);
+    g_biCounter[channel].m_active = false;
+    bapi_irq_exitCritical();
+    bapi_bi_counterStop(channel);
+  }
+}
+
+uint64_t osBiCounterGet(bapi_E_BiChannel channel) {
+  ASSERT(S_CAST(unsigned, channel) < bapi_bi_E_Ch_Count);
+  bapi_bi_CounterCapture capture;
+  bapi_irq_enterCritical();
+  _osBiCounterUpdate(channel, &capture);
+  const uint64_t retval = g_biCounter[channel].m_count;
+  bapi_irq_exitCritical();
+  return retval;
+}
+
+void osBiCounterSet(bapi_E_BiChannel channel, uint64_t count) {
+  ASSERT(S_CAST(unsigned, channel) < bapi_bi_E_Ch_Count);
+  bapi_bi_CounterCapture capture;
+  bapi_irq_enterCritical();
+  _osBiCounterUpdate(channel, &capture);
+  g_biCounter[channel].m_count = count;
+  bapi_irq_exitCritical();
+}
+
+void osBiCounterTimeoutSet(bapi_E_BiChannel channel, uint32_t timeoutUs) {
+  ASSERT(S_CAST(unsigned, channel) < bapi_bi_E_Ch_Count);
+  g_biCounter[channel].m_timeoutUs = timeoutUs;
+}
+
+/**
+ * \ingroup _cmsis_os_ext_bi
+ * \brief The period between the last two pulses in capture timer ticks, or 0 if it is
+ * unknown or stale, because no pulse arrived for longer than the timeout.
+ */
+STATIC uint32_t _osBiCounterPeriodTicks(bapi_E_BiChannel channel, uint32_t tickFrequency) {
+  bapi_bi_CounterCapture capture;
+  bapi_irq_enterCritical();
+  const bool valid = _osBiCounterUpdate(channel, &capture);
+  const uint32_t timeoutUs = g_biCounter[channel].m_timeoutUs;
+  bapi_irq_exitCritical();
+
+  if(!valid || !capture.m_periodTicks) {
+    return 0;
+  }
+  /* Unsigned subtraction handles the wrap around of the capture timer. Without a configured
+   * timeout, the period is stale once at least one pulse is missing. */
+  const uint64_t idleTicks = capture.m_nowTick - capture.m_lastEdgeTick;
+  const uint64_t timeoutTicks = timeoutUs
+    ? (S_CAST(uint64_t, timeoutUs) * tickFrequency) / 1000000U
+    : 2U * S_CAST(uint64_t, capture.m_periodTicks);
+  if(idleTicks > timeoutTicks) {
+    return 0;
+  }
+  return capture.m_periodTicks;
+}
+
+uint32_t osBiCounterPeriodGet(bapi_E_BiChannel channel) {
+  ASSERT(S_CAST(unsigned, channel) < bapi_bi_E_Ch_Count);
+  const uint32_t tickFrequency = bapi_bi_counterTickFrequency();
+  if(!tickFrequency) {
+    return 0;
+  }
+  const uint32_t periodTicks = _osBiCounterPeriodTicks(channel, tickFrequency);
+  return S_CAST(uint32_t, (S_CAST(uint64_t, periodTicks) * 1000000U) / tickFrequency);
+}
+
+uint32_t osBiCounterFrequencyGet(bapi_E_BiChannel channel) {
+  ASSERT(S_CAST(unsigned, channel) < bapi_bi_E_Ch_Count);
+  const uint32_t tickFrequency = bapi_bi_counterTickFrequency();
+  const uint32_t periodTicks = _osBiCounterPeriodTicks(channel, tickFrequency);
+  if(!periodTicks) {
+    return 0;
+  }
+  return S_CAST(uint32_t, (S_CAST(uint64_t, tickFrequency) * 1000U) / periodTicks);
+}
@@ -98,6 +98,21 @@ typedef struct _osBiGroupMembers_ {
 } _osBiGroupMembers;
 typedef struct _osBiGroupMembers_ osBiStateChangeEvents;
 
+/**
+ * \ingroup cmsis_os_ext_bi
+ * \brief A coalesced view of the Binary Inputs of a group, refer to osBiSnapshotGet().
+ *
+ * Zero initialize a snapshot before the first osBiSnapshotGet() call, and pass the same
+ * snapshot to subsequent calls, because the change bits are relative to the previous call.
+ */
+typedef struct _osBiSnapshot_ {
+  uint32_t m_sequence;                                            /**< Sequence number of the shared state the snapshot was taken from. */
+  bitfield_base_t m_biStateChangeBitfield[BITFIELD_ARRAY_SIZE];   /**< Bit field for the BI channels that changed since the previous snapshot. */
+  bitfield_base_t m_biStateBitfield[BITFIELD_ARRAY_SIZE];         /**< Bit field for the state of a BI channel. */
+  uint32_t m_edgeCount[bapi_bi_E_Ch_Count];                       /**< Number of edges per BI channel since group creation (wraps around). */
+  uint32_t m_edgeDelta[bapi_bi_E_Ch_Count];                       /**< Number of edges per BI channel since the previous snapshot. */
+} osBiSnapshot;
+
 /**
  * \ingroup cmsis_os_ext_bi
  * \brief Creates a group of Binary Inputs. State Change Events will be
@@ -137,6 +152,9 @@ C_FUNC osBiGroupId osBiGroupCreate(
  * \note Change State Events will be sent to the mail queue that is associstad
  * with the Binary Input group. This mail queue can be obtained by calling
  * osBiGroupGetMailQ(osBiGroupId biGroup).
+ * \note The state of each Binary Input is seeded from its pin level (bapi_bi_getPinLevel())
+ * when it is attached, so snapshots and mails report the actual levels before the first edge.
+ * Seeding does not count as an edge.
  *
  * \return osOK, if the activation of State Change Event generation for all Binary
  * Inputs was successfully established. osErrorOS if there is at
@@ -232,9 +250,119 @@ C_FUNC bapi_E_BiChannel osBiGetNextStateChange(
    , bapi_E_BiChannel predecessor       /**< [in]  Marks the start for searching the next Binary Input. */
    );
 
+/**
+ * \ingroup cmsis_os_ext_bi
+ * \brief Let the State Change Events of a Binary Input group set thread flags instead
+ * of posting mails.
+ *
+ * Each state change updates a shared state of the group in place and calls
+ * osThreadFlagsSet(thread, flags) from the ISR. No mail is copied. The woken thread
+ * obtains all changes that happened in the meantime at once by osBiSnapshotGet(), so
+ * bursts of edges on fast inputs are coalesced.
+ *
+ * @param thread The thread to notify. NULL switches back to the mail queue.
+ * @param flags  The thread flags to set.
+ */
+C_FUNC osStatus_t osBiGroupNotifySet(osBiGroupId biGroup, osThreadId_t thread, uint32_t flags);
+
+/**
+ * \ingroup cmsis_os_ext_bi
+ * \brief Updates a snapshot with the current state of a Binary Input group, without
+ * locking out the BI interrupt.
+ *
+ * \return true if at least one state change happened since the previous call with this snapshot.
+ */
+C_FUNC bool osBiSnapshotGet(osBiGroupId biGroup, osBiSnapshot* snapshot);
+
+/**
+ * \ingroup cmsis_os_ext_bi
+ * \brief Retrieves the first Binary Input that changed its state within a snapshot.
+ *
+ * \return The Binary Input, or bapi_bi_E_Invalid if there was no state change.
+ */
+C_FUNC bapi_E_BiChannel osBiSnapshotGetFirstStateChange(const osBiSnapshot* snapshot, bool* state);
+
+/**
+ * \ingroup cmsis_os_ext_bi
+ * \brief Retrieves the next Binary Input that changed its state within a snapshot.
+ *
+ * \return The Binary Input that follows the predecessor, or bapi_bi_E_Invalid.
+ */
+C_FUNC bapi_E_BiChannel osBiSnapshotGetNextStateChange(const osBiSnapshot* snapshot, bool* state, bapi_E_BiChannel predecessor);
+
+/**
+ * \ingroup cmsis_os_ext_bi
+ * \brief The number of edges of a Binary Input between the previous and this snapshot.
+ */
+C_INLINE uint32_t osBiSnapshotEdgeCountGet(const osBiSnapshot* snapshot, bapi_E_BiChannel channel) {
+  return snapshot->m_edgeDelta[channel];
+}
+
 C_FUNC uint64_t osBiGetPulseCounter(const osBiStateChangeEvents* stateChangeEvents, bapi_E_BiChannel channel);
 C_FUNC void osResetBiPulseCounter(osBiGroupId biGroup,bapi_E_BiChannel channel);
 C_FUNC void osSetBiPulseCounter(osBiGroupId biGroup,bapi_E_BiChannel channel, uint64_t count);
 
+/**
+ * \ingroup cmsis_os_ext_bi
+ * \brief Starts counting the pulses of a Binary Input with timer capture hardware.
+ *
+ * Unlike osBiGetPulseCounter(), which counts State Change Events of a group, the
+ * hardware counts the pulses without a per edge interrupt, so pulse trains in the
+ * kHz range can be counted. The channel should not be member of an active Binary
+ * Input group while it is counted.
+ *
+ * \return osOK on success, osErrorResource if the board has no capture hardware for
+ *   this channel, osErrorParameter if the channel is invalid.
+ */
+C_FUNC osStatus_t osBiCounterStart(bapi_E_BiChannel channel);
+
+/**
+ * \ingroup cmsis_os_ext_bi
+ * \brief Stops the hardware pulse counter of a Binary Input.
+ */
+C_FUNC void osBiCounterStop(bapi_E_BiChannel channel);
+
+/**
+ * \ingroup cmsis_os_ext_bi
+ * \brief The pulse count of a Binary Input since osBiCounterStart() or osBiCounterSet().
+ *
+ * \note The count must be read at least once per 2^32 pulses.
+ * \return The count, or the last count if the channel is not counted anymore.
+ */
+C_FUNC uint64_t osBiCounterGet(bapi_E_BiChannel channel);
+
+/**
+ * \ingroup cmsis_os_ext_bi
+ * \brief Sets the pulse count of a Binary Input, e.g. to restore a meter reading.
+ */
+C_FUNC void osBiCounterSet(bapi_E_BiChannel channel, uint64_t count);
+
+/**
+ * \ingroup cmsis_os_ext_bi
+ * \brief Sets how long a Binary Input may be without pulses before its period and
+ * frequency are reported as 0.
+ *
+ * @param timeoutUs The timeout in microseconds. 0 (the default) reports 0 once the time
+ *   since the last pulse exceeds twice the last measured period.
+ */
+C_FUNC void osBiCounterTimeoutSet(bapi_E_BiChannel channel, uint32_t timeoutUs);
+
+/**
+ * \ingroup cmsis_os_ext_bi
+ * \brief The period between the last two pulses of a Binary Input in microseconds.
+ *
+ * \return 0 if the period is unknown, or if no pulse arrived within the timeout of
+ *   osBiCounterTimeoutSet(), e.g. because the pulses stopped.
+ */
+C_FUNC uint32_t osBiCounterPeriodGet(bapi_E_BiChannel channel);
+
+/**
+ * \ingroup cmsis_os_ext_bi
+ * \brief The pulse frequency of a Binary Input in mHz, derived from the period between
+ * the last two pulses.
+ *
+ * \return 0 if the period is unknown or stale, refer to osBiCounterPeriodGet().
+ */
+C_FUNC uint32_t osBiCounterFrequencyGet(bapi_E_BiChannel channel);
 
 #endif /* osIoBi_H_ */
@@ -351,6 +351,160 @@ class ComFdInitializer {
 
 ComFdInitializer ComFdInitializer::instance;
 
+
+#if OS_COM_ENABLE_USB_STREAM
+
+/**
+ * \ingroup _cmsis_os_ext_com
+ * \brief A file descriptor on a USB device stream.
+ */
+struct com_usb_binding {
+  struct driver_usbd_stream* m_stream;
+  driver_usbd_stream_callback_t m_chainedCallback;  /**< The callback the stream had before. */
+  struct driver_usbd_stream_buffer* m_rxCurrent;    /**< The received buffer that is partially read. */
+  osThreadId_t volatile m_reader;                   /**< The thread that waits for received data. */
+  int8_t m_isReading;
+  int8_t m_fd;
+
+  inline com_usb_binding()
+    : m_stream(0)
+    , m_chainedCallback(0)
+    , m_rxCurrent(0)
+    , m_reader(0)
+    , m_isReading(0)
+    , m_fd(DEV_FD_INVALID)
+  {
+  }
+};
+
+STATIC struct com_usb_binding _comUsbBindings[OS_COM_USB_STREAM_COUNT];
+
+/**
+ *\brief
+ * Retrieve the USB stream binding for a file descriptor
+ *
+ * \return The binding, or 0 if the file descriptor is not associated with a USB stream.
+ */
+STATIC struct com_usb_binding* _osComFd2UsbStream(int fd) {
+  if(fd < 0) {
+    return 0;
+  }
+  for(size_t i = 0; i < OS_COM_USB_STREAM_COUNT; i++) {
+    if(_comUsbBindings[i].m_fd == fd) {
+      return &_comUsbBindings[i];
+    }
+  }
+  return 0;
+}
+
+/**
+ * \ingroup _cmsis_os_ext_com
+ * \brief The stream callback. Wakes the reader, runs in the USB ISR context.
+ */
+STATIC void _osComUsbOnStreamEvent(struct driver_usbd_stream* stream, uint32_t events) {
+  for(size_t i = 0; i < OS_COM_USB_STREAM_COUNT; i++) {
+    struct com_usb_binding* usb = &_comUsbBindings[i];
+    if(usb->m_stream == stream) {
+      osThreadId_t reader = usb->m_reader;
+      if((events & DRIVER_USBD_STREAM_EVENT_RX_READY) && reader) {
+        osThreadFlagsSet(reader, OS_COM_USB_STREAM_RX_FLAG);
+      }
+      if(usb->m_chainedCallback) {
+        usb->m_chainedCallback(stream, events);
+      }
+      return;
+    }
+  }
+}
+
+int32_t osComUsbStreamInitialize(struct driver_usbd_stream* stream, int fd) {
+  if(!stream || (fd < 0) || (fd >= DEV_FD_COUNT)) {
+    return ARM_DRIVER_ERROR_PARAMETER;
+  }
+
+  bapi_irq_enterCritical();
+  /* The file descriptor must be free, and the stream must not be bound twice. Checked
+   * within the critical section, so two concurrent calls cannot both succeed. */
+  if(_osComFd2UsbStream(fd) || (_osComFd2Usart(fd) != bapi_E_UartCount)) {
+    bapi_irq_exitCritical();
+    return ARM_DRIVER_ERROR_PARAMETER;
+  }
+  for(size_t i = 0; i < OS_COM_USB_STREAM_COUNT; i++) {
+    if((_comUsbBindings[i].m_fd != DEV_FD_INVALID) && (_comUsbBindings[i].m_stream == stream)) {
+      bapi_irq_exitCritical();
+      return ARM_DRIVER_ERROR_PARAMETER;
+    }
+  }
+  for(size_t i = 0; i < OS_COM_USB_STREAM_COUNT; i++) {
+    struct com_usb_binding* usb = &_comUsbBindings[i];
+    if(usb->m_fd == DEV_FD_INVALID) {
+      usb->m_stream = stream;
+      usb->m_chainedCallback = stream->callback;
+      usb->m_rxCurrent = 0;
+      usb->m_reader = 0;
+      usb->m_isReading = 0;
+      stream->callback = _osComUsbOnStreamEvent;
+      /* Finally set the file descriptor in one shot. */
+      usb->m_fd = S_CAST(int8_t, fd);
+      bapi_irq_exitCritical();
+      return ARM_DRIVER_OK;
+    }
+  }
+  bapi_irq_exitCritical();
+
+  /* All bindings are in use, increase OS_COM_USB_STREAM_COUNT. */
+  return ARM_DRIVER_ERROR;
+}
+
+int32_t osComUsbStreamUninitialize(int fd) {
+  struct com_usb_binding* usb = _osComFd2UsbStream(fd);
+  if(!usb) {
+    return ARM_DRIVER_ERROR_PARAMETER;
+  }
+
+  bapi_irq_enterCritical();
+  if(usb->m_isReading) {
+    bapi_irq_exitCritical();
+    return ARM_DRIVER_ERROR_BUSY;
+  }
+  usb->m_fd = DEV_FD_INVALID;
+  usb->m_stream->callback = usb->m_chainedCallback;
+  bapi_irq_exitCritical();
+
+  if(usb->m_rxCurrent) {
+    driver_usbd_stream_rxRelease(usb->m_stream, usb->m_rxCurrent);
+    usb->m_rxCurrent = 0;
+  }
+  usb->m_stream = 0;
+  return ARM_DRIVER_OK;
+}
+
+/**
+ * \ingroup _cmsis_os_ext_com
+ * \brief Copy into as many free transmit buffers of the stream as needed and submit them.
+ */
+STATIC int _osComUsbWrite(struct com_usb_binding* usb, const char *ptr, int len) {
+  int written = 0;
+  while(written < len) {
+    struct driver_usbd_stream_buffer* buffer = driver_usbd_stream_txAlloc(usb->m_stream);
+    if(!buffer) {
+      break;
+    }
+    const uint32_t count = MIN(S_CAST(uint32_t, len - written), buffer->size);
+    MEMCPY(buffer->data, &ptr[written], count);
+    buffer->len = count;
+    if(driver_usbd_stream_txSubmit(usb->m_stream, buffer) != ARM_DRIVER_OK) {
+      return written > 0 ? written : ARM_DRIVER_ERROR;
+    }
+    written += S_CAST(int, count);
+  }
+
+  /* Like a full send queue of a UART. */
+  return (written > 0 || len == 0) ? written : ARM_DRIVER_ERROR_BUSY;
+}
+
+#endif /* #if OS_COM_ENABLE_USB_STREAM */
+
 ///**
 // * \ingroup _cmsis_os_ext_com
 // * \Test if a file descriptor is in use.
@@ -615,6 +769,20 @@ int osComWrite(int fd, const char *ptr, int len)
   {
   int retval = ARM_DRIVER_ERROR_PARAMETER;
 
+#if OS_COM_ENABLE_USB_STREAM
+  {
+    struct com_usb_binding* usb = _osComFd2UsbStream(fd);
+    if (usb) {
+#if OS_COM_ENABLE_WRITE_WITH_FEEDBACK
+      if (callback) {
+        return ARM_DRIVER_ERROR_UNSUPPORTED;
+      }
+#endif
+      return _osComUsbWrite(usb, ptr, len);
+    }
+  }
+#endif /* #if OS_COM_ENABLE_USB_STREAM */
+
   if (fd < DEV_FD_COUNT && fd >= 0) {
 
     bapi_E_UartIndex uartIndex = _osComFd2Usart(fd);
@@ -661,7 +829,77 @@ template<> MsecType getOsBlockTime<osWaitForever>(MsecType msecBlockTime) {
   return msecBlockTime;
 }
 
+#if OS_COM_ENABLE_USB_STREAM
+
+/**
+ * \ingroup _cmsis_os_ext_com
+ * \brief Copy from the received buffers of the stream. Returns what the oldest
+ * received buffer holds, up to len bytes, or waits for the next one.
+ */
+STATIC int _osComUsbRead(struct com_usb_binding* usb, char *ptr, int len, MsecType msecBlockTime, bool flushFirst) {
+  bapi_irq_enterCritical();
+  if(usb->m_isReading) {
+    bapi_irq_exitCritical();
+    return ARM_DRIVER_ERROR_BUSY;
+  }
+  ++usb->m_isReading;
+  bapi_irq_exitCritical();
+
+  struct driver_usbd_stream* stream = usb->m_stream;
+
+  if(flushFirst) {
+    if(usb->m_rxCurrent) {
+      driver_usbd_stream_rxRelease(stream, usb->m_rxCurrent);
+      usb->m_rxCurrent = 0;
+    }
+    struct driver_usbd_stream_buffer* buffer;
+    while((buffer = driver_usbd_stream_rxGet(stream)) != 0) {
+      driver_usbd_stream_rxRelease(stream, buffer);
+    }
+  }
+
+  if(!usb->m_rxCurrent) {
+    usb->m_rxCurrent = driver_usbd_stream_rxGet(stream);
+    if(!usb->m_rxCurrent && msecBlockTime > 0) {
+      /* Register as reader first and look again, so a buffer that arrives in between is not missed. */
+      osThreadFlagsClear(OS_COM_USB_STREAM_RX_FLAG);
+      usb->m_reader = osThreadGetId();
+      usb->m_rxCurrent = driver_usbd_stream_rxGet(stream);
+      if(!usb->m_rxCurrent) {
+        osThreadFlagsWait(OS_COM_USB_STREAM_RX_FLAG, osFlagsWaitAny, getOsBlockTime<osComWaitForever>(msecBlockTime));
+        usb->m_rxCurrent = driver_usbd_stream_rxGet(stream);
+      }
+      usb->m_reader = 0;
+    }
+  }
+
+  int retval = 0;
+  struct driver_usbd_stream_buffer* buffer = usb->m_rxCurrent;
+  if(buffer && len > 0) {
+    const uint32_t count = MIN(S_CAST(uint32_t, len), buffer->len - buffer->offset);
+    MEMCPY(ptr, &buffer->data[buffer->offset], count);
+    buffer->offset += count;
+    if(buffer->offset >= buffer->len) {
+      usb->m_rxCurrent = 0;
+      driver_usbd_stream_rxRelease(stream, buffer);
+    }
+    retval = S_CAST(int, count);
+  }
+
+  atomic_Add(&usb->m_isReading, -1);
+  return retval;
+}
+
+#endif /* #if OS_COM_ENABLE_USB_STREAM */
+
 int osComRead(int fd, char *ptr, int len, MsecType msecBlockTime, bool flushFirst) {
+#if OS_COM_ENABLE_USB_STREAM
+  struct com_usb_binding* usb = _osComFd2UsbStream(fd);
+  if (usb) {
+    return _osComUsbRead(usb, ptr, len, msecBlockTime, flushFirst);
+  }
+#endif /* #if OS_COM_ENABLE_USB_STREAM */
+
   bapi_E_UartIndex uartIndex = _osComFd2Usart(fd);
 
   if (uartIndex < bapi_E_UartCount) {
@@ -22,6 +22,25 @@
 /* Compile time option */
 #define OS_COM_ENABLE_WRITE_WITH_FEEDBACK 1
 
+/* Compile time option: file descriptors on USB device streams, refer to osComUsbStreamInitialize(). Requires an RTOS. */
+#ifndef OS_COM_ENABLE_USB_STREAM
+  #define OS_COM_ENABLE_USB_STREAM 0
+#endif
+
+#if OS_COM_ENABLE_USB_STREAM
+  #include "cmsis-driver/Driver_USBD_Stream.h"
+
+  /* The number of USB device streams that can be assigned file descriptors. */
+  #ifndef OS_COM_USB_STREAM_COUNT
+    #define OS_COM_USB_STREAM_COUNT 1
+  #endif
+
+  /* The thread flag that wakes a thread that blocks in osComRead() on a USB stream. */
+  #ifndef OS_COM_USB_STREAM_RX_FLAG
+    #define OS_COM_USB_STREAM_RX_FLAG (1UL << 30)
+  #endif
+#endif
+
 /**
  * \file
  * This file defines the ARM CMSIS RTOS COM Extension API.
@@ -179,6 +198,44 @@ C_FUNC int32_t osComUsartUninitialize(
   bapi_E_UartIndex uartIndex /**< The UART to be uninitialized */
   );
 
+#if OS_COM_ENABLE_USB_STREAM
+
+/**
+ * \ingroup cmsis_os_ext_com
+ * \brief
+ * Assign a file descriptor to a USB device stream, e.g. the data endpoints of a CDC
+ * service port. osComRead() and osComWrite() then copy directly from the received
+ * endpoint buffers and into the transmit endpoint buffers of the stream, there is no
+ * message allocation and no queue in between. Applications that can work on the
+ * endpoint buffers themselves use the driver_usbd_stream_rx* and _tx* functions instead.
+ *
+ * The stream must be initialized by driver_usbd_stream_init() and own its buffers.
+ * Its callback is chained, i.e. still invoked.
+ *
+ * \note osComWriteWithFeedback() with a callback is not supported on USB streams.
+ *
+ * @return Either \code ARM_DRIVER_OK \endcode or any ARM_DRIVER_ERROR_* code.
+ *   ARM_DRIVER_ERROR_PARAMETER if the file descriptor is already bound to a USART or
+ *   a USB stream, or if the stream is already bound to another file descriptor.
+ */
+C_FUNC int32_t osComUsbStreamInitialize(
+  struct driver_usbd_stream* stream /**< The stream. */
+  ,int fd                            /**< The file descriptor that shall be associated with the stream. */
+  );
+
+/**
+ * \ingroup cmsis_os_ext_com
+ * \brief
+ * Release the file descriptor of a USB device stream. The stream itself keeps running.
+ *
+ * @return Either \code ARM_DRIVER_OK \endcode or any ARM_DRIVER_ERROR_* code.
+ */
+C_FUNC int32_t osComUsbStreamUninitialize(
+  int fd /**< The file descriptor of the stream. */
+  );
+
+#endif /* #if OS_COM_ENABLE_USB_STREAM */
+
 /**
  * \ingroup cmsis_os_ext_com
  * \brief
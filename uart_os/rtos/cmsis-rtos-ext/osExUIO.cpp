@@ -19,6 +19,9 @@
 #include "osExUIO.h"
 #include "rtos/c++/osMailQueue.hpp"
 #include "cmsis_os2.h"
+#include "boards/board-api/bapi_uio_scan.h"
+#include "boards/board-api/bapi_irq.h"
+#include "boards/board-api/bapi_atomic.h"
 
 #if defined (FS_IMXRTEVAL)
 #include "bapi_io_smbio_FS_IMXRTEVAL.h"
@@ -31,43 +34,87 @@
 #endif
 
 osMutexId_t uioCongigMutex;
+/* Writer lock of the value cache (scan buffers and AI filters). The readers of the
+ * cache don't lock. SPI accesses are serialized per bus by uioBusMutex. */
 osMutexId_t uioMutex;
 
+#ifndef UIO_SPI_BUS_LOCK_COUNT
+#define UIO_SPI_BUS_LOCK_COUNT  4
+#endif
+static osMutexId_t uioBusMutex[UIO_SPI_BUS_LOCK_COUNT];
+
+/* UIO scan engine.
+ * osExUioScan() reads all channels into the back buffer and publishes it by switching
+ * the front buffer index. The readers don't lock, they read the front buffer and retry
+ * if a scan published meanwhile (sequence changed). The scan never writes the front buffer.
+ * AO values are queued and written by the next scan. */
+struct UioScanBuffer
+{
+    uint16_t aiRawValue[UIO_CHANNEL_TOTAL];
+    bool biState[UIO_CHANNEL_TOTAL];
+    uint8_t liveStatus[4];
+};
+
+static volatile UioScanBuffer UioScanBuffers[2];
+static volatile uint32_t UioScanSequence = 0;   /* Incremented on every publish, the front buffer is sequence & 1. */
+static volatile bool UioScanActive = false;
+
+static uint32_t UioAoPendingValue[UIO_CHANNEL_TOTAL];
+static volatile uint32_t UioAoPendingMask = 0;
+
+static_assert(UIO_CHANNEL_TOTAL <= 32, "UioAoPendingMask has a bit per channel");
+
 
 #define UIO_AI_SAMPLE_BATCH_NUM  5 
 bool notFirstReadUIOAI[TOTALUIOCHANEL] = {0};
-typedef struct osUioAiSampleBatch 
-{  
-    uint8_t     m_sampleIndex;  
-    uint8_t    m_sampleCount;  
-    uint16_t  m_sampleBatch[UIO_AI_SAMPLE_BATCH_NUM]; 
-} osUioAiSampleBatch_t; 
 
-osUioAiSampleBatch_t UioAiSampleBatch[UIO_CHANNEL_TOTAL];
+/* Per channel AI filter. A channel that was never configured by osExUioConfigAiFilter()
+ * uses a moving average over UIO_AI_SAMPLE_BATCH_NUM samples. */
+struct sample_filter UioAiFilter[UIO_CHANNEL_TOTAL];
+bool UioAiFilterConfigured[UIO_CHANNEL_TOTAL] = {0};
+
+static void osExUioAiFilterReset(uint8_t uioPinIndex)
+{
+    if(UioAiFilterConfigured[uioPinIndex])
+    {
+        sample_filter_init(&UioAiFilter[uioPinIndex]
+          , S_CAST(enum sample_filter_E_Type, UioAiFilter[uioPinIndex].type)
+          , UioAiFilter[uioPinIndex].param);
+    }
+    else
+    {
+        sample_filter_init(&UioAiFilter[uioPinIndex], sample_filter_E_MovingAverage, UIO_AI_SAMPLE_BATCH_NUM);
+        UioAiFilterConfigured[uioPinIndex] = true;
+    }
+}
 
 uint16_t osExUioAiAverage(uint8_t uioPinIndex, uint16_t val)  
 {   
-    uint32_t sum = 0;
-    UioAiSampleBatch[uioPinIndex].m_sampleBatch[UioAiSampleBatch[uioPinIndex].m_sampleIndex] = val; 
-    ++UioAiSampleBatch[uioPinIndex].m_sampleIndex;  
-    ++UioAiSampleBatch[uioPinIndex].m_sampleCount; 
-
-    if( UioAiSampleBatch[uioPinIndex].m_sampleIndex >= UIO_AI_SAMPLE_BATCH_NUM )  
-    {      
-    	UioAiSampleBatch[uioPinIndex].m_sampleIndex = 0;  
-    }  
-	
-    if( UioAiSampleBatch[uioPinIndex].m_sampleCount > UIO_AI_SAMPLE_BATCH_NUM)  
-    {      
-    	UioAiSampleBatch[uioPinIndex].m_sampleCount = UIO_AI_SAMPLE_BATCH_NUM;  
-    }  
-	
-    for(int i = 0; i<UioAiSampleBatch[uioPinIndex].m_sampleCount; i++)  
-    {      
-    	sum += UioAiSampleBatch[uioPinIndex].m_sampleBatch[i];  
+    if(!UioAiFilterConfigured[uioPinIndex])
+    {
+        osExUioAiFilterReset(uioPinIndex);
     }
+    sample_filter_update(&UioAiFilter[uioPinIndex], val);
+    return sample_filter_output(&UioAiFilter[uioPinIndex]);
+}
 
-    return sum/UioAiSampleBatch[uioPinIndex].m_sampleCount; 
+bool osExUioConfigAiFilter(uint8_t uioPinIndex, enum sample_filter_E_Type type, uint8_t param)
+{
+    if(uioPinIndex >= UIO_CHANNEL_TOTAL)
+    {
+        return false;
+    }
+    /* Validate first, an invalid type or param keeps the current filter */
+    struct sample_filter filter;
+    if(!sample_filter_init(&filter, type, param))
+    {
+        return false;
+    }
+    osMutexAcquire(uioMutex, osWaitForever);
+    UioAiFilter[uioPinIndex] = filter;
+    UioAiFilterConfigured[uioPinIndex] = true;
+    osMutexRelease(uioMutex);
+    return true;
 }
 
 
@@ -77,42 +124,208 @@ void osExUioMutexCreat(void)
 	osMutexAttr_t mutexDef2 = {"ExUioValueMutex", osMutexRecursive, NULL, 0};
 	uioMutex = osMutexNew(&mutexDef2);
 
+	for(uint8_t i = 0; i < UIO_SPI_BUS_LOCK_COUNT; i++)
+	{
+		osMutexAttr_t busMutexDef = {"ExUioBusMutex", osMutexRecursive, NULL, 0};
+		uioBusMutex[i] = osMutexNew(&busMutexDef);
+	}
+}
+
+/* Buses beyond UIO_SPI_BUS_LOCK_COUNT and channels with unknown bus share the first lock. */
+static osMutexId_t osExUioBusMutex(int spiBusIndex)
+{
+    if(spiBusIndex < 0 || spiBusIndex >= UIO_SPI_BUS_LOCK_COUNT)
+    {
+        spiBusIndex = 0;
+    }
+    return uioBusMutex[spiBusIndex];
+}
+
+static osMutexId_t osExUioChannelMutex(uint8_t uioPinIndex)
+{
+    /* Don't ask the board for the bus of a channel it does not have. */
+    if(uioPinIndex >= UIO_CHANNEL_TOTAL)
+    {
+        return osExUioBusMutex(-1);
+    }
+    return osExUioBusMutex(bapi_uio_getChannelBus(uioPinIndex));
+}
+
+/* For board functions that access the devices of all buses. Always locked in
+ * ascending order, so it does not deadlock with another thread doing the same. */
+static void osExUioAllBusesLock(void)
+{
+    for(uint8_t i = 0; i < UIO_SPI_BUS_LOCK_COUNT; i++)
+    {
+        osMutexAcquire(uioBusMutex[i], osWaitForever);
+    }
+}
+
+static void osExUioAllBusesUnlock(void)
+{
+    for(uint8_t i = UIO_SPI_BUS_LOCK_COUNT; i > 0; i--)
+    {
+        osMutexRelease(uioBusMutex[i - 1]);
+    }
 }
 
 
 bool osExUioCongigAiChanel(uint8_t uioPinIndex,IO_PIN_TYPE_t pintype)
 {
-    bapi_io_uio_configure(pintype,uioPinIndex);
-	UioAiSampleBatch[uioPinIndex].m_sampleCount = 0;
-	UioAiSampleBatch[uioPinIndex].m_sampleIndex = 0;
-	memset(&UioAiSampleBatch[uioPinIndex].m_sampleBatch[0],0,UIO_AI_SAMPLE_BATCH_NUM);
+    osMutexId_t busMutex = osExUioChannelMutex(uioPinIndex);
+	osMutexAcquire(busMutex, osWaitForever);
+    const bool retvalue = bapi_io_uio_configure(pintype,uioPinIndex);
+	osMutexRelease(busMutex);
+
+	osMutexAcquire(uioMutex, osWaitForever);
+	osExUioAiFilterReset(uioPinIndex);
 	notFirstReadUIOAI[uioPinIndex] = false;
+	osMutexRelease(uioMutex);
+	return retvalue;
+}
+
+bool osExUioConfigChanel(uint8_t uioPinIndex,IO_PIN_TYPE_t pintype)
+{
+    osMutexId_t busMutex = osExUioChannelMutex(uioPinIndex);
+	osMutexAcquire(busMutex, osWaitForever);
+    const bool retvalue = bapi_io_uio_configure(pintype,uioPinIndex);
+	osMutexRelease(busMutex);
+	return retvalue;
 }
 
 bool osExUioCongigBiChanel(uint8_t uioPinIndex,IO_PIN_TYPE_t pintype)
 {
-	return (bapi_io_uio_configure(pintype,uioPinIndex));
+	return osExUioConfigChanel(uioPinIndex, pintype);
 }
 
 bool osExUioCongigAoChanel(uint8_t uioPinIndex,IO_PIN_TYPE_t pintype)
 {
-	bapi_io_uio_configure(pintype,uioPinIndex);
+	return osExUioConfigChanel(uioPinIndex, pintype);
 }
 
-bool osExUioConfigChanel(uint8_t uioPinIndex,IO_PIN_TYPE_t pintype)
+
+static void osExUioScanFlushAo(void)
+{
+    uint32_t values[UIO_CHANNEL_TOTAL];
+    bapi_irq_enterCritical();
+    const uint32_t mask = atomic_Uint32Replace(&UioAoPendingMask, 0);
+    for(uint8_t i = 0; i < UIO_CHANNEL_TOTAL; i++)
+    {
+        values[i] = UioAoPendingValue[i];
+    }
+    bapi_irq_exitCritical();
+
+    if(!mask)
+    {
+        return;
+    }
+    osExUioAllBusesLock();
+    const bool written = bapi_uio_writeAOValues(values, mask);
+    osExUioAllBusesUnlock();
+    if(written)
+    {
+        return;
+    }
+    for(uint8_t i = 0; i < UIO_CHANNEL_TOTAL; i++)
+    {
+        if(mask & (1UL << i))
+        {
+            osMutexId_t busMutex = osExUioChannelMutex(i);
+            osMutexAcquire(busMutex, osWaitForever);
+            bapi_io_uio_setValue(i, values[i]);
+            osMutexRelease(busMutex);
+        }
+    }
+}
+
+void osExUioScan(void)
+{
+    osMutexAcquire(uioMutex, osWaitForever);
+
+    osExUioScanFlushAo();
+
+    UioScanBuffer scan;
+    osExUioAllBusesLock();
+    const bool scanned = bapi_uio_scanChannels(scan.aiRawValue, scan.biState, UIO_CHANNEL_TOTAL);
+    osExUioAllBusesUnlock();
+    if(!scanned)
+    {
+        for(uint8_t i = 0; i < UIO_CHANNEL_TOTAL; i++)
+        {
+            osMutexId_t busMutex = osExUioChannelMutex(i);
+            osMutexAcquire(busMutex, osWaitForever);
+            const UioValue value = bapi_io_uio_getValue(i);
+            osMutexRelease(busMutex);
+            scan.aiRawValue[i] = value.aiRawValue;
+            scan.biState[i] = value.biState;
+        }
+    }
+    osMutexId_t busMutex = osExUioBusMutex(SPI_BUS_UIO_1);
+    osMutexAcquire(busMutex, osWaitForever);
+    bapi_uio_read_LIVE_Status(SPI_BUS_UIO_1, SPI_DEV_UIO_1, scan.liveStatus);
+    osMutexRelease(busMutex);
+
+    /* The readers of the front buffer are not disturbed by the copy. */
+    volatile UioScanBuffer& back = UioScanBuffers[(UioScanSequence + 1) & 1];
+    for(uint8_t i = 0; i < UIO_CHANNEL_TOTAL; i++)
+    {
+        back.aiRawValue[i] = scan.aiRawValue[i];
+        back.biState[i] = scan.biState[i];
+    }
+    for(uint8_t i = 0; i < sizeof(scan.liveStatus); i++)
+    {
+        back.liveStatus[i] = scan.liveStatus[i];
+    }
+    UioScanSequence = UioScanSequence + 1;
+    UioScanActive = true;
+
+    osMutexRelease(uioMutex);
+}
+
+void osExUioScanStop(void)
+{
+    osMutexAcquire(uioMutex, osWaitForever);
+    UioScanActive = false;
+    osExUioScanFlushAo();
+    osMutexRelease(uioMutex);
+}
+
+bool osExUioScanIsActive(void)
 {
-	bapi_io_uio_configure(pintype,uioPinIndex);
+    return UioScanActive;
 }
 
+/* Copy a value of the front buffer. Retries if a scan published while copying,
+ * because the next scan writes the buffer that was front before. */
+#define UIO_SCAN_READ(dst, member) \
+    do { \
+        uint32_t seq; \
+        do { \
+            seq = UioScanSequence; \
+            (dst) = UioScanBuffers[seq & 1].member; \
+        } while(seq != UioScanSequence); \
+    } while(0)
 
 uint16_t osExUioGetAIValue(uint8_t uioPinIndex)
 {
+    if(UioScanActive)
+    {
+        if(uioPinIndex >= UIO_CHANNEL_TOTAL)
+        {
+            return 0;
+        }
+        uint16_t value;
+        UIO_SCAN_READ(value, aiRawValue[uioPinIndex]);
+        return value;
+    }
+
     UioValue retvalue;
-	osMutexAcquire(uioMutex, osWaitForever);
+    osMutexId_t busMutex = osExUioChannelMutex(uioPinIndex);
+	osMutexAcquire(busMutex, osWaitForever);
 
     retvalue = bapi_io_uio_getValue(uioPinIndex);
 	
-	osMutexRelease(uioMutex);
+	osMutexRelease(busMutex);
 //	if(!notFirstReadUIOAI[uioPinIndex])
 //	{
 		return retvalue.aiRawValue;
@@ -125,12 +338,24 @@ uint16_t osExUioGetAIValue(uint8_t uioPinIndex)
 
 bool osExUioGetBIValue(uint8_t uioPinIndex)
 {
+    if(UioScanActive)
+    {
+        if(uioPinIndex >= UIO_CHANNEL_TOTAL)
+        {
+            return false;
+        }
+        bool value;
+        UIO_SCAN_READ(value, biState[uioPinIndex]);
+        return value;
+    }
+
     UioValue retvalue;
-	osMutexAcquire(uioMutex, osWaitForever);
+    osMutexId_t busMutex = osExUioChannelMutex(uioPinIndex);
+	osMutexAcquire(busMutex, osWaitForever);
 
     retvalue = bapi_io_uio_getValue(uioPinIndex);
 	
-	osMutexRelease(uioMutex);
+	osMutexRelease(busMutex);
 	
 	return retvalue.biState;
 }
@@ -140,12 +365,33 @@ bool osExUioGetBIValue(uint8_t uioPinIndex)
  * */
 uint8_t osExUioGet4BIValueinOneUIO(spi_bus_idx_t uio_SPIbusIndex,spi_dev_idx_t uio_deviceIndex)
 {
+    const int firstChannel = bapi_uio_getFirstChannel(uio_SPIbusIndex, uio_deviceIndex);
+    if(UioScanActive && firstChannel >= 0 && firstChannel + 4 <= UIO_CHANNEL_TOTAL)
+    {
+        uint8_t bits;
+        uint32_t seq;
+        do {
+            seq = UioScanSequence;
+            const volatile UioScanBuffer& front = UioScanBuffers[seq & 1];
+            bits = 0;
+            for(uint8_t i = 0; i < 4; i++)
+            {
+                if(front.biState[firstChannel + i])
+                {
+                    bits |= S_CAST(uint8_t, 1U << i);
+                }
+            }
+        } while(seq != UioScanSequence);
+        return bits;
+    }
+
     uint8_t retvalue;
-	osMutexAcquire(uioMutex, osWaitForever);
+    osMutexId_t busMutex = osExUioBusMutex(uio_SPIbusIndex);
+	osMutexAcquire(busMutex, osWaitForever);
 
 //    retvalue = bapi_io_uio_getBIValues(SPI_BUS_UIO_1,SPI_DEV_UIO_1);
 	retvalue = bapi_io_uio_getBIValues(uio_SPIbusIndex,uio_deviceIndex);
-	osMutexRelease(uioMutex);
+	osMutexRelease(busMutex);
 	
 	return retvalue;
 }
@@ -154,12 +400,26 @@ uint8_t osExUioGet4BIValueinOneUIO(spi_bus_idx_t uio_SPIbusIndex,spi_dev_idx_t u
 
 bool osExUioSetAOValue(uint8_t uioPinIndex,uint32_t value)
 {
+    if(UioScanActive)
+    {
+        if(uioPinIndex >= UIO_CHANNEL_TOTAL)
+        {
+            return false;
+        }
+        bapi_irq_enterCritical();
+        UioAoPendingValue[uioPinIndex] = value;
+        atomic_Uint32bitwiseOR(&UioAoPendingMask, 1UL << uioPinIndex);
+        bapi_irq_exitCritical();
+        return true;
+    }
+
     bool retvalue;
-	osMutexAcquire(uioMutex, osWaitForever);
+    osMutexId_t busMutex = osExUioChannelMutex(uioPinIndex);
+	osMutexAcquire(busMutex, osWaitForever);
 
     retvalue = bapi_io_uio_setValue(uioPinIndex,value);
 	
-	osMutexRelease(uioMutex);
+	osMutexRelease(busMutex);
 	
 	return retvalue;
 }
@@ -169,11 +429,17 @@ uint8_t osExUioGetAlertStatus(void)
 {
     uint8_t retvalue;
 	uint8_t liveStatus[4] = {0};
-	osMutexAcquire(uioMutex, osWaitForever);
+    if(UioScanActive)
+    {
+        UIO_SCAN_READ(retvalue, liveStatus[2]);
+        return retvalue & 0x0f;
+    }
+    osMutexId_t busMutex = osExUioBusMutex(SPI_BUS_UIO_1);
+	osMutexAcquire(busMutex, osWaitForever);
 
     bapi_uio_read_LIVE_Status(SPI_BUS_UIO_1, SPI_DEV_UIO_1,liveStatus);
 	
-	osMutexRelease(uioMutex);
+	osMutexRelease(busMutex);
 	retvalue = liveStatus[2]&0x0f;
 	return retvalue;
 }
@@ -21,7 +21,11 @@
 
 #include "boards/board-api/bapi_io.h"
 #include "rtos/cmsis-rtos/cmsis_os_redirect.h"
+#include "utils/sample_filter.h"
 
+/* Creates the value cache lock and one lock per SPI bus (UIO_SPI_BUS_LOCK_COUNT, default 4).
+ * UIO devices on different buses are accessed in parallel, the bus of a channel is
+ * given by bapi_uio_getChannelBus(). */
 void osExUioMutexCreat(void);
 uint16_t osExUioGetAIValue(uint8_t uioPinIndex);
 bool osExUioGetBIValue(uint8_t uioPinIndex);
@@ -35,6 +39,25 @@ bool osExUioConfigChanel(uint8_t uioPinIndex,IO_PIN_TYPE_t pintype);
 uint8_t osExUioGet4BIValueinOneUIO(spi_bus_idx_t uio_SPIbusIndex,spi_dev_idx_t uio_deviceIndex);
 uint8_t osExUioGetAlertStatus(void);
 
+/* UIO scan engine. Call osExUioScan() cyclically from one thread. It reads all UIO
+ * channels in one burst per device (bapi_uio_scanChannels(), channel by channel if the
+ * board has no burst access) and writes the queued AO values.
+ * After the first scan, osExUioGetAIValue(), osExUioGetBIValue(), osExUioGet4BIValueinOneUIO()
+ * and osExUioGetAlertStatus() return the values of the last scan without locking or SPI access,
+ * and osExUioSetAOValue() queues the value for the next scan. Channels beyond UIO_CHANNEL_TOTAL
+ * read as 0 (AI) or false (BI) while scanning.
+ * osExUioScanStop() writes the queued AO values and returns to direct access. */
+void osExUioScan(void);
+void osExUioScanStop(void);
+bool osExUioScanIsActive(void);
+
+/* Select the filter of an AI channel, refer to sample_filter_init() for the parameter.
+ * The filter is applied by osExUioAiAverage(). The default is a moving average over
+ * UIO_AI_SAMPLE_BATCH_NUM samples. Returns false and keeps the current filter if the
+ * channel, type or param is invalid. */
+bool osExUioConfigAiFilter(uint8_t uioPinIndex, enum sample_filter_E_Type type, uint8_t param);
+uint16_t osExUioAiAverage(uint8_t uioPinIndex, uint16_t val);
+
 
 /**
  * \file
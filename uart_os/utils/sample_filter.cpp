@@ -0,0 +1,248 @@
+/*
+ * sample_filter.cpp
+ *
+ */
+
+/**
+ * \file
+ * \brief This file implements the incremental input sample filters declared in
+ * sample_filter.h.
+ */
+
+#include "baseplate.h"
+#include "utils.h"
+#include "sample_filter.h"
+
+#include <string.h>
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+  #include "cmsis_compiler.h"
+  #define SAMPLE_FILTER_SIMD_DSP  1
+#elif defined(__SSE2__)
+  #include <emmintrin.h>
+  #define SAMPLE_FILTER_SIMD_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+  #define SAMPLE_FILTER_SIMD_NEON 1
+#endif
+
+
+/**
+ * \brief Number of SIMD iterations after which the 32 bit accumulators must be
+ * folded into the result before they could overflow.
+ */
+enum { SAMPLE_FILTER_SIMD_CHUNK = 0x4000 };
+
+
+/* The median filter keeps a sorted copy of the window. Remove one value from it. */
+C_INLINE void _sample_filter_sortedRemove(struct sample_filter* filter, uint16_t value) {
+  unsigned i = 0;
+  while((i < filter->count) && (filter->sorted[i] != value)) {
+    i++;
+  }
+  ASSERT(i < filter->count);
+  for(; (i + 1) < filter->count; i++) {
+    filter->sorted[i] = filter->sorted[i + 1];
+  }
+  filter->count--;
+}
+
+/* Insert one value into the sorted copy of the window. */
+C_INLINE void _sample_filter_sortedInsert(struct sample_filter* filter, uint16_t value) {
+  unsigned i = filter->count;
+  while((i > 0) && (filter->sorted[i - 1] > value)) {
+    filter->sorted[i] = filter->sorted[i - 1];
+    i--;
+  }
+  filter->sorted[i] = value;
+  filter->count++;
+}
+
+
+bool sample_filter_init(struct sample_filter* filter, enum sample_filter_E_Type type, uint8_t param) {
+  MEMSET(filter, 0, sizeof(*filter));
+
+  bool valid = false;
+  switch(type) {
+  case sample_filter_E_None:
+    valid = true;
+    break;
+  case sample_filter_E_MovingAverage:
+    valid = (param >= 1) && (param <= SAMPLE_FILTER_MAX_WINDOW);
+    break;
+  case sample_filter_E_Exponential:
+    valid = (param < 16);
+    break;
+  case sample_filter_E_Median:
+    valid = (param & 1) && (param < SAMPLE_FILTER_MAX_WINDOW);
+    break;
+  case sample_filter_E_Cic:
+    valid = (param >= 1);
+    /* The gain of a CIC filter is R^N. */
+    filter->state = S_CAST(uint32_t, param) * param;
+    break;
+  }
+
+  if(!valid) {
+    MEMSET(filter, 0, sizeof(*filter));
+    return false;
+  }
+
+  filter->type = S_CAST(uint8_t, type);
+  filter->param = param;
+  return true;
+}
+
+bool sample_filter_update(struct sample_filter* filter, uint16_t sample) {
+  switch(filter->type) {
+
+  case sample_filter_E_MovingAverage:
+    /* Replace the oldest sample in the running sum. */
+    if(filter->count == filter->param) {
+      filter->state -= filter->window[filter->index];
+    } else {
+      filter->count++;
+    }
+    filter->state += sample;
+    filter->window[filter->index] = sample;
+    filter->index = S_CAST(uint8_t, (filter->index + 1) % filter->param);
+    filter->output = S_CAST(uint16_t, filter->state / filter->count);
+    return true;
+
+  case sample_filter_E_Exponential:
+    if(!filter->count) {
+      filter->state = S_CAST(uint32_t, sample) << 8;
+      filter->count = 1;
+    } else {
+      const int32_t delta = (S_CAST(int32_t, sample) << 8) - S_CAST(int32_t, filter->state);
+      filter->state = S_CAST(uint32_t, S_CAST(int32_t, filter->state) + (delta >> filter->param));
+    }
+    filter->output = S_CAST(uint16_t, MIN((filter->state + 0x80) >> 8, 0xffffU));
+    return true;
+
+  case sample_filter_E_Median:
+    if(filter->count == filter->param) {
+      _sample_filter_sortedRemove(filter, filter->window[filter->index]);
+    }
+    _sample_filter_sortedInsert(filter, sample);
+    filter->window[filter->index] = sample;
+    filter->index = S_CAST(uint8_t, (filter->index + 1) % filter->param);
+    filter->output = filter->sorted[filter->count / 2];
+    return true;
+
+  case sample_filter_E_Cic: {
+    /* Integrators run at the input rate. Unsigned wrap around is intended. */
+    uint32_t* integrator = &filter->cic[0];
+    uint32_t* delay = &filter->cic[SAMPLE_FILTER_CIC_ORDER];
+    uint32_t value = sample;
+    for(unsigned n = 0; n < SAMPLE_FILTER_CIC_ORDER; n++) {
+      integrator[n] += value;
+      value = integrator[n];
+    }
+
+    if(++filter->index < filter->param) {
+      return false;
+    }
+    filter->index = 0;
+
+    /* Combs run at the decimated rate. */
+    for(unsigned n = 0; n < SAMPLE_FILTER_CIC_ORDER; n++) {
+      const uint32_t comb = value - delay[n];
+      delay[n] = value;
+      value = comb;
+    }
+    filter->output = S_CAST(uint16_t, value / filter->state);
+    return true;
+  }
+
+  default:
+    filter->output = sample;
+    return true;
+  }
+}
+
+bool sample_filter_updateBatch(struct sample_filter* filter, const uint16_t* samples
+  , unsigned count, unsigned stride) {
+  bool updated = false;
+  for(unsigned i = 0; i < count; i++) {
+    updated |= sample_filter_update(filter, samples[i * stride]);
+  }
+  return updated;
+}
+
+uint32_t sample_filter_sum_u16(const uint16_t* samples, unsigned count, unsigned stride) {
+  uint32_t sum = 0;
+
+  if(stride != 1) {
+    for(unsigned i = 0; i < count; i++) {
+      sum += samples[i * stride];
+    }
+    return sum;
+  }
+
+#if SAMPLE_FILTER_SIMD_DSP
+  /* Align to a word boundary, then add two samples per __SMLAD. __SMLAD takes the
+   * halfwords as signed, so each sample is biased by -0x8000 and corrected afterwards. */
+  if((R_CAST(uintptr_t, samples) & 2) && count) {
+    sum += *samples++;
+    count--;
+  }
+
+  const uint32_t* pairs = R_CAST(const uint32_t*, samples);
+  unsigned pairCount = count / 2;
+  while(pairCount) {
+    const unsigned chunk = MIN(pairCount, S_CAST(unsigned, SAMPLE_FILTER_SIMD_CHUNK));
+    int32_t acc = 0;
+    for(unsigned i = 0; i < chunk; i++) {
+      acc = S_CAST(int32_t, __SMLAD(pairs[i] ^ 0x80008000U, 0x00010001U, S_CAST(uint32_t, acc)));
+    }
+    sum += S_CAST(uint32_t, acc) + chunk * 0x10000U;
+    pairs += chunk;
+    pairCount -= chunk;
+  }
+  samples = R_CAST(const uint16_t*, pairs);
+  count &= 1;
+
+#elif SAMPLE_FILTER_SIMD_SSE2
+  /* Eight samples per iteration. _mm_madd_epi16 takes the lanes as signed, so each
+   * sample is biased by -0x8000 and corrected afterwards. */
+  const __m128i bias = _mm_set1_epi16(S_CAST(short, 0x8000));
+  const __m128i ones = _mm_set1_epi16(1);
+  unsigned blockCount = count / 8;
+  while(blockCount) {
+    const unsigned chunk = MIN(blockCount, S_CAST(unsigned, SAMPLE_FILTER_SIMD_CHUNK));
+    __m128i acc = _mm_setzero_si128();
+    for(unsigned i = 0; i < chunk; i++) {
+      const __m128i v = _mm_xor_si128(_mm_loadu_si128(R_CAST(const __m128i*, samples + 8 * i)), bias);
+      acc = _mm_add_epi32(acc, _mm_madd_epi16(v, ones));
+    }
+    int32_t lanes[4];
+    _mm_storeu_si128(R_CAST(__m128i*, lanes), acc);
+    /* Each lane holds up to +-2^30, their sum needs 64 bit. */
+    sum += S_CAST(uint32_t, S_CAST(int64_t, lanes[0]) + lanes[1] + lanes[2] + lanes[3]) + chunk * 8 * 0x8000U;
+    samples += 8 * chunk;
+    blockCount -= chunk;
+  }
+  count &= 7;
+
+#elif SAMPLE_FILTER_SIMD_NEON
+  /* Eight samples per iteration, pairwise added into four 32 bit lanes. */
+  unsigned blockCount = count / 8;
+  while(blockCount) {
+    const unsigned chunk = MIN(blockCount, S_CAST(unsigned, SAMPLE_FILTER_SIMD_CHUNK));
+    uint32x4_t acc = vdupq_n_u32(0);
+    for(unsigned i = 0; i < chunk; i++) {
+      acc = vpadalq_u16(acc, vld1q_u16(samples + 8 * i));
+    }
+    sum += vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+    samples += 8 * chunk;
+    blockCount -= chunk;
+  }
+  count &= 7;
+#endif
+
+  for(unsigned i = 0; i < count; i++) {
+    sum += samples[i];
+  }
+  return sum;
+}
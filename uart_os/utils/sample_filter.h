@@ -0,0 +1,116 @@
+/*
+ * sample_filter.h
+ *
+ */
+
+#ifndef UTILS_SAMPLE_FILTER_H_
+#define UTILS_SAMPLE_FILTER_H_
+
+#include "baseplate.h"
+#include "utils/utils.h"
+
+/**
+ * \file
+ * \brief
+ * This file declares incremental filters for 16 bit input samples (ADC and UIO
+ * analog inputs). Each input channel owns a struct sample_filter, so the filter
+ * type can be chosen per channel. Updating a filter with a new sample costs
+ * a constant number of operations, independent of the window size.
+ *
+ * Additionally the block functions sample_filter_sum_u16 and sample_filter_average_u16
+ * sum up sample batches with the Cortex-M DSP instructions, or SSE2/NEON on the host.
+ */
+
+/**
+ * \brief The maximum window size of the moving average and median filter.
+ */
+#define SAMPLE_FILTER_MAX_WINDOW 16
+
+/**
+ * \brief The order of the CIC filter. With a decimation ratio up to 255 the
+ * bit growth of 16 bit samples fits into 32 bit integrators.
+ */
+#define SAMPLE_FILTER_CIC_ORDER 2
+
+/**
+ * \brief The available filter types.
+ */
+enum sample_filter_E_Type {
+  sample_filter_E_None = 0,      /**< Pass through, the output is the last sample. */
+  sample_filter_E_MovingAverage, /**< Running sum average over the last param samples. */
+  sample_filter_E_Exponential,   /**< Exponential average with the smoothing factor 2^-param. */
+  sample_filter_E_Median,        /**< Median of the last param samples (param is odd). */
+  sample_filter_E_Cic            /**< 2nd order CIC filter that decimates by param. */
+};
+
+/**
+ * \brief The state of a filter for a single input channel.
+ */
+struct sample_filter {
+  uint8_t  type;      /**< The filter type, refer to \ref sample_filter_E_Type. */
+  uint8_t  param;     /**< Window size, smoothing shift or decimation ratio. */
+  uint8_t  index;     /**< Ring buffer index of the oldest sample or the decimation phase. */
+  uint8_t  count;     /**< Number of samples in the window, saturates at param. */
+  uint16_t output;    /**< The most recent filter output. */
+  uint32_t state;     /**< Running sum, exponential average (Q8) or the CIC decimation gain. */
+  uint32_t cic[2 * SAMPLE_FILTER_CIC_ORDER];     /**< CIC integrators followed by comb delays. */
+  uint16_t window[SAMPLE_FILTER_MAX_WINDOW];     /**< Sample history (ring buffer). */
+  uint16_t sorted[SAMPLE_FILTER_MAX_WINDOW];     /**< The history in sorted order (median only). */
+};
+
+/**
+ * \brief Initialize or reset a filter.
+ *
+ * @param filter The filter to initialize.
+ * @param type   The filter type.
+ * @param param  The filter parameter:
+ *   - sample_filter_E_MovingAverage: window size 1..SAMPLE_FILTER_MAX_WINDOW
+ *   - sample_filter_E_Exponential:   smoothing shift 0..15 (0 passes through)
+ *   - sample_filter_E_Median:        odd window size 1..SAMPLE_FILTER_MAX_WINDOW-1
+ *   - sample_filter_E_Cic:           decimation ratio 1..255
+ * @return true on success. false if param is out of range. The filter is initialized
+ *   as pass through then.
+ */
+C_FUNC bool sample_filter_init(struct sample_filter* filter, enum sample_filter_E_Type type, uint8_t param);
+
+/**
+ * \brief Feed a new sample into a filter.
+ *
+ * @return true if a new output is available. This is always the case except for the
+ *   CIC filter, which provides a new output only every param samples.
+ */
+C_FUNC bool sample_filter_update(struct sample_filter* filter, uint16_t sample);
+
+/**
+ * \brief Feed a batch of samples into a filter.
+ *
+ * @param stride The distance between two subsequent samples, e.g. the member count
+ *   of an interleaved DMA batch.
+ * @return true if at least one new output became available.
+ */
+C_FUNC bool sample_filter_updateBatch(struct sample_filter* filter, const uint16_t* samples
+  , unsigned count, unsigned stride);
+
+/**
+ * \brief The most recent filter output.
+ */
+C_INLINE uint16_t sample_filter_output(const struct sample_filter* filter) {
+  return filter->output;
+}
+
+/**
+ * \brief Sum up count samples which are stride samples apart.
+ *
+ * Contiguous samples (stride 1) are summed up two or eight at a time with SIMD
+ * instructions where available.
+ */
+C_FUNC uint32_t sample_filter_sum_u16(const uint16_t* samples, unsigned count, unsigned stride);
+
+/**
+ * \brief The rounded down average of count contiguous samples. 0 if count is 0.
+ */
+C_INLINE uint16_t sample_filter_average_u16(const uint16_t* samples, unsigned count) {
+  return count ? S_CAST(uint16_t, sample_filter_sum_u16(samples, count, 1) / count) : 0;
+}
+
+#endif /* UTILS_SAMPLE_FILTER_H_ */